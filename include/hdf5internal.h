@@ -97,6 +97,11 @@ typedef struct NC_HDF5_VAR_INFO
     nc_bool_t *dimscale_attached;  /**< Array of flags that are true if dimscale is attached for that dim index. */
     int flags;
 #       define NC_HDF5_VAR_FILTER_MISSING 1 /* if any filter is missing */
+    /* Dataspaces kept between reads; see NC4_get_vars(). */
+    hid_t plan_filespace;        /**< File space of the dataset, 0 if none. */
+    hid_t plan_memspace;         /**< Memory space for plan_count, 0 if none. */
+    hsize_t *plan_count;         /**< Count of the selection in plan_filespace. */
+    hsize_t *plan_stride;        /**< Stride of the selection in plan_filespace. */
 } NC_HDF5_VAR_INFO_T;
 
 /* Struct to hold HDF5-specific info for a field. */
@@ -133,6 +138,9 @@ int nc4_adjust_var_cache(NC_GRP_INFO_T *grp, NC_VAR_INFO_T * var);
 /* Open a HDF5 dataset. */
 int nc4_open_var_grp2(NC_GRP_INFO_T *grp, int varid, hid_t *dataset);
 
+/* Drop the dataspaces kept for a var, e.g. when its extent changes. */
+int nc4_hdf5_clear_plan(NC_HDF5_VAR_INFO_T *hdf5_var);
+
 /* Find types. */
 NC_TYPE_INFO_T *nc4_rec_find_hdf_type(NC_FILE_INFO_T* h5,
                                       hid_t target_hdf_typeid);
@@ -27,6 +27,8 @@ typedef struct NC {
 	void* dispatchdata; /*per-'file' data; points to e.g. NC3_INFO data*/
 	char* path;
 	int   mode; /* as provided to nc_open/nc_create */
+	void* iostats; /* NCiostats*; NULL unless ENABLE_IOSTATS */
+	void* readahead; /* NCreadahead*; NULL unless nc_set_var_readahead() was used */
 } NC;
 
 /*
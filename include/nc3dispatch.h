@@ -172,6 +172,23 @@ extern "C" {
                  const size_t *start, const size_t *count,
                  void *value, nc_type);
 
+    extern int
+    NC3_get_vara_view(int ncid, int varid,
+                      const size_t *start, const size_t *count,
+                      nc_vara_view_t *view);
+
+    extern int
+    NC3_get_var_points(int ncid, int varid, size_t npoints,
+                       const size_t *coords, void *value);
+
+    extern int
+    NC3_get_recs(int ncid, size_t startrec, size_t nrecs,
+                 int nvars, const int *varids, void **data);
+
+    extern int
+    NC3_put_recs(int ncid, size_t startrec, size_t nrecs,
+                 int nvars, const int *varids, const void *const *data);
+
 /* End _var */
 
     extern int NC3_initialize(void);
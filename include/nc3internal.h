@@ -112,6 +112,8 @@ typedef struct {
     size_t nelems;          /* length of the array */
     void *xvalue;           /* the actual data, in external representation */
     /* end xdr */
+    NC3_INFO *lazy;         /* if not NULL, xvalue is still in this file */
+    off_t xoff;             /* file offset of the value, if lazy */
 } NC_attr;
 
 typedef struct NC_attrarray {
@@ -134,6 +136,10 @@ new_x_NC_attr(
     nc_type type,
     size_t nelems);
 
+extern NC_attr *
+new_x_NC_attr_lazy(NC_string *strp, nc_type type, size_t nelems,
+	NC3_INFO *ncp, off_t xoff);
+
 extern NC_attr **
 NC_findattr(const NC_attrarray *ncap, const char *name);
 
@@ -254,8 +260,9 @@ struct NC3_INFO {
     NC_vararray vars;
 };
 
+/* A dataset left with no file by a failed redef is read-only */
 #define NC_readonly(ncp)                        \
-    (!fIsSet((ncp)->nciop->ioflags, NC_WRITE))
+    ((ncp)->nciop == NULL || !fIsSet((ncp)->nciop->ioflags, NC_WRITE))
 
 #define NC_set_readonly(ncp)                    \
     fClr((ncp)->flags, NC_WRITE)
@@ -334,6 +341,9 @@ ncx_put_NC(const NC3_INFO* ncp, void **xpp, off_t offset, size_t extent);
 extern int
 nc_get_NC(NC3_INFO* ncp);
 
+extern int
+NC_load_attrV(NC_attr *attrp);
+
 /* End defined in v1hpg.c */
 /* Begin defined in putget.c */
 
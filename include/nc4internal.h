@@ -208,6 +208,9 @@ typedef struct NC_VAR_INFO
     } chunkcache;
     int quantize_mode;           /**< Quantize mode. NC_NOQUANTIZE is 0, and means no quantization. */
     int nsd;                     /**< Number of significant digits if quantization is used, 0 if not. */
+    int access_hint;             /**< Access-pattern hint; NC_ACCESS_BALANCED if none was given. */
+    size_t *access_shape;        /**< For NC_ACCESS_SHAPE, the expected read shape (size ndims). */
+    nc_bool_t chunking_set;      /**< True if nc_def_var_chunking() chose the storage or chunksizes. */
     void *format_var_info;       /**< Pointer to any binary format info. */
     void* filters;             /**< Record of the list of filters to be applied to var data; format dependent */
 } NC_VAR_INFO_T;
@@ -243,6 +246,7 @@ typedef struct NC_TYPE_INFO
     nc_bool_t committed;         /**< True when datatype is committed in the file */
     nc_type nc_type_class;       /**< NC_VLEN, NC_COMPOUND, NC_OPAQUE, NC_ENUM, NC_INT, NC_FLOAT, or NC_STRING. */
     void *format_type_info;      /**< HDF5-specific type info. */
+    void *walkplan;              /**< Cached plan for walking instances; see dinstance.c */
 
     /** Information for each type or class */
     union {
@@ -335,6 +339,8 @@ typedef struct NCglobalstate {
     struct NCRCinfo* rcinfo; /* Currently only one rc file per session */
     struct GlobalZarr { /* Zarr specific parameters */
 	char dimension_separator;
+	int prefetch_threads; /* # threads used to read group metadata; <= 1 => none */
+	int write_empty_chunks; /* 0 => do not store chunks holding only the fill value */
     } zarr;
     struct Alignment { /* H5Pset_alignment parameters */
         int defined; /* 1 => threshold and alignment explicitly set */
@@ -453,6 +459,9 @@ extern int nc4_get_att_ptrs(NC_FILE_INFO_T *h5, NC_GRP_INFO_T *grp, NC_VAR_INFO_
 /* Get variable/fixed size flag for type */
 extern int NC4_inq_type_fixed_size(int ncid, nc_type xtype, int* isfixedsizep);
 
+/* Free the walk plan cached on a type (dinstance.c) */
+extern void NC_free_walkplan(void* plan);
+
 /* Close the file. */
 extern int nc4_close_netcdf4_file(NC_FILE_INFO_T *h5, int abort, NC_memio *memio);
 
@@ -460,6 +469,12 @@ extern int nc4_close_netcdf4_file(NC_FILE_INFO_T *h5, int abort, NC_memio *memio
 extern int nc4_find_default_chunksizes2(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var);
 extern int nc4_check_chunksizes(NC_GRP_INFO_T* grp, NC_VAR_INFO_T* var, const size_t* chunksizes);
 
+/* Access-pattern hints */
+extern int nc4_set_access_hint(NC_VAR_INFO_T *var, int hint, const size_t *shape);
+extern int nc4_find_hint_chunksizes(NC_VAR_INFO_T *var, size_t type_size);
+extern size_t nc4_access_hint_cache_size(const NC_VAR_INFO_T *var, size_t type_size, size_t dfalt);
+extern int NC4_inq_var_access_hint(int ncid, int varid, int *hintp, size_t *shapep);
+
 /* HDF5 initialization/finalization */
 extern int nc4_hdf5_initialized;
 extern void nc4_hdf5_initialize(void);
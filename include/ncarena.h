@@ -0,0 +1,28 @@
+/*
+Copyright (c) 1998-2018 University Corporation for Atmospheric Research/Unidata
+See COPYRIGHT for license information.
+*/
+
+/**
+ * @file
+ * @internal Arena allocation of the strings and vlen data returned
+ * by nc_get_vara_arena() and nc_get_vara_string_arena().
+ *
+ * While an arena read is in progress, NC_arena_current() returns its
+ * arena; the format code that fills the caller's memory allocates
+ * from it instead of with malloc.
+ */
+
+#ifndef NCARENA_H
+#define NCARENA_H
+
+#include "netcdf.h"
+
+EXTERNL nc_arena_t* NC_arena_current(void);
+EXTERNL void* NC_arena_alloc(nc_arena_t* arena, size_t size);
+
+/* nc_copy_data() allocating from an arena, if not NULL */
+EXTERNL int NC_copy_data_arena(int ncid, nc_type xtype, const void* memory, size_t count,
+                               void* copy, nc_arena_t* arena);
+
+#endif /*NCARENA_H*/
@@ -49,6 +49,11 @@ typedef struct NCauth {
 	char *user; /*CURLOPT_USERNAME*/
 	char *pwd; /*CURLOPT_PASSWORD*/
     } creds;
+    struct cache {
+	char* dir; /* persistent response cache; NULL => disabled */
+	long long maxsize; /* bytes; <= 0 => unbounded */
+	long maxage; /* seconds a response is used without revalidation */
+    } cache;
     char* s3profile;
 } NCauth;
 
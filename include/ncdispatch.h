@@ -130,6 +130,8 @@ extern int NC4_finalize(void);
 extern const NC_Dispatch* HDF5_dispatch_table;
 extern int NC_HDF5_initialize(void);
 extern int NC_HDF5_finalize(void);
+extern int NC4_HDF5_get_var_points(int ncid, int varid, size_t npoints, const size_t* coords, void* values, int* handledp);
+extern int NC4_HDF5_def_var_access_hint(int ncid, int varid, int hint, const size_t* shape);
 #endif
 
 #ifdef USE_HDF4
@@ -142,6 +144,8 @@ extern int HDF4_finalize(void);
 extern const NC_Dispatch* NCZ_dispatch_table;
 extern int NCZ_initialize(void);
 extern int NCZ_finalize(void);
+extern int NCZ_get_var_points(int ncid, int varid, size_t npoints, const size_t* coords, void* values, int* handledp);
+extern int NCZ_def_var_access_hint(int ncid, int varid, int hint, const size_t* shape);
 #endif
 
 /* User-defined formats.*/
@@ -219,6 +223,7 @@ EXTERNL char* NC_atomictypename(nc_type xtype);
 extern int NC_getshape(int ncid, int varid, int ndims, size_t* shape);
 extern int NC_is_recvar(int ncid, int varid, size_t* nrecs);
 extern int NC_inq_recvar(int ncid, int varid, int* nrecdims, int* is_recdim);
+extern int NC_get_vara(int ncid, int varid, const size_t* start, const size_t* edges, void* value, nc_type memtype);
 
 #define nullstring(s) (s==NULL?"(null)":s)
 
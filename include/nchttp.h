@@ -17,6 +17,7 @@ struct CURL; /* Forward */
 typedef struct NC_HTTP_STATE {
     struct CURL* curl;
     long httpcode;        
+    int verbose;
     struct Response {
         NClist* headset; /* which headers to capture */
         NClist* headers; /* Set of captured headers */
@@ -32,10 +33,20 @@ typedef struct NC_HTTP_STATE {
     char errbuf[1024]; /* assert(CURL_ERROR_SIZE <= 1024) */
 } NC_HTTP_STATE;
 
+/* One byte range for nc_http_read_ranges() */
+typedef struct NC_HTTP_RANGE {
+    const char* url;  /* object to read */
+    size64_t start;   /* starting offset */
+    size64_t count;   /* number of bytes */
+    NCbytes* buf;     /* content is appended here; caller owns */
+    long httpcode;    /* set on return */
+} NC_HTTP_RANGE;
+
 extern int nc_http_init(NC_HTTP_STATE** state);
 extern int nc_http_init_verbose(NC_HTTP_STATE** state, int verbose);
 extern int nc_http_size(NC_HTTP_STATE* state, const char* url, long long* sizep);
 extern int nc_http_read(NC_HTTP_STATE* state, const char* url, size64_t start, size64_t count, NCbytes* buf);
+extern int nc_http_read_ranges(NC_HTTP_STATE* state, size_t nranges, NC_HTTP_RANGE* ranges); /* concurrently */
 extern int nc_http_write(NC_HTTP_STATE* state, const char* url, NCbytes* payload);
 extern int nc_http_close(NC_HTTP_STATE* state);
 extern int nc_http_reset(NC_HTTP_STATE* state);
@@ -45,5 +56,6 @@ extern int nc_http_set_payload(NC_HTTP_STATE* state, size_t len, void* payload);
 extern int nc_http_response_headset(NC_HTTP_STATE* state, const NClist* headers); /* Set of headers to capture */
 extern int nc_http_response_headers(NC_HTTP_STATE* state, NClist** headersp); /* set of captured headers */
 extern int nc_http_request_setheaders(NC_HTTP_STATE* state, const NClist* headers); /* set of extra request headers */
+extern int nc_http_finalize(void); /* release the shared engine */
 
 #endif /*NCHTTP_H*/
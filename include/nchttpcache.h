@@ -0,0 +1,60 @@
+/*
+Copyright (c) 1998-2018 University Corporation for Atmospheric Research/Unidata
+See COPYRIGHT for license information.
+*/
+
+/*
+Persistent on-disk cache of HTTP responses.
+Currently used by the DAP2 and DAP4 protocols for
+DDS/DAS/DMR and data responses.
+
+The cache is enabled by the HTTP.CACHE.DIR .rc key.
+Each response is stored under its complete request url,
+which includes any constraint. A stored response is
+used without contacting the server while it is younger
+than HTTP.CACHE.MAXAGE seconds; after that it is
+revalidated with If-None-Match/If-Modified-Since.
+The least recently used responses are discarded when
+the cache grows beyond HTTP.CACHE.MAXSIZE bytes.
+*/
+
+#ifndef NCHTTPCACHE_H
+#define NCHTTPCACHE_H
+
+#include <stdio.h>
+#include <curl/curl.h>
+#include "ncbytes.h"
+#include "ncauth.h"
+
+typedef struct NChttpcache NChttpcache;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Return the cache entry for url, or NULL if caching is disabled */
+EXTERNL int NC_httpcache_open(const NCauth* auth, const char* url, NChttpcache** cachep);
+EXTERNL void NC_httpcache_close(NChttpcache* cache);
+
+/* Is there a stored response that can be used without revalidation? */
+EXTERNL int NC_httpcache_fresh(const NChttpcache* cache);
+
+/* Copy the stored response into buf or stream */
+EXTERNL int NC_httpcache_read(NChttpcache* cache, NCbytes* buf, FILE* stream, size_t* sizep, long* filetimep);
+
+/* Add the conditional request headers to curl before curl_easy_perform */
+EXTERNL int NC_httpcache_prepare(NChttpcache* cache, CURL* curl);
+
+/* After curl_easy_perform: on 304, read the stored response and change
+   *httpcodep to 200; on 200, store the response from buf or stream.
+   The options set by NC_httpcache_prepare are removed. After a failed
+   or partial transfer, pass a code of 0 and no buf or stream so that
+   only the options are removed. */
+EXTERNL int NC_httpcache_complete(NChttpcache* cache, CURL* curl, long* httpcodep,
+                                  NCbytes* buf, FILE* stream, size_t* sizep, long* filetimep);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /*NCHTTPCACHE_H*/
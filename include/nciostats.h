@@ -0,0 +1,79 @@
+/*
+Copyright (c) 1998-2018 University Corporation for Atmospheric Research/Unidata
+See COPYRIGHT for license information.
+*/
+
+/**
+ * @file
+ * @internal Per-file and per-variable I/O statistics.
+ *
+ * The counters are only compiled in when the library is configured
+ * with ENABLE_IOSTATS; otherwise all the NCIOSTAT macros expand to
+ * nothing so that the I/O paths are unaffected.
+ */
+
+#ifndef NCIOSTATS_H
+#define NCIOSTATS_H
+
+#include "netcdf.h"
+
+/* Name of the environment variable enabling the JSON-lines trace.
+   Its value is a file path (appended to) or "stderr". */
+#define NCENVIOTRACE "NCIOTRACE"
+
+struct NC;
+struct NClist;
+
+#ifdef ENABLE_IOSTATS
+
+/* Per-variable statistics; ncid is the group id */
+typedef struct NCvariostats {
+    int ncid;
+    int varid;
+    char* name;
+    nc_io_stats_t stats;
+} NCvariostats;
+
+typedef struct NCiostats {
+    nc_io_stats_t stats; /* whole file */
+    struct NClist* vars; /* NClist<NCvariostats*> */
+    int depth; /* nesting of get/put calls; only outermost is counted */
+} NCiostats;
+
+EXTERNL int NC_iostats_new(struct NC* ncp);
+EXTERNL void NC_iostats_free(struct NC* ncp);
+EXTERNL nc_io_stats_t* NC_iostats_file(struct NC* ncp);
+EXTERNL nc_io_stats_t* NC_iostats_var(struct NC* ncp, int ncid, int varid);
+EXTERNL nc_io_stats_t* NC_iostats_find(int ncid);
+EXTERNL double NC_iostats_now(void);
+EXTERNL double NC_iostats_enter(struct NC* ncp);
+EXTERNL void NC_iostats_leave(struct NC* ncp, int ncid, int varid, nc_type memtype,
+                              const size_t* count, int isput, double t0);
+
+/* Add n to a field of a (possibly NULL) nc_io_stats_t* */
+#define NCIOSTAT_ADD(sp,field,n) do{if((sp)!=NULL) (sp)->field += (n);}while(0)
+#define NCIOSTAT_INCR(sp,field) NCIOSTAT_ADD(sp,field,1)
+/* Declare/capture a timestamp for timing a region */
+#define NCIOSTAT_TIMER(t) double t = NC_iostats_now()
+#define NCIOSTAT_ELAPSED(sp,field,t) NCIOSTAT_ADD(sp,field,(NC_iostats_now() - (t)))
+/* Update both the file level and variable level counters */
+#define NCIOSTAT_VARADD(ncp,ncid,varid,field,n) \
+    do{NCIOSTAT_ADD(NC_iostats_file(ncp),field,n); NCIOSTAT_ADD(NC_iostats_var(ncp,ncid,varid),field,n);}while(0)
+/* Bracket a dispatched get/put call */
+#define NCIOSTAT_ENTER(ncp) double nciostat_t0 = NC_iostats_enter(ncp)
+#define NCIOSTAT_LEAVE(ncp,ncid,varid,memtype,count,isput) \
+    NC_iostats_leave(ncp,ncid,varid,memtype,count,isput,nciostat_t0)
+
+#else /*!ENABLE_IOSTATS*/
+
+#define NCIOSTAT_ADD(sp,field,n)
+#define NCIOSTAT_INCR(sp,field)
+#define NCIOSTAT_TIMER(t)
+#define NCIOSTAT_ELAPSED(sp,field,t)
+#define NCIOSTAT_VARADD(ncp,ncid,varid,field,n)
+#define NCIOSTAT_ENTER(ncp)
+#define NCIOSTAT_LEAVE(ncp,ncid,varid,memtype,count,isput)
+
+#endif /*ENABLE_IOSTATS*/
+
+#endif /*NCIOSTATS_H*/
@@ -57,9 +57,19 @@ typedef struct NCjson {
     struct NCjlist {
 	    int len;
 	    struct NCjson** contents;
+	    int alloc; /* allocated length of contents; 0 => unknown */
     } list; /* sort == DICT|ARRAY */
+    /* The remaining fields are private to ncjson.c */
+    int flags; /* NCJF_XXX: which parts of this object live in a parse arena */
+    struct NCjarena* arena; /* non-NULL only for the root of a parsed tree */
+    struct NCjindex* index; /* hash index for the keys of a large dict */
 } NCjson;
 
+/* Object parts allocated in the arena of NCJparse rather than individually malloc'd */
+#define NCJF_ARENANODE   1
+#define NCJF_ARENASTRING 2
+#define NCJF_ARENALIST   4
+
 /* Structure to hold result of convertinf one json sort to  value of another type;
    don't use union so we can know when to reclaim sval
 */
@@ -134,8 +144,8 @@ OPTEXPORT const char* NCJtotext(const NCjson* json);
 
 /* Setters */
 #define NCJsetsort(x,s) (x)->sort=(s)
-#define NCJsetstring(x,y) (x)->string=(y)
-#define NCJsetcontents(x,c) (x)->list.contents=(c)
+#define NCJsetstring(x,y) ((x)->string=(y),(x)->flags&=~NCJF_ARENASTRING)
+#define NCJsetcontents(x,c) ((x)->list.contents=(c),(x)->list.alloc=0,(x)->flags&=~NCJF_ARENALIST)
 #define NCJsetlength(x,l) (x)->list.len=(l)
 
 /* Misc */
@@ -0,0 +1,35 @@
+/*
+Copyright (c) 1998-2018 University Corporation for Atmospheric Research/Unidata
+See COPYRIGHT for license information.
+*/
+
+/**
+ * @file
+ * @internal Dispatch-level read-ahead for sequences of small
+ * nc_get_vara() calls on the same variable.
+ *
+ * Read-ahead is enabled per variable with nc_set_var_readahead().
+ * When a request continues the previous one along a single dimension,
+ * a larger hyperslab, extended along that dimension, is read into a
+ * bounded buffer and the following requests are copied out of it.
+ * Any write through the same file, nc_redef() and nc_sync() discard
+ * the buffered data.
+ */
+
+#ifndef NCREADAHEAD_H
+#define NCREADAHEAD_H
+
+#include "netcdf.h"
+
+struct NC;
+
+EXTERNL int NC_readahead_get(struct NC* ncp, int ncid, int varid, const size_t* start,
+                             const size_t* count, void* value, nc_type memtype, int* donep);
+EXTERNL void NC_readahead_invalidate(struct NC* ncp);
+EXTERNL void NC_readahead_free(struct NC* ncp);
+
+/* Discard all read-ahead data of a file; a no-op unless read-ahead is in use */
+#define NC_READAHEAD_INVALIDATE(ncp) \
+    do{if((ncp)->readahead != NULL) NC_readahead_invalidate(ncp);}while(0)
+
+#endif /*NCREADAHEAD_H*/
@@ -308,6 +308,17 @@ NOTE: The NC_MAX_DIMS, NC_MAX_ATTRS, and NC_MAX_VARS limits
 #define NC_VIRTUAL         4
 /**@}*/
 
+/** Access-pattern hints for nc_def_var_access_hint(). They select the
+ * default chunk shape and chunk cache size of a variable. The first
+ * dimension of the variable is taken to be the time (or record)
+ * dimension. */
+/**@{*/
+#define NC_ACCESS_BALANCED   0 /**< No dominant pattern; the library default. */
+#define NC_ACCESS_TIMESERIES 1 /**< Reads of all times at a few points. */
+#define NC_ACCESS_SPATIAL    2 /**< Reads of whole slices at one time. */
+#define NC_ACCESS_SHAPE      3 /**< Reads of an explicitly given shape. */
+/**@}*/
+
 /** In HDF5 files you can set check-summing for each variable.
 Currently the only checksum available is Fletcher-32, which can be set
 with the function nc_def_var_fletcher32.  These defines are used
@@ -952,6 +963,15 @@ nc_def_var_chunking(int ncid, int varid, int storage, const size_t *chunksizesp)
 EXTERNL int
 nc_inq_var_chunking(int ncid, int varid, int *storagep, size_t *chunksizesp);
 
+/* Describe how a variable will mostly be read, so that its default
+   chunking and chunk cache suit that access. */
+EXTERNL int
+nc_def_var_access_hint(int ncid, int varid, int hint, const size_t *shapep);
+
+/* Inq the access hint of a var. */
+EXTERNL int
+nc_inq_var_access_hint(int ncid, int varid, int *hintp, size_t *shapep);
+
 /* Define fill value behavior for a variable. This must be done after
    nc_def_var and before nc_enddef. */
 EXTERNL int
@@ -2106,6 +2126,88 @@ EXTERNL char* nc_rc_get(const char* key);
 /* Set/overwrite the value corresponding to key */
 EXTERNL int nc_rc_set(const char* key, const char* value);
 
+/* I/O statistics; only collected if the library was built
+   with --enable-iostats (-DENABLE_IOSTATS=ON) */
+typedef struct nc_io_stats_t {
+    unsigned long long get_calls;        /**< nc_get_var* calls. */
+    unsigned long long put_calls;        /**< nc_put_var* calls. */
+    unsigned long long bytes_read;       /**< Bytes returned to the caller. */
+    unsigned long long bytes_written;    /**< Bytes provided by the caller. */
+    unsigned long long io_reads;         /**< Storage read requests (ncio get, object read). */
+    unsigned long long io_writes;        /**< Storage write requests. */
+    unsigned long long io_moves;         /**< Storage move requests (ncio move). */
+    unsigned long long io_bytes_read;    /**< Bytes read from storage. */
+    unsigned long long io_bytes_written; /**< Bytes written to storage. */
+    unsigned long long cache_hits;       /**< Chunk cache hits. */
+    unsigned long long cache_misses;     /**< Chunk cache misses. */
+    unsigned long long cache_evictions;  /**< Chunk cache evictions. */
+    unsigned long long filter_encodes;   /**< Filter chain encode calls. */
+    unsigned long long filter_decodes;   /**< Filter chain decode calls. */
+    unsigned long long http_requests;    /**< HTTP requests issued. */
+    unsigned long long http_bytes;       /**< HTTP response bytes. */
+    double filter_encode_time;           /**< Seconds spent encoding. */
+    double filter_decode_time;           /**< Seconds spent decoding. */
+    double get_time;                     /**< Seconds spent in nc_get_var*. */
+    double put_time;                     /**< Seconds spent in nc_put_var*. */
+} nc_io_stats_t;
+
+/* Get the I/O statistics of a file (varid == NC_GLOBAL)
+   or of a single variable */
+EXTERNL int nc_inq_io_stats(int ncid, int varid, nc_io_stats_t* statsp);
+
+/* Reset all I/O statistics of a file */
+EXTERNL int nc_reset_io_stats(int ncid);
+
+/* Read-only view of a hyperslab of a variable; see nc_get_vara_view() */
+typedef struct nc_vara_view_t {
+    const void* data;   /**< Address of the element at start; NULL if empty. */
+    nc_type xtype;      /**< Type of the elements (the variable's type). */
+    size_t size;        /**< Size in bytes of one element. */
+    int ndims;          /**< Number of dimensions of the variable. */
+    size_t* count;      /**< Number of elements along each dimension. */
+    ptrdiff_t* strides; /**< Byte distance between adjacent elements along each dimension. */
+    int zerocopy;       /**< 1 if data points directly into the file mapping. */
+    void* buffer;       /**< Library-managed copy of the data, if any. */
+} nc_vara_view_t;
+
+/* Get a read-only view of a hyperslab without copying, if possible */
+EXTERNL int nc_get_vara_view(int ncid, int varid, const size_t* startp,
+                             const size_t* countp, nc_vara_view_t* view);
+
+/* Release the memory held by a view */
+EXTERNL int nc_free_vara_view(nc_vara_view_t* view);
+
+/* Read a set of scattered elements of a variable */
+EXTERNL int nc_get_var_points(int ncid, int varid, size_t npoints,
+                             const size_t* coords, void* values);
+
+/* Read or write a range of records of several record variables at once */
+EXTERNL int nc_get_recs(int ncid, size_t startrec, size_t nrecs, int nvars,
+                        const int* varids, void** data);
+EXTERNL int nc_put_recs(int ncid, size_t startrec, size_t nrecs, int nvars,
+                        const int* varids, const void* const* data);
+
+/* Read-ahead of sequential small reads of a variable
+   (varid == NC_GLOBAL sets the default for the file); 0 disables */
+EXTERNL int nc_set_var_readahead(int ncid, int varid, size_t size);
+EXTERNL int nc_get_var_readahead(int ncid, int varid, size_t* sizep);
+
+/* Arena holding the strings and vlen data returned by arena reads;
+   zero it before first use, release it with nc_free_arena() */
+typedef struct nc_arena_t {
+    void* blocks; /**< Memory blocks; managed by the library. */
+    size_t size;  /**< Total bytes held by the arena. */
+} nc_arena_t;
+
+/* Read a hyperslab, allocating strings and vlen data from an arena */
+EXTERNL int nc_get_vara_arena(int ncid, int varid, const size_t* startp,
+                              const size_t* countp, void* ip, nc_arena_t* arena);
+EXTERNL int nc_get_vara_string_arena(int ncid, int varid, const size_t* startp,
+                                     const size_t* countp, char** ip, nc_arena_t* arena);
+
+/* Release all memory held by an arena */
+EXTERNL int nc_free_arena(nc_arena_t* arena);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -52,6 +52,17 @@
 #ifndef H5Z_FILTER_BLOSC
 #define H5Z_FILTER_BLOSC 32001
 #endif
+
+/* Filters built into NCZarr; these ids are not registered with The HDF Group */
+#ifndef H5Z_FILTER_DELTA
+#define H5Z_FILTER_DELTA 34001
+#endif
+#ifndef H5Z_FILTER_BITPACK
+#define H5Z_FILTER_BITPACK 34002
+#endif
+#ifndef H5Z_FILTER_FIXEDSCALEOFFSET
+#define H5Z_FILTER_FIXEDSCALEOFFSET 34003
+#endif
 #ifndef BLOSC_SHUFFLE
 enum BLOSC_SHUFFLE {
 BLOSC_NOSHUFFLE=0,  /* no shuffle */
@@ -57,9 +57,19 @@ typedef struct NCjson {
     struct NCjlist {
 	    int len;
 	    struct NCjson** contents;
+	    int alloc; /* allocated length of contents; 0 => unknown */
     } list; /* sort == DICT|ARRAY */
+    /* The remaining fields are private to ncjson.c */
+    int flags; /* NCJF_XXX: which parts of this object live in a parse arena */
+    struct NCjarena* arena; /* non-NULL only for the root of a parsed tree */
+    struct NCjindex* index; /* hash index for the keys of a large dict */
 } NCjson;
 
+/* Object parts allocated in the arena of NCJparse rather than individually malloc'd */
+#define NCJF_ARENANODE   1
+#define NCJF_ARENASTRING 2
+#define NCJF_ARENALIST   4
+
 /* Structure to hold result of convertinf one json sort to  value of another type;
    don't use union so we can know when to reclaim sval
 */
@@ -134,8 +144,8 @@ OPTEXPORT const char* NCJtotext(const NCjson* json);
 
 /* Setters */
 #define NCJsetsort(x,s) (x)->sort=(s)
-#define NCJsetstring(x,y) (x)->string=(y)
-#define NCJsetcontents(x,c) (x)->list.contents=(c)
+#define NCJsetstring(x,y) ((x)->string=(y),(x)->flags&=~NCJF_ARENASTRING)
+#define NCJsetcontents(x,c) ((x)->list.contents=(c),(x)->list.alloc=0,(x)->flags&=~NCJF_ARENALIST)
 #define NCJsetlength(x,l) (x)->list.len=(l)
 
 /* Misc */
@@ -183,8 +193,6 @@ static int ncjbreakpoint(int err) {return err;}
 #define NCJ_OK 0
 #define NCJ_ERR (-1)
 
-#define NCJ_EOF -2
-
 #define NCJ_LBRACKET '['
 #define NCJ_RBRACKET ']'
 #define NCJ_LBRACE '{'
@@ -201,18 +209,63 @@ static int ncjbreakpoint(int err) {return err;}
 #define JSON_WORD "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_$+-."
 
 /**************************************************/
+/*
+The parser makes a single pass over a private copy of the input
+text. Strings are unescaped in place in that copy and the objects
+of the resulting tree point directly into it. All objects, the
+list vectors and the (short) word strings are carved out of a few
+large blocks, collectively called the arena, that are owned by the
+root of the tree and are released in one piece by NCJreclaim.
+Objects added or modified later through the build API are
+individually malloc'd as before; the NCJF_XXX flags record which
+parts of an object live in the arena.
+*/
+
+/* Size of the first arena block beyond the copy of the text */
+#define NCJ_ARENA_MIN 4096
+/* Largest arena block, except for single large requests */
+#define NCJ_ARENA_MAX (1<<20)
+
+/* Dicts with at least this many keys get a hash index */
+#define NCJ_INDEX_MIN 16
+
+#define NCJALIGN(n) (((n)+(sizeof(void*)-1)) & ~(sizeof(void*)-1))
+
+typedef struct NCJblock {
+    struct NCJblock* next;
+    size_t size; /* of data */
+    size_t used;
+    /* data follows */
+} NCJblock;
+#define NCJBLOCKHDR NCJALIGN(sizeof(NCJblock))
+
+typedef struct NCjarena {
+    char* text; /* copy of the input text; strings point into it */
+    NCJblock* blocks; /* most recent first */
+    size_t nextsize; /* size of the next block */
+} NCjarena;
+
+/* Hash index over the keys of a dict; rebuilt if the dict changes */
+typedef struct NCjindex {
+    int len; /* dict length when the index was built */
+    struct NCjson** contents; /* dict contents when the index was built */
+    size_t mask; /* # buckets - 1; # buckets is a power of 2 */
+    int* buckets; /* 1 + index of the key in the dict; 0 => empty */
+} NCjindex;
+
 typedef struct NCJparser {
     char* text;
     char* pos;
-    size_t yylen; /* |yytext| */
-    char* yytext; /* string or word */
-    long long num;
-    int tf;
+    NCjarena* arena;
+    NCjson** stack; /* members of the containers being parsed */
+    size_t nstack;
+    size_t stackalloc;
     int status; /* NCJ_ERR|NCJ_OK */
 } NCJparser;
 
 typedef struct NCJbuf {
-    int len; /* |text|; does not include nul terminator */
+    size_t len; /* |text|; does not include nul terminator */
+    size_t alloc; /* allocated size of text */
     char* text; /* NULL || nul terminated */
 } NCJbuf;
 
@@ -232,32 +285,37 @@ typedef struct NCJbuf {
 #define nulldup(x) ((x)?strdup(x):(x))
 #endif
 
-#ifdef NCJDEBUG
-static char* tokenname(int token);
-#endif
-
 /**************************************************/
 /* Forward */
 static int NCJparseR(NCJparser* parser, NCjson**);
-static int NCJparseArray(NCJparser* parser, struct NCjlist* array);
-static int NCJparseDict(NCJparser* parser, struct NCjlist* dict);
+static int NCJparseArray(NCJparser* parser, NCjson* array);
+static int NCJparseDict(NCJparser* parser, NCjson* dict);
+static int NCJparseString(NCJparser* parser, char** stringp);
+static int NCJparseWord(NCJparser* parser, int* sortp, char** wordp);
+static int NCJcollect(NCJparser* parser, size_t base, NCjson* container);
+static int NCJpush(NCJparser* parser, NCjson* json);
+static void NCJskipspace(NCJparser* parser);
+static NCjson* NCJnode(NCJparser* parser, int sort);
 static int testbool(const char* word);
 static int testint(const char* word);
 static int testdouble(const char* word);
 static int testnull(const char* word);
-static int NCJlex(NCJparser* parser);
-static int NCJyytext(NCJparser*, char* start, size_t pdlen);
-static void NCJreclaimArray(struct NCjlist*);
-static void NCJreclaimDict(struct NCjlist*);
-static int NCJunescape(NCJparser* parser);
+static void* arenaalloc(NCjarena* arena, size_t size);
+static void arenafree(NCjarena* arena);
+static void NCJreclaimArray(NCjson*);
+static void NCJreclaimDict(NCjson*);
+static void NCJfreeindex(NCjson* dict);
+static int NCJbuildindex(NCjson* dict);
+static unsigned NCJhash(const char* key);
 static int unescape1(int c);
-static int listappend(struct NCjlist* list, NCjson* element);
+static int listappend(NCjson* container, NCjson* element);
 
 static int NCJcloneArray(const NCjson* array, NCjson** clonep);
 static int NCJcloneDict(const NCjson* dict, NCjson** clonep);
 static int NCJunparseR(const NCjson* json, NCJbuf* buf, unsigned flags);
 static int bytesappendquoted(NCJbuf* buf, const char* s);
 static int bytesappend(NCJbuf* buf, const char* s);
+static int bytesappendn(NCJbuf* buf, const char* s, size_t n);
 static int bytesappendc(NCJbuf* bufp, const char c);
 
 /* Hide everything for plugins */
@@ -276,6 +334,21 @@ static int NCJunparse(const NCjson* json, unsigned flags, char** textp);
 #define OPTSTATIC
 #endif /*NETCDF_JSON_H*/
 
+/* Characters that may appear in an unquoted word; subsumes numbers */
+static const char NCJwordchars[256] = {
+/* 0x00-0x2f: $ + - . */
+0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,
+0,0,0,0,1,0,0,0, 0,0,0,1,0,1,1,0,
+/* 0x30-0x3f: digits */
+1,1,1,1,1,1,1,1, 1,1,0,0,0,0,0,0,
+/* 0x40-0x5f: upper case, _ */
+0,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1, 1,1,1,0,0,0,0,1,
+/* 0x60-0x7f: lower case */
+0,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1, 1,1,1,0,0,0,0,0,
+/* 0x80-0xff: none */
+};
+#define ISWORD(c) (NCJwordchars[(unsigned char)(c)])
+
 /**************************************************/
 
 OPTSTATIC int
@@ -288,147 +361,138 @@ OPTSTATIC int
 NCJparsen(size_t len, const char* text, unsigned flags, NCjson** jsonp)
 {
     int stat = NCJ_OK;
-    NCJparser* parser = NULL;
+    NCJparser parser;
+    NCjarena* arena = NULL;
     NCjson* json = NULL;
 
-    parser = calloc(1,sizeof(NCJparser));
-    if(parser == NULL)
+    memset(&parser,0,sizeof(parser));
+    if((arena = (NCjarena*)calloc(1,sizeof(NCjarena))) == NULL)
 	{stat = NCJTHROW(NCJ_ERR); goto done;}
-    parser->text = (char*)malloc(len+1+1);
-    if(parser->text == NULL)
+    if((arena->text = (char*)malloc(len+1+1)) == NULL)
 	{stat = NCJTHROW(NCJ_ERR); goto done;}
-    memcpy(parser->text,text,len);
+    memcpy(arena->text,text,len);
     /* trim trailing whitespace */
     if(len > 0) {
 	char* p;
-        for(p=parser->text+(len-1);p >= parser->text;p--) {
+        for(p=arena->text+(len-1);p >= arena->text;p--) {
 	   if(*p > ' ') break;
 	}
-	len = (size_t)((p - parser->text) + 1);
+	len = (size_t)((p - arena->text) + 1);
     }
     if(len == 0) 
 	{stat = NCJTHROW(NCJ_ERR); goto done;}
-    parser->text[len] = '\0';
-    parser->text[len+1] = '\0';
-    parser->pos = &parser->text[0];
-    parser->status = NCJ_OK;
+    arena->text[len] = '\0';
+    arena->text[len+1] = '\0';
+    /* Guess that the tree is about as big as the text */
+    arena->nextsize = NCJALIGN(len);
+    if(arena->nextsize < NCJ_ARENA_MIN) arena->nextsize = NCJ_ARENA_MIN;
+    if(arena->nextsize > NCJ_ARENA_MAX) arena->nextsize = NCJ_ARENA_MAX;
+    parser.text = arena->text;
+    parser.pos = &parser.text[0];
+    parser.arena = arena;
+    parser.status = NCJ_OK;
 #ifdef NCJDEBUG
-fprintf(stderr,"json: |%s|\n",parser->text);
+fprintf(stderr,"json: |%s|\n",parser.text);
 #endif
-    if((stat=NCJparseR(parser,&json))==NCJ_ERR) goto done;
+    if((stat=NCJparseR(&parser,&json))==NCJ_ERR) goto done;
+    if(json == NULL) {stat = NCJTHROW(NCJ_ERR); goto done;}
     /* Must consume all of the input */
-    if(parser->pos != (parser->text+len)) {stat = NCJ_ERR; goto done;}
+    NCJskipspace(&parser);
+    if(parser.pos != (parser.text+len)) {stat = NCJTHROW(NCJ_ERR); goto done;}
+    /* The root owns the arena */
+    json->arena = arena; arena = NULL;
     *jsonp = json;
     json = NULL;
 
 done:
-    if(parser != NULL) {
-	nullfree(parser->text);
-	nullfree(parser->yytext);
-	free(parser);
-    }
-    (void)NCJreclaim(json);
+    nullfree(parser.stack);
+    arenafree(arena); /* reclaims any partial tree */
     return NCJTHROW(stat);
 }
 
 /*
-Simple recursive descent
-intertwined with dict and list parsers.
+Simple recursive descent directly over the text.
 
 Invariants:
 1. The json argument is provided by caller and filled in by NCJparseR.
-2. Each call pushed back last unconsumed token
+2. A closing bracket or brace is not consumed and *jsonp is set to NULL
+   so that the containing array or dict parser will see it.
 */
 
 static int
 NCJparseR(NCJparser* parser, NCjson** jsonp)
 {
     int stat = NCJ_OK;
-    int token = NCJ_UNDEF;
     NCjson* json = NULL;
+    int sort;
+    char* word = NULL;
 
-    if(jsonp == NULL)
-	{stat = NCJTHROW(NCJ_ERR); goto done;}
-    if((token = NCJlex(parser)) == NCJ_UNDEF)
-	{stat = NCJTHROW(NCJ_ERR); goto done;}
-    switch (token) {
-    case NCJ_EOF:
-	break;
-    case NCJ_NULL:
-        if((stat = NCJnew(NCJ_NULL,&json))==NCJ_ERR) goto done;
-	break;
-    case NCJ_BOOLEAN:
-        if((stat = NCJnew(NCJ_BOOLEAN,&json))==NCJ_ERR) goto done;
-	json->string = strdup(parser->yytext);
-	break;
-    case NCJ_INT:
-        if((stat = NCJnew(NCJ_INT,&json))==NCJ_ERR) goto done;
-	json->string = strdup(parser->yytext);
-	break;
-    case NCJ_DOUBLE:
-        if((stat = NCJnew(NCJ_DOUBLE,&json))==NCJ_ERR) goto done;
-	json->string = strdup(parser->yytext);
-	break;
-    case NCJ_STRING:
-        if((stat = NCJnew(NCJ_STRING,&json))==NCJ_ERR) goto done;
-	json->string = strdup(parser->yytext);
+    *jsonp = NULL;
+    NCJskipspace(parser);
+    switch (*parser->pos) {
+    case '\0': /* EOF */
 	break;
     case NCJ_LBRACE:
-        if((stat = NCJnew(NCJ_DICT,&json))==NCJ_ERR) goto done;
-	if((stat = NCJparseDict(parser, &json->list))==NCJ_ERR) goto done;
+	parser->pos++;
+        if((json = NCJnode(parser,NCJ_DICT))==NULL) goto nomem;
+	if((stat = NCJparseDict(parser, json))==NCJ_ERR) goto done;
 	break;
     case NCJ_LBRACKET:
-        if((stat = NCJnew(NCJ_ARRAY,&json))==NCJ_ERR) goto done;
-	if((stat = NCJparseArray(parser, &json->list))==NCJ_ERR) goto done;
+	parser->pos++;
+        if((json = NCJnode(parser,NCJ_ARRAY))==NULL) goto nomem;
+	if((stat = NCJparseArray(parser, json))==NCJ_ERR) goto done;
 	break;
     case NCJ_RBRACE: /* We hit end of the dict we are parsing */
-	parser->pos--; /* pushback so NCJparseArray will catch */
-	json = NULL;
+    case NCJ_RBRACKET: /* or of the array */
 	break;
-    case NCJ_RBRACKET:
-	parser->pos--; /* pushback so NCJparseDict will catch */
-	json = NULL;
+    case NCJ_QUOTE:
+	if((stat = NCJparseString(parser,&word))==NCJ_ERR) goto done;
+        if((json = NCJnode(parser,NCJ_STRING))==NULL) goto nomem;
+	json->string = word;
+	json->flags |= NCJF_ARENASTRING;
 	break;
     default:
-	stat = NCJTHROW(NCJ_ERR);
+	if(!ISWORD(*parser->pos)) {stat = NCJTHROW(NCJ_ERR); goto done;}
+	if((stat = NCJparseWord(parser,&sort,&word))==NCJ_ERR) goto done;
+        if((json = NCJnode(parser,sort))==NULL) goto nomem;
+	if(sort != NCJ_NULL) {
+	    json->string = word;
+	    json->flags |= NCJF_ARENASTRING;
+	}
 	break;
     }
-    if(jsonp && json) {*jsonp = json; json = NULL;}
-
+    *jsonp = json;
 done:
-    NCJreclaim(json);
     return NCJTHROW(stat);
+nomem:
+    stat = NCJTHROW(NCJ_ERR);
+    goto done;
 }
 
 static int
-NCJparseArray(NCJparser* parser, struct NCjlist* arrayp)
+NCJparseArray(NCJparser* parser, NCjson* array)
 {
     int stat = NCJ_OK;
-    int token = NCJ_UNDEF;
     NCjson* element = NULL;
-    int stop = 0;
+    size_t base = parser->nstack;
 
     /* [ ^e1,e2, ...en] */
 
-    while(!stop) {
+    for(;;) {
 	/* Recurse to get the value ei (might be null) */
 	if((stat = NCJparseR(parser,&element))==NCJ_ERR) goto done;
-	token = NCJlex(parser); /* Get next token */
+	NCJskipspace(parser);
 	/* Next token should be comma or rbracket */
-	switch(token) {
+	switch(*parser->pos++) {
 	case NCJ_RBRACKET:
-	    if(element != NULL) listappend(arrayp,element);
-	    element = NULL;
-	    stop = 1;
-	    break;
+	    if(element != NULL && (stat = NCJpush(parser,element))==NCJ_ERR) goto done;
+	    stat = NCJcollect(parser,base,array);
+	    goto done;
 	case NCJ_COMMA:
 	    /* Append the ei to the list */
 	    if(element == NULL) {stat = NCJTHROW(NCJ_ERR); goto done;} /* error */
-	    listappend(arrayp,element);
-	    element = NULL;
+	    if((stat = NCJpush(parser,element))==NCJ_ERR) goto done;
 	    break;
-	case NCJ_EOF:
-	case NCJ_UNDEF:
 	default:
 	    stat = NCJTHROW(NCJ_ERR);
 	    goto done;
@@ -436,146 +500,192 @@ NCJparseArray(NCJparser* parser, struct NCjlist* arrayp)
     }	
 
 done:
-    if(element != NULL)
-	NCJreclaim(element);
     return NCJTHROW(stat);
 }
 
 static int
-NCJparseDict(NCJparser* parser, struct NCjlist* dictp)
+NCJparseDict(NCJparser* parser, NCjson* dict)
 {
     int stat = NCJ_OK;
-    int token = NCJ_UNDEF;
     NCjson* value = NULL;
     NCjson* key = NULL;
-    int stop = 0;
+    size_t base = parser->nstack;
+    int sort;
+    char* word = NULL;
 
     /* { ^k1:v1,k2:v2, ...kn:vn] */
 
-    while(!stop) {
+    for(;;) {
 	/* Get the key, which must be a word of some sort */
-	token = NCJlex(parser);
-	switch(token) {
-	case NCJ_STRING:
-	case NCJ_BOOLEAN:
-	case NCJ_INT: case NCJ_DOUBLE: {
- 	    if((stat=NCJnewstring(token,parser->yytext,&key))==NCJ_ERR) goto done;
-	    } break;
-	case NCJ_RBRACE: /* End of containing Dict */
-	    stop = 1;
-	    continue; /* leave loop */
-	case NCJ_EOF: case NCJ_UNDEF:
-	default:
-	    stat = NCJTHROW(NCJ_ERR);
-	    goto done;
-	}
+	NCJskipspace(parser);
+	if(*parser->pos == NCJ_RBRACE) { /* End of containing Dict */
+	    parser->pos++;
+	    break;
+	} else if(*parser->pos == NCJ_QUOTE) {
+	    if((stat = NCJparseString(parser,&word))==NCJ_ERR) goto done;
+	    sort = NCJ_STRING;
+	} else if(ISWORD(*parser->pos)) {
+	    if((stat = NCJparseWord(parser,&sort,&word))==NCJ_ERR) goto done;
+	    if(sort == NCJ_NULL) {stat = NCJTHROW(NCJ_ERR); goto done;}
+	} else
+	    {stat = NCJTHROW(NCJ_ERR); goto done;}
+	if((key = NCJnode(parser,sort))==NULL) {stat = NCJTHROW(NCJ_ERR); goto done;}
+	key->string = word;
+	key->flags |= NCJF_ARENASTRING;
 	/* Next token must be colon*/
-   	switch((token = NCJlex(parser))) {
-	case NCJ_COLON: break;
-	case NCJ_UNDEF: case NCJ_EOF:
-	default: stat = NCJTHROW(NCJ_ERR); goto done;
-	}    
+	NCJskipspace(parser);
+	if(*parser->pos++ != NCJ_COLON) {stat = NCJTHROW(NCJ_ERR); goto done;}
 	/* Get the value */
 	if((stat = NCJparseR(parser,&value))==NCJ_ERR) goto done;
+	if(value == NULL) {stat = NCJTHROW(NCJ_ERR); goto done;}
+	/* Insert key value into dict: key first, then value */
+	if((stat = NCJpush(parser,key))==NCJ_ERR) goto done;
+	if((stat = NCJpush(parser,value))==NCJ_ERR) goto done;
         /* Next token must be comma or RBRACE */
-	switch((token = NCJlex(parser))) {
+	NCJskipspace(parser);
+	switch(*parser->pos++) {
 	case NCJ_RBRACE:
-	    stop = 1;
-	    /* fall thru */
+	    goto collect;
 	case NCJ_COMMA:
-	    /* Insert key value into dict: key first, then value */
-	    listappend(dictp,key);
-	    key = NULL;
-	    listappend(dictp,value);
-	    value = NULL;
 	    break;
-	case NCJ_EOF:
-	case NCJ_UNDEF:
 	default:
 	    stat = NCJTHROW(NCJ_ERR);
 	    goto done;
 	}	
     }	
+collect:
+    stat = NCJcollect(parser,base,dict);
 
 done:
-    if(key != NULL)
-	NCJreclaim(key);
-    if(value != NULL)
-	NCJreclaim(value);
     return NCJTHROW(stat);
 }
 
-static int
-NCJlex(NCJparser* parser)
+/* Skip whitespace; note that, historically, a backslash outside of
+   a string escapes the following character */
+static void
+NCJskipspace(NCJparser* parser)
 {
     int c;
-    int token = NCJ_UNDEF;
-    char* start;
-    size_t count;
-
-    while(token == 0) { /* avoid need to goto when retrying */
+    for(;;) {
 	c = *parser->pos;
-	if(c == '\0') {
-	    token = NCJ_EOF;
-	} else if(c <= ' ' || c == '\177') {/* ignore whitespace */
+	if(c == '\0')
+	    break;
+	else if(c <= ' ' || c == '\177') /* ignore whitespace */
 	    parser->pos++;
-	    continue;
-	} else if(c == NCJ_ESCAPE) {
+	else if(c == NCJ_ESCAPE) {
 	    parser->pos++;
 	    c = *parser->pos;
-	    *parser->pos = unescape1(c);
-	    continue;
-	} else if(strchr(JSON_WORD, c) != NULL) {
-	    start = parser->pos;
-	    for(;;) {
-		c = *parser->pos++;
-		if(c == '\0' || strchr(JSON_WORD,c) == NULL) break; /* end of word */
-	    }
-	    /* Pushback c */
-	    parser->pos--;
-	    count = ((parser->pos) - start);
-	    if(NCJyytext(parser,start,count)) goto done;
-	    /* Discriminate the word string to get the proper sort */
-	    if(testbool(parser->yytext) == NCJ_OK)
-		token = NCJ_BOOLEAN;
-	    /* do int test first since double subsumes int */
-	    else if(testint(parser->yytext) == NCJ_OK)
-		token = NCJ_INT;
-	    else if(testdouble(parser->yytext) == NCJ_OK)
-		token = NCJ_DOUBLE;
-	    else if(testnull(parser->yytext) == NCJ_OK)
-		token = NCJ_NULL;
-	    else
-		token = NCJ_STRING;
-	} else if(c == NCJ_QUOTE) {
-	    parser->pos++;
-	    start = parser->pos;
-	    for(;;) {
-		c = *parser->pos++;
-		if(c == NCJ_ESCAPE) parser->pos++;
-		else if(c == NCJ_QUOTE || c == '\0') break;
-	    }
-	    if(c == '\0') {
-		parser->status = NCJ_ERR;
-		token = NCJ_UNDEF;
-		goto done;
-	    }
-	    count = ((parser->pos) - start) - 1; /* -1 for trailing quote */
-	    if(NCJyytext(parser,start,count)==NCJ_ERR) goto done;
-	    if(NCJunescape(parser)==NCJ_ERR) goto done;
-	    token = NCJ_STRING;
-	} else { /* single char token */
-	    if(NCJyytext(parser,parser->pos,1)==NCJ_ERR) goto done;
-	    token = *parser->pos++;
+	    *parser->pos = (char)unescape1(c);
+	} else
+	    break;
+    }
+}
+
+/* Parse a quoted string and unescape it in place;
+   this is possible because the unescaped string
+   is never longer than the escaped one. */
+static int
+NCJparseString(NCJparser* parser, char** stringp)
+{
+    char* p = parser->pos+1; /* skip leading quote */
+    char* q = p;
+    int c;
+
+    *stringp = p;
+    for(;;) {
+	c = *p++;
+	if(c == '\0')
+	    return NCJTHROW(NCJ_ERR); /* unterminated */
+	if(c == NCJ_QUOTE)
+	    break;
+	if(c == NCJ_ESCAPE) {
+	    c = *p++;
+	    if(c == '\0') return NCJTHROW(NCJ_ERR);
+	    c = unescape1(c);
 	}
-#ifdef NCJDEBUG
-fprintf(stderr,"%s(%d): |%s|\n",tokenname(token),token,parser->yytext);
-#endif
-    } /*for(;;)*/
-done:
-    if(parser->status == NCJ_ERR)
-        token = NCJ_UNDEF;
-    return token;
+	*q++ = (char)c;
+    }
+    *q = '\0'; /* At or before the closing quote */
+    parser->pos = p;
+    return NCJTHROW(NCJ_OK);
+}
+
+/* Parse an unquoted word and discriminate it to get the proper sort */
+static int
+NCJparseWord(NCJparser* parser, int* sortp, char** wordp)
+{
+    char* start = parser->pos;
+    size_t count;
+    char* word = NULL;
+
+    while(ISWORD(*parser->pos)) parser->pos++;
+    count = (size_t)(parser->pos - start);
+    /* The word cannot be terminated in place without clobbering the
+       following character, so copy it; words are short */
+    if((word = (char*)arenaalloc(parser->arena,count+1)) == NULL)
+	return NCJTHROW(NCJ_ERR);
+    memcpy(word,start,count);
+    word[count] = '\0';
+    if(testbool(word) == NCJ_OK)
+	*sortp = NCJ_BOOLEAN;
+    /* do int test first since double subsumes int */
+    else if(testint(word) == NCJ_OK)
+	*sortp = NCJ_INT;
+    else if(testdouble(word) == NCJ_OK)
+	*sortp = NCJ_DOUBLE;
+    else if(testnull(word) == NCJ_OK)
+	*sortp = NCJ_NULL;
+    else
+	*sortp = NCJ_STRING;
+    *wordp = word;
+    return NCJTHROW(NCJ_OK);
+}
+
+/* Push a member of the container being parsed */
+static int
+NCJpush(NCJparser* parser, NCjson* json)
+{
+    if(parser->nstack >= parser->stackalloc) {
+	size_t newalloc = (parser->stackalloc == 0 ? 64 : 2*parser->stackalloc);
+	NCjson** newstack = (NCjson**)realloc(parser->stack,newalloc*sizeof(NCjson*));
+	if(newstack == NULL) return NCJTHROW(NCJ_ERR);
+	parser->stack = newstack;
+	parser->stackalloc = newalloc;
+    }
+    parser->stack[parser->nstack++] = json;
+    return NCJTHROW(NCJ_OK);
+}
+
+/* Move the members pushed since base into the container;
+   as with listappend, the contents are NULL terminated */
+static int
+NCJcollect(NCJparser* parser, size_t base, NCjson* container)
+{
+    size_t n = parser->nstack - base;
+    if(n > 0) {
+	NCjson** contents = (NCjson**)arenaalloc(parser->arena,(n+1)*sizeof(NCjson*));
+	if(contents == NULL) return NCJTHROW(NCJ_ERR);
+	memcpy(contents,&parser->stack[base],n*sizeof(NCjson*));
+	contents[n] = NULL;
+	container->list.contents = contents;
+	container->list.len = (int)n;
+	container->list.alloc = (int)n;
+	container->flags |= NCJF_ARENALIST;
+    }
+    parser->nstack = base;
+    return NCJTHROW(NCJ_OK);
+}
+
+static NCjson*
+NCJnode(NCJparser* parser, int sort)
+{
+    NCjson* json = (NCjson*)arenaalloc(parser->arena,sizeof(NCjson));
+    if(json != NULL) {
+	memset(json,0,sizeof(NCjson));
+	json->sort = sort;
+	json->flags = NCJF_ARENANODE;
+    }
+    return json;
 }
 
 static int
@@ -598,20 +708,17 @@ testbool(const char* word)
 static int
 testint(const char* word)
 {
-    int ncvt;
-    long long i;
-    int count = 0;
-    /* Try to convert to number */
-    ncvt = sscanf(word,"%lld%n",&i,&count);
-    return NCJTHROW((ncvt == 1 && strlen(word)==count ? NCJ_OK : NCJ_ERR));
+    char* end = NULL;
+    /* Only words starting with a sign or digit can be numbers */
+    if(strchr("+-0123456789",word[0]) == NULL) return NCJTHROW(NCJ_ERR);
+    (void)strtoll(word,&end,10);
+    return NCJTHROW((end != word && *end == '\0' ? NCJ_OK : NCJ_ERR));
 }
 
 static int
 testdouble(const char* word)
 {
-    int ncvt;
-    double d;
-    int count = 0;
+    char* end = NULL;
     /* Check for Nan and Infinity */
     if(strcasecmp("nan",word)==0) return NCJTHROW(NCJ_OK);
     if(strcasecmp("infinity",word)==0) return NCJTHROW(NCJ_OK);
@@ -621,25 +728,48 @@ testdouble(const char* word)
     if(strcasecmp("infinityf",word)==0) return NCJTHROW(NCJ_OK);
     if(strcasecmp("-infinityf",word)==0) return NCJTHROW(NCJ_OK);
     /* Try to convert to number */
-    ncvt = sscanf(word,"%lg%n",&d,&count);
-    return NCJTHROW((ncvt == 1 && strlen(word)==count ? NCJ_OK : NCJ_ERR));
+    if(strchr("+-.0123456789iInN",word[0]) == NULL) return NCJTHROW(NCJ_ERR);
+    (void)strtod(word,&end);
+    return NCJTHROW((end != word && *end == '\0' ? NCJ_OK : NCJ_ERR));
 }
 
-static int
-NCJyytext(NCJparser* parser, char* start, size_t pdlen)
+/**************************************************/
+/* Arena management */
+
+static void*
+arenaalloc(NCjarena* arena, size_t size)
 {
-    size_t len = (size_t)pdlen;
-    if(parser->yytext == NULL) {
-	parser->yytext = (char*)malloc(len+1);
-	parser->yylen = len;
-    } else if(parser->yylen <= len) {
-	parser->yytext = (char*) realloc(parser->yytext,len+1);
-	parser->yylen = len;
+    NCJblock* block = arena->blocks;
+    void* mem = NULL;
+
+    size = NCJALIGN(size);
+    if(block == NULL || block->used + size > block->size) {
+	size_t blocksize = arena->nextsize;
+	if(blocksize < size) blocksize = size;
+	if((block = (NCJblock*)malloc(NCJBLOCKHDR + blocksize)) == NULL)
+	    return NULL;
+	block->size = blocksize;
+	block->used = 0;
+	block->next = arena->blocks;
+	arena->blocks = block;
+	if(arena->nextsize < NCJ_ARENA_MAX) arena->nextsize *= 2;
     }
-    if(parser->yytext == NULL) return NCJTHROW(NCJ_ERR);
-    memcpy(parser->yytext,start,len);
-    parser->yytext[len] = '\0';
-    return NCJTHROW(NCJ_OK);
+    mem = ((char*)block) + NCJBLOCKHDR + block->used;
+    block->used += size;
+    return mem;
+}
+
+static void
+arenafree(NCjarena* arena)
+{
+    NCJblock* block;
+    if(arena == NULL) return;
+    while((block = arena->blocks) != NULL) {
+	arena->blocks = block->next;
+	free(block);
+    }
+    nullfree(arena->text);
+    free(arena);
 }
 
 /**************************************************/
@@ -647,39 +777,49 @@ NCJyytext(NCJparser* parser, char* start, size_t pdlen)
 OPTSTATIC void
 NCJreclaim(NCjson* json)
 {
+    NCjarena* arena = NULL;
     if(json == NULL) return;
     switch(json->sort) {
     case NCJ_INT:
     case NCJ_DOUBLE:
     case NCJ_BOOLEAN:
     case NCJ_STRING: 
-	nullfree(json->string);
+	if(!(json->flags & NCJF_ARENASTRING))
+	    nullfree(json->string);
 	break;
     case NCJ_DICT:
-	NCJreclaimDict(&json->list);
+	NCJreclaimDict(json);
 	break;
     case NCJ_ARRAY:
-	NCJreclaimArray(&json->list);
+	NCJreclaimArray(json);
 	break;
     default: break; /* nothing to reclaim */
     }
-    free(json);
+    arena = json->arena;
+    if(!(json->flags & NCJF_ARENANODE))
+	free(json);
+    /* Must be last since json may be in the arena */
+    arenafree(arena);
 }
 
 static void
-NCJreclaimArray(struct NCjlist* array)
+NCJreclaimArray(NCjson* array)
 {
     int i;
-    for(i=0;i<array->len;i++) {
-	NCJreclaim(array->contents[i]);
+    for(i=0;i<array->list.len;i++) {
+	NCJreclaim(array->list.contents[i]);
     }
-    nullfree(array->contents);
-    array->contents = NULL;
+    if(!(array->flags & NCJF_ARENALIST))
+	nullfree(array->list.contents);
+    array->list.contents = NULL;
+    array->list.len = 0;
+    array->list.alloc = 0;
 }
 
 static void
-NCJreclaimDict(struct NCjlist* dict)
+NCJreclaimDict(NCjson* dict)
 {
+   NCJfreeindex(dict);
    NCJreclaimArray(dict);
 }
 
@@ -748,14 +888,40 @@ OPTSTATIC int
 NCJdictget(const NCjson* dict, const char* key, NCjson** valuep)
 {
     int i,stat = NCJ_OK;
+    NCjindex* index = NULL;
 
     if(dict == NULL || dict->sort != NCJ_DICT)
         {stat = NCJTHROW(NCJ_ERR); goto done;}
     if(valuep) {*valuep = NULL;}
+    if(NCJlength(dict)/2 >= NCJ_INDEX_MIN) {
+	/* Large dict: (re)build the index if needed; the index is a cache,
+	   so casting away the const is harmless */
+	index = dict->index;
+	if(index == NULL || index->len != dict->list.len || index->contents != dict->list.contents) {
+	    if(NCJbuildindex((NCjson*)dict) == NCJ_OK)
+		index = dict->index;
+	    else
+		index = NULL; /* fall back to a linear search */
+	}
+    }
+    if(index != NULL) {
+	size_t b = NCJhash(key) & index->mask;
+	for(;;b=((b+1) & index->mask)) {
+	    NCjson* jkey;
+	    if(index->buckets[b] == 0) break; /* not found */
+	    jkey = NCJith(dict,index->buckets[b]-1);
+	    if(strcmp(jkey->string,key)==0) {
+		if(valuep) {*valuep = NCJith(dict,index->buckets[b]);}
+		break;
+	    }
+	}
+	goto done;
+    }
     for(i=0;i<NCJlength(dict);i+=2) {
 	NCjson* jkey = NCJith(dict,i);
 	if(jkey->string != NULL && strcmp(jkey->string,key)==0) {
-	    if(valuep) {*valuep = NCJith(dict,i+1); break;}
+	    if(valuep && i+1 < NCJlength(dict)) {*valuep = NCJith(dict,i+1);}
+	    break;
 	}	    
     }
 
@@ -763,33 +929,58 @@ done:
     return NCJTHROW(stat);
 }
 
-/* Unescape the text in parser->yytext; can
-   do in place because unescaped string will
-   always be shorter */
+/* FNV-1a */
+static unsigned
+NCJhash(const char* key)
+{
+    unsigned h = 2166136261U;
+    const unsigned char* p;
+    for(p=(const unsigned char*)key;*p;p++) {
+	h ^= *p;
+	h *= 16777619U;
+    }
+    return h;
+}
+
+/* Build a hash index over the keys of a dict; the first
+   occurrence of a duplicated key wins, as for a linear search */
 static int
-NCJunescape(NCJparser* parser)
+NCJbuildindex(NCjson* dict)
 {
-    char* p = parser->yytext;
-    char* q = p;
-    int c;
-    for(;(c=*p++);) {
-	if(c == NCJ_ESCAPE) {
-	    c = *p++;
-	    switch (c) {
-	    case 'b': c = '\b'; break;
-	    case 'f': c = '\f'; break;
-	    case 'n': c = '\n'; break;
-	    case 'r': c = '\r'; break;
-	    case 't': c = '\t'; break;
-	    case NCJ_QUOTE: c = c; break;
-	    case NCJ_ESCAPE: c = c; break;
-	    default: c = c; break;/* technically not Json conformant */
-	    }
+    int i, npairs = NCJlength(dict)/2;
+    size_t nbuckets = 16;
+    NCjindex* index = NULL;
+
+    NCJfreeindex(dict);
+    while(nbuckets < (size_t)(2*npairs)) nbuckets <<= 1;
+    if((index = (NCjindex*)calloc(1,sizeof(NCjindex))) == NULL)
+	return NCJTHROW(NCJ_ERR);
+    if((index->buckets = (int*)calloc(nbuckets,sizeof(int))) == NULL)
+	{free(index); return NCJTHROW(NCJ_ERR);}
+    index->mask = nbuckets - 1;
+    index->len = dict->list.len;
+    index->contents = dict->list.contents;
+    for(i=0;i<2*npairs;i+=2) {
+	NCjson* jkey = NCJith(dict,i);
+	size_t b;
+	if(jkey == NULL || jkey->string == NULL) continue;
+	for(b=(NCJhash(jkey->string) & index->mask);;b=((b+1) & index->mask)) {
+	    if(index->buckets[b] == 0) {index->buckets[b] = i+1; break;}
+	    if(strcmp(NCJith(dict,index->buckets[b]-1)->string,jkey->string)==0) break; /* duplicate */
 	}
-	*q++ = c;
     }
-    *q = '\0';
-    return NCJTHROW(NCJ_OK);    
+    dict->index = index;
+    return NCJTHROW(NCJ_OK);
+}
+
+static void
+NCJfreeindex(NCjson* dict)
+{
+    if(dict->index != NULL) {
+	nullfree(dict->index->buckets);
+	free(dict->index);
+	dict->index = NULL;
+    }
 }
 
 /* Unescape a single character */
@@ -807,33 +998,6 @@ unescape1(int c)
     return c;
 }
 
-#ifdef NCJDEBUG
-static char*
-tokenname(int token)
-{
-    switch (token) {
-    case NCJ_STRING: return ("NCJ_STRING");
-    case NCJ_INT: return ("NCJ_INT");
-    case NCJ_DOUBLE: return ("NCJ_DOUBLE");
-    case NCJ_BOOLEAN: return ("NCJ_BOOLEAN");
-    case NCJ_DICT: return ("NCJ_DICT");
-    case NCJ_ARRAY: return ("NCJ_ARRAY");
-    case NCJ_NULL: return ("NCJ_NULL");
-    default:
-	if(token > ' ' && token <= 127) {
-	    static char s[4];
-	    s[0] = '\'';
-	    s[1] = (char)token;
-	    s[2] = '\'';
-	    s[3] = '\0';
-	    return (s);
-	} else
-	    break;
-    }
-    return ("NCJ_UNDEF");
-}
-#endif
-
 /* Convert a JSON value to an equivalent value of a specified sort */
 OPTSTATIC int
 NCJcvt(const NCjson* jvalue, int outsort, struct NCJconst* output)
@@ -911,34 +1075,35 @@ done:
     return NCJTHROW(stat);
 }
 
+/* Note that some callers depend on the contents being NULL terminated */
 static int
-listappend(struct NCjlist* list, NCjson* json)
+listappend(NCjson* container, NCjson* json)
 {
     int stat = NCJ_OK;
+    struct NCjlist* list = &container->list;
     NCjson** newcontents = NULL;
 
     assert(list->len == 0 || list->contents != NULL);
     if(json == NULL)
         {stat = NCJTHROW(NCJ_ERR); goto done;}
-    if(list->len == 0) {
-	nullfree(list->contents);
-	list->contents = (NCjson**)calloc(2,sizeof(NCjson*));
-	if(list->contents == NULL)
-	    {stat = NCJTHROW(NCJ_ERR); goto done;}
-	list->contents[0] = json;
-	list->len++;
-    } else {
-        if((newcontents = (NCjson**)calloc((2*list->len)+1,sizeof(NCjson*)))==NULL)
+    if(list->len+1 >= list->alloc || (container->flags & NCJF_ARENALIST)) {
+	int newalloc = (list->len < 4 ? 8 : 2*list->len);
+	if(container->flags & NCJF_ARENALIST) {
+	    /* Move the contents out of the arena */
+	    if((newcontents = (NCjson**)malloc((size_t)newalloc*sizeof(NCjson*)))==NULL)
+                {stat = NCJTHROW(NCJ_ERR); goto done;}
+	    if(list->len > 0)
+	        memcpy(newcontents,list->contents,(size_t)list->len*sizeof(NCjson*));
+	    container->flags &= ~NCJF_ARENALIST;
+	} else if((newcontents = (NCjson**)realloc(list->contents,(size_t)newalloc*sizeof(NCjson*)))==NULL)
             {stat = NCJTHROW(NCJ_ERR); goto done;}
-        memcpy(newcontents,list->contents,list->len*sizeof(NCjson*));
-	newcontents[list->len] = json;
-	list->len++;
-	free(list->contents);
-	list->contents = newcontents; newcontents = NULL;
+	list->contents = newcontents;
+	list->alloc = newalloc;
     }
+    list->contents[list->len++] = json;
+    list->contents[list->len] = NULL;
 
 done:
-    nullfree(newcontents);
     return NCJTHROW(stat);
 }
 
@@ -1053,7 +1218,7 @@ NCJappend(NCjson* object, NCjson* value)
     switch (object->sort) {
     case NCJ_ARRAY:
     case NCJ_DICT:
-	listappend(&object->list,value);
+	if(listappend(object,value)==NCJ_ERR) return NCJTHROW(NCJ_ERR);
 	break;
     default:
 	return NCJTHROW(NCJ_ERR);
@@ -1068,7 +1233,7 @@ OPTSTATIC int
 NCJunparse(const NCjson* json, unsigned flags, char** textp)
 {
     int stat = NCJ_OK;
-    NCJbuf buf = {0,NULL};
+    NCJbuf buf = {0,0,NULL};
     if((stat = NCJunparseR(json,&buf,flags))==NCJ_ERR)
 	goto done;
     if(textp) {*textp = buf.text; buf.text = NULL; buf.len = 0;}
@@ -1102,7 +1267,7 @@ NCJunparseR(const NCjson* json, NCJbuf* buf, unsigned flags)
 		bytesappendc(buf,NCJ_COLON);
 		bytesappendc(buf,' ');
 		/* Allow for the possibility of a short dict entry */
-		if(json->list.contents[i+1] == NULL) { /* short */
+		if(i+1 >= json->list.len || json->list.contents[i+1] == NULL) { /* short */
 	   	    bytesappendc(buf,'?');		
 		    shortlist = 1;
 		} else {
@@ -1171,41 +1336,34 @@ bytesappendquoted(NCJbuf* buf, const char* s)
 static int
 bytesappend(NCJbuf* buf, const char* s)
 {
-    int stat = NCJ_OK;
-    char* newtext = NULL;
-    if(buf == NULL)
-        {stat = NCJTHROW(NCJ_ERR); goto done;}
     if(s == NULL) s = "";
-    if(buf->len == 0) {
-	assert(buf->text == NULL);
-	buf->text = strdup(s);
-	if(buf->text == NULL)
-	    {stat = NCJTHROW(NCJ_ERR); goto done;}
-	buf->len = strlen(s);
-    } else {
-	size_t slen = strlen(s);
-	size_t newlen = buf->len + slen + 1;
-        if((newtext = (char*)malloc(newlen))==NULL)
-            {stat = NCJTHROW(NCJ_ERR); goto done;}
-        strcpy(newtext,buf->text);
-	strcat(newtext,s);	
-	free(buf->text); buf->text = NULL;
-	buf->text = newtext; newtext = NULL;
-	buf->len = newlen;
-    }
+    return bytesappendn(buf,s,strlen(s));
+}
 
-done:
-    nullfree(newtext);
-    return NCJTHROW(stat);
+static int
+bytesappendn(NCJbuf* buf, const char* s, size_t n)
+{
+    if(buf == NULL)
+        return NCJTHROW(NCJ_ERR);
+    if(buf->len + n + 1 > buf->alloc) {
+	size_t newalloc = (buf->alloc < 64 ? 64 : 2*buf->alloc);
+	char* newtext = NULL;
+	while(newalloc < buf->len + n + 1) newalloc *= 2;
+        if((newtext = (char*)realloc(buf->text,newalloc))==NULL)
+            return NCJTHROW(NCJ_ERR);
+	buf->text = newtext;
+	buf->alloc = newalloc;
+    }
+    memcpy(buf->text+buf->len,s,n);
+    buf->len += n;
+    buf->text[buf->len] = '\0';
+    return NCJTHROW(NCJ_OK);
 }
 
 static int
 bytesappendc(NCJbuf* bufp, const char c)
 {
-    char s[2];
-    s[0] = c;
-    s[1] = '\0';
-    return bytesappend(bufp,s);
+    return bytesappendn(bufp,&c,1);
 }
 
 OPTSTATIC void
@@ -24,8 +24,12 @@ typedef struct NC_memio {
     void* memory;
     int flags;
 #define NC_MEMIO_LOCKED 1    /* Do not try to realloc or free provided memory */
+#define NC_MEMIO_COW 2       /* memory is an NC_memimage* shared copy-on-write */
 } NC_memio;
 
+/* Opaque page-granular image of a netcdf-3 file; see docs/inmemory.md */
+typedef struct NC_memimage NC_memimage;
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -43,6 +47,17 @@ EXTERNL int nc_open_memio(const char* path, int mode, NC_memio* info, int* ncidp
 /* Close memory file and return the final memory state */
 EXTERNL int nc_close_memio(int ncid, NC_memio* info);
 
+/* Build a copy-on-write image from a block of memory (which is copied) */
+EXTERNL int nc_memimage_create(size_t size, const void* memory, NC_memimage** imagep);
+
+/* Release a reference to an image; pages still used elsewhere are kept */
+EXTERNL int nc_memimage_free(NC_memimage* image);
+
+EXTERNL int nc_memimage_size(const NC_memimage* image, size_t* sizep);
+
+/* Copy count bytes starting at offset out of an image */
+EXTERNL int nc_memimage_read(const NC_memimage* image, size_t offset, size_t count, void* buf);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -35,11 +35,22 @@ NCD4_fetchhttpcode(CURL* curl)
 
 int
 NCD4_fetchurl_file(CURL* curl, const char* url, FILE* stream,
-                d4size_t* sizep, long* filetime)
+                d4size_t* sizep, long* filetime, NChttpcache* cache)
 {
     int ret = NC_NOERR;
     CURLcode cstat = CURLE_OK;
     struct Fetchdata fetchdata;
+    long httpcode = 0;
+    int notmodified = 0;
+
+    /* Use a stored response if it is recent enough */
+    if(NC_httpcache_fresh(cache)) {
+        size_t size = 0;
+        if(NC_httpcache_read(cache,NULL,stream,&size,filetime) == NC_NOERR) {
+            if(sizep != NULL) *sizep = (d4size_t)size;
+            return THROW(ret);
+        }
+    }
 
     /* Set the URL */
     cstat = curl_easy_setopt(curl, CURLOPT_URL, (void*)url);
@@ -59,7 +70,20 @@ NCD4_fetchurl_file(CURL* curl, const char* url, FILE* stream,
 
     fetchdata.stream = stream;
     fetchdata.size = 0;
+    (void)NC_httpcache_prepare(cache,curl);
     cstat = curl_easy_perform(curl);
+    if(cache != NULL && cstat != CURLE_OK) {
+        /* Do not store a failed transfer */
+        long nocode = 0;
+        (void)NC_httpcache_complete(cache,curl,&nocode,NULL,NULL,NULL,NULL);
+    } else if(cache != NULL) {
+        size_t size = fetchdata.size;
+        httpcode = NCD4_fetchhttpcode(curl);
+        notmodified = (httpcode == 304);
+        if((ret = NC_httpcache_complete(cache,curl,&httpcode,NULL,stream,&size,filetime)))
+            goto fail;
+        fetchdata.size = size;
+    }
     if (cstat != CURLE_OK)
         {ret = NC_EDAPSVC; goto fail;}
 
@@ -71,7 +95,7 @@ NCD4_fetchurl_file(CURL* curl, const char* url, FILE* stream,
         if (sizep != NULL)
             *sizep = fetchdata.size;
         /* Get the last modified time */
-        if(filetime != NULL)
+        if(filetime != NULL && !notmodified)
             cstat = curl_easy_getinfo(curl,CURLINFO_FILETIME,filetime);
         if(cstat != CURLE_OK)
 	    {ret = NC_ECURL; goto fail;}
@@ -87,12 +111,21 @@ fail:
 }
 
 int
-NCD4_fetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime, int* httpcodep)
+NCD4_fetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime, int* httpcodep, NChttpcache* cache)
 {
     int ret = NC_NOERR;
     CURLcode cstat = CURLE_OK;
     size_t len;
     long httpcode = 0;
+    int notmodified = 0;
+    int partial = 0;
+
+    /* Use a stored response if it is recent enough */
+    if(NC_httpcache_fresh(cache)
+       && NC_httpcache_read(cache,buf,NULL,NULL,filetime) == NC_NOERR) {
+        if(httpcodep) *httpcodep = 200;
+        return THROW(ret);
+    }
 
     /* send all data to this function  */
     cstat = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
@@ -113,6 +146,7 @@ NCD4_fetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime, int* ht
     if (cstat != CURLE_OK)
         goto done;
 
+    (void)NC_httpcache_prepare(cache,curl);
     cstat = curl_easy_perform(curl);
 
     if(cstat == CURLE_PARTIAL_FILE) {
@@ -120,14 +154,27 @@ NCD4_fetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime, int* ht
         nclog(NCLOGWARN, "curl error: %s; ignored",
                curl_easy_strerror(cstat));
         cstat = CURLE_OK;
+        partial = 1;
+    }
+    if(cstat != CURLE_OK) {
+        (void)NC_httpcache_complete(cache,curl,&httpcode,NULL,NULL,NULL,NULL);
+        goto done;
     }
-    if(cstat != CURLE_OK) goto done;
 
     httpcode = NCD4_fetchhttpcode(curl);
+    if(cache != NULL && partial) {
+        /* Do not store a truncated transfer */
+        long nocode = 0;
+        (void)NC_httpcache_complete(cache,curl,&nocode,NULL,NULL,NULL,NULL);
+    } else if(cache != NULL) {
+        notmodified = (httpcode == 304);
+        if((ret = NC_httpcache_complete(cache,curl,&httpcode,buf,NULL,NULL,filetime)))
+            return THROW(ret);
+    }
     if(httpcodep) *httpcodep = httpcode;
 
     /* Get the last modified time */
-    if(filetime != NULL)
+    if(filetime != NULL && !notmodified)
         cstat = curl_easy_getinfo(curl,CURLINFO_FILETIME,filetime);
     if(cstat != CURLE_OK) goto done;
 
@@ -292,7 +339,7 @@ NCD4_ping(const char* url)
 
     /* Try to get the file */
     buf = ncbytesnew();
-    ret = NCD4_fetchurl(curl,url,buf,NULL,NULL);
+    ret = NCD4_fetchurl(curl,url,buf,NULL,NULL,NULL);
     if(ret == NC_NOERR) {
         /* Don't trust curl to return an error when request gets 404 */
         long http_code = 0;
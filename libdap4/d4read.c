@@ -55,6 +55,7 @@ NCD4_readDMR(NCD4INFO* state, int flags)
             stat = readfiletofile(state, url, NCD4_DMR, NCD4_FORMAT_XML, state->data.ondiskfile, &state->data.datasize);
         } else {
 	    char* readurl = NULL;
+            NChttpcache* cache = NULL;
             int flags = 0;
             if(!fileprotocol) flags |= NCURIQUERY;
             flags |= NCURIENCODE;
@@ -65,8 +66,10 @@ NCD4_readDMR(NCD4INFO* state, int flags)
 	    readurl = ncuribuild(url,NULL,".dmr.xml",NCURISVC);
 	    if(readurl == NULL)
 		return THROW(NC_ENOMEM);
-            stat = NCD4_fetchurl_file(state->curl, readurl, state->data.ondiskfile,
-                                   &state->data.datasize, &lastmod);
+            if((stat = NC_httpcache_open(state->auth,readurl,&cache)) == NC_NOERR)
+                stat = NCD4_fetchurl_file(state->curl->curl, readurl, state->data.ondiskfile,
+                                   &state->data.datasize, &lastmod, cache);
+            NC_httpcache_close(cache);
             nullfree(readurl);
             if(stat == NC_NOERR)
                 state->data.dmrlastmodified = lastmod;
@@ -96,6 +99,7 @@ NCD4_readDAP(NCD4INFO* state, int flags)
             stat = readfiletofile(state, url, NCD4_DAP, NCD4_FORMAT_NONE, state->data.ondiskfile, &state->data.datasize);
         } else {
 	    char* readurl = NULL;
+            NChttpcache* cache = NULL;
             int flags = 0;
             if(!fileprotocol) flags |= NCURIQUERY;
             flags |= NCURIENCODE;
@@ -106,8 +110,10 @@ NCD4_readDAP(NCD4INFO* state, int flags)
 	    readurl = ncuribuild(url,NULL,".dap",NCURISVC);
 	    if(readurl == NULL)
 		return THROW(NC_ENOMEM);
-            stat = NCD4_fetchurl_file(state->curl, readurl, state->data.ondiskfile,
-                                   &state->data.datasize, &lastmod);
+            if((stat = NC_httpcache_open(state->auth,readurl,&cache)) == NC_NOERR)
+                stat = NCD4_fetchurl_file(state->curl->curl, readurl, state->data.ondiskfile,
+                                   &state->data.datasize, &lastmod, cache);
+            NC_httpcache_close(cache);
             nullfree(readurl);
             if(stat == NC_NOERR)
                 state->data.daplastmodified = lastmod;
@@ -173,6 +179,7 @@ readpacket(NCD4INFO* state, NCURI* url, NCbytes* packet, NCD4mode dxx, NCD4forma
 	stat = readfile(state, url, dxx, fxx, packet);
     } else {
         char* fetchurl = NULL;
+        NChttpcache* cache = NULL;
 	int flags = NCURIBASE;
 
 	if(!fileprotocol) flags |= NCURIQUERY;
@@ -185,7 +192,9 @@ readpacket(NCD4INFO* state, NCURI* url, NCbytes* packet, NCD4mode dxx, NCD4forma
    	    gettimeofday(&time0,NULL);
 #endif
 	}
-        stat = NCD4_fetchurl(curl,fetchurl,packet,lastmodified,&state->substrate.metadata->error.httpcode);
+        if((stat = NC_httpcache_open(state->auth,fetchurl,&cache)) == NC_NOERR)
+            stat = NCD4_fetchurl(curl,fetchurl,packet,lastmodified,&state->substrate.metadata->error.httpcode,cache);
+        NC_httpcache_close(cache);
         nullfree(fetchurl);
 	if(stat) goto fail;
 	if(FLAGSET(state->controls.flags,NCF_SHOWFETCH)) {
@@ -77,8 +77,8 @@ EXTERNL int dsp_open(const char* path, ND4dsp** dspp);
 
 /* From d4http.c */
 EXTERNL long NCD4_fetchhttpcode(CURL* curl);
-EXTERNL int NCD4_fetchurl_file(CURL* curl, const char* url, FILE* stream, d4size_t* sizep, long* filetime);
-EXTERNL int NCD4_fetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime, int* httpcode);
+EXTERNL int NCD4_fetchurl_file(CURL* curl, const char* url, FILE* stream, d4size_t* sizep, long* filetime, NChttpcache* cache);
+EXTERNL int NCD4_fetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime, int* httpcode, NChttpcache* cache);
 EXTERNL int NCD4_curlopen(CURL** curlp);
 EXTERNL void NCD4_curlclose(CURL* curl);
 EXTERNL int NCD4_fetchlastmodified(CURL* curl, char* url, long* filetime);
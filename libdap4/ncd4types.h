@@ -18,6 +18,7 @@ are defined here.
 
 #include "ncrc.h"
 #include "ncauth.h"
+#include "nchttpcache.h"
 
 /*
 Control if struct fields can be map targets.
@@ -0,0 +1,249 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+/**
+ * @file
+ *
+ * Arena reads of strings and vlens.
+ *
+ * Reading a variable of strings or vlens normally returns one
+ * malloc'd block per element, each of which must then be freed. An
+ * arena read instead allocates all of that data from a few large
+ * blocks owned by an nc_arena_t, which are released together by
+ * nc_free_arena().
+ *
+ * During an arena read the arena is made the current arena; the
+ * format code that fills the caller's memory (HDF5 through its vlen
+ * memory manager, NCZarr through NC_copy_data_arena) allocates from
+ * it. For other formats the data is read as usual and then copied
+ * into the arena.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include "ncdispatch.h"
+#include "ncarena.h"
+
+/* Size of a regular arena block */
+#define ARENA_BLOCKSIZE (64*1024)
+/* Alignment of all allocations */
+#define ARENA_ALIGN 16
+
+#define ARENA_ROUND(n) ((((n)+ARENA_ALIGN-1)/ARENA_ALIGN)*ARENA_ALIGN)
+
+/* Arena blocks form a list; the first block is the one being filled */
+typedef struct NCarenablock {
+    struct NCarenablock* next;
+    size_t size; /* usable bytes */
+    size_t used;
+} NCarenablock;
+
+#define ARENA_HDRSIZE ARENA_ROUND(sizeof(NCarenablock))
+
+/* The arena of the arena read in progress, if any */
+static nc_arena_t* current_arena = NULL;
+
+/**
+ * @internal Return the arena of the arena read in progress.
+ *
+ * @return The arena, or NULL outside of an arena read.
+ */
+nc_arena_t*
+NC_arena_current(void)
+{
+    return current_arena;
+}
+
+/**
+ * @internal Allocate zeroed memory from an arena. The memory is
+ * released only by nc_free_arena().
+ *
+ * @param arena The arena.
+ * @param size Number of bytes.
+ *
+ * @return The memory, or NULL if out of memory.
+ */
+void*
+NC_arena_alloc(nc_arena_t* arena, size_t size)
+{
+    NCarenablock* head = (NCarenablock*)arena->blocks;
+    NCarenablock* block = NULL;
+    void* p = NULL;
+
+    size = ARENA_ROUND(size == 0 ? 1 : size);
+    if(head != NULL && head->size - head->used >= size) {
+	p = ((char*)head) + ARENA_HDRSIZE + head->used;
+	head->used += size;
+	return p;
+    }
+    /* Large requests get a block of their own behind the current one */
+    if(size > ARENA_BLOCKSIZE/4) {
+	if((block = (NCarenablock*)calloc(1,ARENA_HDRSIZE+size)) == NULL) return NULL;
+	block->size = size;
+	block->used = size;
+	if(head == NULL)
+	    arena->blocks = block;
+	else {
+	    block->next = head->next;
+	    head->next = block;
+	}
+    } else {
+	if((block = (NCarenablock*)calloc(1,ARENA_HDRSIZE+ARENA_BLOCKSIZE)) == NULL) return NULL;
+	block->size = ARENA_BLOCKSIZE;
+	block->used = size;
+	block->next = head;
+	arena->blocks = block;
+    }
+    arena->size += block->size;
+    return ((char*)block) + ARENA_HDRSIZE;
+}
+
+/**
+ * @internal Read a hyperslab, allocating strings and vlen data from
+ * an arena.
+ *
+ * @param ncid NetCDF or group ID.
+ * @param varid Variable ID.
+ * @param startp Start vector.
+ * @param countp Count vector.
+ * @param ip Where the data go.
+ * @param memtype Memory type.
+ * @param arena The arena.
+ *
+ * @return ::NC_NOERR No error.
+ */
+static int
+NC_get_vara_arena(int ncid, int varid, const size_t *startp, const size_t *countp,
+                  void *ip, nc_type memtype, nc_arena_t *arena)
+{
+    NC* ncp;
+    int stat = NC_NOERR;
+    nc_arena_t* saved = current_arena;
+    size_t* my_count = (size_t*)countp;
+    void* tmp = NULL;
+    size_t nelems = 1, size = 0;
+    int i, ndims;
+
+    if((stat = NC_check_id(ncid, &ncp))) return stat;
+    if(arena == NULL) return NC_EINVAL;
+
+    switch (ncp->dispatch->model) {
+    case NC_FORMATX_NC_HDF5:
+    case NC_FORMATX_NCZARR:
+	/* These allocate from the current arena */
+	current_arena = arena;
+	stat = NC_get_vara(ncid, varid, startp, countp, ip, memtype);
+	current_arena = saved;
+	break;
+    default:
+	/* Read as usual, then move the data into the arena */
+	if((stat = nc_inq_varndims(ncid, varid, &ndims))) goto done;
+	if((stat = nc_inq_type(ncid, memtype, NULL, &size))) goto done;
+	if(startp == NULL || countp == NULL) {
+	    if((stat = NC_check_nulls(ncid, varid, startp, &my_count, NULL))) goto done;
+	}
+	for(i=0;i<ndims;i++) nelems *= my_count[i];
+	if(nelems == 0) goto done;
+	if((tmp = calloc(nelems,size)) == NULL) {stat = NC_ENOMEM; goto done;}
+	if((stat = NC_get_vara(ncid, varid, startp, my_count, tmp, memtype))) goto done;
+	stat = NC_copy_data_arena(ncid, memtype, tmp, nelems, ip, arena);
+	(void)nc_reclaim_data(ncid, memtype, tmp, nelems);
+	break;
+    }
+
+done:
+    if(my_count != countp) free(my_count);
+    nullfree(tmp);
+    return stat;
+}
+
+/**
+\ingroup variables
+Read an array of values from a variable, allocating any strings or
+vlen data of the values from an arena instead of one block per value.
+
+This reads like nc_get_vara(), but the memory referenced by the
+values belongs to the arena and is released, all at once, by
+nc_free_arena(). The values must not be passed to nc_free_string(),
+nc_free_vlens() or nc_reclaim_data(). Several reads may share one
+arena.
+
+The arena must be initialized to all zeros before its first use.
+
+\param ncid NetCDF or group ID.
+\param varid Variable ID.
+\param startp Start vector with one element for each dimension.
+\param countp Count vector with one element for each dimension.
+\param ip Pointer where the data will be copied.
+\param arena Arena to allocate strings and vlen data from.
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EINVAL Invalid arena pointer.
+\returns ::NC_ENOTVAR Variable not found.
+\returns ::NC_EINVALCOORDS Index exceeds dimension bound.
+\returns ::NC_EEDGE Start+count exceeds dimension bound.
+\returns ::NC_EBADID Bad ncid.
+\author Dennis Heimbigner
+*/
+int
+nc_get_vara_arena(int ncid, int varid, const size_t *startp,
+                  const size_t *countp, void *ip, nc_arena_t *arena)
+{
+    nc_type xtype = NC_NAT;
+    int stat = nc_inq_vartype(ncid, varid, &xtype);
+    if(stat != NC_NOERR) return stat;
+    return NC_get_vara_arena(ncid, varid, startp, countp, ip, xtype, arena);
+}
+
+/**
+\ingroup variables
+Read an array of strings from a variable, allocating the strings from
+an arena; see nc_get_vara_arena().
+
+\param ncid NetCDF or group ID.
+\param varid Variable ID.
+\param startp Start vector with one element for each dimension.
+\param countp Count vector with one element for each dimension.
+\param ip Pointer where the string pointers will be stored.
+\param arena Arena to allocate the strings from.
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EINVAL Invalid arena pointer.
+\returns ::NC_ECHAR Variable is not of a string type.
+\author Dennis Heimbigner
+*/
+int
+nc_get_vara_string_arena(int ncid, int varid, const size_t *startp,
+                         const size_t *countp, char **ip, nc_arena_t *arena)
+{
+    return NC_get_vara_arena(ncid, varid, startp, countp, (void*)ip, NC_STRING, arena);
+}
+
+/**
+\ingroup variables
+Release all memory held by an arena. Every string or vlen obtained
+from arena reads with this arena becomes invalid. The arena is reset
+and may be used again.
+
+\param arena The arena.
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EINVAL Invalid arena pointer.
+\author Dennis Heimbigner
+*/
+int
+nc_free_arena(nc_arena_t *arena)
+{
+    NCarenablock* block;
+    if(arena == NULL) return NC_EINVAL;
+    for(block=(NCarenablock*)arena->blocks;block!=NULL;) {
+	NCarenablock* next = block->next;
+	free(block);
+	block = next;
+    }
+    arena->blocks = NULL;
+    arena->size = 0;
+    return NC_NOERR;
+}
@@ -38,6 +38,7 @@ static const char* AUTHDEFAULTS[] = {
 "HTTP.SSL.VERIFYHOST","-1", /* Use default */
 "HTTP.TIMEOUT","1800", /*seconds */ /* Long but not infinite */
 "HTTP.CONNECTTIMEOUT","50", /*seconds */ /* Long but not infinite */
+"HTTP.CACHE.MAXSIZE","1073741824", /* 1 GiB */
 NULL
 };
 
@@ -149,6 +150,12 @@ NC_authsetup(NCauth** authp, NCURI* uri)
 			NC_rclookup("HTTP.SSL.VALIDATE",uri_hostport,uri->path));
     setauthfield(auth,"HTTP.NETRC",
 			NC_rclookup("HTTP.NETRC",uri_hostport,uri->path));
+    setauthfield(auth,"HTTP.CACHE.DIR",
+			NC_rclookup("HTTP.CACHE.DIR",uri_hostport,uri->path));
+    setauthfield(auth,"HTTP.CACHE.MAXSIZE",
+			NC_rclookup("HTTP.CACHE.MAXSIZE",uri_hostport,uri->path));
+    setauthfield(auth,"HTTP.CACHE.MAXAGE",
+			NC_rclookup("HTTP.CACHE.MAXAGE",uri_hostport,uri->path));
 
     { /* Handle various cases for user + password */
       /* First, see if the user+pwd was in the original url */
@@ -209,6 +216,7 @@ NC_authfree(NCauth* auth)
     nullfree(auth->proxy.pwd);
     nullfree(auth->creds.user);
     nullfree(auth->creds.pwd);
+    nullfree(auth->cache.dir);
     nullfree(auth->s3profile);
     nullfree(auth);
 }
@@ -349,6 +357,27 @@ setauthfield(NCauth* auth, const char* flag, const char* value)
 #endif
     }
 
+    if(strcmp(flag,"HTTP.CACHE.DIR")==0) {
+        nullfree(auth->cache.dir);
+        auth->cache.dir = strdup(value);
+        MEMCHECK(auth->cache.dir);
+#ifdef DEBUG
+            nclog(NCLOGNOTE,"HTTP.CACHE.DIR: %s", auth->cache.dir);
+#endif
+    }
+    if(strcmp(flag,"HTTP.CACHE.MAXSIZE")==0) {
+        auth->cache.maxsize = atoll(value);
+#ifdef DEBUG
+            nclog(NCLOGNOTE,"HTTP.CACHE.MAXSIZE: %lld", auth->cache.maxsize);
+#endif
+    }
+    if(strcmp(flag,"HTTP.CACHE.MAXAGE")==0) {
+        auth->cache.maxage = atol(value);
+#ifdef DEBUG
+            nclog(NCLOGNOTE,"HTTP.CACHE.MAXAGE: %ld", auth->cache.maxage);
+#endif
+    }
+
     if(strcmp(flag,"HTTP.CREDENTIALS.USERNAME")==0) {
         nullfree(auth->creds.user);
         auth->creds.user = strdup(value);
@@ -28,6 +28,10 @@ See LICENSE.txt for license information.
 #include <curl/curl.h>
 #endif
 
+#ifdef ENABLE_BYTERANGE
+#include "nchttp.h"
+#endif
+
 #ifdef ENABLE_S3_SDK
 #include "ncs3sdk.h"
 #endif
@@ -135,6 +139,9 @@ NCDISPATCH_finalize(void)
 {
     int status = NC_NOERR;
     NC_freeglobalstate();
+#ifdef ENABLE_BYTERANGE
+    (void)nc_http_finalize();
+#endif
 #if defined(ENABLE_BYTERANGE) || defined(ENABLE_DAP) || defined(ENABLE_DAP4)
     curl_global_cleanup();
 #endif
@@ -37,6 +37,7 @@
 #include "netcdf_mem.h"
 #include "ncpathmgr.h"
 #include "fbits.h"
+#include "ncreadahead.h"
 
 #undef DEBUG
 
@@ -800,6 +801,11 @@ nc_open_mem(const char* path, int omode, size_t size, void* memory, int* ncidp)
     is the same as passed to nc_open_memio. You <b>must</b> check
     before attempting to free the original memory.
 
+    If the NC_MEMIO_COW flag is set, then params->memory must be an
+    NC_memimage created with nc_memimage_create() or returned by
+    nc_close_memio(); the file shares its pages with the image and
+    only copies the pages it modifies (netcdf-3 files only).
+
     \param path Must be non-null, but otherwise only used to set the dataset name.
 
     \param omode the open mode flags; Note that this procedure uses a limited set of flags because it forcibly sets NC_INMEMORY.
@@ -845,6 +851,10 @@ nc_open_memio(const char* path, int omode, NC_memio* params, int* ncidp)
     /* Sanity checks */
     if(path == NULL || params == NULL)
         return NC_EINVAL;
+    if(params->memory != NULL && (params->flags & NC_MEMIO_COW)) {
+        int stat = nc_memimage_size((NC_memimage*)params->memory,&params->size);
+        if(stat != NC_NOERR) return stat;
+    }
     if(params->memory == NULL || params->size < MAGIC_NUMBER_LEN)
         return NC_EINVAL;
 
@@ -967,6 +977,7 @@ nc_redef(int ncid)
     NC* ncp;
     int stat = NC_check_id(ncid, &ncp);
     if(stat != NC_NOERR) return stat;
+    NC_READAHEAD_INVALIDATE(ncp);
     return ncp->dispatch->redef(ncid);
 }
 
@@ -1199,6 +1210,7 @@ nc_sync(int ncid)
     NC* ncp;
     int stat = NC_check_id(ncid, &ncp);
     if(stat != NC_NOERR) return stat;
+    NC_READAHEAD_INVALIDATE(ncp);
     return ncp->dispatch->sync(ncid);
 }
 
@@ -1322,7 +1334,9 @@ nc_close(int ncid)
     \param ncid NetCDF ID, from a previous call to nc_open() or nc_create().
 
     \param memio a pointer to an NC_memio object into which the final valid memory
-    size and memory will be returned.
+    size and memory will be returned. If the file was opened from a
+    copy-on-write image, the memory is a new NC_memimage sharing the
+    unmodified pages and NC_MEMIO_COW is set in its flags.
 
     \returns ::NC_NOERR No error.
 
@@ -35,7 +35,35 @@ static const char* LENGTH_ACCEPT[] = {"content-length","accept-ranges",NULL};
 #endif
 static const char* CONTENTLENGTH[] = {"content-length",NULL};
 
+/* Most transfers that nc_http_read_ranges() keeps active at once;
+   also the most connections it opens to one host */
+#define NC_HTTP_MAXCONCURRENT 8
+
+/* The engine shared by all NC_HTTP_STATE objects of the process.
+   The DNS, TLS session and connection caches are shared, so that
+   reopening a remote dataset, or opening another one on the same
+   server, reuses a live connection. The multi handle and a pool of
+   idle easy handles serve nc_http_read_ranges(). */
+static struct NCHTTPENGINE {
+    int initialized;
+    CURLSH* share;
+    CURLM* multi;
+    NClist* idle; /* List<CURL*> */
+} engine = {0,NULL,NULL,NULL};
+
+/* One transfer of nc_http_read_ranges() */
+struct Transfer {
+    CURL* curl;
+    NC_HTTP_RANGE* range;
+    size_t len0; /* length of range->buf before the transfer */
+};
+
 /* Forward */
+static int engine_init(void);
+static int setoptions(NC_HTTP_STATE* state, CURL* curl, const char* objecturl);
+static int transferbegin(NC_HTTP_STATE* state, struct Transfer* t, NC_HTTP_RANGE* range);
+static int transferend(NC_HTTP_STATE* state, struct Transfer* t, CURLcode result);
+static void transferrelease(struct Transfer* t);
 static int setupconn(NC_HTTP_STATE* state, const char* objecturl);
 static int execute(NC_HTTP_STATE* state);
 static int headerson(NC_HTTP_STATE* state, const char** which);
@@ -83,8 +111,10 @@ nc_http_init_verbose(NC_HTTP_STATE** statep, int verbose)
 
     Trace("open");
 
+    if((stat = engine_init())) goto done;
     if((state = calloc(1,sizeof(NC_HTTP_STATE))) == NULL)
         {stat = NC_ENOMEM; goto done;}
+    state->verbose = verbose;
     /* initialize curl*/
     state->curl = curl_easy_init();
     if (state->curl == NULL) {stat = NC_ECURL; goto done;}
@@ -244,6 +274,105 @@ fail:
     goto done;
 }
 
+/**
+Read several byte ranges concurrently. Up to NC_HTTP_MAXCONCURRENT
+transfers are active at once; they share the connections of the
+engine, and are multiplexed over one connection when the server
+speaks HTTP/2. The content of each range is appended to its buf,
+and its httpcode is set. If a server ignores the Range header and
+returns the whole object, the requested range is extracted from it.
+
+@param state state handle; provides the error buffer and verbosity
+@param nranges number of ranges
+@param ranges the ranges to read; a NULL url, or a zero count, is
+       skipped
+@return NC_NOERR, or NC_ECURL if any transfer failed or returned an
+        HTTP error; the httpcode of each range tells which
+*/
+
+int
+nc_http_read_ranges(NC_HTTP_STATE* state, size_t nranges, NC_HTTP_RANGE* ranges)
+{
+    int stat = NC_NOERR;
+    struct Transfer* transfers = NULL;
+    size_t next = 0;
+    size_t nactive = 0;
+    size_t i;
+
+    Trace("read_ranges");
+
+    if(nranges == 0) goto done;
+    if(ranges == NULL) {stat = NC_EINVAL; goto done;}
+    if((stat = engine_init())) goto done;
+    if(engine.multi == NULL) {stat = NC_ECURL; goto done;}
+    if((transfers = calloc(nranges,sizeof(struct Transfer))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+
+    for(;;) {
+	int running = 0;
+	int nmsgs = 0;
+	CURLMsg* msg = NULL;
+	CURLMcode mstat = CURLM_OK;
+
+	/* Keep the pipeline full */
+	while(next < nranges && nactive < NC_HTTP_MAXCONCURRENT) {
+	    NC_HTTP_RANGE* range = &ranges[next];
+	    range->httpcode = 0;
+	    if(range->url != NULL && range->count > 0) {
+	        if((stat = transferbegin(state,&transfers[next],range))) goto done;
+		nactive++;
+	    }
+	    next++;
+	}
+	if(nactive == 0) break; /* all done */
+
+	mstat = curl_multi_perform(engine.multi,&running);
+	if(mstat != CURLM_OK) {stat = NC_ECURL; goto done;}
+	while((msg = curl_multi_info_read(engine.multi,&nmsgs)) != NULL) {
+	    struct Transfer* t = NULL;
+	    if(msg->msg != CURLMSG_DONE) continue;
+	    (void)curl_easy_getinfo(msg->easy_handle,CURLINFO_PRIVATE,(char**)&t);
+	    nactive--;
+	    if((stat = transferend(state,t,msg->data.result))) goto done;
+	}
+	if(running > 0) {
+	    mstat = curl_multi_wait(engine.multi,NULL,0,1000,NULL);
+	    if(mstat != CURLM_OK) {stat = NC_ECURL; goto done;}
+	}
+    }
+
+done:
+    /* After an error, abandon the transfers still active */
+    if(transfers != NULL) {
+        for(i=0;i<nranges;i++)
+	    transferrelease(&transfers[i]);
+	free(transfers);
+    }
+dbgflush();
+    return stat;
+}
+
+/**
+Release the engine shared by all NC_HTTP_STATE objects.
+Called when the library is finalized.
+*/
+
+int
+nc_http_finalize(void)
+{
+    size_t i;
+    if(!engine.initialized) return NC_NOERR;
+    for(i=0;i<nclistlength(engine.idle);i++)
+	curl_easy_cleanup((CURL*)nclistget(engine.idle,i));
+    nclistfree(engine.idle);
+    if(engine.multi != NULL)
+	(void)curl_multi_cleanup(engine.multi);
+    if(engine.share != NULL)
+	(void)curl_share_cleanup(engine.share);
+    memset(&engine,0,sizeof(engine));
+    return NC_NOERR;
+}
+
 /**
 @param state state handle
 @param objecturl to write
@@ -377,6 +506,15 @@ WriteMemoryCallback(void *ptr, size_t size, size_t nmemb, void *data)
     return realsize;
 }
 
+static size_t
+WriteBytesCallback(void *ptr, size_t size, size_t nmemb, void *data)
+{
+    NCbytes* buf = data;
+    size_t realsize = size * nmemb;
+    ncbytesappendn(buf, ptr, realsize);
+    return realsize;
+}
+
 static void
 trim(char* s)
 {
@@ -460,8 +598,9 @@ done:
     return realsize;    
 }
 
+/* Set the options common to all requests on an easy handle */
 static int
-setupconn(NC_HTTP_STATE* state, const char* objecturl)
+setoptions(NC_HTTP_STATE* state, CURL* curl, const char* objecturl)
 {
     int stat = NC_NOERR;
     CURLcode cstat = CURLE_OK;
@@ -471,18 +610,31 @@ setupconn(NC_HTTP_STATE* state, const char* objecturl)
 #ifdef TRACE
         fprintf(stderr,"curl.setup: url |%s|\n",objecturl);
 #endif
-        cstat = CURLERR(curl_easy_setopt(state->curl, CURLOPT_URL, (void*)objecturl));
+        cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_URL, (void*)objecturl));
         if (cstat != CURLE_OK) goto fail;
     }
     /* Set options */
-    cstat = CURLERR(curl_easy_setopt(state->curl, CURLOPT_TIMEOUT, 100)); /* 30sec timeout*/
+    cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_TIMEOUT, 100)); /* 30sec timeout*/
     if (cstat != CURLE_OK) goto fail;
-    cstat = CURLERR(curl_easy_setopt(state->curl, CURLOPT_CONNECTTIMEOUT, 100));
+    cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 100));
     if (cstat != CURLE_OK) goto fail;
-    cstat = CURLERR(curl_easy_setopt(state->curl, CURLOPT_NOPROGRESS, 1));
+    cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1));
     if (cstat != CURLE_OK) goto fail;
-    cstat = curl_easy_setopt(state->curl, CURLOPT_FOLLOWLOCATION, 1); 
+    cstat = curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1); 
     if (cstat != CURLE_OK) goto fail;
+    /* Share the caches of the engine and keep connections alive */
+    if(engine.share != NULL) {
+        cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_SHARE, engine.share));
+        if (cstat != CURLE_OK) goto fail;
+    }
+#ifdef HAVE_CURLOPT_KEEPALIVE
+    (void)curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072F00
+    /* Use HTTP/2 over TLS if the server offers it; not an error if
+       libcurl was built without it */
+    (void)curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+#endif
 
     /* Pull some values from .rc tables */
     {
@@ -498,11 +650,26 @@ setupconn(NC_HTTP_STATE* state, const char* objecturl)
 	if(value == NULL)
 	    value = NC_rclookup("HTTP.SSL.CAINFO",NULL,NULL);
 	if(value != NULL) {
-	    cstat = CURLERR(curl_easy_setopt(state->curl, CURLOPT_CAINFO, value));
+	    cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_CAINFO, value));
 	    if (cstat != CURLE_OK) goto fail;
 	}
     }
 
+done:
+    return stat;
+fail:
+    stat = NC_ECURL;
+    goto done;
+}
+
+static int
+setupconn(NC_HTTP_STATE* state, const char* objecturl)
+{
+    int stat = NC_NOERR;
+    CURLcode cstat = CURLE_OK;
+
+    if((stat = setoptions(state,state->curl,objecturl))) goto fail;
+
     /* Set the method */
     if((stat = nc_http_set_method(state,state->request.method))) goto done;
 
@@ -548,6 +715,123 @@ fail:
     goto done;
 }
 
+/**************************************************/
+/* The shared engine */
+
+static int
+engine_init(void)
+{
+    int stat = NC_NOERR;
+
+    if(engine.initialized) goto done;
+    engine.initialized = 1;
+    engine.idle = nclistnew();
+    /* Without a share handle each state just keeps its own caches */
+    if((engine.share = curl_share_init()) != NULL) {
+	(void)curl_share_setopt(engine.share,CURLSHOPT_SHARE,CURL_LOCK_DATA_DNS);
+	(void)curl_share_setopt(engine.share,CURLSHOPT_SHARE,CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+	(void)curl_share_setopt(engine.share,CURLSHOPT_SHARE,CURL_LOCK_DATA_CONNECT);
+#endif
+    }
+    if((engine.multi = curl_multi_init()) == NULL)
+	{stat = NC_ECURL; goto done;}
+#if LIBCURL_VERSION_NUM >= 0x072B00
+    (void)curl_multi_setopt(engine.multi,CURLMOPT_PIPELINING,(long)CURLPIPE_MULTIPLEX);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x071E00
+    (void)curl_multi_setopt(engine.multi,CURLMOPT_MAX_HOST_CONNECTIONS,(long)NC_HTTP_MAXCONCURRENT);
+#endif
+done:
+    return stat;
+}
+
+/* Start the transfer of one range, on an idle easy handle if any */
+static int
+transferbegin(NC_HTTP_STATE* state, struct Transfer* t, NC_HTTP_RANGE* range)
+{
+    int stat = NC_NOERR;
+    CURLcode cstat = CURLE_OK;
+    CURL* curl = NULL;
+    char rangestr[64];
+
+    if(nclistlength(engine.idle) > 0)
+	curl = (CURL*)nclistpop(engine.idle);
+    else if((curl = curl_easy_init()) == NULL)
+	{stat = NC_ECURL; goto done;}
+    (void)curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, state->errbuf);
+    if(state->verbose) {
+        (void)curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+	(void)curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, my_trace);
+    }
+    if((stat = setoptions(state,curl,range->url))) goto done;
+    snprintf(rangestr,sizeof(rangestr),"%llu-%llu",
+	     (unsigned long long)range->start,
+	     (unsigned long long)((range->start+range->count)-1));
+    cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_RANGE, rangestr));
+    if(cstat != CURLE_OK) {stat = NC_ECURL; goto done;}
+    cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteBytesCallback));
+    if(cstat != CURLE_OK) {stat = NC_ECURL; goto done;}
+    cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)range->buf));
+    if(cstat != CURLE_OK) {stat = NC_ECURL; goto done;}
+    cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*)t));
+    if(cstat != CURLE_OK) {stat = NC_ECURL; goto done;}
+#if LIBCURL_VERSION_NUM >= 0x072B00
+    /* Prefer waiting for a connection that can multiplex
+       over opening a new one */
+    (void)curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+#endif
+    if(curl_multi_add_handle(engine.multi,curl) != CURLM_OK)
+	{stat = NC_ECURL; goto done;}
+    t->curl = curl; curl = NULL;
+    t->range = range;
+    t->len0 = ncbyteslength(range->buf);
+done:
+    if(curl != NULL) curl_easy_cleanup(curl);
+    return stat;
+}
+
+/* Finish the transfer of one range and recycle its easy handle */
+static int
+transferend(NC_HTTP_STATE* state, struct Transfer* t, CURLcode result)
+{
+    int stat = NC_NOERR;
+    NC_HTTP_RANGE* range = t->range;
+    long httpcode = 0;
+
+    if(CURLERR(result) != CURLE_OK) {stat = NC_ECURL; goto done;}
+    (void)curl_easy_getinfo(t->curl,CURLINFO_RESPONSE_CODE,&httpcode);
+    range->httpcode = httpcode;
+    if(httpcode >= 400) {stat = NC_ECURL; goto done;}
+    if(httpcode == 200) {
+	/* The whole object was returned; keep just the range */
+	size_t len = ncbyteslength(range->buf) - t->len0;
+	char* content = ncbytescontents(range->buf) + t->len0;
+	size_t count = (size_t)range->count;
+	if(range->start >= len) count = 0;
+	else if(range->start + count > len) count = len - (size_t)range->start;
+	memmove(content,content+range->start,count);
+	ncbytessetlength(range->buf,t->len0 + count);
+    }
+done:
+    transferrelease(t);
+    return stat;
+}
+
+static void
+transferrelease(struct Transfer* t)
+{
+    if(t->curl == NULL) return;
+    (void)curl_multi_remove_handle(engine.multi,t->curl);
+    if(nclistlength(engine.idle) < NC_HTTP_MAXCONCURRENT) {
+	/* Keeps the live connections and caches of the handle */
+	curl_easy_reset(t->curl);
+	nclistpush(engine.idle,t->curl);
+    } else
+	curl_easy_cleanup(t->curl);
+    t->curl = NULL;
+}
+
 static int
 execute(NC_HTTP_STATE* state)
 {
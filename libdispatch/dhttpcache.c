@@ -0,0 +1,547 @@
+/**
+ * @file
+ *
+ * Persistent on-disk cache of HTTP responses, used by DAP2 and DAP4.
+ *
+ * Every response lives in two files of the HTTP.CACHE.DIR directory,
+ * named by a hash of the request url: "<hash>.body" holds the bytes
+ * as received and "<hash>.meta" holds lines of the form key=value:
+ * the url itself (to detect hash collisions), the ETag and
+ * Last-Modified validators, the time the response was stored or last
+ * revalidated, the time it was last used and the body size.  Both
+ * files are written under a temporary name and renamed, so several
+ * processes can share one cache directory.
+ *
+ * Copyright 2018 University Corporation for Atmospheric
+ * Research/Unidata. See COPYRIGHT file for more info.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <dirent.h>
+#endif
+
+#define CURL_DISABLE_TYPECHECK 1
+#include <curl/curl.h>
+
+#include "netcdf.h"
+#include "nclog.h"
+#include "ncbytes.h"
+#include "nclist.h"
+#include "ncrc.h"
+#include "nccrc.h"
+#include "ncauth.h"
+#include "ncpathmgr.h"
+#include "nchttpcache.h"
+
+#define METASUFFIX ".meta"
+#define BODYSUFFIX ".body"
+#define COPYSIZE 65536
+
+struct NChttpcache {
+    char* url;
+    char* base;         /* <dir>/<hash>; the files append the suffixes */
+    char* dir;
+    long long maxsize;
+    long maxage;
+    int present;        /* a stored response for url exists */
+    char* etag;
+    long lastmodified;  /* -1 if unknown */
+    long long stored;   /* time stored or last revalidated */
+    long long used;     /* time last used */
+    size_t size;
+    char* newetag;      /* ETag of the response being fetched */
+    struct curl_slist* headers;
+};
+
+/* Forward */
+static int readmeta(const char* path, NCbytes* text, char** urlp, char** etagp, long* lastmodp, long long* storedp, long long* usedp, size_t* sizep);
+static int writemeta(NChttpcache* cache);
+static int writebody(NChttpcache* cache, NCbytes* buf, FILE* stream);
+static int listmeta(const char* dir, NClist* names);
+static void evict(NChttpcache* cache);
+static size_t HeaderCallback(char *buffer, size_t size, size_t nitems, void *data);
+static long long filesize(const char* path);
+static char* pathcat(const char* s1, const char* s2);
+
+/**************************************************/
+
+/**
+@internal Find the cache entry for a url.
+@param auth the .rc derived settings for the url
+@param url the complete request url, including any constraint
+@param cachep return the entry; NULL if caching is not enabled
+@return NC_NOERR | NC_ENOMEM
+*/
+int
+NC_httpcache_open(const NCauth* auth, const char* url, NChttpcache** cachep)
+{
+    int stat = NC_NOERR;
+    NChttpcache* cache = NULL;
+    char hash[32];
+    char* name = NULL;
+    char* metaurl = NULL;
+    NCbytes* text = NULL;
+
+    if(cachep) *cachep = NULL;
+    if(auth == NULL || auth->cache.dir == NULL || url == NULL) goto done;
+
+    if(NCaccess(auth->cache.dir,ACCESS_MODE_EXISTS) < 0
+       && NCmkdir(auth->cache.dir,0777) < 0 && errno != EEXIST) {
+        nclog(NCLOGWARN,"HTTP.CACHE.DIR: cannot create %s",auth->cache.dir);
+        goto done;
+    }
+    if((cache = (NChttpcache*)calloc(1,sizeof(NChttpcache)))==NULL)
+        {stat = NC_ENOMEM; goto done;}
+    cache->lastmodified = -1;
+    cache->maxsize = auth->cache.maxsize;
+    cache->maxage = auth->cache.maxage;
+    if((cache->url = strdup(url))==NULL
+       || (cache->dir = strdup(auth->cache.dir))==NULL)
+        {stat = NC_ENOMEM; goto done;}
+    snprintf(hash,sizeof(hash),"/%016llx",
+             NC_crc64(0,(void*)url,(unsigned int)strlen(url)));
+    if((cache->base = pathcat(cache->dir,hash))==NULL)
+        {stat = NC_ENOMEM; goto done;}
+
+    /* Look for a stored response */
+    if((name = pathcat(cache->base,METASUFFIX))==NULL) {stat = NC_ENOMEM; goto done;}
+    text = ncbytesnew();
+    if(readmeta(name,text,&metaurl,&cache->etag,&cache->lastmodified,&cache->stored,
+                &cache->used,&cache->size) == NC_NOERR
+       && metaurl != NULL && strcmp(metaurl,url) == 0) {
+        free(name);
+        if((name = pathcat(cache->base,BODYSUFFIX))==NULL) {stat = NC_ENOMEM; goto done;}
+        cache->present = (filesize(name) == (long long)cache->size);
+    }
+    if(!cache->present) {
+        nullfree(cache->etag);
+        cache->etag = NULL;
+        cache->lastmodified = -1;
+    }
+    if(cachep) {*cachep = cache; cache = NULL;}
+
+done:
+    ncbytesfree(text);
+    nullfree(metaurl);
+    nullfree(name);
+    NC_httpcache_close(cache);
+    return stat;
+}
+
+void
+NC_httpcache_close(NChttpcache* cache)
+{
+    if(cache == NULL) return;
+    if(cache->headers) curl_slist_free_all(cache->headers);
+    nullfree(cache->url);
+    nullfree(cache->base);
+    nullfree(cache->dir);
+    nullfree(cache->etag);
+    nullfree(cache->newetag);
+    free(cache);
+}
+
+int
+NC_httpcache_fresh(const NChttpcache* cache)
+{
+    if(cache == NULL || !cache->present || cache->maxage <= 0) return 0;
+    return ((long long)time(NULL) - cache->stored) < cache->maxage;
+}
+
+/**
+@internal Copy the stored response into buf (which is then null
+terminated, like a fetched packet) or onto stream.
+@return NC_NOERR | NC_ENOTFOUND | NC_EIO
+*/
+int
+NC_httpcache_read(NChttpcache* cache, NCbytes* buf, FILE* stream, size_t* sizep, long* filetimep)
+{
+    int stat = NC_NOERR;
+    char* name = NULL;
+    FILE* f = NULL;
+    char* block = NULL;
+    size_t total = 0;
+
+    if(cache == NULL || !cache->present) {stat = NC_ENOTFOUND; goto done;}
+    if((name = pathcat(cache->base,BODYSUFFIX))==NULL) {stat = NC_ENOMEM; goto done;}
+    if((f = NCfopen(name,"rb"))==NULL) {stat = NC_ENOTFOUND; goto done;}
+    if(buf != NULL) {
+        ncbytesclear(buf);
+        if(!ncbytessetalloc(buf,cache->size+1)) {stat = NC_ENOMEM; goto done;}
+        if(cache->size > 0 && fread(ncbytescontents(buf),1,cache->size,f) != cache->size)
+            {stat = NC_EIO; goto done;}
+        ncbytessetlength(buf,cache->size);
+        ncbytesnull(buf);
+        total = cache->size;
+    } else if(stream != NULL) {
+        size_t n;
+        if((block = malloc(COPYSIZE))==NULL) {stat = NC_ENOMEM; goto done;}
+        while((n = fread(block,1,COPYSIZE,f)) > 0) {
+            if(fwrite(block,1,n,stream) != n) {stat = NC_EIO; goto done;}
+            total += n;
+        }
+        if(total != cache->size) {stat = NC_EIO; goto done;}
+    }
+    if(sizep) *sizep = total;
+    if(filetimep) *filetimep = cache->lastmodified;
+    /* Record the use for the LRU ordering */
+    cache->used = (long long)time(NULL);
+    (void)writemeta(cache);
+
+done:
+    if(f) fclose(f);
+    nullfree(block);
+    nullfree(name);
+    return stat;
+}
+
+/**
+@internal Make the request conditional on the stored validators
+and capture the ETag of the response.
+*/
+int
+NC_httpcache_prepare(NChttpcache* cache, CURL* curl)
+{
+    int stat = NC_NOERR;
+
+    if(cache == NULL) goto done;
+    nullfree(cache->newetag);
+    cache->newetag = NULL;
+    if(cache->present && cache->etag != NULL) {
+        NCbytes* hdr = ncbytesnew();
+        ncbytescat(hdr,"If-None-Match: ");
+        ncbytescat(hdr,cache->etag);
+        cache->headers = curl_slist_append(cache->headers,ncbytescontents(hdr));
+        ncbytesfree(hdr);
+        if(cache->headers == NULL) {stat = NC_ENOMEM; goto done;}
+        (void)curl_easy_setopt(curl,CURLOPT_HTTPHEADER,cache->headers);
+    } else if(cache->present && cache->lastmodified > 0) {
+        (void)curl_easy_setopt(curl,CURLOPT_TIMECONDITION,(long)CURL_TIMECOND_IFMODSINCE);
+        (void)curl_easy_setopt(curl,CURLOPT_TIMEVALUE,cache->lastmodified);
+    }
+    (void)curl_easy_setopt(curl,CURLOPT_HEADERFUNCTION,HeaderCallback);
+    (void)curl_easy_setopt(curl,CURLOPT_HEADERDATA,(void*)cache);
+done:
+    return stat;
+}
+
+int
+NC_httpcache_complete(NChttpcache* cache, CURL* curl, long* httpcodep,
+                      NCbytes* buf, FILE* stream, size_t* sizep, long* filetimep)
+{
+    int stat = NC_NOERR;
+    long filetime = -1;
+
+    if(cache == NULL) goto done;
+    (void)curl_easy_setopt(curl,CURLOPT_HTTPHEADER,NULL);
+    (void)curl_easy_setopt(curl,CURLOPT_TIMECONDITION,(long)CURL_TIMECOND_NONE);
+    (void)curl_easy_setopt(curl,CURLOPT_HEADERFUNCTION,NULL);
+    (void)curl_easy_setopt(curl,CURLOPT_HEADERDATA,NULL);
+    if(cache->headers) {curl_slist_free_all(cache->headers); cache->headers = NULL;}
+
+    if(*httpcodep == 304 && cache->present) {
+        /* Not modified: use the stored response */
+        if((stat = NC_httpcache_read(cache,buf,stream,sizep,filetimep))) goto done;
+        cache->stored = cache->used;
+        (void)writemeta(cache);
+        *httpcodep = 200;
+    } else if(*httpcodep == 200) {
+        if(curl_easy_getinfo(curl,CURLINFO_FILETIME,&filetime) != CURLE_OK)
+            filetime = -1;
+        /* A response without validators can only be reused within maxage */
+        if(cache->newetag == NULL && filetime <= 0 && cache->maxage <= 0)
+            goto done;
+        nullfree(cache->etag);
+        cache->etag = cache->newetag;
+        cache->newetag = NULL;
+        cache->lastmodified = filetime;
+        cache->stored = cache->used = (long long)time(NULL);
+        if(writebody(cache,buf,stream) == NC_NOERR
+           && writemeta(cache) == NC_NOERR) {
+            cache->present = 1;
+            evict(cache);
+        } else
+            nclog(NCLOGWARN,"HTTP.CACHE.DIR: cannot store response for %s",cache->url);
+    }
+done:
+    return stat;
+}
+
+/**************************************************/
+
+static size_t
+HeaderCallback(char *buffer, size_t size, size_t nitems, void *data)
+{
+    size_t realsize = size * nitems;
+    NChttpcache* cache = (NChttpcache*)data;
+    size_t i, start, end;
+
+    if(realsize >= 5 && strncmp(buffer,"HTTP/",5) == 0) {
+        /* A new response, e.g. after a redirect */
+        nullfree(cache->newetag);
+        cache->newetag = NULL;
+    } else if(realsize > 5 && strncasecmp(buffer,"etag:",5) == 0) {
+        for(start=5;start<realsize && (buffer[start]==' ' || buffer[start]=='\t');start++);
+        for(end=realsize;end>start && (buffer[end-1]=='\r' || buffer[end-1]=='\n'
+                                       || buffer[end-1]==' ');end--);
+        nullfree(cache->newetag);
+        if((cache->newetag = (char*)malloc((end-start)+1)) != NULL) {
+            for(i=start;i<end;i++) cache->newetag[i-start] = buffer[i];
+            cache->newetag[end-start] = '\0';
+        }
+    }
+    return realsize;
+}
+
+static int
+readmeta(const char* path, NCbytes* text, char** urlp, char** etagp, long* lastmodp,
+         long long* storedp, long long* usedp, size_t* sizep)
+{
+    int stat = NC_NOERR;
+    char* line;
+    char* next;
+
+    ncbytesclear(text);
+    if((stat = NC_readfile(path,text))) goto done;
+    ncbytesnull(text);
+    for(line=ncbytescontents(text);line != NULL && *line;line=next) {
+        char* value;
+        if((next = strchr(line,'\n')) != NULL) *next++ = '\0';
+        if((value = strchr(line,'=')) == NULL) continue;
+        *value++ = '\0';
+        if(strcmp(line,"url")==0 && urlp) {
+            nullfree(*urlp);
+            *urlp = strdup(value);
+        } else if(strcmp(line,"etag")==0 && etagp) {
+            nullfree(*etagp);
+            *etagp = (*value ? strdup(value) : NULL);
+        } else if(strcmp(line,"lastmodified")==0 && lastmodp)
+            *lastmodp = atol(value);
+        else if(strcmp(line,"stored")==0 && storedp)
+            *storedp = atoll(value);
+        else if(strcmp(line,"used")==0 && usedp)
+            *usedp = atoll(value);
+        else if(strcmp(line,"size")==0 && sizep)
+            *sizep = (size_t)strtoull(value,NULL,10);
+    }
+done:
+    return stat;
+}
+
+/* Write name via a temporary file so readers never see a partial file */
+static int
+replacefile(const char* name, const void* content, size_t len, FILE* stream)
+{
+    int stat = NC_NOERR;
+    char suffix[64];
+    char* tmp = NULL;
+    FILE* f = NULL;
+    char* block = NULL;
+
+    snprintf(suffix,sizeof(suffix),".tmp%ld",(long)getpid());
+    if((tmp = pathcat(name,suffix))==NULL) {stat = NC_ENOMEM; goto done;}
+    if((f = NCfopen(tmp,"wb"))==NULL) {stat = NC_EIO; goto done;}
+    if(stream != NULL) {
+        /* Copy len bytes from the start of stream, then restore its position */
+        size_t n, left = len;
+        if((block = malloc(COPYSIZE))==NULL) {stat = NC_ENOMEM; goto done;}
+        fflush(stream);
+        if(fseek(stream,0,SEEK_SET)) {stat = NC_EIO; goto done;}
+        while(left > 0 && (n = fread(block,1,(left < COPYSIZE ? left : COPYSIZE),stream)) > 0) {
+            if(fwrite(block,1,n,f) != n) {stat = NC_EIO; break;}
+            left -= n;
+        }
+        if(fseek(stream,(long)len,SEEK_SET) || left > 0) stat = NC_EIO;
+        if(stat) goto done;
+    } else if(len > 0 && fwrite(content,1,len,f) != len)
+        {stat = NC_EIO; goto done;}
+    if(fclose(f)) {f = NULL; stat = NC_EIO; goto done;}
+    f = NULL;
+#ifdef _WIN32
+    (void)NCremove(name);
+#endif
+    if(rename(tmp,name)) {stat = NC_EIO; goto done;}
+done:
+    if(f) fclose(f);
+    if(stat && tmp) (void)NCremove(tmp);
+    nullfree(block);
+    nullfree(tmp);
+    return stat;
+}
+
+static int
+writemeta(NChttpcache* cache)
+{
+    int stat = NC_NOERR;
+    NCbytes* text = ncbytesnew();
+    char* name = NULL;
+    char line[128];
+
+    ncbytescat(text,"url="); ncbytescat(text,cache->url);
+    ncbytescat(text,"\netag="); ncbytescat(text,(cache->etag ? cache->etag : ""));
+    snprintf(line,sizeof(line),"\nlastmodified=%ld\nstored=%lld\nused=%lld\nsize=%llu\n",
+             cache->lastmodified,cache->stored,cache->used,(unsigned long long)cache->size);
+    ncbytescat(text,line);
+    if((name = pathcat(cache->base,METASUFFIX))==NULL) {stat = NC_ENOMEM; goto done;}
+    stat = replacefile(name,ncbytescontents(text),ncbyteslength(text),NULL);
+done:
+    nullfree(name);
+    ncbytesfree(text);
+    return stat;
+}
+
+static int
+writebody(NChttpcache* cache, NCbytes* buf, FILE* stream)
+{
+    int stat = NC_NOERR;
+    char* name = NULL;
+    long pos;
+
+    if(buf != NULL)
+        cache->size = ncbyteslength(buf);
+    else if(stream != NULL && (pos = ftell(stream)) >= 0)
+        cache->size = (size_t)pos;
+    else
+        {stat = NC_EINVAL; goto done;}
+    if(cache->maxsize > 0 && (long long)cache->size > cache->maxsize)
+        {stat = NC_EINVAL; goto done;}
+    if((name = pathcat(cache->base,BODYSUFFIX))==NULL) {stat = NC_ENOMEM; goto done;}
+    stat = replacefile(name,(buf ? ncbytescontents(buf) : NULL),cache->size,(buf ? NULL : stream));
+done:
+    nullfree(name);
+    return stat;
+}
+
+/* Discard the least recently used responses until the cache fits in maxsize */
+static void
+evict(NChttpcache* cache)
+{
+    NClist* names = nclistnew();
+    NClist* entries = nclistnew();
+    NCbytes* text = ncbytesnew();
+    long long total = 0;
+    size_t i;
+    struct Entry {char* base; long long used; size_t size;} *e;
+
+    if(cache->maxsize <= 0) goto done;
+    if(listmeta(cache->dir,names)) goto done;
+    for(i=0;i<nclistlength(names);i++) {
+        char* name = (char*)nclistget(names,i);
+        char* path = pathcat(cache->dir,"/");
+        char* full = (path ? pathcat(path,name) : NULL);
+        nullfree(path);
+        if(full == NULL) continue;
+        if((e = (struct Entry*)calloc(1,sizeof(struct Entry))) == NULL
+           || readmeta(full,text,NULL,NULL,NULL,NULL,&e->used,&e->size) != NC_NOERR) {
+            nullfree(e); free(full); continue;
+        }
+        full[strlen(full)-strlen(METASUFFIX)] = '\0';
+        e->base = full;
+        total += (long long)e->size;
+        if(strcmp(full,cache->base) == 0) {
+            /* Never evict the response just stored */
+            free(full); free(e); continue;
+        }
+        nclistpush(entries,e);
+    }
+    while(total > cache->maxsize && nclistlength(entries) > 0) {
+        /* Remove the oldest */
+        size_t oldest = 0;
+        char* name;
+        for(i=1;i<nclistlength(entries);i++) {
+            if(((struct Entry*)nclistget(entries,i))->used
+               < ((struct Entry*)nclistget(entries,oldest))->used)
+                oldest = i;
+        }
+        e = (struct Entry*)nclistremove(entries,oldest);
+        if((name = pathcat(e->base,METASUFFIX)) != NULL) {(void)NCremove(name); free(name);}
+        if((name = pathcat(e->base,BODYSUFFIX)) != NULL) {(void)NCremove(name); free(name);}
+        total -= (long long)e->size;
+        free(e->base);
+        free(e);
+    }
+done:
+    for(i=0;i<nclistlength(entries);i++) {
+        e = (struct Entry*)nclistget(entries,i);
+        free(e->base);
+        free(e);
+    }
+    nclistfreeall(names);
+    nclistfree(entries);
+    ncbytesfree(text);
+}
+
+/* Collect the names of the .meta files in dir */
+static int
+listmeta(const char* dir, NClist* names)
+{
+    int stat = NC_NOERR;
+    size_t slen = strlen(METASUFFIX);
+#ifdef _WIN32
+    WIN32_FIND_DATA data;
+    HANDLE h;
+    char* pattern = pathcat(dir,"/*" METASUFFIX);
+    char* lpath = NULL;
+
+    if(pattern == NULL) return NC_ENOMEM;
+    if((lpath = NCpathcvt(pattern)) == NULL) {free(pattern); return NC_ENOMEM;}
+    h = FindFirstFile(lpath,&data);
+    free(pattern);
+    free(lpath);
+    if(h == INVALID_HANDLE_VALUE) return NC_NOERR;
+    do {
+        const char* name = data.cFileName;
+        size_t len = strlen(name);
+        if(len > slen && strcmp(name+len-slen,METASUFFIX) == 0)
+            nclistpush(names,strdup(name));
+    } while(FindNextFile(h,&data));
+    FindClose(h);
+#else
+    DIR* d;
+    struct dirent* de;
+
+    if((d = NCopendir(dir)) == NULL) return NC_EIO;
+    while((de = readdir(d)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if(len > slen && strcmp(de->d_name+len-slen,METASUFFIX) == 0)
+            nclistpush(names,strdup(de->d_name));
+    }
+    NCclosedir(d);
+#endif
+    return stat;
+}
+
+static long long
+filesize(const char* path)
+{
+    struct stat buf;
+    if(NCstat(path,&buf) < 0) return -1;
+    return (long long)buf.st_size;
+}
+
+static char*
+pathcat(const char* s1, const char* s2)
+{
+    size_t len1 = strlen(s1), len2 = strlen(s2);
+    char* s = (char*)malloc(len1+len2+1);
+    if(s == NULL) return NULL;
+    memcpy(s,s1,len1);
+    memcpy(s+len1,s2,len2+1);
+    return s;
+}
@@ -1423,8 +1423,13 @@ readmagic(struct MagicFile* file, long pos, char* magic)
 	NC_memio* meminfo = (NC_memio*)file->parameters;
 	if((pos + MAGIC_NUMBER_LEN) > meminfo->size)
 	    {status = NC_EINMEMORY; goto done;}
+	if(fIsSet(meminfo->flags,NC_MEMIO_COW)) {
+	    if((status = nc_memimage_read((NC_memimage*)meminfo->memory,(size_t)pos,MAGIC_NUMBER_LEN,magic)))
+	        goto done;
+	} else {
 	mempos = ((char*)meminfo->memory) + pos;
 	memcpy((void*)magic,mempos,MAGIC_NUMBER_LEN);
+	}
 #ifdef DEBUG
 	printmagic("XXX: readmagic",magic,file);
 #endif
@@ -20,38 +20,58 @@ Currently two operations are defined:
 #include "nc4dispatch.h"
 #include "ncoffsets.h"
 #include "ncbytes.h"
+#include "ncarena.h"
 
 #undef REPORT
 #undef DEBUG
 
+#ifdef ENABLE_DAP4
+EXTERNL int NCD4_get_substrate(int ncid);
+#endif
 
-/* It is helpful to have a structure that contains memory and an offset */
-typedef struct Position{char* memory; ptrdiff_t offset;} Position;
+
+/*
+A walk plan is a compiled description of the layout of one type, so
+that reclaiming, copying or dumping many instances does not look up
+the type metadata for every nested element. Plans of user types are
+built once and cached on their NC_TYPE_INFO_T (see NC_free_walkplan);
+plans of atomic types are static.
+*/
+typedef struct NCWalkField {
+    char* name;
+    size_t offset; /* of the field within the compound */
+    int ndims;
+    int dimsizes[NC_MAX_VAR_DIMS];
+    size_t arraycount; /* product of dimsizes */
+    struct NCWalkPlan* plan;
+} NCWalkField;
+
+typedef struct NCWalkPlan {
+    nc_type xtype;
+    int klass; /* NC_VLEN, NC_COMPOUND, NC_OPAQUE, NC_ENUM or the atomic type */
+    size_t size; /* size of one instance in memory */
+    size_t alignment;
+    int fixed; /* 1 => no nested memory: copy with memcpy, nothing to reclaim */
+    struct NCWalkPlan* base; /* vlen or enum basetype */
+    size_t nfields; /* compound fields */
+    NCWalkField* fields;
+} NCWalkPlan;
 
 static int type_alignment_initialized = 0;
 
+static int atomic_plans_initialized = 0;
+static NCWalkPlan atomic_plans[NC_MAX_ATOMIC_TYPE+1];
+
 /* Forward */
+static int getplan(int ncid, nc_type xtype, NCWalkPlan** planp);
 #ifdef USE_NETCDF4
-static int reclaim_datar(int ncid, nc_type xtype, Position*);
-static int reclaim_compound(int ncid, nc_type xtype, size_t size, size_t nfields, Position* offset);
-static int reclaim_vlen(int ncid, nc_type xtype, nc_type basetype, Position* offset);
-static int reclaim_enum(int ncid, nc_type xtype, nc_type basetype, Position* offset);
-static int reclaim_opaque(int ncid, nc_type xtype, size_t size, Position* offset);
-
-static int copy_datar(int ncid, nc_type xtype, Position* src, Position* dst);
-static int copy_compound(int ncid, nc_type xtype, size_t size, size_t nfields, Position* src, Position* dst);
-static int copy_vlen(int ncid, nc_type xtype, nc_type basetype, Position* src, Position* dst);
-static int copy_enum(int ncid, nc_type xtype, nc_type basetype, Position* src, Position* dst);
-static int copy_opaque(int ncid, nc_type xtype, size_t size, Position* src,Position* dst);
-
-static int dump_datar(int ncid, nc_type xtype, Position*, NCbytes* buf);
-static int dump_compound(int ncid, nc_type xtype, size_t size, size_t nfields, Position* offset, NCbytes* buf);
-static int dump_vlen(int ncid, nc_type xtype, nc_type basetype, Position* offset, NCbytes* buf);
-static int dump_enum(int ncid, nc_type xtype, nc_type basetype, Position* offset, NCbytes* buf);
-static int dump_opaque(int ncid, nc_type xtype, size_t size, Position* offset, NCbytes* buf);
-
+static int compileplan(int ncid, nc_type xtype, NCWalkPlan** planp);
+static int reclaim_plan(const NCWalkPlan* plan, char* memory, size_t count, size_t stride);
+static int copy_plan(const NCWalkPlan* plan, const char* src, char* dst, size_t count, size_t stride, nc_arena_t* arena);
+static size_t vlen_stride(const NCWalkPlan* base);
 static ptrdiff_t read_align(ptrdiff_t offset, size_t alignment);
 #endif
+static int dump_plan(const NCWalkPlan* plan, const char* memory, NCbytes* buf);
 
 static int NC_inq_any_type(int ncid, nc_type typeid, char *name, size_t *size, nc_type *basetypep, size_t *nfieldsp, int *classp);
 
@@ -88,9 +108,7 @@ int
 nc_reclaim_data(int ncid, nc_type xtype, void* memory, size_t count)
 {
     int stat = NC_NOERR;
-    size_t i;
-    Position offset;
-    int isf;
+    NCWalkPlan* plan = NULL;
 
     if(ncid < 0 || xtype <= 0)
         {stat = NC_EINVAL; goto done;}
@@ -102,26 +120,11 @@ nc_reclaim_data(int ncid, nc_type xtype, void* memory, size_t count)
     fprintf(stderr,">>> reclaim: memory=%p count=%lu ncid=%d xtype=%d\n",memory,(unsigned long)count,ncid,xtype);
 #endif
 
-    /* Optimizations */
-    /* 1. Vector of fixed size types */
-    if((stat = NC4_inq_type_fixed_size(ncid,xtype,&isf))) goto done;
-    if(isf) goto done; /* no need to reclaim anything */
+    if((stat = getplan(ncid,xtype,&plan))) goto done;
+    if(plan->fixed) goto done; /* no need to reclaim anything */
 
 #ifdef USE_NETCDF4
-    /* 2.Vector of strings */
-    if(xtype == NC_STRING) {
-	char** ss = (char**)memory;
-        for(i=0;i<count;i++) {
-	    nullfree(ss[i]);
-	}
-        goto done;
-    }
-    offset.memory = (char*)memory; /* use char* so we can do pointer arithmetic */
-    offset.offset = 0;
-    for(i=0;i<count;i++) {
-        if((stat=reclaim_datar(ncid,xtype,&offset))) /* reclaim one instance */
-	    break;
-    }
+    stat = reclaim_plan(plan,(char*)memory,count,plan->size);
 #else
     stat = NC_EBADTYPE;
 #endif
@@ -142,134 +145,44 @@ nc_reclaim_data_all(int ncid, nc_type xtypeid, void* memory, size_t count)
 }
 
 #ifdef USE_NETCDF4
-/* Recursive type walker: reclaim a single instance */
+/* Plan walker: reclaim count instances, stride bytes apart */
 static int
-reclaim_datar(int ncid, nc_type xtype, Position* offset)
+reclaim_plan(const NCWalkPlan* plan, char* memory, size_t count, size_t stride)
 {
     int stat = NC_NOERR;
-    size_t xsize;
-    nc_type basetype;
-    size_t nfields;
-    int klass, isf;
-
-    if((stat = NC4_inq_type_fixed_size(ncid,xtype,&isf))) goto done;
-
-    /* Get relevant type info */
-    if((stat = NC_inq_any_type(ncid,xtype,NULL,&xsize,&basetype,&nfields,&klass))) goto done;
-
-    if(isf) { /* no need to reclaim anything */
-	offset->offset += xsize;
-	goto done;
-    }
+    size_t i, fid;
 
-    switch  (xtype) {
-    case NC_STRING: {
-        char** sp = (char**)(offset->memory + offset->offset);
-        /* Need to reclaim string */
-	if(*sp != NULL) free(*sp);
-	offset->offset += xsize;
-	} break;
-    default:
-    	/* reclaim a user type */
-        switch (klass) {
-        case NC_OPAQUE: stat = reclaim_opaque(ncid,xtype,xsize,offset); break;
-        case NC_ENUM: stat = reclaim_enum(ncid,xtype,basetype,offset); break;
-        case NC_COMPOUND: stat = reclaim_compound(ncid,xtype,xsize,nfields,offset); break;
-        case NC_VLEN:
-	    stat = reclaim_vlen(ncid,xtype,basetype,offset);
-	    break;
-        default:
-            stat = NC_EINVAL;
-	    break;
-        }
+    if(plan->fixed) goto done;
+    switch (plan->klass) {
+    case NC_STRING:
+        for(i=0;i<count;i++) {
+	    char** sp = (char**)(memory + i*stride);
+	    nullfree(*sp);
+	}
 	break;
-    }
-done:
-    return stat;
-}
-
-static int
-reclaim_vlen(int ncid, nc_type xtype, nc_type basetype, Position* offset)
-{
-    int stat = NC_NOERR;
-    size_t i;
-    nc_vlen_t* vl = (nc_vlen_t*)(offset->memory+offset->offset);
-
-    if(vl->len > 0 && vl->p == NULL)
-        {stat = NC_EINVAL; goto done;}
-
-    /* Free up each entry in the vlen list */
-    if(vl->len > 0) {
-	Position voffset;
-	size_t alignment = 0;
-	if((stat = NC_type_alignment(ncid,basetype,&alignment))) goto done;;
-	voffset.memory = vl->p;
-	voffset.offset = 0;
-        for(i=0;i<vl->len;i++) {
-	    voffset.offset = read_align(voffset.offset,alignment);
-	    if((stat = reclaim_datar(ncid,basetype,&voffset))) goto done;
+    case NC_VLEN:
+        for(i=0;i<count;i++) {
+	    nc_vlen_t* vl = (nc_vlen_t*)(memory + i*stride);
+	    if(vl->len > 0 && vl->p == NULL)
+	        {stat = NC_EINVAL; goto done;}
+	    if(vl->len > 0) {
+		if((stat = reclaim_plan(plan->base,(char*)vl->p,vl->len,vlen_stride(plan->base)))) goto done;
+		free(vl->p);
+	    }
 	}
-	free(vl->p);
-    }
-    offset->offset += sizeof(nc_vlen_t);
-
-done:
-    return stat;
-}
-
-static int
-reclaim_enum(int ncid, nc_type xtype, nc_type basetype, Position* offset)
-{
-    int stat = NC_NOERR;
-abort();
-
-    /* basically same as an instance of the enum's integer basetype */
-    stat = reclaim_datar(ncid,basetype,offset);
-    return stat;
-}
-
-static int
-reclaim_opaque(int ncid, nc_type xtype, size_t size, Position* offset)
-{
-abort();
-    /* basically a fixed size sequence of bytes */
-    offset->offset += size;
-    return NC_NOERR;
-}
-
-static int
-reclaim_compound(int ncid, nc_type xtype, size_t size, size_t nfields, Position* offset)
-{
-    int stat = NC_NOERR;
-    size_t fid, i, arraycount;
-    ptrdiff_t saveoffset;
-    int ndims;
-    int dimsizes[NC_MAX_VAR_DIMS];
-
-    saveoffset = offset->offset;
-
-    /* Get info about each field in turn and reclaim it */
-    for(fid=0;fid<nfields;fid++) {
-	size_t fieldalignment;
-	nc_type fieldtype;
-
-	/* Get all relevant info about the field */
-	if((stat = nc_inq_compound_field(ncid,xtype,fid,NULL,&fieldalignment,&fieldtype,&ndims,dimsizes))) goto done;
-
-	if(ndims == 0) {ndims=1; dimsizes[0]=1;} /* fake the scalar case */
-	/* Align to this field */
-	offset->offset = saveoffset + fieldalignment;
-	/* compute the total number of elements in the field array */
-	arraycount = 1;
-	for(i=0;i<ndims;i++) arraycount *= dimsizes[i];
-	for(i=0;i<arraycount;i++) {
-	    if((stat = reclaim_datar(ncid, fieldtype, offset))) goto done;
+	break;
+    case NC_COMPOUND:
+        for(i=0;i<count;i++) {
+	    char* instance = memory + i*stride;
+	    for(fid=0;fid<plan->nfields;fid++) {
+		const NCWalkField* field = &plan->fields[fid];
+		if(field->plan->fixed) continue;
+		if((stat = reclaim_plan(field->plan,instance+field->offset,field->arraycount,field->plan->size))) goto done;
+	    }
 	}
+	break;
+    default: stat = NC_EINVAL; break;
     }
-    /* Return to beginning of the compound and move |compound| */
-    offset->offset = saveoffset;
-    offset->offset += size;
-
 done:
     return stat;
 }
@@ -305,13 +218,30 @@ Should work for any netcdf format.
 
 int
 nc_copy_data(int ncid, nc_type xtype, const void* memory, size_t count, void* copy)
+{
+    return NC_copy_data_arena(ncid,xtype,memory,count,copy,NULL);
+}
+
+/**
+@internal
+Copy as nc_copy_data() does, but allocate the nested strings and
+vlens from an arena, if one is given. Used to fill the caller's
+memory during nc_get_vara_arena().
+
+@param ncid root id
+@param xtype type id
+@param memory ptr to top-level memory to copy
+@param count number of instances of the type in memory block
+@param copy top-level space into which to copy the instance
+@param arena arena to allocate from, or NULL to use malloc
+@return error code
+*/
+
+int
+NC_copy_data_arena(int ncid, nc_type xtype, const void* memory, size_t count, void* copy, nc_arena_t* arena)
 {
     int stat = NC_NOERR;
-    size_t i;
-    Position src;
-    Position dst;
-    size_t xsize;
-    int isf;
+    NCWalkPlan* plan = NULL;
 
     if(ncid < 0 || xtype <= 0)
         {stat = NC_EINVAL; goto done;}
@@ -326,26 +256,17 @@ nc_copy_data(int ncid, nc_type xtype, const void* memory, size_t count, void* co
     fprintf(stderr,">>> copy   : copy  =%p memory=%p count=%lu ncid=%d xtype=%d\n",copy,memory,(unsigned long)count,ncid,xtype);
 #endif
 
-    /* Get type size */
-    if((stat = NC_inq_any_type(ncid,xtype,NULL,&xsize,NULL,NULL,NULL))) goto done;
+    if((stat = getplan(ncid,xtype,&plan))) goto done;
 
     /* Optimizations */
     /* 1. Vector of fixed sized objects */
-    if((stat = NC4_inq_type_fixed_size(ncid,xtype,&isf))) goto done;
-    if(isf) {
-	memcpy(copy,memory,xsize*count);
+    if(plan->fixed) {
+	memcpy(copy,memory,plan->size*count);
 	goto done;
     }
 
 #ifdef USE_NETCDF4
-    src.memory = (char*)memory; /* use char* so we can do pointer arithmetic */
-    src.offset = 0;
-    dst.memory = (char*)copy; /* use char* so we can do pointer arithmetic */
-    dst.offset = 0;
-    for(i=0;i<count;i++) {
-        if((stat=copy_datar(ncid,xtype,&src,&dst))) /* copy one instance copy_datar will increment src and dst*/
-	    break;
-    }
+    stat = copy_plan(plan,(const char*)memory,(char*)copy,count,plan->size,arena);
 #else
     stat = NC_EBADTYPE;
 #endif
@@ -380,176 +301,213 @@ done:
 }
 
 #ifdef USE_NETCDF4
-/* Recursive type walker: copy a single instance */
+/* Plan walker: copy count instances, stride bytes apart;
+   nested memory comes from the arena when there is one */
 static int
-copy_datar(int ncid, nc_type xtype, Position* src, Position* dst)
+copy_plan(const NCWalkPlan* plan, const char* src, char* dst, size_t count, size_t stride, nc_arena_t* arena)
 {
     int stat = NC_NOERR;
-    size_t xsize;
-    nc_type basetype;
-    size_t nfields;
-    int xclass,isf;
-
-    if((stat = NC_inq_any_type(ncid,xtype,NULL,&xsize,&basetype,&nfields,&xclass))) goto done;
+    size_t i, fid;
 
-    /* Optimizations */
-    /* 1. Vector of fixed size types */
-    if((stat = NC4_inq_type_fixed_size(ncid,xtype,&isf))) goto done;
-    if(isf) {
-	memcpy(dst->memory+dst->offset,src->memory+src->offset,xsize*1);
-        src->offset += xsize;
-        dst->offset += xsize;
+    if(count == 0) goto done;
+    if(plan->fixed) {
+	memcpy(dst,src,(count-1)*stride + plan->size);
 	goto done;
     }
-
-    switch  (xtype) {
-    case NC_STRING: {
-        char** sp = (char**)(src->memory + src->offset);
-	char* copy = NULL;
-        /* Need to copy string */
-	if(*sp != NULL) {
-	    if((copy = strdup(*sp))==NULL) {stat = NC_ENOMEM; goto done;}
+    switch (plan->klass) {
+    case NC_STRING:
+        for(i=0;i<count;i++) {
+	    char* const* sp = (char* const*)(src + i*stride);
+	    char* copy = NULL;
+	    /* Need to copy string */
+	    if(*sp != NULL) {
+		if(arena == NULL)
+		    copy = strdup(*sp);
+		else if((copy = (char*)NC_arena_alloc(arena,strlen(*sp)+1))!=NULL)
+		    strcpy(copy,*sp);
+		if(copy==NULL) {stat = NC_ENOMEM; goto done;}
+	    }
+	    memcpy(dst + i*stride,(void*)&copy,sizeof(char*));
+	}
+	break;
+    case NC_VLEN:
+        for(i=0;i<count;i++) {
+	    const nc_vlen_t* vl = (const nc_vlen_t*)(src + i*stride);
+	    nc_vlen_t copy = {0,NULL};
+	    size_t basestride = vlen_stride(plan->base);
+	    if(vl->len > 0 && vl->p == NULL)
+	        {stat = NC_EINVAL; goto done;}
+	    /* Make space in the copy vlen and copy each entry */
+	    if(vl->len > 0) {
+		copy.len = vl->len;
+		if(arena == NULL)
+		    copy.p = calloc(copy.len,basestride);
+		else
+		    copy.p = NC_arena_alloc(arena,copy.len*basestride);
+		if(copy.p==NULL) {stat = NC_ENOMEM; goto done;}
+		if((stat = copy_plan(plan->base,(const char*)vl->p,(char*)copy.p,copy.len,basestride,arena)))
+		    {if(arena == NULL) nullfree(copy.p); goto done;}
+	    }
+	    /* Move into place */
+	    memcpy(dst + i*stride,&copy,sizeof(nc_vlen_t));
 	}
-	memcpy(dst->memory+dst->offset,(void*)&copy,sizeof(char*));
-	src->offset += xsize;
-	dst->offset += xsize;
-	} break;
-    default:
-    	/* copy a user type */
-        switch (xclass) {
-        case NC_OPAQUE: stat = copy_opaque(ncid,xtype,xsize,src,dst); break;
-        case NC_ENUM: stat = copy_enum(ncid,xtype,basetype,src,dst); break;
-        case NC_COMPOUND: stat = copy_compound(ncid,xtype,xsize,nfields,src,dst); break;
-        case NC_VLEN: stat = copy_vlen(ncid,xtype,basetype,src,dst); break;
-        default: stat = NC_EINVAL; break;
-        }
 	break;
+    case NC_COMPOUND:
+        for(i=0;i<count;i++) {
+	    const char* srcinstance = src + i*stride;
+	    char* dstinstance = dst + i*stride;
+	    /* Copy the fixed size fields at once, then replace the others */
+	    memcpy(dstinstance,srcinstance,plan->size);
+	    for(fid=0;fid<plan->nfields;fid++) {
+		const NCWalkField* field = &plan->fields[fid];
+		if(field->plan->fixed) continue;
+		if((stat = copy_plan(field->plan,srcinstance+field->offset,dstinstance+field->offset,
+				     field->arraycount,field->plan->size,arena))) goto done;
+	    }
+	}
+	break;
+    default: stat = NC_EINVAL; break;
     }
 done:
     return stat;
 }
+#endif
+
+/**************************************************/
+/* Walk plans */
 
+/* Get the plan for a type, compiling a user type plan on first use */
 static int
-copy_vlen(int ncid, nc_type xtype, nc_type basetype, Position* src, Position* dst)
+getplan(int ncid, nc_type xtype, NCWalkPlan** planp)
 {
     int stat = NC_NOERR;
-    size_t i, basetypesize;
-    nc_vlen_t* vl = (nc_vlen_t*)(src->memory+src->offset);
-    nc_vlen_t copy = {0,NULL};
 
-    if(vl->len > 0 && vl->p == NULL)
-        {stat = NC_EINVAL; goto done;}
-
-    /* Get basetype info */
-    if((stat = NC_inq_any_type(ncid,basetype,NULL,&basetypesize,NULL,NULL,NULL))) goto done;
-
-    /* Make space in the copy vlen */
-    if(vl->len > 0) {
-        copy.len = vl->len;
-        if((copy.p = calloc(copy.len,basetypesize))==NULL) {stat = NC_ENOMEM; goto done;}
-    } 
-    /* Copy each entry in the vlen list */
-    if(vl->len > 0) {
-	Position vsrc, vdst;
-	size_t alignment = 0;
-	if((stat = NC_type_alignment(ncid,basetype,&alignment))) goto done;;
-	vsrc.memory = vl->p;
-	vsrc.offset = 0;
-	vdst.memory = copy.p;
-	vdst.offset = 0;
-        for(i=0;i<vl->len;i++) {
-	    vsrc.offset= read_align(vsrc.offset,alignment);
-    	    vdst.offset= read_align(vdst.offset,alignment);
-	    if((stat = copy_datar(ncid,basetype,&vsrc,&vdst))) goto done;
+    if(xtype > NC_NAT && xtype <= NC_MAX_ATOMIC_TYPE) {
+	if(!atomic_plans_initialized) {
+	    nc_type t;
+	    if(!type_alignment_initialized) {
+		NC_compute_alignments();
+		type_alignment_initialized = 1;
+	    }
+	    for(t=NC_NAT+1;t<=NC_MAX_ATOMIC_TYPE;t++) {
+		NCWalkPlan* plan = &atomic_plans[t];
+		plan->xtype = t;
+		plan->klass = t;
+		plan->fixed = (t != NC_STRING);
+		if((stat = NC4_inq_atomic_type(t,NULL,&plan->size))) goto done;
+		if((stat = NC_class_alignment(t,&plan->alignment))) goto done;
+	    }
+	    atomic_plans_initialized = 1;
+	}
+	*planp = &atomic_plans[xtype];
+    } else {
+#ifdef USE_NETCDF4
+	NC_FILE_INFO_T* h5 = NULL;
+	NC_TYPE_INFO_T* typ = NULL;
+	int typencid = ncid;
+#ifdef ENABLE_DAP4
+        NC* nc = NULL;
+        if ((stat = NC_check_id(ncid, &nc))) goto done;
+	if(nc->dispatch->model == NC_FORMATX_DAP4)
+	    typencid = NCD4_get_substrate(ncid);
+#endif
+        if ((stat = nc4_find_grp_h5(typencid, NULL, &h5))) goto done;
+        if((stat = nc4_find_type(h5,xtype,&typ))) goto done;
+	if(typ == NULL) {stat = NC_EBADTYPE; goto done;}
+	if(typ->walkplan == NULL) {
+	    NCWalkPlan* plan = NULL;
+	    if((stat = compileplan(ncid,xtype,&plan))) goto done;
+	    typ->walkplan = plan;
 	}
+	*planp = (NCWalkPlan*)typ->walkplan;
+#else
+	stat = NC_EBADTYPE;
+#endif
     }
-    /* Move into place */
-    memcpy(dst->memory+dst->offset,&copy,sizeof(nc_vlen_t));
-    src->offset += sizeof(nc_vlen_t);
-    dst->offset += sizeof(nc_vlen_t);
-
 done:
-    if(stat) {
-	nullfree(copy.p);
-    }
     return stat;
 }
 
+#ifdef USE_NETCDF4
+/* Build the plan of a user type; the plans of its base and field
+   types are obtained (and cached) through getplan */
 static int
-copy_enum(int ncid, nc_type xtype, nc_type basetype, Position* src, Position* dst)
+compileplan(int ncid, nc_type xtype, NCWalkPlan** planp)
 {
     int stat = NC_NOERR;
-abort();
-    /* basically same as an instance of the enum's integer basetype */
-    stat = copy_datar(ncid,basetype,src,dst);
+    NCWalkPlan* plan = NULL;
+    nc_type basetype;
+    size_t nfields, fid;
+    int d;
+
+    if((plan = (NCWalkPlan*)calloc(1,sizeof(NCWalkPlan)))==NULL)
+	{stat = NC_ENOMEM; goto done;}
+    plan->xtype = xtype;
+    if((stat = NC_inq_any_type(ncid,xtype,NULL,&plan->size,&basetype,&nfields,&plan->klass))) goto done;
+    if((stat = NC_type_alignment(ncid,xtype,&plan->alignment))) goto done;
+
+    switch (plan->klass) {
+    case NC_OPAQUE:
+	plan->fixed = 1;
+	break;
+    case NC_ENUM:
+	if((stat = getplan(ncid,basetype,&plan->base))) goto done;
+	plan->fixed = 1;
+	break;
+    case NC_VLEN:
+	if((stat = getplan(ncid,basetype,&plan->base))) goto done;
+	plan->fixed = 0;
+	break;
+    case NC_COMPOUND:
+	plan->fixed = 1;
+	if(nfields > 0 && (plan->fields = (NCWalkField*)calloc(nfields,sizeof(NCWalkField)))==NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	plan->nfields = nfields;
+	for(fid=0;fid<nfields;fid++) {
+	    NCWalkField* field = &plan->fields[fid];
+	    char name[NC_MAX_NAME+1];
+	    nc_type fieldtype;
+	    if((stat = nc_inq_compound_field(ncid,xtype,fid,name,&field->offset,&fieldtype,&field->ndims,field->dimsizes))) goto done;
+	    if((field->name = strdup(name))==NULL) {stat = NC_ENOMEM; goto done;}
+	    field->arraycount = 1;
+	    for(d=0;d<field->ndims;d++) field->arraycount *= (size_t)field->dimsizes[d];
+	    if((stat = getplan(ncid,fieldtype,&field->plan))) goto done;
+	    if(!field->plan->fixed) plan->fixed = 0;
+	}
+	break;
+    default: stat = NC_EBADTYPE; goto done;
+    }
+    *planp = plan; plan = NULL;
+
+done:
+    NC_free_walkplan(plan);
     return stat;
 }
 
-static int
-copy_opaque(int ncid, nc_type xtype, size_t size, Position* src, Position* dst)
+/* Distance between the elements of a vlen */
+static size_t
+vlen_stride(const NCWalkPlan* base)
 {
-abort();
-    /* basically a fixed size sequence of bytes */
-    memcpy(dst->memory+dst->offset,src->memory+src->offset,size);
-    src->offset += size;
-    dst->offset += size;
-    return NC_NOERR;
+    return (size_t)read_align((ptrdiff_t)base->size,base->alignment);
 }
-
-static int
-copy_compound(int ncid, nc_type xtype, size_t size, size_t nfields, Position* src, Position* dst)
-{
-    int stat = NC_NOERR;
-    size_t fid, i, arraycount;
-    ptrdiff_t savesrcoffset, savedstoffset;
-    int ndims;
-    int dimsizes[NC_MAX_VAR_DIMS];
-
-    savesrcoffset = src->offset;
-    savedstoffset = dst->offset;
-
-    /* Get info about each field in turn and copy it */
-    for(fid=0;fid<nfields;fid++) {
-	size_t fieldoffset;
-	nc_type fieldtype;
-char name[NC_MAX_NAME];
-
-	/* Get all relevant info about the field */
-	if((stat = nc_inq_compound_field(ncid,xtype,fid,name,&fieldoffset,&fieldtype,&ndims,dimsizes))) goto done;
-
-	if(ndims == 0) {ndims=1; dimsizes[0]=1;} /* fake the scalar case */
-	/* Set offset for this field */
-#ifdef DEBUG
-fprintf(stderr,"before: offset = %d after: offset = %d\n",(int)src->offset,(int)(savesrcoffset+fieldoffset));
 #endif
-	src->offset = savesrcoffset+fieldoffset;
-	dst->offset = savedstoffset+fieldoffset;
-#ifdef DEBUG
-fprintf(stderr,"field %s(%d) = %d\n",name,(int)fieldoffset,(int)src->offset);
-#endif
-	/* compute the total number of elements in the field array */
-	arraycount = 1;
-	for(i=0;i<ndims;i++) arraycount *= dimsizes[i];
-	for(i=0;i<arraycount;i++) {
-	    if((stat = copy_datar(ncid, fieldtype, src, dst))) goto done;
-	}
-#ifdef DEBUG
-fprintf(stderr,"src=(%d,%p)\n",(int)src->offset,src->memory);
-#endif
-    }
-#ifdef DEBUG
-fprintf(stderr,"\n");
-#endif
-    /* Return to beginning of the compound and move |compound| */
-    src->offset = savesrcoffset;
-    dst->offset = savedstoffset;
-    src->offset += size;
-    dst->offset += size;
 
-done:
-    return stat;
+/**
+ @internal Free the walk plan cached on a user type. Nested plans
+ belong to their own types and are not freed.
+ @param plan0 plan to free; may be NULL
+*/
+void
+NC_free_walkplan(void* plan0)
+{
+    NCWalkPlan* plan = (NCWalkPlan*)plan0;
+    size_t i;
+    if(plan == NULL) return;
+    for(i=0;i<plan->nfields;i++)
+	nullfree(plan->fields[i].name);
+    nullfree(plan->fields);
+    free(plan);
 }
-#endif
 
 /**************************************************/
 /* Alignment functions */
@@ -623,7 +581,7 @@ nc_dump_data(int ncid, nc_type xtype, void* memory, size_t count, char** bufp)
 {
     int stat = NC_NOERR;
     size_t i;
-    Position offset;
+    NCWalkPlan* plan = NULL;
     NCbytes* buf = ncbytesnew();
 
     if(ncid < 0 || xtype <= 0)
@@ -635,11 +593,10 @@ nc_dump_data(int ncid, nc_type xtype, void* memory, size_t count, char** bufp)
 #ifdef REPORT
     fprintf(stderr,">>> dump: memory=%p count=%lu ncid=%d xtype=%d\n",memory,(unsigned long)count,ncid,xtype);
 #endif
-    offset.memory = (char*)memory; /* use char* so we can do pointer arithmetic */
-    offset.offset = 0;
+    if((stat = getplan(ncid,xtype,&plan))) goto done;
     for(i=0;i<count;i++) {
 	if(i > 0) ncbytescat(buf," ");
-        if((stat=dump_datar(ncid,xtype,&offset,buf))) /* dump one instance */
+        if((stat=dump_plan(plan,(char*)memory + i*plan->size,buf))) /* dump one instance */
 	    break;
     }
 
@@ -661,207 +618,120 @@ nc_print_data(int ncid, nc_type xtype, void* memory, size_t count)
     return stat;
 }
 
-/* Recursive type walker: dump a single instance */
+/* Plan walker: dump a single instance */
 static int
-dump_datar(int ncid, nc_type xtype, Position* offset, NCbytes* buf)
+dump_plan(const NCWalkPlan* plan, const char* memory, NCbytes* buf)
 {
     int stat = NC_NOERR;
-    size_t xsize;
-    nc_type basetype;
-    size_t nfields;
-    int klass;
     char s[128];
+    size_t i;
 
-    /* Get relevant type info */
-    if((stat = NC_inq_any_type(ncid,xtype,NULL,&xsize,&basetype,&nfields,&klass))) goto done;
-
-    switch  (xtype) {
+    switch (plan->klass) {
     case NC_CHAR:
-	snprintf(s,sizeof(s),"'%c'",*(char*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"'%c'",*(char*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_BYTE:
-	snprintf(s,sizeof(s),"%d",*(char*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%d",*(char*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_UBYTE:
-	snprintf(s,sizeof(s),"%u",*(unsigned char*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%u",*(unsigned char*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_SHORT:
-	snprintf(s,sizeof(s),"%d",*(short*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%d",*(short*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_USHORT:
-	snprintf(s,sizeof(s),"%d",*(unsigned short*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%d",*(unsigned short*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_INT:
-	snprintf(s,sizeof(s),"%d",*(int*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%d",*(int*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_UINT:
-	snprintf(s,sizeof(s),"%d",*(unsigned int*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%d",*(unsigned int*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_FLOAT:
-	snprintf(s,sizeof(s),"%f",*(float*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%f",*(float*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_INT64:
-	snprintf(s,sizeof(s),"%lld",*(long long*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%lld",*(long long*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_UINT64:
-	snprintf(s,sizeof(s),"%llu",*(unsigned long long*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%llu",*(unsigned long long*)memory);
 	ncbytescat(buf,s);
 	break;
     case NC_DOUBLE:
-	snprintf(s,sizeof(s),"%lf",*(double*)(offset->memory+offset->offset));
+	snprintf(s,sizeof(s),"%lf",*(double*)memory);
 	ncbytescat(buf,s);
 	break;
 #ifdef USE_NETCDF4
     case NC_STRING: {
-        char* s = *(char**)(offset->memory + offset->offset);
+        char* s = *(char**)memory;
 	ncbytescat(buf,"\"");
 	ncbytescat(buf,s);
 	ncbytescat(buf,"\"");
 	} break;
-#endif
-    default:
-#ifdef USE_NETCDF4
-    	/* dump a user type */
-        switch (klass) {
-        case NC_OPAQUE: stat = dump_opaque(ncid,xtype,xsize,offset,buf); break;
-        case NC_ENUM: stat = dump_enum(ncid,xtype,basetype,offset,buf); break;
-        case NC_COMPOUND: stat = dump_compound(ncid,xtype,xsize,nfields,offset,buf); break;
-        case NC_VLEN: stat = dump_vlen(ncid,xtype,basetype,offset,buf); break;
-        default: stat = NC_EBADTYPE; break;
-        }
-#else
-	stat = NC_EBADTYPE;
-#endif
-	break;
-    }
-    if(xtype <= NC_MAX_ATOMIC_TYPE)
-	offset->offset += xsize;
-
-done:
-    return stat;
-}
-
-#ifdef USE_NETCDF4
-static int
-dump_vlen(int ncid, nc_type xtype, nc_type basetype, Position* offset, NCbytes* buf)
-{
-    int stat = NC_NOERR;
-    size_t i;
-    nc_vlen_t* vl = (nc_vlen_t*)(offset->memory+offset->offset);
-    char s[128];
-
-    if(vl->len > 0 && vl->p == NULL)
-        {stat = NC_EINVAL; goto done;}
-
-    snprintf(s,sizeof(s),"{len=%u,p=(",(unsigned)vl->len);
-    ncbytescat(buf,s);
-    /* dump each entry in the vlen list */
-    if(vl->len > 0) {
-	Position voffset;
-	size_t alignment = 0;
-	if((stat = NC_type_alignment(ncid,basetype,&alignment))) goto done;;
-	voffset.memory = vl->p;
-	voffset.offset = 0;
-        for(i=0;i<vl->len;i++) {
+    case NC_VLEN: {
+        const nc_vlen_t* vl = (const nc_vlen_t*)memory;
+	size_t basestride = vlen_stride(plan->base);
+	if(vl->len > 0 && vl->p == NULL)
+	    {stat = NC_EINVAL; goto done;}
+	snprintf(s,sizeof(s),"{len=%u,p=(",(unsigned)vl->len);
+	ncbytescat(buf,s);
+	/* dump each entry in the vlen list */
+	for(i=0;i<vl->len;i++) {
 	    if(i > 0) ncbytescat(buf," ");
-	    voffset.offset = read_align(voffset.offset,alignment);
-	    if((stat = dump_datar(ncid,basetype,&voffset,buf))) goto done;
+	    if((stat = dump_plan(plan->base,(const char*)vl->p + i*basestride,buf))) goto done;
 	}
-    } 
-    ncbytescat(buf,")}");
-    offset->offset += sizeof(nc_vlen_t);
-    
-done:
-    return stat;
-}
-
-static int
-dump_enum(int ncid, nc_type xtype, nc_type basetype, Position* offset, NCbytes* buf)
-{
-    int stat = NC_NOERR;
-
-    /* basically same as an instance of the enum's integer basetype */
-    stat = dump_datar(ncid,basetype,offset,buf);
-    return stat;
-}
-
-static int
-dump_opaque(int ncid, nc_type xtype, size_t size, Position* offset, NCbytes* buf)
-{
-    size_t i;
-    char sx[16];
-    /* basically a fixed size sequence of bytes */
-    ncbytescat(buf,"|");
-    for(i=0;i<size;i++) {
-	unsigned char x = *(offset->memory+offset->offset+i);
-	snprintf(sx,sizeof(sx),"%2x",x);
-	ncbytescat(buf,sx);
-    }
-    ncbytescat(buf,"|");
-    offset->offset += size;
-    return NC_NOERR;
-}
-
-static int
-dump_compound(int ncid, nc_type xtype, size_t size, size_t nfields, Position* offset, NCbytes* buf)
-{
-    int stat = NC_NOERR;
-    size_t fid, i, arraycount;
-    ptrdiff_t saveoffset;
-    int ndims;
-    int dimsizes[NC_MAX_VAR_DIMS];
-
-    saveoffset = offset->offset;
-
-    ncbytescat(buf,"<");
-
-    /* Get info about each field in turn and dump it */
-    for(fid=0;fid<nfields;fid++) {
-	size_t fieldalignment;
-	nc_type fieldtype;
-	char name[NC_MAX_NAME];
-	char sd[128];
-
-	/* Get all relevant info about the field */
-	if((stat = nc_inq_compound_field(ncid,xtype,fid,name,&fieldalignment,&fieldtype,&ndims,dimsizes))) goto done;
-	if(fid > 0) ncbytescat(buf,";");
-	ncbytescat(buf,name);
-        if(ndims > 0) {
+	ncbytescat(buf,")}");
+	} break;
+    case NC_ENUM:
+	/* basically same as an instance of the enum's integer basetype */
+	stat = dump_plan(plan->base,memory,buf);
+	break;
+    case NC_OPAQUE: {
+	char sx[16];
+	/* basically a fixed size sequence of bytes */
+	ncbytescat(buf,"|");
+	for(i=0;i<plan->size;i++) {
+	    unsigned char x = (unsigned char)memory[i];
+	    snprintf(sx,sizeof(sx),"%2x",x);
+	    ncbytescat(buf,sx);
+	}
+	ncbytescat(buf,"|");
+	} break;
+    case NC_COMPOUND: {
+	size_t fid;
+	ncbytescat(buf,"<");
+	for(fid=0;fid<plan->nfields;fid++) {
+	    const NCWalkField* field = &plan->fields[fid];
 	    int j;
-	    for(j=0;j<ndims;j++) {
-		snprintf(sd,sizeof(sd),"[%d]",(int)dimsizes[j]);
-		ncbytescat(buf,sd);
+	    if(fid > 0) ncbytescat(buf,";");
+	    ncbytescat(buf,field->name);
+	    for(j=0;j<field->ndims;j++) {
+		snprintf(s,sizeof(s),"[%d]",(int)field->dimsizes[j]);
+		ncbytescat(buf,s);
+	    }
+	    for(i=0;i<field->arraycount;i++) {
+		if(i > 0) ncbytescat(buf," ");
+		if((stat = dump_plan(field->plan,memory+field->offset+i*field->plan->size,buf))) goto done;
 	    }
 	}
-	if(ndims == 0) {ndims=1; dimsizes[0]=1;} /* fake the scalar case */
-	/* Align to this field */
-	offset->offset = saveoffset + fieldalignment;
-	/* compute the total number of elements in the field array */
-	arraycount = 1;
-	for(i=0;i<ndims;i++) arraycount *= dimsizes[i];
-	for(i=0;i<arraycount;i++) {
-	    if(i > 0) ncbytescat(buf," ");
-	    if((stat = dump_datar(ncid, fieldtype, offset,buf))) goto done;
-	}
+	ncbytescat(buf,">");
+	} break;
+#endif
+    default: stat = NC_EBADTYPE; break;
     }
-    ncbytescat(buf,">");
-    /* Return to beginning of the compound and move |compound| */
-    offset->offset = saveoffset;
-    offset->offset += size;
-
 done:
     return stat;
 }
-#endif
 
 /* Extended version that can handle atomic typeids */
 int
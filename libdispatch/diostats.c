@@ -0,0 +1,365 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+/**
+ * @file
+ *
+ * Per-file and per-variable I/O statistics and the optional
+ * JSON-lines trace written when a file is closed.
+ *
+ * The statistics are only collected when the library was built with
+ * ENABLE_IOSTATS. The trace is enabled by setting the environment
+ * variable NCIOTRACE to a file name (the trace is appended to it)
+ * or to "stderr".
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#ifdef HAVE_CLOCK_GETTIME
+#include <time.h>
+#endif
+#include "ncdispatch.h"
+#include "nclist.h"
+#include "nciostats.h"
+
+#ifdef ENABLE_IOSTATS
+
+/* Forward */
+static void iotrace(NC* ncp);
+
+/**
+ * @internal Create the statistics object for a newly created NC.
+ *
+ * @param ncp NC instance
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOMEM Out of memory.
+ */
+int
+NC_iostats_new(NC* ncp)
+{
+    NCiostats* iostats = NULL;
+    if((iostats = (NCiostats*)calloc(1,sizeof(NCiostats))) == NULL)
+        return NC_ENOMEM;
+    if((iostats->vars = nclistnew()) == NULL)
+        {free(iostats); return NC_ENOMEM;}
+    ncp->iostats = iostats;
+    return NC_NOERR;
+}
+
+/**
+ * @internal Emit the trace (if enabled) and reclaim the statistics.
+ *
+ * @param ncp NC instance
+ */
+void
+NC_iostats_free(NC* ncp)
+{
+    size_t i;
+    NCiostats* iostats = ncp->iostats;
+    if(iostats == NULL) return;
+    iotrace(ncp);
+    for(i=0;i<nclistlength(iostats->vars);i++) {
+        NCvariostats* vs = (NCvariostats*)nclistget(iostats->vars,i);
+        nullfree(vs->name);
+        free(vs);
+    }
+    nclistfree(iostats->vars);
+    free(iostats);
+    ncp->iostats = NULL;
+}
+
+/**
+ * @internal Return the file level counters.
+ *
+ * @param ncp NC instance; may be NULL.
+ * @return pointer to the counters or NULL.
+ */
+nc_io_stats_t*
+NC_iostats_file(NC* ncp)
+{
+    if(ncp == NULL || ncp->iostats == NULL) return NULL;
+    return &((NCiostats*)ncp->iostats)->stats;
+}
+
+/**
+ * @internal Return the counters for a variable, creating them if
+ * necessary.
+ *
+ * @param ncp NC instance; may be NULL.
+ * @param ncid group id containing the variable
+ * @param varid variable id
+ * @return pointer to the counters or NULL.
+ */
+nc_io_stats_t*
+NC_iostats_var(NC* ncp, int ncid, int varid)
+{
+    size_t i;
+    NCiostats* iostats = NULL;
+    NCvariostats* vs = NULL;
+    char name[NC_MAX_NAME+1];
+
+    if(ncp == NULL || (iostats = (NCiostats*)ncp->iostats) == NULL) return NULL;
+    if(varid == NC_GLOBAL) return NULL;
+    /* Most recently created or used is most likely at the end */
+    for(i=nclistlength(iostats->vars);i-->0;) {
+        vs = (NCvariostats*)nclistget(iostats->vars,i);
+        if(vs->ncid == ncid && vs->varid == varid) return &vs->stats;
+    }
+    if((vs = (NCvariostats*)calloc(1,sizeof(NCvariostats))) == NULL) return NULL;
+    vs->ncid = ncid;
+    vs->varid = varid;
+    /* Capture the name now since it may not be available at close */
+    if(ncp->dispatch != NULL && ncp->dispatch->inq_var_all != NULL
+       && ncp->dispatch->inq_var_all(ncid,varid,name,NULL,NULL,NULL,NULL,NULL,NULL,NULL,
+                                     NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL) == NC_NOERR)
+        vs->name = strdup(name);
+    nclistpush(iostats->vars,vs);
+    return &vs->stats;
+}
+
+/**
+ * @internal Return the file level counters given an ncid.
+ *
+ * @param ncid file or group id
+ * @return pointer to the counters or NULL.
+ */
+nc_io_stats_t*
+NC_iostats_find(int ncid)
+{
+    NC* ncp = NULL;
+    if(NC_check_id(ncid,&ncp)) return NULL;
+    return NC_iostats_file(ncp);
+}
+
+/**
+ * @internal Current time in seconds from some arbitrary origin.
+ *
+ * @return the time
+ */
+double
+NC_iostats_now(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ((double)ts.tv_sec) + (((double)ts.tv_nsec) / 1.0e9);
+#elif defined(HAVE_GETTIMEOFDAY)
+    struct timeval tv;
+    gettimeofday(&tv,NULL);
+    return ((double)tv.tv_sec) + (((double)tv.tv_usec) / 1.0e6);
+#else
+    return 0.0;
+#endif
+}
+
+/**
+ * @internal Note the start of a dispatched get/put call.
+ *
+ * @param ncp NC instance
+ * @return the start time of the call
+ */
+double
+NC_iostats_enter(NC* ncp)
+{
+    NCiostats* iostats = (NCiostats*)ncp->iostats;
+    if(iostats == NULL) return 0.0;
+    iostats->depth++;
+    return NC_iostats_now();
+}
+
+/**
+ * @internal Note the end of a dispatched get/put call and
+ * account for it. Calls nested inside another get/put call (e.g. the
+ * per-element calls of NCDEFAULT_get_vars) are not counted.
+ *
+ * @param ncp NC instance
+ * @param ncid group id
+ * @param varid variable id
+ * @param memtype memory type of the transfer; NC_NAT => var type
+ * @param count number of elements along each dimension
+ * @param isput 1 for a write, 0 for a read
+ * @param t0 value returned by NC_iostats_enter
+ */
+void
+NC_iostats_leave(NC* ncp, int ncid, int varid, nc_type memtype,
+                 const size_t* count, int isput, double t0)
+{
+    int i, ndims = 0;
+    nc_type xtype = NC_NAT;
+    size_t typesize = 0;
+    unsigned long long nelems = 1;
+    double elapsed;
+    nc_io_stats_t* fs = NULL;
+    nc_io_stats_t* vs = NULL;
+    NCiostats* iostats = (NCiostats*)ncp->iostats;
+
+    if(iostats == NULL) return;
+    if(--iostats->depth > 0) return;
+    elapsed = NC_iostats_now() - t0;
+    if(ncp->dispatch->inq_var_all(ncid,varid,NULL,&xtype,&ndims,NULL,NULL,NULL,NULL,NULL,
+                                  NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL) != NC_NOERR)
+        return;
+    if(memtype == NC_NAT) memtype = xtype;
+    if(nc_inq_type(ncid,memtype,NULL,&typesize) != NC_NOERR) typesize = 0;
+    for(i=0;i<ndims && count != NULL;i++) nelems *= count[i];
+    fs = NC_iostats_file(ncp);
+    vs = NC_iostats_var(ncp,ncid,varid);
+    if(isput) {
+        NCIOSTAT_INCR(fs,put_calls); NCIOSTAT_INCR(vs,put_calls);
+        NCIOSTAT_ADD(fs,bytes_written,nelems*typesize); NCIOSTAT_ADD(vs,bytes_written,nelems*typesize);
+        NCIOSTAT_ADD(fs,put_time,elapsed); NCIOSTAT_ADD(vs,put_time,elapsed);
+    } else {
+        NCIOSTAT_INCR(fs,get_calls); NCIOSTAT_INCR(vs,get_calls);
+        NCIOSTAT_ADD(fs,bytes_read,nelems*typesize); NCIOSTAT_ADD(vs,bytes_read,nelems*typesize);
+        NCIOSTAT_ADD(fs,get_time,elapsed); NCIOSTAT_ADD(vs,get_time,elapsed);
+    }
+}
+
+/**************************************************/
+/* Trace output */
+
+static void
+jsonstring(FILE* f, const char* s)
+{
+    fputc('"',f);
+    for(;s != NULL && *s;s++) {
+        switch (*s) {
+        case '"': case '\\': fputc('\\',f); fputc(*s,f); break;
+        case '\n': fputs("\\n",f); break;
+        case '\t': fputs("\\t",f); break;
+        default:
+            if(((unsigned char)*s) < ' ') fprintf(f,"\\u%04x",(unsigned)*s); else fputc(*s,f);
+            break;
+        }
+    }
+    fputc('"',f);
+}
+
+static void
+jsonstats(FILE* f, const nc_io_stats_t* s)
+{
+    fprintf(f,"\"get_calls\":%llu,\"put_calls\":%llu,\"bytes_read\":%llu,\"bytes_written\":%llu",
+        s->get_calls,s->put_calls,s->bytes_read,s->bytes_written);
+    fprintf(f,",\"io_reads\":%llu,\"io_writes\":%llu,\"io_moves\":%llu,\"io_bytes_read\":%llu,\"io_bytes_written\":%llu",
+        s->io_reads,s->io_writes,s->io_moves,s->io_bytes_read,s->io_bytes_written);
+    fprintf(f,",\"cache_hits\":%llu,\"cache_misses\":%llu,\"cache_evictions\":%llu",
+        s->cache_hits,s->cache_misses,s->cache_evictions);
+    fprintf(f,",\"filter_encodes\":%llu,\"filter_decodes\":%llu,\"filter_encode_time\":%.6f,\"filter_decode_time\":%.6f",
+        s->filter_encodes,s->filter_decodes,s->filter_encode_time,s->filter_decode_time);
+    fprintf(f,",\"http_requests\":%llu,\"http_bytes\":%llu,\"get_time\":%.6f,\"put_time\":%.6f",
+        s->http_requests,s->http_bytes,s->get_time,s->put_time);
+}
+
+/* Append one JSON object per line: one for the file, one per variable */
+static void
+iotrace(NC* ncp)
+{
+    size_t i;
+    FILE* f = NULL;
+    const char* target = getenv(NCENVIOTRACE);
+    NCiostats* iostats = (NCiostats*)ncp->iostats;
+
+    if(target == NULL || *target == '\0') return;
+    if(strcmp(target,"stderr")==0)
+        f = stderr;
+    else if((f = fopen(target,"a")) == NULL)
+        return;
+    fputs("{\"scope\":\"file\",\"path\":",f);
+    jsonstring(f,ncp->path);
+    fprintf(f,",\"ncid\":%d,",ncp->ext_ncid);
+    jsonstats(f,&iostats->stats);
+    fputs("}\n",f);
+    for(i=0;i<nclistlength(iostats->vars);i++) {
+        NCvariostats* vs = (NCvariostats*)nclistget(iostats->vars,i);
+        fputs("{\"scope\":\"var\",\"path\":",f);
+        jsonstring(f,ncp->path);
+        fprintf(f,",\"ncid\":%d,\"varid\":%d,\"name\":",vs->ncid,vs->varid);
+        jsonstring(f,vs->name);
+        fputc(',',f);
+        jsonstats(f,&vs->stats);
+        fputs("}\n",f);
+    }
+    if(f == stderr) fflush(f); else fclose(f);
+}
+
+#endif /*ENABLE_IOSTATS*/
+
+/**************************************************/
+/* Public API */
+
+/**
+ * Get the accumulated I/O statistics for an open file or for one of
+ * its variables.
+ *
+ * Counters that do not apply to the format of the file (for example
+ * the chunk cache counters for a classic file) are left at zero.
+ *
+ * @param ncid NetCDF or group ID.
+ * @param varid Variable ID, or ::NC_GLOBAL for the whole file.
+ * @param statsp Pointer that gets the statistics.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EBADID Bad ncid.
+ * @return ::NC_EINVAL statsp is NULL.
+ * @return ::NC_ENOTBUILT Library was built without I/O statistics.
+ */
+int
+nc_inq_io_stats(int ncid, int varid, nc_io_stats_t* statsp)
+{
+#ifdef ENABLE_IOSTATS
+    NC* ncp = NULL;
+    nc_io_stats_t* s = NULL;
+    int stat = NC_check_id(ncid,&ncp);
+    if(stat != NC_NOERR) return stat;
+    if(statsp == NULL) return NC_EINVAL;
+    if(varid == NC_GLOBAL)
+        s = NC_iostats_file(ncp);
+    else
+        s = NC_iostats_var(ncp,ncid,varid);
+    if(s == NULL)
+        memset(statsp,0,sizeof(nc_io_stats_t));
+    else
+        *statsp = *s;
+    return NC_NOERR;
+#else
+    NC_UNUSED(ncid); NC_UNUSED(varid); NC_UNUSED(statsp);
+    return NC_ENOTBUILT;
+#endif
+}
+
+/**
+ * Reset all the I/O statistics of an open file to zero.
+ *
+ * @param ncid NetCDF or group ID.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EBADID Bad ncid.
+ * @return ::NC_ENOTBUILT Library was built without I/O statistics.
+ */
+int
+nc_reset_io_stats(int ncid)
+{
+#ifdef ENABLE_IOSTATS
+    size_t i;
+    NC* ncp = NULL;
+    NCiostats* iostats = NULL;
+    int stat = NC_check_id(ncid,&ncp);
+    if(stat != NC_NOERR) return stat;
+    if((iostats = (NCiostats*)ncp->iostats) == NULL) return NC_NOERR;
+    memset(&iostats->stats,0,sizeof(nc_io_stats_t));
+    for(i=0;i<nclistlength(iostats->vars);i++) {
+        NCvariostats* vs = (NCvariostats*)nclistget(iostats->vars,i);
+        memset(&vs->stats,0,sizeof(nc_io_stats_t));
+    }
+    return NC_NOERR;
+#else
+    NC_UNUSED(ncid);
+    return NC_ENOTBUILT;
+#endif
+}
@@ -0,0 +1,389 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+/**
+ * @file
+ *
+ * Read-ahead of sequential nc_get_vara() calls at the dispatch level.
+ *
+ * Reading a variable one row, one record or one element per call
+ * costs a complete trip through the format specific code for every
+ * call. When read-ahead is enabled for a variable and a request
+ * continues the previous request along exactly one dimension (same
+ * counts, start advanced by the count), a window holding several
+ * such requests is read with a single dispatch call and the requests
+ * that fall inside it are copied from memory.
+ *
+ * Only variables of the fixed size atomic types are handled; any
+ * other request, and any request that fails while filling a window,
+ * simply goes to the dispatcher as usual.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include "ncdispatch.h"
+#include "nclist.h"
+#include "ncreadahead.h"
+
+/* Read-ahead state of one variable */
+typedef struct NCRAvar {
+    int ncid;           /* group id */
+    int varid;
+    size_t size;        /* window size limit in bytes; 0 => disabled */
+    int explicit;       /* size was set for this variable, not the file */
+    int ndims;
+    int* dimids;
+    nc_type xtype;
+    int havelast;       /* last start/count are valid */
+    size_t* laststart;  /* previous request */
+    size_t* lastcount;
+    nc_type memtype;    /* type of the window data; NC_NAT => no window */
+    size_t* wstart;     /* the window */
+    size_t* wcount;
+    size_t alloc;       /* allocated size of buf */
+    unsigned char* buf;
+} NCRAvar;
+
+typedef struct NCreadahead {
+    size_t defaultsize; /* set with varid == NC_GLOBAL */
+    NClist* vars;       /* NClist<NCRAvar*> */
+} NCreadahead;
+
+/* Forward */
+static int ravar(NCreadahead* ra, int ncid, int varid, int create, NCRAvar** vp);
+static void ravarfree(NCRAvar* v);
+static int rainside(const NCRAvar* v, const size_t* start, const size_t* count);
+static int rasequential(const NCRAvar* v, const size_t* start, const size_t* count);
+static void racopy(const NCRAvar* v, const size_t* start, const size_t* count,
+                   size_t elemsize, void* value);
+
+/**
+ * @internal Serve an nc_get_vara() request from the read-ahead window
+ * of the variable, filling a new window first if the request continues
+ * a sequence.
+ *
+ * @param ncp NC instance
+ * @param ncid File or group id.
+ * @param varid Variable id.
+ * @param start Start vector.
+ * @param count Count vector.
+ * @param value Where the data go.
+ * @param memtype Memory type; NC_NAT means the type of the variable.
+ * @param donep Set to 1 if the request was served, else 0.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOMEM Out of memory.
+ */
+int
+NC_readahead_get(NC* ncp, int ncid, int varid, const size_t* start,
+                 const size_t* count, void* value, nc_type memtype, int* donep)
+{
+    int stat = NC_NOERR;
+    NCreadahead* ra = (NCreadahead*)ncp->readahead;
+    NCRAvar* v = NULL;
+    size_t elemsize, nelems, wbytes, len;
+    int d, adv;
+
+    *donep = 0;
+    if(ra == NULL) goto done;
+    if((stat = ravar(ra,ncid,varid,(ra->defaultsize > 0),&v))) goto done;
+    if(v == NULL || v->size == 0 || v->ndims == 0) goto done;
+    if(memtype == NC_NAT) memtype = v->xtype;
+    if(memtype <= NC_NAT || memtype >= NC_STRING) goto done;
+    elemsize = NC_atomictypelen(memtype);
+
+    /* Inside the current window? */
+    if(v->memtype == memtype && rainside(v,start,count)) {
+	racopy(v,start,count,elemsize,value);
+	goto served;
+    }
+
+    adv = rasequential(v,start,count);
+    memcpy(v->laststart,start,sizeof(size_t)*(size_t)v->ndims);
+    memcpy(v->lastcount,count,sizeof(size_t)*(size_t)v->ndims);
+    v->havelast = 1;
+    if(adv < 0) goto done;
+
+    /* Extend the request along adv by as many requests as fit */
+    for(nelems=1,d=0;d<v->ndims;d++) nelems *= count[d];
+    if(nelems == 0 || nelems * elemsize > v->size / 2) goto done;
+    if((stat = nc_inq_dimlen(ncid,v->dimids[adv],&len))) {stat = NC_NOERR; goto done;}
+    memcpy(v->wstart,start,sizeof(size_t)*(size_t)v->ndims);
+    memcpy(v->wcount,count,sizeof(size_t)*(size_t)v->ndims);
+    v->wcount[adv] = count[adv] * (v->size / (nelems * elemsize));
+    if(start[adv] >= len) goto done;
+    if(v->wcount[adv] > len - start[adv]) v->wcount[adv] = len - start[adv];
+    if(v->wcount[adv] <= count[adv]) goto done;
+    wbytes = (nelems / count[adv]) * v->wcount[adv] * elemsize;
+    if(wbytes > v->alloc) {
+	unsigned char* newbuf = (unsigned char*)realloc(v->buf,wbytes);
+	if(newbuf == NULL) {stat = NC_ENOMEM; goto done;}
+	v->buf = newbuf;
+	v->alloc = wbytes;
+    }
+    v->memtype = NC_NAT;
+    if(ncp->dispatch->get_vara(ncid,varid,v->wstart,v->wcount,v->buf,memtype) != NC_NOERR)
+	goto done; /* let the dispatcher report the error for the request itself */
+    v->memtype = memtype;
+    racopy(v,start,count,elemsize,value);
+
+served:
+    memcpy(v->laststart,start,sizeof(size_t)*(size_t)v->ndims);
+    memcpy(v->lastcount,count,sizeof(size_t)*(size_t)v->ndims);
+    v->havelast = 1;
+    *donep = 1;
+done:
+    return stat;
+}
+
+/**
+ * @internal Discard the read-ahead windows of all variables of a file,
+ * e.g. because the file was written.
+ *
+ * @param ncp NC instance
+ */
+void
+NC_readahead_invalidate(NC* ncp)
+{
+    size_t i;
+    NCreadahead* ra = (NCreadahead*)ncp->readahead;
+    if(ra == NULL) return;
+    for(i=0;i<nclistlength(ra->vars);i++) {
+	NCRAvar* v = (NCRAvar*)nclistget(ra->vars,i);
+	v->memtype = NC_NAT;
+    }
+}
+
+/**
+ * @internal Reclaim the read-ahead state of a file.
+ *
+ * @param ncp NC instance
+ */
+void
+NC_readahead_free(NC* ncp)
+{
+    size_t i;
+    NCreadahead* ra = (NCreadahead*)ncp->readahead;
+    if(ra == NULL) return;
+    for(i=0;i<nclistlength(ra->vars);i++)
+	ravarfree((NCRAvar*)nclistget(ra->vars,i));
+    nclistfree(ra->vars);
+    free(ra);
+    ncp->readahead = NULL;
+}
+
+/** \ingroup variables
+Set the read-ahead buffer size of a variable.
+
+When read-ahead is enabled and a call to nc_get_vara() or one of
+its typed variants (including nc_get_var1()) continues the previous
+call on the same variable along exactly one dimension (same count,
+start advanced by the count), a hyperslab holding as many such
+requests as fit in the buffer is read at once. The following
+requests are then copied from memory instead of going through the
+format specific code and the storage layer. This is intended for
+clients reading a variable one row, one record or one value per
+call.
+
+Only variables of the atomic types other than ::NC_STRING are
+handled. Buffered data are discarded when the variable or any other
+variable of the file is written through this ncid, and by nc_redef()
+and nc_sync(); read-ahead should not be used on files that are
+being modified by another process.
+
+The setting only lasts until the file is closed.
+
+@param ncid NetCDF or group ID, from a previous call to nc_open(),
+nc_create(), nc_def_grp(), or associated inquiry functions such as
+nc_inq_ncid().
+@param varid Variable ID, or ::NC_GLOBAL to set the default for all
+variables of the file that do not have their own setting.
+@param size Maximum size of the read-ahead buffer in bytes; 0
+disables read-ahead.
+
+@return ::NC_NOERR No error.
+@return ::NC_EBADID Bad ncid.
+@return ::NC_ENOTVAR Invalid variable ID.
+@return ::NC_ENOMEM Out of memory.
+*/
+int
+nc_set_var_readahead(int ncid, int varid, size_t size)
+{
+    int stat = NC_NOERR;
+    NC* ncp = NULL;
+    NCreadahead* ra = NULL;
+    NCRAvar* v = NULL;
+    size_t i;
+
+    if((stat = NC_check_id(ncid,&ncp))) goto done;
+    if(varid != NC_GLOBAL && (stat = nc_inq_varndims(ncid,varid,NULL))) goto done;
+    if((ra = (NCreadahead*)ncp->readahead) == NULL) {
+	if(size == 0) goto done;
+	if((ra = (NCreadahead*)calloc(1,sizeof(NCreadahead))) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	if((ra->vars = nclistnew()) == NULL)
+	    {free(ra); stat = NC_ENOMEM; goto done;}
+	ncp->readahead = ra;
+    }
+    if(varid == NC_GLOBAL) {
+	ra->defaultsize = size;
+	for(i=0;i<nclistlength(ra->vars);i++) {
+	    v = (NCRAvar*)nclistget(ra->vars,i);
+	    if(!v->explicit && v->xtype > NC_NAT && v->xtype < NC_STRING) {
+		v->size = size;
+		v->memtype = NC_NAT;
+	    }
+	}
+    } else {
+	if((stat = ravar(ra,ncid,varid,1,&v))) goto done;
+	v->explicit = 1;
+	if(v->xtype > NC_NAT && v->xtype < NC_STRING) v->size = size;
+	v->memtype = NC_NAT;
+    }
+done:
+    return stat;
+}
+
+/** \ingroup variables
+Get the read-ahead buffer size of a variable, as set with
+nc_set_var_readahead().
+
+@param ncid NetCDF or group ID.
+@param varid Variable ID, or ::NC_GLOBAL for the default of the file.
+@param sizep Pointer that gets the size in bytes; 0 if read-ahead is
+disabled or the variable is not of a supported type. Ignored if NULL.
+
+@return ::NC_NOERR No error.
+@return ::NC_EBADID Bad ncid.
+@return ::NC_ENOTVAR Invalid variable ID.
+*/
+int
+nc_get_var_readahead(int ncid, int varid, size_t* sizep)
+{
+    int stat = NC_NOERR;
+    NC* ncp = NULL;
+    NCreadahead* ra = NULL;
+    NCRAvar* v = NULL;
+    size_t size = 0;
+
+    if((stat = NC_check_id(ncid,&ncp))) goto done;
+    if(varid != NC_GLOBAL && (stat = nc_inq_varndims(ncid,varid,NULL))) goto done;
+    if((ra = (NCreadahead*)ncp->readahead) != NULL) {
+	if(varid == NC_GLOBAL)
+	    size = ra->defaultsize;
+	else if((stat = ravar(ra,ncid,varid,(ra->defaultsize > 0),&v)) == NC_NOERR && v != NULL)
+	    size = v->size;
+    }
+    if(sizep) *sizep = size;
+done:
+    return stat;
+}
+
+/**************************************************/
+/* Utilities */
+
+/* Find the state of a variable, creating it if requested */
+static int
+ravar(NCreadahead* ra, int ncid, int varid, int create, NCRAvar** vp)
+{
+    int stat = NC_NOERR;
+    NCRAvar* v = NULL;
+    size_t i;
+
+    for(i=0;i<nclistlength(ra->vars);i++) {
+	v = (NCRAvar*)nclistget(ra->vars,i);
+	if(v->ncid == ncid && v->varid == varid) goto done;
+    }
+    v = NULL;
+    if(!create) goto done;
+    if((v = (NCRAvar*)calloc(1,sizeof(NCRAvar))) == NULL) {stat = NC_ENOMEM; goto done;}
+    v->ncid = ncid;
+    v->varid = varid;
+    v->memtype = NC_NAT;
+    if((stat = nc_inq_var(ncid,varid,NULL,&v->xtype,&v->ndims,NULL,NULL))) goto done;
+    if(v->ndims > 0) {
+	if((v->dimids = (int*)malloc(sizeof(int)*(size_t)v->ndims)) == NULL
+	   || (v->laststart = (size_t*)malloc(4*sizeof(size_t)*(size_t)v->ndims)) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	v->lastcount = v->laststart + v->ndims;
+	v->wstart = v->lastcount + v->ndims;
+	v->wcount = v->wstart + v->ndims;
+	if((stat = nc_inq_vardimid(ncid,varid,v->dimids))) goto done;
+    }
+    if(v->xtype > NC_NAT && v->xtype < NC_STRING) v->size = ra->defaultsize;
+    nclistpush(ra->vars,v);
+done:
+    if(stat && v != NULL) {ravarfree(v); v = NULL;}
+    if(vp) *vp = v;
+    return stat;
+}
+
+static void
+ravarfree(NCRAvar* v)
+{
+    if(v == NULL) return;
+    nullfree(v->dimids);
+    nullfree(v->laststart);
+    nullfree(v->buf);
+    free(v);
+}
+
+/* Is the request entirely inside the window? */
+static int
+rainside(const NCRAvar* v, const size_t* start, const size_t* count)
+{
+    int d;
+    for(d=0;d<v->ndims;d++) {
+	if(start[d] < v->wstart[d]
+	   || start[d] + count[d] > v->wstart[d] + v->wcount[d])
+	    return 0;
+    }
+    return 1;
+}
+
+/* If the request continues the previous one along a single dimension,
+   return that dimension, else -1 */
+static int
+rasequential(const NCRAvar* v, const size_t* start, const size_t* count)
+{
+    int d, adv = -1;
+    if(!v->havelast) return -1;
+    for(d=0;d<v->ndims;d++) {
+	if(count[d] != v->lastcount[d]) return -1;
+	if(start[d] != v->laststart[d]) {
+	    if(adv >= 0 || start[d] != v->laststart[d] + v->lastcount[d]) return -1;
+	    adv = d;
+	}
+    }
+    return adv;
+}
+
+/* Copy a request out of the window, one innermost row at a time */
+static void
+racopy(const NCRAvar* v, const size_t* start, const size_t* count,
+       size_t elemsize, void* value)
+{
+    size_t index[NC_MAX_VAR_DIMS];
+    size_t run, offset;
+    unsigned char* dst = (unsigned char*)value;
+    int d, nd = v->ndims;
+
+    for(d=0;d<nd;d++) {
+	if(count[d] == 0) return;
+	index[d] = 0;
+    }
+    run = count[nd-1] * elemsize;
+    for(;;) {
+	for(offset=0,d=0;d<nd;d++)
+	    offset = offset * v->wcount[d] + (start[d] - v->wstart[d] + index[d]);
+	memcpy(dst,v->buf + offset * elemsize,run);
+	dst += run;
+	for(d=nd-2;d>=0;d--) {
+	    if(++index[d] < count[d]) break;
+	    index[d] = 0;
+	}
+	if(d < 0) break;
+    }
+}
@@ -735,6 +735,80 @@ nc_def_var_chunking(int ncid, int varid, int storage, const size_t *chunksizesp)
                                            chunksizesp);
 }
 
+/**
+   Describe how a variable will mostly be read.
+
+   The hint replaces the library's generic choice of chunk shape and
+   chunk cache size for the variable with one that suits the given
+   access pattern. The first dimension of the variable is taken to be
+   the time (or record) dimension.
+
+   - ::NC_ACCESS_TIMESERIES: reads of the whole time dimension at one
+     point of the other dimensions. Chunks are long in time and small
+     in the other dimensions.
+   - ::NC_ACCESS_SPATIAL: reads of whole slices at one time. Chunks
+     hold whole slices and few times.
+   - ::NC_ACCESS_SHAPE: reads of the shape given by shapep; a zero
+     length stands for the whole dimension. Chunks take that shape.
+   - ::NC_ACCESS_BALANCED: no dominant pattern; the library default.
+
+   Chunks are grown to about 1 MiB along the dimensions the reads do
+   not span, and are shrunk along the others to at most the default
+   chunk size. An unlimited dimension is taken to grow to at least
+   1024 records.
+
+   As long as nc_enddef() has not been called for the variable, and
+   the storage and chunksizes have not been chosen with
+   nc_def_var_chunking(), the variable is chunked for the hinted
+   reads. The per-variable chunk cache is enlarged to hold the chunks
+   touched by one hinted read (up to the maximum default cache size)
+   if it still has its default size, so the hint also helps reads of
+   existing files. The hint itself is not stored in the file.
+
+   @param ncid NetCDF ID, from a previous call to nc_open() or
+   nc_create().
+   @param varid Variable ID.
+   @param hint The access hint.
+   @param shapep For ::NC_ACCESS_SHAPE, an array with the expected
+   length of the reads along each dimension. Ignored for the other
+   hints.
+
+   @return ::NC_NOERR No error.
+   @return ::NC_EBADID Bad ID.
+   @return ::NC_ENOTNC4 Not a netCDF-4 or NCZarr file.
+   @return ::NC_ENOTVAR Invalid variable ID.
+   @return ::NC_EINVAL Invalid hint, or no shape for ::NC_ACCESS_SHAPE.
+
+   @section nc_def_var_access_hint_example Example
+
+   @code
+   int ncid, dimids[3], varid;
+
+   if (nc_create(FILE_NAME, NC_NETCDF4, &ncid)) ERR;
+   if (nc_def_dim(ncid, "time", NC_UNLIMITED, &dimids[0])) ERR;
+   if (nc_def_dim(ncid, "lat", 180, &dimids[1])) ERR;
+   if (nc_def_dim(ncid, "lon", 360, &dimids[2])) ERR;
+   if (nc_def_var(ncid, "tas", NC_FLOAT, 3, dimids, &varid)) ERR;
+   if (nc_def_var_access_hint(ncid, varid, NC_ACCESS_TIMESERIES, NULL)) ERR;
+   @endcode
+*/
+int
+nc_def_var_access_hint(int ncid, int varid, int hint, const size_t *shapep)
+{
+    NC* ncp;
+    int stat = NC_check_id(ncid, &ncp);
+    if(stat != NC_NOERR) return stat;
+#ifdef USE_HDF5
+    if(ncp->dispatch == HDF5_dispatch_table)
+        return NC4_HDF5_def_var_access_hint(ncid, varid, hint, shapep);
+#endif
+#ifdef ENABLE_NCZARR
+    if(ncp->dispatch == NCZ_dispatch_table)
+        return NCZ_def_var_access_hint(ncid, varid, hint, shapep);
+#endif
+    return NC_ENOTNC4;
+}
+
 /**
    Define endianness of a variable.
 
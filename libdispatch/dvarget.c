@@ -7,6 +7,9 @@ Research/Unidata. See \ref copyright file for more info.
 */
 
 #include "ncdispatch.h"
+#include "nciostats.h"
+#include "ncreadahead.h"
+#include "nc3dispatch.h"
 
 /*!
   \internal
@@ -101,7 +104,15 @@ NC_get_vara(int ncid, int varid,
       stat = NC_check_nulls(ncid, varid, start, &my_count, NULL);
       if(stat != NC_NOERR) return stat;
    }
-   stat =  ncp->dispatch->get_vara(ncid,varid,start,my_count,value,memtype);
+   {
+      int done = 0;
+      NCIOSTAT_ENTER(ncp);
+      if(ncp->readahead != NULL)
+         stat = NC_readahead_get(ncp,ncid,varid,start,my_count,value,memtype,&done);
+      if(!done)
+         stat =  ncp->dispatch->get_vara(ncid,varid,start,my_count,value,memtype);
+      NCIOSTAT_LEAVE(ncp,ncid,varid,memtype,my_count,0);
+   }
    if(edges == NULL) free(my_count);
    return stat;
 }
@@ -588,8 +599,12 @@ NC_get_vars(int ncid, int varid, const size_t *start,
       if(stat != NC_NOERR) return stat;
    }
 
-   stat = ncp->dispatch->get_vars(ncid,varid,start,my_count,my_stride,
+   {
+      NCIOSTAT_ENTER(ncp);
+      stat = ncp->dispatch->get_vars(ncid,varid,start,my_count,my_stride,
                                   value,memtype);
+      NCIOSTAT_LEAVE(ncp,ncid,varid,memtype,my_count,0);
+   }
    if(edges == NULL) free(my_count);
    if(stride == NULL) free(my_stride);
    return stat;
@@ -650,8 +665,12 @@ NC_get_varm(int ncid, int varid, const size_t *start,
       if(stat != NC_NOERR) return stat;
    }
 
-   stat = ncp->dispatch->get_varm(ncid, varid, start, my_count, my_stride,
+   {
+      NCIOSTAT_ENTER(ncp);
+      stat = ncp->dispatch->get_varm(ncid, varid, start, my_count, my_stride,
                                   map, value, memtype);
+      NCIOSTAT_LEAVE(ncp,ncid,varid,memtype,my_count,0);
+   }
    if(edges == NULL) free(my_count);
    if(stride == NULL) free(my_stride);
    return stat;
@@ -1496,3 +1515,372 @@ nc_get_varm_string(int ncid, int varid, const size_t *startp,
 
 
 /*! \} */ /* End of named group... */
+
+/**
+\ingroup variables
+Get a read-only view of a hyperslab of a variable.
+
+For classic, 64-bit offset and CDF-5 files opened read-only with
+::NC_MMAP, the view points directly into the file mapping whenever no
+conversion is needed: byte, ubyte and char variables, or any variable
+on a big-endian host. Otherwise, the data is read into a buffer managed
+by the library, in the external type of the variable.
+
+The element at index (i0,i1,...) of the hyperslab is found at
+(const char*)view->data + i0*view->strides[0] + i1*view->strides[1] + ...
+
+A zero-copy view is only valid until the file is closed. Each view
+must be released with nc_free_vara_view().
+
+\param ncid NetCDF or group ID.
+\param varid Variable ID.
+\param startp Start vector with one element for each dimension.
+\param countp Count vector with one element for each dimension.
+\param view Pointer to the view to fill in.
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EINVAL Invalid view pointer.
+\returns ::NC_EBADTYPE Variable is not of a fixed-size atomic type.
+\returns ::NC_ENOTVAR Variable not found.
+\returns ::NC_EINVALCOORDS Index exceeds dimension bound.
+\returns ::NC_EEDGE Start+count exceeds dimension bound.
+\returns ::NC_EINDEFINE Operation not allowed in define mode.
+\returns ::NC_EBADID Bad ncid.
+\author Dennis Heimbigner
+*/
+int
+nc_get_vara_view(int ncid, int varid, const size_t *startp,
+                 const size_t *countp, nc_vara_view_t *view)
+{
+   NC* ncp;
+   int i, ndims;
+   nc_type xtype;
+   size_t size, nelems;
+   size_t *my_count = (size_t *)countp;
+   int stat = NC_check_id(ncid, &ncp);
+   if(stat != NC_NOERR) return stat;
+   if(view == NULL) return NC_EINVAL;
+   memset(view,0,sizeof(nc_vara_view_t));
+
+   if((stat = nc_inq_var(ncid,varid,NULL,&xtype,&ndims,NULL,NULL))) return stat;
+   if(xtype <= NC_NAT || xtype > NC_MAX_ATOMIC_TYPE || xtype == NC_STRING)
+      return NC_EBADTYPE;
+   if((stat = nc_inq_type(ncid,xtype,NULL,&size))) return stat;
+
+   if(startp == NULL || countp == NULL) {
+      stat = NC_check_nulls(ncid, varid, startp, &my_count, NULL);
+      if(stat != NC_NOERR) return stat;
+   }
+
+   view->xtype = xtype;
+   view->size = size;
+   view->ndims = ndims;
+   if(ndims > 0) {
+      if((view->count = (size_t*)calloc((size_t)ndims,sizeof(size_t))) == NULL
+         || (view->strides = (ptrdiff_t*)calloc((size_t)ndims,sizeof(ptrdiff_t))) == NULL)
+         {stat = NC_ENOMEM; goto done;}
+      memcpy(view->count,my_count,sizeof(size_t)*(size_t)ndims);
+   }
+
+   /* Try to avoid the copy */
+   if(ncp->dispatch == NC3_dispatch_table) {
+      stat = NC3_get_vara_view(ncid,varid,startp,view->count,view);
+      if(stat != NC_NOERR || view->zerocopy) goto done;
+   }
+
+   /* Fall back to reading into a library-managed buffer */
+   nelems = 1;
+   for(i=ndims-1;i>=0;i--) {
+      view->strides[i] = (ptrdiff_t)(nelems * size);
+      nelems *= view->count[i];
+   }
+   if(nelems > 0) {
+      if((view->buffer = malloc(nelems * size)) == NULL)
+         {stat = NC_ENOMEM; goto done;}
+      if((stat = NC_get_vara(ncid,varid,startp,view->count,view->buffer,xtype))) goto done;
+      view->data = view->buffer;
+   }
+
+done:
+   if(countp == NULL) free(my_count);
+   if(stat != NC_NOERR) (void)nc_free_vara_view(view);
+   return stat;
+}
+
+/**
+\ingroup variables
+Release the memory held by a view obtained from nc_get_vara_view().
+
+\param view Pointer to the view; it is reset to empty.
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EINVAL Invalid view pointer.
+\author Dennis Heimbigner
+*/
+int
+nc_free_vara_view(nc_vara_view_t *view)
+{
+   if(view == NULL) return NC_EINVAL;
+   nullfree(view->buffer);
+   nullfree(view->count);
+   nullfree(view->strides);
+   memset(view,0,sizeof(nc_vara_view_t));
+   return NC_NOERR;
+}
+
+/**
+ * @internal One point of a nc_get_var_points() request.
+ */
+typedef struct NCpoint {
+    const size_t* coord; /* ndims indices into the variable */
+    size_t index;        /* position of the point in the request */
+    int ndims;
+} NCpoint;
+
+/* Order points by their indices (row-major), then by request position */
+static int
+NC_pointcompare(const void* a, const void* b)
+{
+    const NCpoint* pa = (const NCpoint*)a;
+    const NCpoint* pb = (const NCpoint*)b;
+    int i;
+    for(i=0;i<pa->ndims;i++) {
+        if(pa->coord[i] < pb->coord[i]) return -1;
+        if(pa->coord[i] > pb->coord[i]) return 1;
+    }
+    return (pa->index < pb->index ? -1 : (pa->index > pb->index ? 1 : 0));
+}
+
+/* Is q the element immediately following p along the last dimension? */
+static int
+NC_pointadjacent(const NCpoint* p, const NCpoint* q)
+{
+    int i, last = p->ndims - 1;
+    if(p->ndims == 0) return 0;
+    for(i=0;i<last;i++)
+        if(p->coord[i] != q->coord[i]) return 0;
+    return (q->coord[last] == p->coord[last] + 1);
+}
+
+/**
+ * @internal Default implementation of nc_get_var_points() for
+ * dispatchers without a specialized one. The points are sorted so
+ * that runs of consecutive elements along the last dimension can be
+ * read with a single get_vara call each.
+ *
+ * @param ncp Pointer to the file.
+ * @param ncid NetCDF or group ID.
+ * @param varid Variable ID.
+ * @param ndims Rank of the variable.
+ * @param size Size of one element of the variable's type.
+ * @param npoints Number of points.
+ * @param coords npoints*ndims indices.
+ * @param values Where the npoints values are stored.
+ *
+ * @return ::NC_NOERR No error.
+ */
+static int
+NC_get_var_points_default(NC* ncp, int ncid, int varid, int ndims, size_t size,
+                          size_t npoints, const size_t* coords, void* values)
+{
+   int stat = NC_NOERR;
+   size_t i, j, k, run, maxrun = 0;
+   size_t origin[1] = {0};
+   size_t count[NC_MAX_VAR_DIMS];
+   NCpoint* points = NULL;
+   char* buf = NULL;
+   char* dst = (char*)values;
+
+   if((points = (NCpoint*)malloc(sizeof(NCpoint)*npoints)) == NULL)
+      {stat = NC_ENOMEM; goto done;}
+   for(i=0;i<npoints;i++) {
+      points[i].coord = (ndims == 0 ? origin : coords + (i * (size_t)ndims));
+      points[i].index = i;
+      points[i].ndims = ndims;
+   }
+   qsort(points,npoints,sizeof(NCpoint),NC_pointcompare);
+
+   for(k=0;k<(size_t)ndims;k++) count[k] = 1;
+   for(i=0;i<npoints;i=j) {
+      int lstat;
+      for(j=i+1;j<npoints && NC_pointadjacent(&points[j-1],&points[j]);j++);
+      run = j - i;
+      if(run == 1) {
+         lstat = ncp->dispatch->get_vara(ncid,varid,points[i].coord,count,
+                                         dst + (points[i].index * size),NC_NAT);
+      } else {
+         if(run > maxrun) {
+            char* newbuf = (char*)realloc(buf,run * size);
+            if(newbuf == NULL) {stat = NC_ENOMEM; goto done;}
+            buf = newbuf;
+            maxrun = run;
+         }
+         count[ndims-1] = run;
+         lstat = ncp->dispatch->get_vara(ncid,varid,points[i].coord,count,buf,NC_NAT);
+         count[ndims-1] = 1;
+         if(lstat == NC_NOERR || lstat == NC_ERANGE) {
+            for(k=0;k<run;k++)
+               memcpy(dst + (points[i+k].index * size),buf + (k * size),size);
+         } else {
+            /* Read the run point by point to report the same error
+               as nc_get_var1() would */
+            for(lstat=NC_NOERR,k=0;k<run;k++) {
+               int pstat = ncp->dispatch->get_vara(ncid,varid,points[i+k].coord,count,
+                                                   dst + (points[i+k].index * size),NC_NAT);
+               if(pstat != NC_NOERR) lstat = pstat;
+               if(pstat != NC_NOERR && pstat != NC_ERANGE) break;
+            }
+         }
+      }
+      if(lstat != NC_NOERR) {
+         if(lstat != NC_ERANGE) {stat = lstat; goto done;}
+         if(stat == NC_NOERR) stat = lstat;
+      }
+   }
+
+done:
+   nullfree(points);
+   nullfree(buf);
+   return stat;
+}
+
+/**
+\ingroup variables
+Read a set of scattered elements of a variable.
+
+Point i is at the indices coords[i*ndims .. i*ndims+ndims-1], where
+ndims is the rank of the variable, and its value is stored in
+values[i] in the type of the variable, as with nc_get_var1().
+
+This is equivalent to calling nc_get_var1() once for each point, but
+the points are visited in storage order so that each chunk or file
+block is read only once. For classic files the points are sorted by
+file offset; for netCDF-4/HDF5 files a single HDF5 point selection is
+read; for NCZarr files the points are grouped by chunk. Other formats
+coalesce runs of adjacent points into single reads.
+
+\param ncid NetCDF or group ID.
+\param varid Variable ID.
+\param npoints Number of points.
+\param coords Indices of the points, npoints*ndims values; may be NULL
+for a scalar variable.
+\param values Pointer to an array of npoints elements into which the
+data is read. For string variables, the strings must be released with
+nc_free_string().
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EINVAL Invalid coords or values pointer.
+\returns ::NC_ENOTVAR Variable not found.
+\returns ::NC_EINVALCOORDS Index exceeds dimension bound.
+\returns ::NC_EEDGE Index exceeds the current number of records.
+\returns ::NC_EINDEFINE Operation not allowed in define mode.
+\returns ::NC_EBADID Bad ncid.
+\author Dennis Heimbigner
+*/
+int
+nc_get_var_points(int ncid, int varid, size_t npoints, const size_t *coords,
+                  void *values)
+{
+   NC* ncp;
+   int i, ndims, handled = 0;
+   nc_type xtype;
+   size_t size;
+   size_t pcount[NC_MAX_VAR_DIMS];
+   int stat = NC_check_id(ncid, &ncp);
+   if(stat != NC_NOERR) return stat;
+
+   if((stat = nc_inq_var(ncid,varid,NULL,&xtype,&ndims,NULL,NULL))) return stat;
+   if(npoints == 0) return NC_NOERR;
+   if(values == NULL || (ndims > 0 && coords == NULL)) return NC_EINVAL;
+   if((stat = nc_inq_type(ncid,xtype,NULL,&size))) return stat;
+
+   /* For the statistics: the points count as a 1-d read */
+   NC_UNUSED(pcount);
+   for(i=0;i<ndims;i++) pcount[i] = 1;
+   pcount[0] = npoints;
+   {
+      NCIOSTAT_ENTER(ncp);
+      if(ncp->dispatch == NC3_dispatch_table) {
+         stat = NC3_get_var_points(ncid,varid,npoints,coords,values);
+         handled = 1;
+      }
+#ifdef USE_HDF5
+      else if(ncp->dispatch == HDF5_dispatch_table)
+         stat = NC4_HDF5_get_var_points(ncid,varid,npoints,coords,values,&handled);
+#endif
+#ifdef ENABLE_NCZARR
+      else if(ncp->dispatch == NCZ_dispatch_table)
+         stat = NCZ_get_var_points(ncid,varid,npoints,coords,values,&handled);
+#endif
+      if(stat == NC_NOERR && !handled)
+         stat = NC_get_var_points_default(ncp,ncid,varid,ndims,size,npoints,coords,values);
+      NCIOSTAT_LEAVE(ncp,ncid,varid,NC_NAT,pcount,0);
+   }
+   return stat;
+}
+
+/**
+\ingroup variables
+Read a range of records of several record variables at once.
+
+For each i, data[i] receives records startrec .. startrec+nrecs-1 of
+variable varids[i], in the type of the variable, as with nc_get_vara()
+of the whole records. Variables whose data pointer is NULL are
+skipped.
+
+For classic, 64-bit offset and CDF-5 files, where the records of all
+record variables are interleaved, the records are read with one
+sequential pass over the file and then split among the variables.
+For other formats the variables are read one after the other; the
+first dimension of each variable must be unlimited.
+
+\param ncid NetCDF or group ID.
+\param startrec Index of the first record.
+\param nrecs Number of records.
+\param nvars Number of variables.
+\param varids IDs of the variables.
+\param data Array of nvars pointers to memory for the data of each
+variable.
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EINVAL A variable is not a record variable.
+\returns ::NC_ENOTVAR Variable not found.
+\returns ::NC_EINVALCOORDS Index exceeds dimension bound.
+\returns ::NC_EEDGE Start+count exceeds the number of records.
+\returns ::NC_EINDEFINE Operation not allowed in define mode.
+\returns ::NC_EBADID Bad ncid.
+\author Dennis Heimbigner
+*/
+int
+nc_get_recs(int ncid, size_t startrec, size_t nrecs, int nvars,
+            const int *varids, void **data)
+{
+   NC* ncp;
+   int i, d, ndims;
+   size_t start[NC_MAX_VAR_DIMS];
+   size_t count[NC_MAX_VAR_DIMS];
+   int dimids[NC_MAX_VAR_DIMS];
+   int isrecdim[NC_MAX_VAR_DIMS];
+   int stat = NC_check_id(ncid, &ncp);
+   if(stat != NC_NOERR) return stat;
+   if(nvars < 0 || (nvars > 0 && (varids == NULL || data == NULL))) return NC_EINVAL;
+
+   if(ncp->dispatch == NC3_dispatch_table)
+      return NC3_get_recs(ncid,startrec,nrecs,nvars,varids,data);
+
+   for(i=0;i<nvars;i++) {
+      if(data[i] == NULL) continue;
+      if((stat = nc_inq_var(ncid,varids[i],NULL,NULL,&ndims,dimids,NULL))) return stat;
+      if(ndims == 0) return NC_EINVAL;
+      if((stat = NC_inq_recvar(ncid,varids[i],NULL,isrecdim))) return stat;
+      if(!isrecdim[0]) return NC_EINVAL;
+      for(d=0;d<ndims;d++) {
+         start[d] = 0;
+         if((stat = nc_inq_dimlen(ncid,dimids[d],&count[d]))) return stat;
+      }
+      start[0] = startrec;
+      count[0] = nrecs;
+      if((stat = NC_get_vara(ncid,varids[i],start,count,data[i],NC_NAT))) return stat;
+   }
+   return NC_NOERR;
+}
@@ -475,6 +475,42 @@ nc_inq_var_chunking(int ncid, int varid, int *storagep, size_t *chunksizesp)
                                      NULL, NULL, NULL);
 }
 
+/**
+ * @ingroup variables
+ *
+ * Get the access hint of a variable. See nc_def_var_access_hint().
+ *
+ * @param ncid NetCDF or group ID, from a previous call to nc_open(),
+ * nc_create(), nc_def_grp(), or associated inquiry functions such as
+ * nc_inq_ncid().
+ * @param varid Variable ID
+ * @param hintp Address of the returned hint; ::NC_ACCESS_BALANCED if
+ * none was given. \ref ignored_if_null.
+ * @param shapep The shape of the hinted reads, one length per
+ * dimension, will be copied here. \ref ignored_if_null.
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EBADID Bad ncid.
+ * @return ::NC_ENOTNC4 Not a netCDF-4 or NCZarr file.
+ * @return ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+nc_inq_var_access_hint(int ncid, int varid, int *hintp, size_t *shapep)
+{
+   NC *ncp;
+   int stat = NC_check_id(ncid, &ncp);
+   if(stat != NC_NOERR) return stat;
+#ifdef USE_HDF5
+   if(ncp->dispatch == HDF5_dispatch_table)
+      return NC4_inq_var_access_hint(ncid, varid, hintp, shapep);
+#endif
+#ifdef ENABLE_NCZARR
+   if(ncp->dispatch == NCZ_dispatch_table)
+      return NC4_inq_var_access_hint(ncid, varid, hintp, shapep);
+#endif
+   return NC_ENOTNC4;
+}
+
 /** \ingroup variables
 Learn the fill mode of a variable.
 
@@ -6,6 +6,9 @@ Research/Unidata. See COPYRIGHT file for more info.
 */
 
 #include "ncdispatch.h"
+#include "nciostats.h"
+#include "ncreadahead.h"
+#include "nc3dispatch.h"
 
 struct PUTodometer {
     int            rank;
@@ -94,7 +97,12 @@ NC_put_vara(int ncid, int varid, const size_t *start,
       stat = NC_check_nulls(ncid, varid, start, &my_count, NULL);
       if(stat != NC_NOERR) return stat;
    }
-   stat = ncp->dispatch->put_vara(ncid, varid, start, my_count, value, memtype);
+   NC_READAHEAD_INVALIDATE(ncp);
+   {
+      NCIOSTAT_ENTER(ncp);
+      stat = ncp->dispatch->put_vara(ncid, varid, start, my_count, value, memtype);
+      NCIOSTAT_LEAVE(ncp,ncid,varid,memtype,my_count,1);
+   }
    if(edges == NULL) free(my_count);
    return stat;
 }
@@ -545,8 +553,13 @@ NC_put_vars(int ncid, int varid, const size_t *start,
       if(stat != NC_NOERR) return stat;
    }
 
-   stat = ncp->dispatch->put_vars(ncid, varid, start, my_count, my_stride,
+   NC_READAHEAD_INVALIDATE(ncp);
+   {
+      NCIOSTAT_ENTER(ncp);
+      stat = ncp->dispatch->put_vars(ncid, varid, start, my_count, my_stride,
                                   value, memtype);
+      NCIOSTAT_LEAVE(ncp,ncid,varid,memtype,my_count,1);
+   }
    if(edges == NULL) free(my_count);
    if(stride == NULL) free(my_stride);
    return stat;
@@ -574,8 +587,13 @@ NC_put_varm(int ncid, int varid, const size_t *start,
       if(stat != NC_NOERR) return stat;
    }
 
-   stat = ncp->dispatch->put_varm(ncid, varid, start, my_count, my_stride,
+   NC_READAHEAD_INVALIDATE(ncp);
+   {
+      NCIOSTAT_ENTER(ncp);
+      stat = ncp->dispatch->put_varm(ncid, varid, start, my_count, my_stride,
                                   map, value, memtype);
+      NCIOSTAT_LEAVE(ncp,ncid,varid,memtype,my_count,1);
+   }
    if(edges == NULL) free(my_count);
    if(stride == NULL) free(my_stride);
    return stat;
@@ -1381,3 +1399,70 @@ nc_put_varm_string(int ncid, int varid,
 /**\} */
 
 /*! \} */ /*End of named group... */
+
+/**
+\ingroup variables
+Write a range of records of several record variables at once.
+
+For each i, data[i] holds records startrec .. startrec+nrecs-1 of
+variable varids[i], in the type of the variable, as with nc_put_vara()
+of the whole records. Variables whose data pointer is NULL are
+skipped.
+
+For classic, 64-bit offset and CDF-5 files, where the records of all
+record variables are interleaved, the records are assembled in memory
+and written with one sequential pass over the file. For other formats
+the variables are written one after the other; the first dimension of
+each variable must be unlimited.
+
+\param ncid NetCDF or group ID.
+\param startrec Index of the first record.
+\param nrecs Number of records.
+\param nvars Number of variables.
+\param varids IDs of the variables.
+\param data Array of nvars pointers to the data of each variable.
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EINVAL A variable is not a record variable.
+\returns ::NC_ENOTVAR Variable not found.
+\returns ::NC_EINVALCOORDS Index exceeds dimension bound.
+\returns ::NC_EPERM Attempt to write to a read-only file.
+\returns ::NC_EINDEFINE Operation not allowed in define mode.
+\returns ::NC_EBADID Bad ncid.
+\author Dennis Heimbigner
+*/
+int
+nc_put_recs(int ncid, size_t startrec, size_t nrecs, int nvars,
+            const int *varids, const void *const *data)
+{
+   NC* ncp;
+   int i, d, ndims;
+   size_t start[NC_MAX_VAR_DIMS];
+   size_t count[NC_MAX_VAR_DIMS];
+   int dimids[NC_MAX_VAR_DIMS];
+   int isrecdim[NC_MAX_VAR_DIMS];
+   int stat = NC_check_id(ncid, &ncp);
+   if(stat != NC_NOERR) return stat;
+   if(nvars < 0 || (nvars > 0 && (varids == NULL || data == NULL))) return NC_EINVAL;
+
+   if(ncp->dispatch == NC3_dispatch_table) {
+      NC_READAHEAD_INVALIDATE(ncp);
+      return NC3_put_recs(ncid,startrec,nrecs,nvars,varids,data);
+   }
+
+   for(i=0;i<nvars;i++) {
+      if(data[i] == NULL) continue;
+      if((stat = nc_inq_var(ncid,varids[i],NULL,NULL,&ndims,dimids,NULL))) return stat;
+      if(ndims == 0) return NC_EINVAL;
+      if((stat = NC_inq_recvar(ncid,varids[i],NULL,isrecdim))) return stat;
+      if(!isrecdim[0]) return NC_EINVAL;
+      for(d=0;d<ndims;d++) {
+         start[d] = 0;
+         if((stat = nc_inq_dimlen(ncid,dimids[d],&count[d]))) return stat;
+      }
+      start[0] = startrec;
+      count[0] = nrecs;
+      if((stat = NC_put_vara(ncid,varids[i],start,count,data[i],NC_NAT))) return stat;
+   }
+   return NC_NOERR;
+}
@@ -20,6 +20,8 @@
 #include <unistd.h>
 #endif
 #include "ncdispatch.h"
+#include "nciostats.h"
+#include "ncreadahead.h"
 
 #ifndef nulldup
  #define nulldup(x) ((x)?strdup(x):(x))
@@ -61,6 +63,10 @@ free_NC(NC *ncp)
 {
     if(ncp == NULL)
         return;
+#ifdef ENABLE_IOSTATS
+    NC_iostats_free(ncp);
+#endif
+    NC_readahead_free(ncp);
     if(ncp->path)
         free(ncp->path);
     /* We assume caller has already cleaned up ncp->dispatchdata */
@@ -94,6 +100,12 @@ new_NC(const NC_Dispatch* dispatcher, const char* path, int mode, NC** ncpp)
         free_NC(ncp);
         return NC_ENOMEM;
     }
+#ifdef ENABLE_IOSTATS
+    if(NC_iostats_new(ncp)) {
+        free_NC(ncp);
+        return NC_ENOMEM;
+    }
+#endif
     if(ncpp) {
         *ncpp = ncp;
     } else {
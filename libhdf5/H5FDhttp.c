@@ -70,12 +70,21 @@ Define a simple #ifdef test for the version of H5FD_class_t we are using
 #include "netcdf.h"
 #include "ncbytes.h"
 #include "nclist.h"
+#include "nchashmap.h"
+#include "ncuri.h"
+#include "ncrc.h"
+#include "nclog.h"
 #include "nchttp.h"
 
 #include "H5FDhttp.h"
 
 typedef off_t file_offset_t;
 
+/* Page cache defaults; see pagecache_config() for the .rc keys */
+#define H5FD_HTTP_PAGESIZE  65536
+#define H5FD_HTTP_CACHESIZE (16*1024*1024)
+#define H5FD_HTTP_READAHEAD 4
+
 /* The driver identification number, initialized at runtime */
 static hid_t H5FD_HTTP_g = 0;
 
@@ -87,6 +96,14 @@ typedef enum {
     H5FD_HTTP_OP_SEEK=3
 } H5FD_http_file_op;
 
+/* A cached page of the remote object */
+typedef struct H5FD_http_page {
+    struct H5FD_http_page* prev; /* LRU list; the head is the most recently used */
+    struct H5FD_http_page* next;
+    haddr_t index;               /* page number */
+    unsigned char* data;         /* pagesize bytes; less for the last page */
+} H5FD_http_page;
+
 /* The description of a file belonging to this driver. The 'eoa' and 'eof'
  * determine the amount of hdf5 address space in use and the high-water mark
  * of the file (the current size of the underlying Unix file). The 'pos'
@@ -107,6 +124,16 @@ typedef struct H5FD_http_t {
     H5FD_http_file_op op;	/* last operation */
     NC_HTTP_STATE*  state;       /* Curl handle + extra */
     char*           url;        /* The URL (minus any fragment) for the dataset */ 
+    struct {                    /* Cache of fixed size pages of the object */
+        size_t pagesize;
+        size_t maxpages;        /* 0 => no caching */
+        size_t readahead;       /* pages added to a sequential read */
+        size_t npages;
+        NC_hashmap* map;        /* page number -> H5FD_http_page* */
+        H5FD_http_page* head;
+        H5FD_http_page* tail;
+        haddr_t lastpage;       /* last page of the previous read */
+    } cache;
 } H5FD_http_t;
 
 
@@ -131,6 +158,13 @@ typedef struct H5FD_http_t {
 #define REGION_OVERFLOW(A,Z)  (ADDR_OVERFLOW(A) || SIZE_OVERFLOW(Z) || \
     HADDR_UNDEF==(A)+(Z) || (file_offset_t)((A)+(Z))<(file_offset_t)(A))
 
+/* Page cache */
+static void pagecache_config(H5FD_http_t* file, size_t* prefetchp);
+static const char* pagecache_rclookup(NCURI* uri, const char* key);
+static void pagecache_free(H5FD_http_t* file);
+static int pagecache_fill(H5FD_http_t* file, haddr_t first, haddr_t last);
+static H5FD_http_page* pagecache_get(H5FD_http_t* file, haddr_t index);
+
 /* Prototypes */
 static H5FD_t *H5FD_http_open(const char *name, unsigned flags,
                  hid_t fapl_id, haddr_t maxaddr);
@@ -373,6 +407,21 @@ H5FD_http_open( const char *name, unsigned flags, hid_t /*UNUSED*/ fapl_id,
     }
     memcpy(file->url,name,strlen(name)+1);
 
+    /* Set up the page cache and prefetch the front of the object,
+       where the superblock and most metadata usually are */
+    {
+	size_t prefetch = 0;
+	pagecache_config(file,&prefetch);
+	if(file->cache.maxpages > 0 && prefetch > 0 && file->eof > 0) {
+	    haddr_t last = (haddr_t)((prefetch - 1) / file->cache.pagesize);
+	    haddr_t eofpage = (file->eof - 1) / file->cache.pagesize;
+	    if(last > eofpage) last = eofpage;
+	    if(last >= (haddr_t)file->cache.maxpages) last = (haddr_t)file->cache.maxpages - 1;
+	    if(pagecache_fill(file,0,last))
+	        nclog(NCLOGWARN,"H5FDhttp: prefetch failed: %s",file->url);
+	}
+    }
+
     return((H5FD_t*)file);
 } /* end H5FD_HTTP_OPen() */
 
@@ -405,6 +454,7 @@ H5FD_http_close(H5FD_t *_file)
     /* Close the underlying curl handle*/
     if(file->state) nc_http_close(file->state);
     if(file->url) H5free_memory(file->url);
+    pagecache_free(file);
 
     H5free_memory(file);
 
@@ -727,7 +777,44 @@ H5FD_http_read(H5FD_t *_file, H5FD_mem_t /*UNUSED*/ type, hid_t /*UNUSED*/ dxpl_
         size -= nbytes;
     }
 
-    {
+    if(file->cache.maxpages > 0
+       && (addr + size - 1) / file->cache.pagesize - addr / file->cache.pagesize
+          < file->cache.maxpages / 2) {
+	/* Read through the page cache */
+	size_t ps = file->cache.pagesize;
+	haddr_t first = addr / ps;
+	haddr_t last = (addr + size - 1) / ps;
+	haddr_t fill = last;
+	haddr_t p;
+	size_t done = 0;
+
+	/* Extend a sequential read by the read-ahead, staying within
+	   the file and within half the cache */
+	if(file->cache.lastpage != HADDR_UNDEF
+	   && (first == file->cache.lastpage || first == file->cache.lastpage + 1)) {
+	    haddr_t eofpage = (file->eof - 1) / ps;
+	    fill = last + file->cache.readahead;
+	    if(fill > eofpage) fill = eofpage;
+	    if(fill - first >= file->cache.maxpages / 2) fill = first + file->cache.maxpages / 2 - 1;
+	    if(fill < last) fill = last;
+	}
+	if(pagecache_fill(file,first,fill)) {
+            file->op = H5FD_HTTP_OP_UNKNOWN;
+            file->pos = HADDR_UNDEF;
+            H5Epush_ret(func, H5E_ERR_CLS, H5E_IO, H5E_READERROR, "HTTP byte-range read failed", -1);
+	}
+	for(p=first;p<=last;p++) {
+	    H5FD_http_page* page = pagecache_get(file,p);
+	    size_t offset = (p == first ? (size_t)(addr - first * ps) : 0);
+	    size_t n = ps - offset;
+	    if(n > size - done) n = size - done;
+	    if(page == NULL)
+                H5Epush_ret(func, H5E_ERR_CLS, H5E_IO, H5E_READERROR, "HTTP page cache inconsistency", -1);
+	    memcpy((unsigned char*)buf + done,page->data + offset,n);
+	    done += n;
+	}
+	file->cache.lastpage = last;
+    } else {
 	NCbytes* bbuf = ncbytesnew();
         if((ncstat = nc_http_read(file->state,file->url,addr,size,bbuf))) {
             file->op = H5FD_HTTP_OP_UNKNOWN;
@@ -906,3 +993,182 @@ H5FD_http_unlock(H5FD_t *_file)
  */
 #error "Do not use HDF5 private definitions"
 #endif
+
+/**************************************************/
+/* Page cache */
+
+/* Read the cache parameters from the .rc file:
+   HTTP.PAGECACHE.SIZE      total bytes of cached pages; 0 disables the cache
+   HTTP.PAGECACHE.PAGESIZE  bytes per page
+   HTTP.PAGECACHE.READAHEAD pages added to reads that continue the previous one
+   HTTP.PAGECACHE.PREFETCH  bytes read from the front of the object at open
+*/
+static void
+pagecache_config(H5FD_http_t* file, size_t* prefetchp)
+{
+    NCURI* uri = NULL;
+    const char* value;
+    size_t cachesize = H5FD_HTTP_CACHESIZE;
+
+    file->cache.pagesize = H5FD_HTTP_PAGESIZE;
+    file->cache.readahead = H5FD_HTTP_READAHEAD;
+    file->cache.lastpage = HADDR_UNDEF;
+    *prefetchp = 0;
+    if(ncuriparse(file->url,&uri) != NC_NOERR) uri = NULL;
+    if((value = pagecache_rclookup(uri,"HTTP.PAGECACHE.SIZE")) != NULL)
+	cachesize = (size_t)strtoull(value,NULL,10);
+    if((value = pagecache_rclookup(uri,"HTTP.PAGECACHE.PAGESIZE")) != NULL && strtoull(value,NULL,10) > 0)
+	file->cache.pagesize = (size_t)strtoull(value,NULL,10);
+    if((value = pagecache_rclookup(uri,"HTTP.PAGECACHE.READAHEAD")) != NULL)
+	file->cache.readahead = (size_t)strtoull(value,NULL,10);
+    if((value = pagecache_rclookup(uri,"HTTP.PAGECACHE.PREFETCH")) != NULL)
+	*prefetchp = (size_t)strtoull(value,NULL,10);
+    ncurifree(uri);
+    file->cache.maxpages = cachesize / file->cache.pagesize;
+    /* A cache of one page cannot hold a read that straddles pages */
+    if(file->cache.maxpages < 4) file->cache.maxpages = 0;
+    if(file->cache.maxpages > 0)
+	file->cache.map = NC_hashmapnew(file->cache.maxpages);
+    if(file->cache.map == NULL) file->cache.maxpages = 0;
+}
+
+/* Look up key for the host of uri, then as a global key */
+static const char*
+pagecache_rclookup(NCURI* uri, const char* key)
+{
+    const char* value = NULL;
+    if(uri != NULL) value = NC_rclookupx(uri,key);
+    if(value == NULL) value = NC_rclookup(key,NULL,NULL);
+    return value;
+}
+
+static void
+pagecache_free(H5FD_http_t* file)
+{
+    H5FD_http_page* page;
+    H5FD_http_page* next;
+    for(page=file->cache.head;page != NULL;page=next) {
+	next = page->next;
+	free(page->data);
+	free(page);
+    }
+    file->cache.head = file->cache.tail = NULL;
+    file->cache.npages = 0;
+    if(file->cache.map) NC_hashmapfree(file->cache.map);
+    file->cache.map = NULL;
+}
+
+static void
+pagecache_unlink(H5FD_http_t* file, H5FD_http_page* page)
+{
+    if(page->prev) page->prev->next = page->next; else file->cache.head = page->next;
+    if(page->next) page->next->prev = page->prev; else file->cache.tail = page->prev;
+    page->prev = page->next = NULL;
+}
+
+static void
+pagecache_push(H5FD_http_t* file, H5FD_http_page* page)
+{
+    page->prev = NULL;
+    page->next = file->cache.head;
+    if(file->cache.head) file->cache.head->prev = page; else file->cache.tail = page;
+    file->cache.head = page;
+}
+
+/* Return a cached page and mark it most recently used */
+static H5FD_http_page*
+pagecache_get(H5FD_http_t* file, haddr_t index)
+{
+    uintptr_t data = 0;
+    H5FD_http_page* page;
+    if(!NC_hashmapget(file->cache.map,(const char*)&index,sizeof(index),&data))
+	return NULL;
+    page = (H5FD_http_page*)data;
+    if(page != file->cache.head) {
+	pagecache_unlink(file,page);
+	pagecache_push(file,page);
+    }
+    return page;
+}
+
+/* Add a page, evicting the least recently used one if the cache is full */
+static int
+pagecache_add(H5FD_http_t* file, haddr_t index, const unsigned char* data, size_t len)
+{
+    H5FD_http_page* page;
+    if(file->cache.npages >= file->cache.maxpages) {
+	page = file->cache.tail;
+	pagecache_unlink(file,page);
+	NC_hashmapremove(file->cache.map,(const char*)&page->index,sizeof(page->index),NULL);
+	file->cache.npages--;
+    } else {
+	if((page = (H5FD_http_page*)calloc(1,sizeof(H5FD_http_page))) == NULL)
+	    return NC_ENOMEM;
+	if((page->data = (unsigned char*)malloc(file->cache.pagesize)) == NULL)
+	    {free(page); return NC_ENOMEM;}
+    }
+    page->index = index;
+    memcpy(page->data,data,len);
+    NC_hashmapadd(file->cache.map,(uintptr_t)page,(const char*)&page->index,sizeof(page->index));
+    pagecache_push(file,page);
+    file->cache.npages++;
+    return NC_NOERR;
+}
+
+/* Make sure pages first..last are cached. Cached pages in the range
+   are touched first so that adding the missing ones cannot evict
+   them; each run of missing pages is read with one range request
+   and the runs are read concurrently. */
+static int
+pagecache_fill(H5FD_http_t* file, haddr_t first, haddr_t last)
+{
+    int ncstat = NC_NOERR;
+    size_t ps = file->cache.pagesize;
+    NClist* runs = nclistnew(); /* pairs of first, last page */
+    NC_HTTP_RANGE* ranges = NULL;
+    size_t i, nruns;
+    haddr_t p;
+
+    for(p=first;p<=last;p++) {
+	if(pagecache_get(file,p) != NULL) continue;
+	if(nclistlength(runs) > 0 && (haddr_t)(uintptr_t)nclistget(runs,nclistlength(runs)-1) == p - 1)
+	    nclistset(runs,nclistlength(runs)-1,(void*)(uintptr_t)p);
+	else {
+	    nclistpush(runs,(void*)(uintptr_t)p);
+	    nclistpush(runs,(void*)(uintptr_t)p);
+	}
+    }
+    nruns = nclistlength(runs) / 2;
+    if(nruns == 0) goto done;
+    if((ranges = (NC_HTTP_RANGE*)calloc(nruns,sizeof(NC_HTTP_RANGE))) == NULL)
+	{ncstat = NC_ENOMEM; goto done;}
+    for(i=0;i<nruns;i++) {
+	haddr_t a = (haddr_t)(uintptr_t)nclistget(runs,2*i);
+	haddr_t b = (haddr_t)(uintptr_t)nclistget(runs,2*i+1);
+	haddr_t end = (b + 1) * ps;
+	if(end > file->eof) end = file->eof;
+	ranges[i].url = file->url;
+	ranges[i].start = a * ps;
+	ranges[i].count = end - a * ps;
+	ranges[i].buf = ncbytesnew();
+    }
+    if((ncstat = nc_http_read_ranges(file->state,nruns,ranges))) goto done;
+    for(i=0;i<nruns;i++) {
+	const unsigned char* data = (const unsigned char*)ncbytescontents(ranges[i].buf);
+	size_t len = ncbyteslength(ranges[i].buf);
+	if(len != ranges[i].count) {ncstat = NC_EIO; goto done;}
+	for(p=ranges[i].start/ps;len > 0;p++) {
+	    size_t n = (len < ps ? len : ps);
+	    if((ncstat = pagecache_add(file,p,data,n))) goto done;
+	    data += n;
+	    len -= n;
+	}
+    }
+done:
+    if(ranges != NULL) {
+	for(i=0;i<nruns;i++) ncbytesfree(ranges[i].buf);
+	free(ranges);
+    }
+    nclistfree(runs);
+    return ncstat;
+}
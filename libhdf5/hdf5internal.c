@@ -606,6 +606,8 @@ close_vars(NC_GRP_INFO_T *grp)
         if (hdf5_var->hdf_datasetid)
         {
             LOG((3, "closing HDF5 dataset %lld", hdf5_var->hdf_datasetid));
+            if (nc4_hdf5_clear_plan(hdf5_var))
+                return NC_EHDFERR;
             if (H5Dclose(hdf5_var->hdf_datasetid) < 0)
                 return NC_EHDFERR;
 
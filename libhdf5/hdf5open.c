@@ -497,6 +497,174 @@ exit:
     return retval;
 }
 
+/** Size of the key of a dimension scale in the dimscale map. */
+#define DIMSCALE_KEYSIZE (sizeof(HDF5_OBJID_T))
+
+/**
+ * @internal Make the dimscale map key of an HDF5 object id. Fields
+ * are copied one by one so that padding does not enter the key.
+ *
+ * @param objid The HDF5 object id.
+ * @param key Buffer of DIMSCALE_KEYSIZE bytes for the key.
+ */
+static void
+dimscale_key(const HDF5_OBJID_T *objid, char *key)
+{
+    memset(key, 0, DIMSCALE_KEYSIZE);
+#if H5_VERSION_GE(1,12,0)
+    memcpy(key, &objid->fileno, sizeof(objid->fileno));
+    memcpy(key + sizeof(objid->fileno), &objid->token, sizeof(objid->token));
+#else
+    memcpy(key, objid->fileno, sizeof(objid->fileno));
+    memcpy(key + sizeof(objid->fileno), objid->objno, sizeof(objid->objno));
+#endif
+}
+
+/**
+ * @internal Add the dimensions of a group and its subgroups to the
+ * dimscale map, keyed by the HDF5 object id of their dimension
+ * scale. An object that is the scale of more than one dimension
+ * (through hard links) is entered with no dimension, so that lookups
+ * of it fall back to searching the groups in scope.
+ *
+ * @param grp Pointer to group info struct.
+ * @param dimmap The dimscale map.
+ *
+ * @returns NC_NOERR No error.
+ * @returns NC_ENOMEM Out of memory.
+ */
+static int
+rec_build_dimscale_map(NC_GRP_INFO_T *grp, NC_hashmap *dimmap)
+{
+    char key[DIMSCALE_KEYSIZE];
+    int retval;
+    int i;
+
+    for (i = 0; i < ncindexsize(grp->dim); i++)
+    {
+        NC_DIM_INFO_T *dim = (NC_DIM_INFO_T *)ncindexith(grp->dim, i);
+        NC_HDF5_DIM_INFO_T *hdf5_dim;
+
+        assert(dim && dim->format_dim_info);
+        hdf5_dim = (NC_HDF5_DIM_INFO_T *)dim->format_dim_info;
+        dimscale_key(&hdf5_dim->hdf5_objid, key);
+        if (NC_hashmapget(dimmap, key, DIMSCALE_KEYSIZE, NULL))
+            NC_hashmapsetdata(dimmap, key, DIMSCALE_KEYSIZE, (uintptr_t)0);
+        else if (!NC_hashmapadd(dimmap, (uintptr_t)dim, key, DIMSCALE_KEYSIZE))
+            return NC_ENOMEM;
+    }
+    for (i = 0; i < ncindexsize(grp->children); i++)
+        if ((retval = rec_build_dimscale_map((NC_GRP_INFO_T *)ncindexith(grp->children, i),
+                                             dimmap)))
+            return retval;
+    return NC_NOERR;
+}
+
+/**
+ * @internal Compare the HDF5 object id of a dimension scale attached
+ * to a variable with that of a dimension.
+ *
+ * @param hdf5_var The HDF5-specific var info.
+ * @param objid The object id of the attached scale.
+ * @param dim The dimension.
+ * @param matchp Set to 1 if the objects are the same, 0 otherwise.
+ *
+ * @returns NC_NOERR No error.
+ * @returns NC_EHDFERR HDF5 returned an error.
+ */
+static int
+dimscale_matches(NC_HDF5_VAR_INFO_T *hdf5_var, const HDF5_OBJID_T *objid,
+                 NC_DIM_INFO_T *dim, int *matchp)
+{
+    NC_HDF5_DIM_INFO_T *hdf5_dim;
+
+    assert(dim && dim->format_dim_info);
+    hdf5_dim = (NC_HDF5_DIM_INFO_T *)dim->format_dim_info;
+
+    /* Check for exact match of fileno/objid arrays
+     * to find identical objects in HDF5 file. */
+#if H5_VERSION_GE(1,12,0)
+    {
+        int token_cmp;
+        if (H5Otoken_cmp(hdf5_var->hdf_datasetid, &objid->token,
+                         &hdf5_dim->hdf5_objid.token, &token_cmp) < 0)
+            return NC_EHDFERR;
+        *matchp = (objid->fileno == hdf5_dim->hdf5_objid.fileno && token_cmp == 0);
+    }
+#else
+    *matchp = (objid->fileno[0] == hdf5_dim->hdf5_objid.fileno[0] &&
+               objid->objno[0] == hdf5_dim->hdf5_objid.objno[0] &&
+               objid->fileno[1] == hdf5_dim->hdf5_objid.fileno[1] &&
+               objid->objno[1] == hdf5_dim->hdf5_objid.objno[1]);
+#endif
+    return NC_NOERR;
+}
+
+/**
+ * @internal Find the dimension whose dimension scale is attached to
+ * a dimension of a variable. The dimscale map gives the dimension
+ * directly; it must belong to the variable's group or one of its
+ * ancestors. Only scales shared by several dimensions need a search
+ * of this and parent groups, nearest group first.
+ *
+ * @param grp Group of the variable.
+ * @param hdf5_var The HDF5-specific var info.
+ * @param objid The object id of the attached scale.
+ * @param dimmap The dimscale map.
+ * @param dimp Set to the dimension, or NULL if there is none.
+ *
+ * @returns NC_NOERR No error.
+ * @returns NC_EHDFERR HDF5 returned an error.
+ */
+static int
+find_dimscale_dim(NC_GRP_INFO_T *grp, NC_HDF5_VAR_INFO_T *hdf5_var,
+                  const HDF5_OBJID_T *objid, NC_hashmap *dimmap,
+                  NC_DIM_INFO_T **dimp)
+{
+    char key[DIMSCALE_KEYSIZE];
+    uintptr_t data = 0;
+    NC_GRP_INFO_T *g;
+    int match = 0;
+    int retval;
+    int j;
+
+    *dimp = NULL;
+    dimscale_key(objid, key);
+    if (!NC_hashmapget(dimmap, key, DIMSCALE_KEYSIZE, &data))
+        return NC_NOERR;
+    if (data)
+    {
+        NC_DIM_INFO_T *dim = (NC_DIM_INFO_T *)data;
+        for (g = grp; g; g = g->parent)
+            if (g == dim->container)
+                break;
+        if (g == NULL)
+            return NC_NOERR; /* Not in scope. */
+        if ((retval = dimscale_matches(hdf5_var, objid, dim, &match)))
+            return retval;
+        if (match)
+            *dimp = dim;
+        return NC_NOERR;
+    }
+
+    /* Shared scale: check this and parent groups. */
+    for (g = grp; g; g = g->parent)
+    {
+        for (j = 0; j < ncindexsize(g->dim); j++)
+        {
+            NC_DIM_INFO_T *dim = (NC_DIM_INFO_T *)ncindexith(g->dim, j);
+            if ((retval = dimscale_matches(hdf5_var, objid, dim, &match)))
+                return retval;
+            if (match)
+            {
+                *dimp = dim;
+                return NC_NOERR;
+            }
+        }
+    }
+    return NC_NOERR;
+}
+
 /**
  * @internal Iterate through the vars in this file and make sure we've
  * got a dimid and a pointer to a dim for each dimension. This may
@@ -505,7 +673,11 @@ exit:
  * desirable because recurdively matching the dimscales (when
  * necessary) is very much the slowest part of opening a file.
  *
+ * Attached scales are resolved through the dimscale map built by
+ * rec_build_dimscale_map().
+ *
  * @param grp Pointer to group info struct.
+ * @param dimmap The dimscale map.
  *
  * @returns NC_NOERR No error.
  * @returns NC_EHDFERR HDF5 returned an error.
@@ -513,7 +685,7 @@ exit:
  * @author Ed Hartnett
  */
 static int
-rec_match_dimscales(NC_GRP_INFO_T *grp)
+rec_match_dimscales(NC_GRP_INFO_T *grp, NC_hashmap *dimmap)
 {
     NC_VAR_INFO_T *var;
     NC_DIM_INFO_T *dim;
@@ -525,7 +697,8 @@ rec_match_dimscales(NC_GRP_INFO_T *grp)
 
     /* Perform var dimscale match for child groups. */
     for (i = 0; i < ncindexsize(grp->children); i++)
-        if ((retval = rec_match_dimscales((NC_GRP_INFO_T *)ncindexith(grp->children, i))))
+        if ((retval = rec_match_dimscales((NC_GRP_INFO_T *)ncindexith(grp->children, i),
+                                          dimmap)))
             return retval;
 
     /* Check all the vars in this group. If they have dimscale info,
@@ -561,15 +734,12 @@ rec_match_dimscales(NC_GRP_INFO_T *grp)
         if (!hdf5_var->dimscale)
         {
             int d;
-            int j;
 
             /* Are there dimscales for this variable? */
             if (hdf5_var->dimscale_hdf5_objids)
             {
                 for (d = 0; d < var->ndims; d++)
                 {
-                    NC_GRP_INFO_T *g;
-                    nc_bool_t finished = NC_FALSE;
                     LOG((5, "%s: var %s has dimscale info...", __func__, var->hdr.name));
 
                     /* If we already have the dimension, we don't need to
@@ -578,45 +748,18 @@ rec_match_dimscales(NC_GRP_INFO_T *grp)
                     if (var->dim[d])
                         continue;
 
-                    /* Now we have to try to match dimscales. Check this
-                     * and parent groups. */
-                    for (g = grp; g && !finished; g = g->parent)
+                    /* Now we have to try to match dimscales. */
+                    if ((retval = find_dimscale_dim(grp, hdf5_var,
+                                                    &hdf5_var->dimscale_hdf5_objids[d],
+                                                    dimmap, &dim)))
+                        return retval;
+                    if (dim)
                     {
-                        /* Check all dims in this group. */
-                        for (j = 0; j < ncindexsize(g->dim); j++)
-                        {
-                            /* Get the HDF5 specific dim info. */
-                            NC_HDF5_DIM_INFO_T *hdf5_dim;
-                            dim = (NC_DIM_INFO_T *)ncindexith(g->dim, j);
-                            assert(dim && dim->format_dim_info);
-                            hdf5_dim = (NC_HDF5_DIM_INFO_T *)dim->format_dim_info;
-
-                            /* Check for exact match of fileno/objid arrays
-                             * to find identical objects in HDF5 file. */
-#if H5_VERSION_GE(1,12,0)
-                            int token_cmp;
-                            if (H5Otoken_cmp(hdf5_var->hdf_datasetid,
-                                             &hdf5_var->dimscale_hdf5_objids[d].token,
-                                             &hdf5_dim->hdf5_objid.token, &token_cmp) < 0)
-                                return NC_EHDFERR;
-                            if (hdf5_var->dimscale_hdf5_objids[d].fileno == hdf5_dim->hdf5_objid.fileno &&
-                                token_cmp == 0)
-#else
-                            if (hdf5_var->dimscale_hdf5_objids[d].fileno[0] == hdf5_dim->hdf5_objid.fileno[0] &&
-                                hdf5_var->dimscale_hdf5_objids[d].objno[0] == hdf5_dim->hdf5_objid.objno[0] &&
-                                hdf5_var->dimscale_hdf5_objids[d].fileno[1] == hdf5_dim->hdf5_objid.fileno[1] &&
-                                hdf5_var->dimscale_hdf5_objids[d].objno[1] == hdf5_dim->hdf5_objid.objno[1])
-#endif
-                            {
-                                LOG((4, "%s: for dimension %d, found dim %s", __func__,
-                                     d, dim->hdr.name));
-                                var->dimids[d] = dim->hdr.id;
-                                var->dim[d] = dim;
-                                finished = NC_TRUE;
-                                break;
-                            }
-                        } /* next dim */
-                    } /* next grp */
+                        LOG((4, "%s: for dimension %d, found dim %s", __func__,
+                             d, dim->hdr.name));
+                        var->dimids[d] = dim->hdr.id;
+                        var->dim[d] = dim;
+                    }
                 } /* next var->dim */
             }
             else
@@ -692,6 +835,7 @@ nc4_open_file(const char *path, int mode, void* parameters, int ncid)
     hid_t fapl_id = H5P_DEFAULT;
     unsigned flags;
     int is_classic;
+    NC_hashmap *dimmap = NULL;
 #ifdef USE_PARALLEL4
     NC_MPI_INFO *mpiinfo = NULL;
     int comm_duped = 0; /* Whether the MPI Communicator was duplicated */
@@ -841,6 +985,9 @@ nc4_open_file(const char *path, int mode, void* parameters, int ncid)
         memio = (NC_memio*)parameters;
         if(memio->memory == NULL || memio->size == 0)
             BAIL(NC_EINMEMORY);
+        /* Copy-on-write images are only supported for netcdf-3 */
+        if((memio->flags & NC_MEMIO_COW) == NC_MEMIO_COW)
+            BAIL(NC_EINMEMORY);
         /* initialize h5->mem */
         nc4_info->mem.memio = *memio;
         /* Is the incoming memory locked? */
@@ -961,8 +1108,14 @@ nc4_open_file(const char *path, int mode, void* parameters, int ncid)
 
     /* Now figure out which netCDF dims are indicated by the dimscale
      * information. */
-    if ((retval = rec_match_dimscales(nc4_info->root_grp)))
+    if (!(dimmap = NC_hashmapnew(0)))
+        BAIL(NC_ENOMEM);
+    if ((retval = rec_build_dimscale_map(nc4_info->root_grp, dimmap)))
+        BAIL(retval);
+    if ((retval = rec_match_dimscales(nc4_info->root_grp, dimmap)))
         BAIL(retval);
+    NC_hashmapfree(dimmap);
+    dimmap = NULL;
 
 #ifdef LOGGING
     /* This will print out the names, types, lens, etc of the vars and
@@ -982,6 +1135,8 @@ exit:
     if (info_duped) MPI_Info_free(&nc4_info->info);
 #endif
 
+    if (dimmap)
+        NC_hashmapfree(dimmap);
     if (fapl_id > 0 && fapl_id != H5P_DEFAULT)
         H5Pclose(fapl_id);
     if (nc4_info)
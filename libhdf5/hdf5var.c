@@ -12,6 +12,7 @@
 #include "nc4internal.h"
 #include "hdf5internal.h"
 #include "hdf5err.h" /* For BAIL2 */
+#include "ncarena.h"
 #include <math.h> /* For pow() used below. */
 
 #include "netcdf.h"
@@ -89,6 +90,8 @@ nc4_reopen_dataset(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var)
                                var->chunkcache.size,
                                var->chunkcache.preemption) < 0)
             return NC_EHDFERR;
+        if (nc4_hdf5_clear_plan(hdf5_var))
+            return NC_EHDFERR;
         if (H5Dclose(hdf5_var->hdf_datasetid) < 0)
             return NC_EHDFERR;
         if ((hdf5_var->hdf_datasetid = H5Dopen2(grpid, var->hdr.name, access_pid)) < 0)
@@ -622,6 +625,10 @@ nc_def_var_extra(int ncid, int varid, int *shuffle, int *unused1,
 
             var->storage = NC_COMPACT;
         }
+
+        /* An access hint no longer picks the layout. */
+        if (*storage != NC_CHUNKED || chunksizes)
+            var->chunking_set = NC_TRUE;
     }
 
     /* Is this a variable with a chunksize greater than the current
@@ -1036,6 +1043,52 @@ NC4_def_var_chunking(int ncid, int varid, int storage, const size_t *chunksizesp
                             &storage, chunksizesp, NULL, NULL, NULL, NULL, NULL);
 }
 
+/**
+ * @internal Set the access hint of a var. This is called by
+ * nc_def_var_access_hint(). Until the dataset is created, a var whose
+ * layout was not chosen with nc_def_var_chunking() is chunked for the
+ * hinted reads. The chunk cache is sized for the hinted reads if it
+ * still has its default size.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param hint The access hint.
+ * @param shape For ::NC_ACCESS_SHAPE, the expected read shape.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ * @returns ::NC_EINVAL Invalid hint or shape.
+ * @returns ::NC_EHDFERR HDF5 error.
+ */
+int
+NC4_HDF5_def_var_access_hint(int ncid, int varid, int hint, const size_t *shape)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    int retval;
+
+    /* Find info for this file, group, and var. */
+    if ((retval = nc4_hdf5_find_grp_h5_var(ncid, varid, &h5, &grp, &var)))
+        return retval;
+
+    if ((retval = nc4_set_access_hint(var, hint, shape)))
+        return retval;
+
+    /* Choose new default chunksizes, if it is not too late. */
+    if (!var->created && !var->chunking_set && var->ndims > 0)
+    {
+        if (hint != NC_ACCESS_BALANCED)
+            var->storage = NC_CHUNKED;
+        memset(var->chunksizes, 0, var->ndims * sizeof(size_t));
+        if ((retval = nc4_find_default_chunksizes2(grp, var)))
+            return retval;
+    }
+
+    return nc4_adjust_var_cache(grp, var);
+}
+
 /**
  * @internal Define chunking stuff for a var. This is called by
  * the fortran API.
@@ -1768,6 +1821,8 @@ NC4_put_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
 
             if (H5Dset_extent(hdf5_var->hdf_datasetid, fdims) < 0)
                 BAIL(NC_EHDFERR);
+            if (nc4_hdf5_clear_plan(hdf5_var))
+                BAIL(NC_EHDFERR);
             if (file_spaceid > 0 && H5Sclose(file_spaceid) < 0)
                 BAIL2(NC_EHDFERR);
             if ((file_spaceid = H5Dget_space(hdf5_var->hdf_datasetid)) < 0)
@@ -1827,6 +1882,131 @@ exit:
     return NC_NOERR;
 }
 
+/**
+ * @internal Close the dataspaces kept for a var by NC4_get_vars(). This
+ * must be called whenever the extent of the dataset changes or the
+ * dataset is closed.
+ *
+ * @param hdf5_var Pointer to HDF5 var info struct.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EHDFERR HDF5 function returned error.
+ */
+int
+nc4_hdf5_clear_plan(NC_HDF5_VAR_INFO_T *hdf5_var)
+{
+    int retval = NC_NOERR;
+
+    if (hdf5_var->plan_filespace > 0 && H5Sclose(hdf5_var->plan_filespace) < 0)
+        retval = NC_EHDFERR;
+    if (hdf5_var->plan_memspace > 0 && H5Sclose(hdf5_var->plan_memspace) < 0)
+        retval = NC_EHDFERR;
+    hdf5_var->plan_filespace = 0;
+    hdf5_var->plan_memspace = 0;
+    nullfree(hdf5_var->plan_count);
+    hdf5_var->plan_count = NULL;
+    hdf5_var->plan_stride = NULL;
+    return retval;
+}
+
+/**
+ * @internal Select a hyperslab in the file space kept for a var and
+ * get a memory space of matching shape. The selection is made at
+ * the origin and moved to start with H5Soffset_simple(), so when
+ * count and stride are those of the previous read, the selection
+ * and the memory space are reused as they are.
+ *
+ * @param hdf5_var Pointer to HDF5 var info struct; plan_filespace
+ * must be set.
+ * @param ndims Number of dimensions of the var.
+ * @param start Start of the hyperslab.
+ * @param stride Stride of the hyperslab.
+ * @param count Count of the hyperslab; none may be zero.
+ * @param mem_spaceidp Gets the memory space, which belongs to the
+ * var.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_ENOMEM Out of memory.
+ * @returns ::NC_EHDFERR HDF5 function returned error.
+ */
+static int
+select_plan(NC_HDF5_VAR_INFO_T *hdf5_var, int ndims, const hsize_t *start,
+            const hsize_t *stride, const hsize_t *count, hid_t *mem_spaceidp)
+{
+    hsize_t origin[NC_MAX_VAR_DIMS];
+    hssize_t offset[NC_MAX_VAR_DIMS];
+    size_t nd = (size_t)ndims;
+    int d, same = 0;
+
+    if (hdf5_var->plan_memspace)
+    {
+        same = 1;
+        for (d = 0; d < ndims; d++)
+            if (hdf5_var->plan_count[d] != count[d] ||
+                hdf5_var->plan_stride[d] != stride[d])
+                same = 0;
+    }
+    if (!same)
+    {
+        if (hdf5_var->plan_memspace && H5Sclose(hdf5_var->plan_memspace) < 0)
+            return NC_EHDFERR;
+        hdf5_var->plan_memspace = 0;
+        if (!hdf5_var->plan_count)
+        {
+            if (!(hdf5_var->plan_count = malloc(2 * nd * sizeof(hsize_t))))
+                return NC_ENOMEM;
+            hdf5_var->plan_stride = hdf5_var->plan_count + ndims;
+        }
+        for (d = 0; d < ndims; d++)
+            origin[d] = 0;
+        if (H5Sselect_hyperslab(hdf5_var->plan_filespace, H5S_SELECT_SET,
+                                origin, stride, count, NULL) < 0)
+            return NC_EHDFERR;
+        if ((hdf5_var->plan_memspace = H5Screate_simple(ndims, count, NULL)) < 0)
+        {
+            hdf5_var->plan_memspace = 0;
+            return NC_EHDFERR;
+        }
+        memcpy(hdf5_var->plan_count, count, nd * sizeof(hsize_t));
+        memcpy(hdf5_var->plan_stride, stride, nd * sizeof(hsize_t));
+    }
+    for (d = 0; d < ndims; d++)
+        offset[d] = (hssize_t)start[d];
+    if (H5Soffset_simple(hdf5_var->plan_filespace, offset) < 0)
+        return NC_EHDFERR;
+    *mem_spaceidp = hdf5_var->plan_memspace;
+    return NC_NOERR;
+}
+
+/**
+ * @internal HDF5 vlen memory manager allocating from the arena of an
+ * arena read.
+ *
+ * @param size Bytes to allocate.
+ * @param info The arena.
+ *
+ * @return The memory, or NULL if out of memory.
+ */
+static void *
+arena_vlen_alloc(size_t size, void *info)
+{
+    return NC_arena_alloc((nc_arena_t *)info, size);
+}
+
+/**
+ * @internal Arena memory is only released by nc_free_arena(), so
+ * there is nothing to free here.
+ *
+ * @param mem Memory from arena_vlen_alloc().
+ * @param info Unused.
+ */
+static void
+arena_vlen_free(void *mem, void *info)
+{
+    (void)mem;
+    (void)info;
+}
+
 /**
  * @internal Read a strided array of data from a variable. This is
  * called by nc_get_vars() for netCDF-4 files, as well as all the
@@ -1881,6 +2061,7 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
     int need_to_convert = 0;
     size_t len = 1;
     int fixedlengthstring = 0;
+    nc_arena_t *arena = NC_arena_current();
     hsize_t fstring_len = 0;
     size_t fstring_count = 1;
 
@@ -1929,9 +2110,17 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
             no_read++;
     }
 
-    /* Get file space of data. */
-    if ((file_spaceid = H5Dget_space(hdf5_var->hdf_datasetid)) < 0)
-        BAIL(NC_EHDFERR);
+    /* Get file space of data. It is kept with the var, together with
+     * the memory space of the last hyperslab shape read, so that
+     * repeated reads of the same shape only move the selection. It is
+     * not closed on exit. */
+    if (!hdf5_var->plan_filespace)
+        if ((hdf5_var->plan_filespace = H5Dget_space(hdf5_var->hdf_datasetid)) < 0)
+        {
+            hdf5_var->plan_filespace = 0;
+            BAIL(NC_EHDFERR);
+        }
+    file_spaceid = hdf5_var->plan_filespace;
 
     /* Check to ensure the user selection is
      * valid. H5Sget_simple_extent_dims gets the sizes of all the dims
@@ -2052,13 +2241,11 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
         }
         else
         {
-            if (H5Sselect_hyperslab(file_spaceid, H5S_SELECT_SET,
-                                    start, stride, count, NULL) < 0)
-                BAIL(NC_EHDFERR);
-            /* Create a space for the memory, just big enough to hold the slab
-               we want. */
-            if ((mem_spaceid = H5Screate_simple(var->ndims, count, NULL)) < 0)
-                BAIL(NC_EHDFERR);
+            /* Select the slab and get a space for the memory, just big
+               enough to hold it. */
+            if ((retval = select_plan(hdf5_var, var->ndims, start, stride,
+                                      count, &mem_spaceid)))
+                BAIL(retval);
         }
 
         /* Fix bug when reading HDF5 files with variable of type
@@ -2091,6 +2278,11 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
         if ((xfer_plistid = H5Pcreate(H5P_DATASET_XFER)) < 0)
             BAIL(NC_EHDFERR);
 
+        /* During nc_get_vara_arena(), strings and vlens come from the arena. */
+        if (arena && H5Pset_vlen_mem_manager(xfer_plistid, arena_vlen_alloc, arena,
+                                             arena_vlen_free, NULL) < 0)
+            BAIL(NC_EHDFERR);
+
 #ifdef USE_PARALLEL4
         /* Set up parallel I/O, if needed. */
         if ((retval = set_par_access(h5, var, xfer_plistid)))
@@ -2119,6 +2311,11 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
             if ((retval = set_par_access(h5, var, xfer_plistid)))
                 BAIL(retval);
 
+            /* The selection is changed, so take the file space out of
+             * the plan; it will be closed on exit. */
+            hdf5_var->plan_filespace = 0;
+            if (nc4_hdf5_clear_plan(hdf5_var))
+                BAIL(NC_EHDFERR);
             if (H5Sselect_none(file_spaceid) < 0)
                 BAIL(NC_EHDFERR);
 
@@ -2146,7 +2343,11 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
 	char* p;
 	for(k=0;k < fstring_count;k++) {
 	    char* eol;
-	    if((p = (char*)malloc(1+fstring_len))==NULL) BAIL(NC_ENOMEM);
+	    if (arena)
+		p = (char*)NC_arena_alloc(arena,1+fstring_len);
+	    else
+		p = (char*)malloc(1+fstring_len);
+	    if(p==NULL) BAIL(NC_ENOMEM);
 	    memcpy(p,((char*)bufr)+(k*fstring_len),fstring_len);
 	    eol = p + fstring_len;
 	    *eol = '\0';
@@ -2209,7 +2410,7 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
 #else
 	    {
 		/* Copy one instance of the fill_value */
-		if((retval = nc_copy_data(ncid,var->type_info->hdr.id,fillvalue,1,filldata)))
+		if((retval = NC_copy_data_arena(ncid,var->type_info->hdr.id,fillvalue,1,filldata,arena)))
 		    BAIL(retval);
 	    }
 #endif
@@ -2236,10 +2437,10 @@ NC4_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
     
 exit:
     if(fixedlengthstring && bufr) free(bufr);
-    if (file_spaceid > 0)
+    if (file_spaceid > 0 && file_spaceid != hdf5_var->plan_filespace)
         if (H5Sclose(file_spaceid) < 0)
             BAIL2(NC_EHDFERR);
-    if (mem_spaceid > 0)
+    if (mem_spaceid > 0 && mem_spaceid != hdf5_var->plan_memspace)
         if (H5Sclose(mem_spaceid) < 0)
             BAIL2(NC_EHDFERR);
     if (xfer_plistid > 0)
@@ -2265,6 +2466,113 @@ exit:
     return NC_NOERR;
 }
 
+/**
+ * @internal Read a set of scattered elements of a variable with a
+ * single HDF5 point selection, so that HDF5 visits each chunk only
+ * once. Only variables of fixed-size atomic types are handled, and
+ * only when all points are inside the current extent of the dataset;
+ * otherwise *handledp is set to 0 and the caller falls back to the
+ * generic implementation (which also supplies fill values past the
+ * end of an unlimited dimension).
+ *
+ * @param ncid File and group ID.
+ * @param varid Variable ID.
+ * @param npoints Number of points.
+ * @param coords npoints*ndims indices.
+ * @param data Where the values are stored, in the variable's type.
+ * @param handledp Set to 1 if the points were read.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Var not found.
+ * @returns ::NC_ENOFILTER A filter of the variable is not available.
+ * @returns ::NC_EHDFERR HDF5 function returned error.
+ */
+int
+NC4_HDF5_get_var_points(int ncid, int varid, size_t npoints,
+                        const size_t *coords, void *data, int *handledp)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NC_HDF5_VAR_INFO_T *hdf5_var;
+    NC_HDF5_TYPE_INFO_T *hdf5_type;
+    nc_type mem_nc_type = NC_NAT;
+    hid_t file_spaceid = 0, mem_spaceid = 0;
+    hsize_t fdims[NC_MAX_VAR_DIMS], fmaxdims[NC_MAX_VAR_DIMS];
+    hsize_t *hcoords = NULL;
+    hsize_t hnpoints = (hsize_t)npoints;
+    size_t i;
+    int d, retval = NC_NOERR;
+
+    *handledp = 0;
+
+    /* Find info for this file, group, and var. */
+    if ((retval = nc4_hdf5_find_grp_h5_var(ncid, varid, &h5, &grp, &var)))
+        return retval;
+    hdf5_var = (NC_HDF5_VAR_INFO_T *)var->format_var_info;
+    hdf5_type = (NC_HDF5_TYPE_INFO_T *)var->type_info->format_type_info;
+
+    /* Only simple cases are handled here. */
+    if (var->ndims == 0 || h5->parallel ||
+        var->type_info->hdr.id > NC_MAX_ATOMIC_TYPE ||
+        var->type_info->hdr.id == NC_STRING)
+        return NC_NOERR;
+
+    /* End define mode, if needed. */
+    if ((retval = check_for_vara(&mem_nc_type, var, h5)))
+        return retval;
+    assert(hdf5_var->hdf_datasetid);
+
+    /* Verify that all the variable's filters are available */
+    if(hdf5_var->flags & NC_HDF5_VAR_FILTER_MISSING) {
+	unsigned id = 0;
+	NC4_hdf5_find_missing_filter(var, &id);
+	LOG((0,"missing filter: variable=%s id=%u",var->hdr.name,id));
+        return NC_ENOFILTER;
+    }
+
+    if ((file_spaceid = H5Dget_space(hdf5_var->hdf_datasetid)) < 0)
+        BAIL(NC_EHDFERR);
+    if (H5Sget_simple_extent_dims(file_spaceid, fdims, fmaxdims) < 0)
+        BAIL(NC_EHDFERR);
+
+    if (!(hcoords = malloc(sizeof(hsize_t) * npoints * (size_t)var->ndims)))
+        BAIL(NC_ENOMEM);
+    for (i = 0; i < npoints; i++)
+    {
+        for (d = 0; d < var->ndims; d++)
+        {
+            size_t c = coords[i * (size_t)var->ndims + (size_t)d];
+            /* Leave errors and fill values to the generic code. */
+            if ((hsize_t)c >= fdims[d])
+                goto exit;
+            hcoords[i * (size_t)var->ndims + (size_t)d] = (hsize_t)c;
+        }
+    }
+
+    if (H5Sselect_elements(file_spaceid, H5S_SELECT_SET, npoints, hcoords) < 0)
+        BAIL(NC_EHDFERR);
+    if ((mem_spaceid = H5Screate_simple(1, &hnpoints, NULL)) < 0)
+        BAIL(NC_EHDFERR);
+    LOG((5, "About to H5Dread %ld points...", (long)npoints));
+    if (H5Dread(hdf5_var->hdf_datasetid, hdf5_type->native_hdf_typeid,
+                mem_spaceid, file_spaceid, H5P_DEFAULT, data) < 0)
+        BAIL(NC_EHDFERR);
+    *handledp = 1;
+
+exit:
+    if (file_spaceid > 0)
+        if (H5Sclose(file_spaceid) < 0)
+            BAIL2(NC_EHDFERR);
+    if (mem_spaceid > 0)
+        if (H5Sclose(mem_spaceid) < 0)
+            BAIL2(NC_EHDFERR);
+    if (hcoords)
+        free(hcoords);
+    return retval;
+}
+
 /**
  * @internal Get all the information about a variable. Pass NULL for
  * whatever you don't care about.
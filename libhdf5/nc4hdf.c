@@ -1128,6 +1128,7 @@ int
 nc4_adjust_var_cache(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var)
 {
     size_t chunk_size_bytes = 1;
+    size_t type_size;
     int d;
     int retval;
 
@@ -1142,25 +1143,31 @@ nc4_adjust_var_cache(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var)
 #endif
 
     /* How many bytes in the chunk? */
+    type_size = (var->type_info->size ? var->type_info->size : sizeof(char *));
     for (d = 0; d < var->ndims; d++)
         chunk_size_bytes *= var->chunksizes[d];
-    if (var->type_info->size)
-        chunk_size_bytes *= var->type_info->size;
-    else
-        chunk_size_bytes *= sizeof(char *);
+    chunk_size_bytes *= type_size;
 
     /* If the chunk cache is too small, and the user has not changed
      * the default value of the chunk cache size, then increase the
-     * size of the cache. */
+     * size of the cache. An access hint asks for room for the chunks
+     * of one hinted read. */
     if (var->chunkcache.size == CHUNK_CACHE_SIZE)
-        if (chunk_size_bytes > var->chunkcache.size)
+    {
+        size_t size = nc4_access_hint_cache_size(var, type_size, CHUNK_CACHE_SIZE);
+        if (chunk_size_bytes > size)
+        {
+            size = chunk_size_bytes * DEFAULT_CHUNKS_IN_CACHE;
+            if (size > MAX_DEFAULT_CACHE_SIZE)
+                size = MAX_DEFAULT_CACHE_SIZE;
+        }
+        if (size != var->chunkcache.size)
         {
-            var->chunkcache.size = chunk_size_bytes * DEFAULT_CHUNKS_IN_CACHE;
-            if (var->chunkcache.size > MAX_DEFAULT_CACHE_SIZE)
-                var->chunkcache.size = MAX_DEFAULT_CACHE_SIZE;
+            var->chunkcache.size = size;
             if ((retval = nc4_reopen_dataset(grp, var)))
                 return retval;
         }
+    }
 
     return NC_NOERR;
 }
@@ -1707,6 +1714,8 @@ write_var(NC_VAR_INFO_T *var, NC_GRP_INFO_T *grp, nc_bool_t write_dimid)
     if (replace_existing_var)
     {
         /* Free the HDF5 dataset id. */
+        if (nc4_hdf5_clear_plan(hdf5_var))
+            return NC_EHDFERR;
         if (hdf5_var->hdf_datasetid && H5Dclose(hdf5_var->hdf_datasetid) < 0)
             return NC_EHDFERR;
         hdf5_var->hdf_datasetid = 0;
@@ -1918,6 +1927,8 @@ write_dim(NC_DIM_INFO_T *dim, NC_GRP_INFO_T *grp, nc_bool_t write_dimid)
             }
             if (H5Dset_extent(hdf5_v1->hdf_datasetid, new_size) < 0)
                 BAIL(NC_EHDFERR);
+            if (nc4_hdf5_clear_plan(hdf5_v1))
+                BAIL(NC_EHDFERR);
             free(new_size);
         }
     }
@@ -77,6 +77,9 @@ ncz_create_dataset(NC_FILE_INFO_T* file, NC_GRP_INFO_T* root, const char** contr
     /* initialize map handle*/
     if((stat = nczmap_create(zinfo->controls.mapimpl,nc->path,nc->mode,zinfo->controls.flags,NULL,&zinfo->map)))
 	goto done;
+#ifdef ENABLE_IOSTATS
+    zinfo->map->iostats = NC_iostats_file(nc);
+#endif
 
 done:
     ncurifree(uri);
@@ -141,6 +144,9 @@ ncz_open_dataset(NC_FILE_INFO_T* file, const char** controls)
     /* initialize map handle*/
     if((stat = nczmap_open(zinfo->controls.mapimpl,nc->path,mode,zinfo->controls.flags,NULL,&zinfo->map)))
 	goto done;
+#ifdef ENABLE_IOSTATS
+    zinfo->map->iostats = NC_iostats_file(nc);
+#endif
 
     if((stat = ncz_read_superblock(file,&nczarr_version,&zarr_format))) goto done;
 
@@ -344,6 +350,15 @@ applycontrols(NCZ_FILE_INFO_T* zinfo)
 	if(strcasecmp(value,"fetch")==0)
 	    zinfo->controls.flags |= FLAG_SHOWFETCH;
     }
+    /* The .rc default can be overridden per dataset */
+    if(!NC_getglobalstate()->zarr.write_empty_chunks)
+	zinfo->controls.flags |= FLAG_NOEMPTYCHUNKS;
+    if((value = controllookup((const char**)zinfo->envv_controls,EMPTYCHUNKSCONTROL)) != NULL) {
+	if(NCZ_isfalse(value))
+	    zinfo->controls.flags |= FLAG_NOEMPTYCHUNKS;
+	else
+	    zinfo->controls.flags &= ~((size64_t)FLAG_NOEMPTYCHUNKS);
+    }
 done:
     nclistfreeall(modelist);
     return stat;
@@ -33,6 +33,7 @@ typedef struct NCZCacheEntry {
     size64_t hashkey;
     int isfiltered; /* 1=>data contains filtered data else real data */
     int isfixedstring; /* 1 => data contains the fixed strings, 0 => data contains pointers to strings */
+    int stored; /* 1 => the chunk object exists in the map */
     size64_t size; /* |data| */
     void* data; /* contains either filtered or real data */
 } NCZCacheEntry;
@@ -50,6 +51,8 @@ typedef struct NCZChunkCache {
     NClist* mru; /* NClist<NCZCacheEntry> all cache entries in mru order */
     struct NCxcache* xcache;
     char dimension_separator;
+    int partial; /* 1 => lastpartial is defined */
+    size64_t lastpartial; /* hash key of the last chunk read in part by NCZ_read_chunk_ranges */
 } NCZChunkCache;
 
 /**************************************************/
@@ -62,6 +65,8 @@ extern int NCZ_create_chunk_cache(NC_VAR_INFO_T* var, size64_t, char dimsep, NCZ
 extern void NCZ_free_chunk_cache(NCZChunkCache* cache);
 extern int NCZ_read_cache_chunk(NCZChunkCache* cache, const size64_t* indices, void** datap);
 extern int NCZ_flush_chunk_cache(NCZChunkCache* cache);
+extern int NCZ_chunk_cache_modify(NCZChunkCache* cache, const size64_t* indices);
+extern int NCZ_read_chunk_ranges(NCZChunkCache* cache, const size64_t* indices, size_t nranges, const size64_t* ranges, void* chunkbuf);
 extern size64_t NCZ_cache_entrysize(NCZChunkCache* cache);
 extern NCZCacheEntry* NCZ_cache_entry(NCZChunkCache* cache, const size64_t* indices);
 extern size64_t NCZ_cache_size(NCZChunkCache* cache);
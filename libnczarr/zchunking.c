@@ -13,6 +13,8 @@ static int pcounter = 0;
 static int compute_intersection(const NCZSlice* slice, const size64_t chunklen, NCZChunkRange* range);
 static void skipchunk(const NCZSlice* slice, NCZProjection* projection);
 static int verifyslice(const NCZSlice* slice);
+static int findplan(NCZ_VAR_INFO_T* zvar, const struct Common* common, int r, const NCZSlice* slice, NCZSliceProjections* slp);
+static int saveplan(NCZ_VAR_INFO_T* zvar, const struct Common* common, int r, const NCZSlice* slice, const NCZSliceProjections* slp);
 
 /**************************************************/
 /* Goal:create a vector of chunk ranges: one for each slice in
@@ -206,6 +208,8 @@ NCZ_compute_per_slice_projections(
     int stat = NC_NOERR;
     size64_t index,slicecount;
     size_t n;
+    NCZ_VAR_INFO_T* zvar = (common->var != NULL ? common->var->format_var_info : NULL);
+    int planable = 0;
 
     /* Part fill the Slice Projections */
     slp->r = r;
@@ -214,6 +218,14 @@ NCZ_compute_per_slice_projections(
     if((slp->projections = calloc(slp->count,sizeof(NCZProjection))) == NULL)
 	{stat = NC_ENOMEM; goto done;}
 
+    /* The projections only depend on the position of the slice within
+       its first chunk, unless the last chunk is clipped by the dimension
+       length; so reuse those of an earlier slice of the same shape. */
+    if(zvar != NULL && range->stop * common->chunklens[r] <= common->dimlens[r]) {
+	planable = 1;
+	if(findplan(zvar,common,r,slice,slp)) goto done;
+    }
+
     /* Compute the total number of output items defined by this slice
            (equivalent to count as used by nc_get_vars) */
     slicecount = ceildiv((slice->stop - slice->start), slice->stride);
@@ -224,6 +236,8 @@ NCZ_compute_per_slice_projections(
 	if((stat = NCZ_compute_projections(common, r, index, slice, n, slp->projections))) 
 	    goto done; /* something went wrong */
     }
+    if(planable && (stat = saveplan(zvar,common,r,slice,slp)))
+	goto done;
 
 done:
     return stat;
@@ -284,6 +298,92 @@ NCZ_clearsliceprojections(int count, NCZSliceProjections* slpv)
     }
 }
 
+/* Look for a plan matching slice; if found, fill slp from it */
+static int
+findplan(NCZ_VAR_INFO_T* zvar, const struct Common* common, int r, const NCZSlice* slice, NCZSliceProjections* slp)
+{
+    size_t i, n;
+    size64_t chunklen = common->chunklens[r];
+    size64_t base = slp->range.start;
+    NClist* plans = zvar->plans;
+
+    for(i=nclistlength(plans);i-->0;) {
+	NCZPlan* plan = (NCZPlan*)nclistget(plans,i);
+	if(plan->r != r || plan->chunklen != chunklen
+	   || plan->align != slice->start - base * chunklen
+	   || plan->span != slice->stop - slice->start
+	   || plan->stride != slice->stride
+	   || plan->memlen != common->memshape[r])
+	    continue;
+	assert(plan->slp.count == slp->count);
+	memcpy(slp->projections,plan->slp.projections,sizeof(NCZProjection)*slp->count);
+	for(n=0;n<slp->count;n++) {
+	    slp->projections[n].chunkindex += base;
+	    slp->projections[n].offset += base * chunklen;
+	}
+	/* Make it the most recently used */
+	if(i != nclistlength(plans) - 1) {
+	    nclistremove(plans,i);
+	    nclistpush(plans,plan);
+	}
+	return 1;
+    }
+    return 0;
+}
+
+/* Remember the projections in slp, computed for slice */
+static int
+saveplan(NCZ_VAR_INFO_T* zvar, const struct Common* common, int r, const NCZSlice* slice, const NCZSliceProjections* slp)
+{
+    size_t n;
+    size64_t chunklen = common->chunklens[r];
+    size64_t base = slp->range.start;
+    NCZPlan* plan = NULL;
+
+    if(zvar->plans == NULL && (zvar->plans = nclistnew()) == NULL)
+	return NC_ENOMEM;
+    if((plan = (NCZPlan*)calloc(1,sizeof(NCZPlan))) == NULL)
+	return NC_ENOMEM;
+    if((plan->slp.projections = (NCZProjection*)malloc(sizeof(NCZProjection)*slp->count)) == NULL)
+	{free(plan); return NC_ENOMEM;}
+    plan->r = r;
+    plan->chunklen = chunklen;
+    plan->align = slice->start - base * chunklen;
+    plan->span = slice->stop - slice->start;
+    plan->stride = slice->stride;
+    plan->memlen = common->memshape[r];
+    plan->slp.r = r;
+    plan->slp.range.start = 0;
+    plan->slp.range.stop = slp->count;
+    plan->slp.count = slp->count;
+    memcpy(plan->slp.projections,slp->projections,sizeof(NCZProjection)*slp->count);
+    for(n=0;n<slp->count;n++) {
+	plan->slp.projections[n].chunkindex -= base;
+	plan->slp.projections[n].offset -= base * chunklen;
+    }
+    if(nclistlength(zvar->plans) >= NCZ_MAXPLANS) {
+	NCZPlan* old = (NCZPlan*)nclistremove(zvar->plans,0);
+	nullfree(old->slp.projections);
+	free(old);
+    }
+    nclistpush(zvar->plans,plan);
+    return NC_NOERR;
+}
+
+/* Reclaim the plans of a variable */
+void
+NCZ_free_plans(NClist* plans)
+{
+    size_t i;
+    if(plans == NULL) return;
+    for(i=0;i<nclistlength(plans);i++) {
+	NCZPlan* plan = (NCZPlan*)nclistget(plans,i);
+	nullfree(plan->slp.projections);
+	free(plan);
+    }
+    nclistfree(plans);
+}
+
 #if 0
 static void
 clearallprojections(NCZAllProjections* nap)
@@ -54,6 +54,30 @@ typedef struct NCZSliceProjections {
 				   the chunk */
 } NCZSliceProjections;
 
+/* The projections of one dimension computed for an earlier slice,
+   rebased so that the slice starts in chunk 0. They are reused for
+   any slice with the same shape and the same position within its
+   first chunk; see NCZ_compute_per_slice_projections. */
+typedef struct NCZPlan {
+    int r;
+    size64_t chunklen;
+    size64_t align;  /* slice start - offset of its first chunk */
+    size64_t span;   /* slice stop - slice start */
+    size64_t stride;
+    size64_t memlen; /* memshape[r] */
+    NCZSliceProjections slp;
+} NCZPlan;
+
+/* Max number of plans kept per variable */
+#define NCZ_MAXPLANS 16
+
+/* Partial chunk reads of unfiltered variables (see NCZ_transfer):
+   ranges closer than NCZ_PARTIAL_GAP bytes are merged, and a chunk is
+   read whole if it needs more than NCZ_PARTIAL_MAXRANGES ranges or
+   more than half of its bytes. */
+#define NCZ_PARTIAL_GAP 8192
+#define NCZ_PARTIAL_MAXRANGES 16
+
 /* Combine some values to simplify internal argument lists */
 struct Common {
     NC_FILE_INFO_T* file;
@@ -73,6 +97,8 @@ struct Common {
     NCZSliceProjections* allprojections;
     /* Parametric chunk reader so we can do unittests */
     struct Reader reader;
+    int partial; /* 1 => reads may fetch only the needed bytes of a chunk */
+    void* partbuf; /* chunk sized buffer for such reads */
 };
 
 /**************************************************/
@@ -81,6 +107,7 @@ EXTERNL int NCZ_compute_chunk_ranges(int rank, const NCZSlice*, const size64_t*,
 EXTERNL int NCZ_compute_projections(struct Common*, int r, size64_t chunkindex, const NCZSlice* slice, size_t n, NCZProjection* projections);
 EXTERNL int NCZ_compute_per_slice_projections(struct Common*, int rank, const NCZSlice*, const NCZChunkRange*, NCZSliceProjections* slp);
 EXTERNL int NCZ_compute_all_slice_projections(struct Common*, const NCZSlice* slices, const NCZChunkRange*, NCZSliceProjections*);
+EXTERNL void NCZ_free_plans(struct NClist* plans);
 
 /* From zwalk.c */
 EXTERNL int ncz_chunking_init(void);
@@ -89,6 +116,7 @@ EXTERNL int NCZ_transferslice(NC_VAR_INFO_T* var, int reading,
 		  void* memory, nc_type typecode);
 EXTERNL int NCZ_transfer(struct Common* common, NCZSlice* slices);
 EXTERNL int NCZ_transferscalar(struct Common* common);
+EXTERNL int NCZ_transferpoints(NC_VAR_INFO_T* var, size_t npoints, const size_t* coords, void* memory);
 EXTERNL size64_t NCZ_computelinearoffset(size_t, const size64_t*, const size64_t*);
 
 /* Special entry points for unit testing */
@@ -174,6 +174,7 @@ zclose_vars(NC_GRP_INFO_T* grp)
 	/* Reclaim the type */
 	if(var->type_info) (void)zclose_type(var->type_info);
         if(zvar->cache) NCZ_free_chunk_cache(zvar->cache);
+        NCZ_free_plans(zvar->plans);
 	/* reclaim xarray */
 	if(zvar->xarray) nclistfreeall(zvar->xarray);
 	nullfree(zvar);
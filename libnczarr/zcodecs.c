@@ -0,0 +1,827 @@
+/* Copyright 2018-2018 University Corporation for Atmospheric
+   Research/Unidata. */
+
+/**
+ * @file
+ * @internal Codecs built into libnczarr. They need neither a plugin
+ * library nor an external compression library:
+ *
+ * - "delta" (H5Z_FILTER_DELTA): stores the differences between
+ *   successive integers; same JSON and algorithm as numcodecs Delta.
+ * - "bitpack" (H5Z_FILTER_BITPACK): frame of reference bit packing of
+ *   integers in blocks of BITPACK_BLOCK values.
+ * - "fixedscaleoffset" (H5Z_FILTER_FIXEDSCALEOFFSET): stores
+ *   round((x - offset) * scale) as a (narrower) integer type; same JSON
+ *   and algorithm as numcodecs FixedScaleOffset.
+ *
+ * The codecs work on values in native byte order. Their inner loops
+ * convert whole blocks of values between the stored and the working
+ * representation, so that they are free of data dependent branches
+ * and can be vectorized by the compiler.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+
+#include "zincludes.h"
+#include "zfilter.h"
+#include "netcdf_filter.h"
+#include "netcdf_filter_build.h"
+#include "netcdf_aux.h"
+
+#ifdef ENABLE_NCZARR_FILTERS
+
+/* Number of values sharing one frame of reference and bit width */
+#define BITPACK_BLOCK 128
+/* Wider offsets are stored as 8 byte values */
+#define BITPACK_MAXBITS 56
+/* Number of values converted at a time by fixedscaleoffset */
+#define FSO_BLOCK 1024
+
+/* Forward */
+static size_t H5Z_filter_delta(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes, size_t* buf_size, void** buf);
+static size_t H5Z_filter_bitpack(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes, size_t* buf_size, void** buf);
+static size_t H5Z_filter_fixedscaleoffset(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes, size_t* buf_size, void** buf);
+
+static int NCZ_delta_codec_to_hdf5(const char* codec, size_t* nparamsp, unsigned** paramsp);
+static int NCZ_delta_hdf5_to_codec(size_t nparams, const unsigned* params, char** codecp);
+static int NCZ_bitpack_codec_to_hdf5(const char* codec, size_t* nparamsp, unsigned** paramsp);
+static int NCZ_bitpack_hdf5_to_codec(size_t nparams, const unsigned* params, char** codecp);
+static int NCZ_integer_modify_parameters(int ncid, int varid, size_t* vnparamsp, unsigned** vparamsp, size_t* wnparamsp, unsigned** wparamsp);
+static int NCZ_fixedscaleoffset_codec_to_hdf5(const char* codec, size_t* nparamsp, unsigned** paramsp);
+static int NCZ_fixedscaleoffset_hdf5_to_codec(size_t nparams, const unsigned* params, char** codecp);
+static int NCZ_fixedscaleoffset_modify_parameters(int ncid, int varid, size_t* vnparamsp, unsigned** vparamsp, size_t* wnparamsp, unsigned** wparamsp);
+
+/**************************************************/
+/* Codec and filter tables */
+
+static const H5Z_class2_t H5Z_DELTA = {
+    H5Z_CLASS_T_VERS,
+    (H5Z_filter_t)H5Z_FILTER_DELTA,
+    1, 1,
+    "delta",
+    NULL, NULL,
+    (H5Z_func_t)H5Z_filter_delta,
+};
+
+static const NCZ_codec_t NCZ_delta_codec = {
+  NCZ_CODEC_CLASS_VER,
+  NCZ_CODEC_HDF5,
+  "delta",
+  H5Z_FILTER_DELTA,
+  NULL,
+  NULL,
+  NCZ_delta_codec_to_hdf5,
+  NCZ_delta_hdf5_to_codec,
+  NCZ_integer_modify_parameters,
+};
+
+static const H5Z_class2_t H5Z_BITPACK = {
+    H5Z_CLASS_T_VERS,
+    (H5Z_filter_t)H5Z_FILTER_BITPACK,
+    1, 1,
+    "bitpack",
+    NULL, NULL,
+    (H5Z_func_t)H5Z_filter_bitpack,
+};
+
+static const NCZ_codec_t NCZ_bitpack_codec = {
+  NCZ_CODEC_CLASS_VER,
+  NCZ_CODEC_HDF5,
+  "bitpack",
+  H5Z_FILTER_BITPACK,
+  NULL,
+  NULL,
+  NCZ_bitpack_codec_to_hdf5,
+  NCZ_bitpack_hdf5_to_codec,
+  NCZ_integer_modify_parameters,
+};
+
+static const H5Z_class2_t H5Z_FIXEDSCALEOFFSET = {
+    H5Z_CLASS_T_VERS,
+    (H5Z_filter_t)H5Z_FILTER_FIXEDSCALEOFFSET,
+    1, 1,
+    "fixedscaleoffset",
+    NULL, NULL,
+    (H5Z_func_t)H5Z_filter_fixedscaleoffset,
+};
+
+static const NCZ_codec_t NCZ_fixedscaleoffset_codec = {
+  NCZ_CODEC_CLASS_VER,
+  NCZ_CODEC_HDF5,
+  "fixedscaleoffset",
+  H5Z_FILTER_FIXEDSCALEOFFSET,
+  NULL,
+  NULL,
+  NCZ_fixedscaleoffset_codec_to_hdf5,
+  NCZ_fixedscaleoffset_hdf5_to_codec,
+  NCZ_fixedscaleoffset_modify_parameters,
+};
+
+const NCZ_Builtin NCZ_builtin_codecs[] = {
+{&H5Z_DELTA, &NCZ_delta_codec},
+{&H5Z_BITPACK, &NCZ_bitpack_codec},
+{&H5Z_FIXEDSCALEOFFSET, &NCZ_fixedscaleoffset_codec},
+{NULL, NULL}
+};
+
+/**************************************************/
+/* Utilities */
+
+/* Size and signedness of the integer types */
+static int
+inttype(nc_type type, size_t* sizep, int* signedp)
+{
+    switch (type) {
+    case NC_BYTE: *sizep = 1; *signedp = 1; break;
+    case NC_UBYTE: *sizep = 1; *signedp = 0; break;
+    case NC_SHORT: *sizep = 2; *signedp = 1; break;
+    case NC_USHORT: *sizep = 2; *signedp = 0; break;
+    case NC_INT: *sizep = 4; *signedp = 1; break;
+    case NC_UINT: *sizep = 4; *signedp = 0; break;
+    case NC_INT64: *sizep = 8; *signedp = 1; break;
+    case NC_UINT64: *sizep = 8; *signedp = 0; break;
+    default: return 0;
+    }
+    return 1;
+}
+
+/* Size of the types fixedscaleoffset can produce; 0 if not supported */
+static size_t
+numtypesize(nc_type type)
+{
+    size_t size;
+    int issigned;
+    if(type == NC_FLOAT) return 4;
+    if(type == NC_DOUBLE) return 8;
+    return (inttype(type,&size,&issigned) ? size : 0);
+}
+
+/* Get the type of a codec key like "dtype"; NC_NAT if the key is missing */
+static int
+codec_dtype(const NCjson* jcodec, const char* key, nc_type* typep)
+{
+    NCjson* jtmp = NULL;
+    int endianness;
+
+    *typep = NC_NAT;
+    if(NCJdictget(jcodec,key,&jtmp)) return NC_EFILTER;
+    if(jtmp == NULL) return NC_NOERR;
+    if(NCJsort(jtmp) != NCJ_STRING) return NC_EFILTER;
+    if(ncz_dtype2nctype(NCJstring(jtmp),NC_NAT,1,typep,&endianness,NULL)) return NC_EFILTER;
+    /* The values are processed in native order */
+    if(endianness != NC_ENDIAN_NATIVE
+       && endianness != (NC_isLittleEndian() ? NC_ENDIAN_LITTLE : NC_ENDIAN_BIG))
+        return NC_EFILTER;
+    return NC_NOERR;
+}
+
+/* Get the dtype string for a type in native order */
+static int
+type_dtype(unsigned type, char** dtypep)
+{
+    int endianness = (NC_isLittleEndian() ? NC_ENDIAN_LITTLE : NC_ENDIAN_BIG);
+    if(numtypesize((nc_type)type) == 0) return NC_EFILTER;
+    if(numtypesize((nc_type)type) == 1) endianness = NC_ENDIAN_NATIVE;
+    return ncz_nctype2dtype((nc_type)type,endianness,1,0,dtypep);
+}
+
+/* Parse a codec and verify its id */
+static int
+codec_parse(const char* codec_json, const char* codecid, NCjson** jcodecp)
+{
+    int stat = NC_NOERR;
+    NCjson* jcodec = NULL;
+    NCjson* jtmp = NULL;
+
+    if(NCJparse(codec_json,0,&jcodec))
+        {stat = NC_EFILTER; goto done;}
+    if(NCJsort(jcodec) != NCJ_DICT) {stat = NC_EPLUGIN; goto done;}
+    if(NCJdictget(jcodec,"id",&jtmp))
+        {stat = NC_EFILTER; goto done;}
+    if(jtmp == NULL || !NCJisatomic(jtmp)) {stat = NC_EFILTER; goto done;}
+    if(strcmp(NCJstring(jtmp),codecid)!=0) {stat = NC_EINVAL; goto done;}
+    *jcodecp = jcodec; jcodec = NULL;
+done:
+    NCJreclaim(jcodec);
+    return stat;
+}
+
+/* Doubles are passed as two parameters; see docs/filters.md, Appendix A */
+static void
+double_to_params(double d, unsigned* params)
+{
+    memcpy(params,&d,sizeof(double));
+    ncaux_h5filterspec_fix8((unsigned char*)params,0);
+}
+
+static double
+params_to_double(const unsigned* params)
+{
+    double d;
+    unsigned tmp[2];
+    memcpy(tmp,params,sizeof(tmp));
+    ncaux_h5filterspec_fix8((unsigned char*)tmp,1);
+    memcpy(&d,tmp,sizeof(double));
+    return d;
+}
+
+/* Format a double with as few digits as reproduce it */
+static void
+format_double(double d, char* s, size_t len)
+{
+    double back = 0;
+    snprintf(s,len,"%.15g",d);
+    if(sscanf(s,"%lf",&back) != 1 || back != d)
+        snprintf(s,len,"%.17g",d);
+}
+
+/**************************************************/
+/* delta and bitpack codecs */
+
+/* The visible parameter is the nc_type of the values,
+   the working parameters are their size and signedness. */
+
+static int
+integer_codec_to_hdf5(const char* codecid, const char* codec_json, size_t* nparamsp, unsigned** paramsp)
+{
+    int stat = NC_NOERR;
+    NCjson* jcodec = NULL;
+    unsigned* params = NULL;
+    nc_type dtype, astype;
+    size_t size;
+    int issigned;
+
+    if(nparamsp == NULL || paramsp == NULL)
+        {stat = NC_EINTERNAL; goto done;}
+    if((stat = codec_parse(codec_json,codecid,&jcodec))) goto done;
+    if((stat = codec_dtype(jcodec,"dtype",&dtype))) goto done;
+    if((stat = codec_dtype(jcodec,"astype",&astype))) goto done;
+    /* The encoded values must have the type of the variable */
+    if(!inttype(dtype,&size,&issigned) || (astype != NC_NAT && astype != dtype))
+        {stat = NC_EFILTER; goto done;}
+    if((params = (unsigned*)calloc(1,sizeof(unsigned)))== NULL)
+        {stat = NC_ENOMEM; goto done;}
+    params[0] = (unsigned)dtype;
+    *nparamsp = 1;
+    *paramsp = params; params = NULL;
+
+done:
+    nullfree(params);
+    NCJreclaim(jcodec);
+    return stat;
+}
+
+static int
+integer_hdf5_to_codec(const char* codecid, size_t nparams, const unsigned* params, char** codecp)
+{
+    int stat = NC_NOERR;
+    char json[1024];
+    char* dtype = NULL;
+
+    if(nparams == 0 || params == NULL)
+        {stat = NC_EFILTER; goto done;}
+    if((stat = type_dtype(params[0],&dtype))) goto done;
+    snprintf(json,sizeof(json),"{\"id\": \"%s\", \"dtype\": \"%s\"}",codecid,dtype);
+    if(codecp) {
+        if((*codecp = strdup(json))==NULL) {stat = NC_ENOMEM; goto done;}
+    }
+
+done:
+    nullfree(dtype);
+    return stat;
+}
+
+static int
+NCZ_delta_codec_to_hdf5(const char* codec_json, size_t* nparamsp, unsigned** paramsp)
+{
+    return integer_codec_to_hdf5(NCZ_delta_codec.codecid,codec_json,nparamsp,paramsp);
+}
+
+static int
+NCZ_delta_hdf5_to_codec(size_t nparams, const unsigned* params, char** codecp)
+{
+    return integer_hdf5_to_codec(NCZ_delta_codec.codecid,nparams,params,codecp);
+}
+
+static int
+NCZ_bitpack_codec_to_hdf5(const char* codec_json, size_t* nparamsp, unsigned** paramsp)
+{
+    return integer_codec_to_hdf5(NCZ_bitpack_codec.codecid,codec_json,nparamsp,paramsp);
+}
+
+static int
+NCZ_bitpack_hdf5_to_codec(size_t nparams, const unsigned* params, char** codecp)
+{
+    return integer_hdf5_to_codec(NCZ_bitpack_codec.codecid,nparams,params,codecp);
+}
+
+static int
+NCZ_integer_modify_parameters(int ncid, int varid, size_t* vnparamsp, unsigned** vparamsp, size_t* wnparamsp, unsigned** wparamsp)
+{
+    int stat = NC_NOERR;
+    nc_type vtype;
+    size_t size;
+    int issigned;
+    unsigned* vparams = NULL;
+    unsigned* wparams = NULL;
+
+    if(!vnparamsp || !vparamsp || !wnparamsp || !wparamsp)
+        {stat = NC_EINTERNAL; goto done;}
+    if((stat = nc_inq_vartype(ncid,varid,&vtype))) goto done;
+    if(!inttype(vtype,&size,&issigned)) {stat = NC_EFILTER; goto done;}
+    /* A codec read from the dataset must describe the variable type */
+    if(*vnparamsp > 0 && (*vparamsp)[0] != (unsigned)vtype)
+        {stat = NC_EFILTER; goto done;}
+
+    if((vparams = (unsigned*)malloc(sizeof(unsigned)))==NULL
+       || (wparams = (unsigned*)malloc(2*sizeof(unsigned)))==NULL)
+        {stat = NC_ENOMEM; goto done;}
+    vparams[0] = (unsigned)vtype;
+    wparams[0] = (unsigned)size;
+    wparams[1] = (unsigned)issigned;
+
+    nullfree(*vparamsp);
+    *vnparamsp = 1; *vparamsp = vparams; vparams = NULL;
+    nullfree(*wparamsp);
+    *wnparamsp = 2; *wparamsp = wparams; wparams = NULL;
+
+done:
+    nullfree(vparams);
+    nullfree(wparams);
+    return stat;
+}
+
+/* Delta coding in place; unsigned arithmetic wraps like numcodecs does */
+#define DELTA_CODE(T) \
+    if(flags & H5Z_FLAG_REVERSE) { \
+        T* x = (T*)*buf; \
+        for(i=1;i<n;i++) x[i] = (T)(x[i] + x[i-1]); \
+    } else { \
+        T* x = (T*)*buf; \
+        for(i=n;i-- > 1;) x[i] = (T)(x[i] - x[i-1]); \
+    }
+
+static size_t
+H5Z_filter_delta(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes, size_t* buf_size, void** buf)
+{
+    size_t typesize, n, i;
+
+    NC_UNUSED(buf_size);
+    if(cd_nelmts < 1) return 0;
+    typesize = cd_values[0];
+    if(typesize == 0 || nbytes % typesize) return 0;
+    n = nbytes / typesize;
+    switch (typesize) {
+    case 1: DELTA_CODE(unsigned char); break;
+    case 2: DELTA_CODE(unsigned short); break;
+    case 4: DELTA_CODE(unsigned int); break;
+    case 8: DELTA_CODE(unsigned long long); break;
+    default: return 0;
+    }
+    return nbytes;
+}
+
+/*
+The bitpack encoding of a chunk of n values of size s:
+    8 bytes: n, little endian
+    per block of BITPACK_BLOCK values (the last may be shorter):
+        1 byte: number of bits b per value
+        s bytes: the smallest value in the block (the reference), little endian
+        ceil(count*b/8) bytes: the differences from the reference in b bits each,
+                               least significant bits first; if b is 64, the
+                               differences are stored in 8 bytes each.
+Signed values are biased to unsigned by flipping the sign bit, so that the
+differences are never negative.
+*/
+
+/* Biased values of one block */
+#define BP_LOAD(T) {const T* s = (const T*)src; for(i=0;i<n;i++) u[i] = (unsigned long long)(T)(s[i] ^ (T)bias);}
+#define BP_STORE(T) {T* d = (T*)dst; for(i=0;i<n;i++) d[i] = (T)((T)u[i] ^ (T)bias);}
+
+static void
+bp_load(const void* src, size_t typesize, unsigned long long bias, size_t n, unsigned long long* u)
+{
+    size_t i;
+    switch (typesize) {
+    case 1: BP_LOAD(unsigned char); break;
+    case 2: BP_LOAD(unsigned short); break;
+    case 4: BP_LOAD(unsigned int); break;
+    case 8: BP_LOAD(unsigned long long); break;
+    }
+}
+
+static void
+bp_store(void* dst, size_t typesize, unsigned long long bias, size_t n, const unsigned long long* u)
+{
+    size_t i;
+    switch (typesize) {
+    case 1: BP_STORE(unsigned char); break;
+    case 2: BP_STORE(unsigned short); break;
+    case 4: BP_STORE(unsigned int); break;
+    case 8: BP_STORE(unsigned long long); break;
+    }
+}
+
+static unsigned char*
+bp_putle(unsigned char* p, unsigned long long v, size_t len)
+{
+    size_t k;
+    for(k=0;k<len;k++) *p++ = (unsigned char)(v >> (8*k));
+    return p;
+}
+
+static const unsigned char*
+bp_getle(const unsigned char* p, unsigned long long* vp, size_t len)
+{
+    size_t k;
+    unsigned long long v = 0;
+    for(k=0;k<len;k++) v |= ((unsigned long long)*p++) << (8*k);
+    *vp = v;
+    return p;
+}
+
+static unsigned char*
+bp_pack(unsigned char* p, const unsigned long long* u, size_t n, unsigned nbits)
+{
+    size_t i;
+    unsigned long long acc = 0;
+    unsigned accbits = 0;
+
+    if(nbits > BITPACK_MAXBITS) {
+        for(i=0;i<n;i++) p = bp_putle(p,u[i],8);
+        return p;
+    }
+    for(i=0;i<n;i++) {
+        acc |= u[i] << accbits;
+        accbits += nbits;
+        while(accbits >= 8) {*p++ = (unsigned char)acc; acc >>= 8; accbits -= 8;}
+    }
+    if(accbits > 0) *p++ = (unsigned char)acc;
+    return p;
+}
+
+/* Unpack n values of nbits bits; the input ends at end */
+static const unsigned char*
+bp_unpack(const unsigned char* p, const unsigned char* end, unsigned long long* u, size_t n, unsigned nbits)
+{
+    size_t i, nfast, avail = (size_t)(end - p);
+    unsigned long long acc, w, mask;
+    unsigned accbits;
+
+    if(nbits > BITPACK_MAXBITS) {
+        for(i=0;i<n;i++) p = bp_getle(p,&u[i],8);
+        return p;
+    }
+    if(nbits == 0) {
+        for(i=0;i<n;i++) u[i] = 0;
+        return p;
+    }
+    mask = (1ULL << nbits) - 1;
+    /* Each value lies within the 8 bytes starting at its first byte;
+       extract the values whose 8 bytes are inside the input at once */
+    nfast = 0;
+    if(avail >= 8) {
+        nfast = ((avail-7)*8 - 1) / nbits + 1;
+        if(nfast > n) nfast = n;
+    }
+    if(NC_isLittleEndian()) {
+        for(i=0;i<nfast;i++) {
+            size_t bit = i*nbits;
+            memcpy(&w,p + bit/8,8);
+            u[i] = (w >> (bit & 7)) & mask;
+        }
+    } else {
+        for(i=0;i<nfast;i++) {
+            size_t bit = i*nbits;
+            bp_getle(p + bit/8,&w,8);
+            u[i] = (w >> (bit & 7)) & mask;
+        }
+    }
+    /* The rest, a byte at a time */
+    if(i < n) {
+        size_t bit = i*nbits;
+        const unsigned char* q = p + bit/8;
+        acc = (unsigned long long)(*q++) >> (bit & 7);
+        accbits = 8 - (unsigned)(bit & 7);
+        for(;i<n;i++) {
+            while(accbits < nbits) {acc |= ((unsigned long long)*q++) << accbits; accbits += 8;}
+            u[i] = acc & mask;
+            acc >>= nbits;
+            accbits -= nbits;
+        }
+    }
+    return p + (n*nbits + 7) / 8;
+}
+
+static size_t
+bitpack_encode(size_t typesize, unsigned long long bias, size_t nbytes, size_t* buf_size, void** buf)
+{
+    size_t n = nbytes / typesize;
+    size_t nblocks = (n + BITPACK_BLOCK - 1) / BITPACK_BLOCK;
+    size_t outsize = 8 + nblocks*(1+typesize) + n*typesize;
+    size_t i, j, count;
+    unsigned char* out = NULL;
+    unsigned char* p;
+    unsigned long long u[BITPACK_BLOCK];
+
+    if((out = (unsigned char*)malloc(outsize)) == NULL) return 0;
+    p = bp_putle(out,(unsigned long long)n,8);
+    for(i=0;i<n;i+=count) {
+        unsigned long long umin, umax;
+        unsigned nbits;
+        count = (n - i < BITPACK_BLOCK ? n - i : BITPACK_BLOCK);
+        bp_load((const char*)*buf + i*typesize,typesize,bias,count,u);
+        umin = u[0]; umax = u[0];
+        for(j=1;j<count;j++) {
+            umin = (u[j] < umin ? u[j] : umin);
+            umax = (u[j] > umax ? u[j] : umax);
+        }
+        for(nbits=0;nbits<64 && ((umax - umin) >> nbits) != 0;nbits++);
+        if(nbits > BITPACK_MAXBITS) nbits = 64;
+        for(j=0;j<count;j++) u[j] -= umin;
+        *p++ = (unsigned char)nbits;
+        p = bp_putle(p,umin,typesize);
+        p = bp_pack(p,u,count,nbits);
+    }
+    free(*buf);
+    *buf = out;
+    *buf_size = outsize;
+    return (size_t)(p - out);
+}
+
+static size_t
+bitpack_decode(size_t typesize, unsigned long long bias, size_t nbytes, size_t* buf_size, void** buf)
+{
+    const unsigned char* p = (const unsigned char*)*buf;
+    const unsigned char* end = p + nbytes;
+    unsigned long long n64;
+    size_t n, i, count, outsize;
+    char* out = NULL;
+    unsigned long long u[BITPACK_BLOCK];
+
+    if(nbytes < 8) return 0;
+    p = bp_getle(p,&n64,8);
+    n = (size_t)n64;
+    if(n64 != (unsigned long long)n || n > ((size_t)-1) / typesize) return 0;
+    outsize = n*typesize;
+    if((out = (char*)malloc(outsize > 0 ? outsize : 1)) == NULL) return 0;
+    for(i=0;i<n;i+=count) {
+        unsigned long long umin;
+        unsigned nbits;
+        size_t j, packed;
+        count = (n - i < BITPACK_BLOCK ? n - i : BITPACK_BLOCK);
+        if((size_t)(end - p) < 1 + typesize) goto fail;
+        nbits = *p++;
+        if(nbits > 8*typesize || (nbits > BITPACK_MAXBITS && nbits != 64)) goto fail;
+        p = bp_getle(p,&umin,typesize);
+        packed = (nbits == 64 ? 8*count : (count*nbits + 7) / 8);
+        if((size_t)(end - p) < packed) goto fail;
+        p = bp_unpack(p,end,u,count,nbits);
+        for(j=0;j<count;j++) u[j] += umin;
+        bp_store(out + i*typesize,typesize,bias,count,u);
+    }
+    free(*buf);
+    *buf = out;
+    *buf_size = outsize;
+    return outsize;
+fail:
+    free(out);
+    return 0;
+}
+
+static size_t
+H5Z_filter_bitpack(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes, size_t* buf_size, void** buf)
+{
+    size_t typesize;
+    unsigned long long bias = 0;
+
+    if(cd_nelmts < 2) return 0;
+    typesize = cd_values[0];
+    if(typesize != 1 && typesize != 2 && typesize != 4 && typesize != 8) return 0;
+    if(cd_values[1]) bias = 1ULL << (8*typesize - 1);
+    if(flags & H5Z_FLAG_REVERSE)
+        return bitpack_decode(typesize,bias,nbytes,buf_size,buf);
+    if(nbytes % typesize) return 0;
+    return bitpack_encode(typesize,bias,nbytes,buf_size,buf);
+}
+
+/**************************************************/
+/* fixedscaleoffset codec */
+
+/* The visible and the working parameters are
+    [0] astype: the nc_type of the encoded values
+    [1,2] offset (a double)
+    [3,4] scale (a double)
+    [5] dtype: the nc_type of the variable; set by modify_parameters
+*/
+#define FSO_NPARAMS 6
+
+static int
+NCZ_fixedscaleoffset_codec_to_hdf5(const char* codec_json, size_t* nparamsp, unsigned** paramsp)
+{
+    int stat = NC_NOERR;
+    NCjson* jcodec = NULL;
+    NCjson* jtmp = NULL;
+    unsigned* params = NULL;
+    struct NCJconst jc;
+    nc_type dtype, astype;
+    size_t size;
+    int issigned;
+
+    if(nparamsp == NULL || paramsp == NULL)
+        {stat = NC_EINTERNAL; goto done;}
+    if((stat = codec_parse(codec_json,NCZ_fixedscaleoffset_codec.codecid,&jcodec))) goto done;
+    if((params = (unsigned*)calloc(FSO_NPARAMS,sizeof(unsigned)))== NULL)
+        {stat = NC_ENOMEM; goto done;}
+    if((stat = codec_dtype(jcodec,"dtype",&dtype))) goto done;
+    if((stat = codec_dtype(jcodec,"astype",&astype))) goto done;
+    if(astype == NC_NAT) astype = dtype;
+    if(numtypesize(dtype) == 0 || !inttype(astype,&size,&issigned))
+        {stat = NC_EFILTER; goto done;}
+    params[0] = (unsigned)astype;
+    params[5] = (unsigned)dtype;
+    /* Get offset */
+    if(NCJdictget(jcodec,"offset",&jtmp) || jtmp == NULL)
+        {stat = NC_EFILTER; goto done;}
+    if(NCJcvt(jtmp,NCJ_DOUBLE,&jc))
+        {stat = NC_EFILTER; goto done;}
+    double_to_params(jc.dval,&params[1]);
+    /* Get scale */
+    if(NCJdictget(jcodec,"scale",&jtmp) || jtmp == NULL)
+        {stat = NC_EFILTER; goto done;}
+    if(NCJcvt(jtmp,NCJ_DOUBLE,&jc))
+        {stat = NC_EFILTER; goto done;}
+    double_to_params(jc.dval,&params[3]);
+    *nparamsp = FSO_NPARAMS;
+    *paramsp = params; params = NULL;
+
+done:
+    nullfree(params);
+    NCJreclaim(jcodec);
+    return stat;
+}
+
+static int
+NCZ_fixedscaleoffset_hdf5_to_codec(size_t nparams, const unsigned* params, char** codecp)
+{
+    int stat = NC_NOERR;
+    char json[1024];
+    char offset[64], scale[64];
+    char* dtype = NULL;
+    char* astype = NULL;
+
+    if(nparams < FSO_NPARAMS || params == NULL)
+        {stat = NC_EFILTER; goto done;}
+    if((stat = type_dtype(params[0],&astype))) goto done;
+    if((stat = type_dtype(params[5],&dtype))) goto done;
+    format_double(params_to_double(&params[1]),offset,sizeof(offset));
+    format_double(params_to_double(&params[3]),scale,sizeof(scale));
+    snprintf(json,sizeof(json),"{\"id\": \"%s\", \"offset\": %s, \"scale\": %s, \"dtype\": \"%s\", \"astype\": \"%s\"}",
+             NCZ_fixedscaleoffset_codec.codecid,offset,scale,dtype,astype);
+    if(codecp) {
+        if((*codecp = strdup(json))==NULL) {stat = NC_ENOMEM; goto done;}
+    }
+
+done:
+    nullfree(dtype);
+    nullfree(astype);
+    return stat;
+}
+
+static int
+NCZ_fixedscaleoffset_modify_parameters(int ncid, int varid, size_t* vnparamsp, unsigned** vparamsp, size_t* wnparamsp, unsigned** wparamsp)
+{
+    int stat = NC_NOERR;
+    nc_type vtype;
+    size_t size;
+    int issigned;
+    double offset, scale;
+    unsigned* vparams = NULL;
+    unsigned* wparams = NULL;
+
+    if(!vnparamsp || !vparamsp || !wnparamsp || !wparamsp)
+        {stat = NC_EINTERNAL; goto done;}
+    /* nc_def_var_filter passes astype, offset and scale; a codec also has dtype */
+    if(*vnparamsp < FSO_NPARAMS-1 || *vnparamsp > FSO_NPARAMS)
+        {stat = NC_EFILTER; goto done;}
+    if((stat = nc_inq_vartype(ncid,varid,&vtype))) goto done;
+    if(numtypesize(vtype) == 0) {stat = NC_EFILTER; goto done;}
+    if(*vnparamsp == FSO_NPARAMS && (*vparamsp)[5] != (unsigned)vtype)
+        {stat = NC_EFILTER; goto done;}
+    if(!inttype((nc_type)(*vparamsp)[0],&size,&issigned))
+        {stat = NC_EFILTER; goto done;}
+    offset = params_to_double(&(*vparamsp)[1]);
+    scale = params_to_double(&(*vparamsp)[3]);
+    if(!isfinite(offset) || !isfinite(scale) || scale == 0)
+        {stat = NC_EFILTER; goto done;}
+
+    if((vparams = (unsigned*)malloc(FSO_NPARAMS*sizeof(unsigned)))==NULL
+       || (wparams = (unsigned*)malloc(FSO_NPARAMS*sizeof(unsigned)))==NULL)
+        {stat = NC_ENOMEM; goto done;}
+    memcpy(vparams,*vparamsp,(FSO_NPARAMS-1)*sizeof(unsigned));
+    vparams[5] = (unsigned)vtype;
+    memcpy(wparams,vparams,FSO_NPARAMS*sizeof(unsigned));
+
+    nullfree(*vparamsp);
+    *vnparamsp = FSO_NPARAMS; *vparamsp = vparams; vparams = NULL;
+    nullfree(*wparamsp);
+    *wnparamsp = FSO_NPARAMS; *wparamsp = wparams; wparams = NULL;
+
+done:
+    nullfree(vparams);
+    nullfree(wparams);
+    return stat;
+}
+
+/* Convert a block of values to doubles and back. Integer results are
+   clamped to the range of their type; NaN becomes 0. */
+#define FSO_LOAD(T) {const T* s = (const T*)src; for(i=0;i<n;i++) d[i] = (double)s[i];} break
+#define FSO_STORE(T) {T* o = (T*)dst; for(i=0;i<n;i++) o[i] = (T)d[i];} break
+#define FSO_CLAMP(T,lo,hi) {T* o = (T*)dst; for(i=0;i<n;i++) { \
+    double v = d[i]; \
+    o[i] = (v != v ? (T)0 : (v <= (double)(lo) ? (T)(lo) : (v >= (double)(hi) ? (T)(hi) : (T)v))); \
+    }} break
+
+static void
+fso_load(const void* src, nc_type type, size_t n, double* d)
+{
+    size_t i;
+    switch (type) {
+    case NC_BYTE: FSO_LOAD(signed char);
+    case NC_UBYTE: FSO_LOAD(unsigned char);
+    case NC_SHORT: FSO_LOAD(short);
+    case NC_USHORT: FSO_LOAD(unsigned short);
+    case NC_INT: FSO_LOAD(int);
+    case NC_UINT: FSO_LOAD(unsigned int);
+    case NC_INT64: FSO_LOAD(long long);
+    case NC_UINT64: FSO_LOAD(unsigned long long);
+    case NC_FLOAT: FSO_LOAD(float);
+    case NC_DOUBLE: FSO_LOAD(double);
+    default: break;
+    }
+}
+
+static void
+fso_store(void* dst, nc_type type, size_t n, const double* d)
+{
+    size_t i;
+    switch (type) {
+    case NC_BYTE: FSO_CLAMP(signed char,SCHAR_MIN,SCHAR_MAX);
+    case NC_UBYTE: FSO_CLAMP(unsigned char,0,UCHAR_MAX);
+    case NC_SHORT: FSO_CLAMP(short,SHRT_MIN,SHRT_MAX);
+    case NC_USHORT: FSO_CLAMP(unsigned short,0,USHRT_MAX);
+    case NC_INT: FSO_CLAMP(int,INT_MIN,INT_MAX);
+    case NC_UINT: FSO_CLAMP(unsigned int,0,UINT_MAX);
+    case NC_INT64: FSO_CLAMP(long long,LLONG_MIN,LLONG_MAX);
+    case NC_UINT64: FSO_CLAMP(unsigned long long,0,ULLONG_MAX);
+    case NC_FLOAT: FSO_STORE(float);
+    case NC_DOUBLE: FSO_STORE(double);
+    default: break;
+    }
+}
+
+static size_t
+H5Z_filter_fixedscaleoffset(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes, size_t* buf_size, void** buf)
+{
+    nc_type astype, dtype, intype, outtype;
+    size_t insize, outsize, n, i, j, count;
+    double offset, scale;
+    char* out = NULL;
+    double d[FSO_BLOCK];
+
+    if(cd_nelmts < FSO_NPARAMS) return 0;
+    astype = (nc_type)cd_values[0];
+    dtype = (nc_type)cd_values[5];
+    offset = params_to_double(&cd_values[1]);
+    scale = params_to_double(&cd_values[3]);
+    if(numtypesize(astype) == 0 || numtypesize(dtype) == 0) return 0;
+    if(flags & H5Z_FLAG_REVERSE) {
+        intype = astype; outtype = dtype;
+    } else {
+        intype = dtype; outtype = astype;
+    }
+    insize = numtypesize(intype);
+    outsize = numtypesize(outtype);
+    if(nbytes % insize) return 0;
+    n = nbytes / insize;
+    if((out = (char*)malloc(n > 0 ? n*outsize : 1)) == NULL) return 0;
+    for(i=0;i<n;i+=count) {
+        count = (n - i < FSO_BLOCK ? n - i : FSO_BLOCK);
+        fso_load((const char*)*buf + i*insize,intype,count,d);
+        if(flags & H5Z_FLAG_REVERSE) {
+            for(j=0;j<count;j++) d[j] = d[j] / scale + offset;
+        } else {
+            for(j=0;j<count;j++) d[j] = rint((d[j] - offset) * scale);
+        }
+        fso_store(out + i*outsize,outtype,count,d);
+    }
+    free(*buf);
+    *buf = out;
+    *buf_size = (n > 0 ? n*outsize : 1);
+    return n*outsize;
+}
+
+#endif /*ENABLE_NCZARR_FILTERS*/
@@ -248,6 +248,9 @@ printfilter(const NCZ_Filter* f)
 
 
 /* Forward */
+#ifdef ENABLE_NCZARR_FILTERS
+static int NCZ_load_builtin_plugins(void);
+#endif
 static int NCZ_load_all_plugins(void);
 static int NCZ_load_plugin_dir(const char* path);
 static int NCZ_load_plugin(const char* path, NCZ_Plugin** plugp);
@@ -754,6 +757,8 @@ NCZ_filter_initialize(void)
     NCZ_filter_initialized = 1;
     memset(loaded_plugins,0,sizeof(loaded_plugins));
 #ifdef ENABLE_NCZARR_FILTERS
+    /* Load the built-in filters first, so they take precedence over plugins with the same id */
+    if((stat = NCZ_load_builtin_plugins())) goto done;
     if((stat = NCZ_load_all_plugins())) goto done;
 #endif
 
@@ -862,6 +867,9 @@ NCZ_applyfilterchain(const NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, NClist* cha
 	size_t next_alloc = 0;
 	void* next_buf = NULL;
 	size_t next_used = 0;
+#ifdef ENABLE_IOSTATS
+	NCIOSTAT_TIMER(t0);
+#endif
 
 #ifdef DEBUG
 fprintf(stderr,">>> current: alloc=%u used=%u buf=%p\n",(unsigned)current_alloc,(unsigned)current_used,current_buf);
@@ -911,6 +919,20 @@ fprintf(stderr,">>> current: alloc=%u used=%u buf=%p\n",(unsigned)current_alloc,
 	/* return results */
 	if(outlenp) {*outlenp = current_used;} /* or should it be current_alloc? */
 	if(outdatap) {*outdatap = current_buf;}
+#ifdef ENABLE_IOSTATS
+	{
+	    NC* nc = (NC*)file->controller;
+	    int ncid = nc->ext_ncid | var->container->hdr.id;
+	    double elapsed = NC_iostats_now() - t0;
+	    if(encode) {
+		NCIOSTAT_VARADD(nc,ncid,var->hdr.id,filter_encodes,1);
+		NCIOSTAT_VARADD(nc,ncid,var->hdr.id,filter_encode_time,elapsed);
+	    } else {
+		NCIOSTAT_VARADD(nc,ncid,var->hdr.id,filter_decodes,1);
+		NCIOSTAT_VARADD(nc,ncid,var->hdr.id,filter_decode_time,elapsed);
+	    }
+	}
+#endif
     }
 
 done:
@@ -1142,6 +1164,29 @@ done:
 }
 #endif /*_WIN32*/
 
+#ifdef ENABLE_NCZARR_FILTERS
+/* Make the filters of zcodecs.c available; they need no shared library */
+static int
+NCZ_load_builtin_plugins(void)
+{
+    int stat = NC_NOERR;
+    const NCZ_Builtin* b;
+    NCZ_Plugin* plugin = NULL;
+
+    ZTRACE(6,"");
+    for(b=NCZ_builtin_codecs;b->filter != NULL;b++) {
+	if((plugin = (NCZ_Plugin*)calloc(1,sizeof(NCZ_Plugin)))==NULL) {stat = NC_ENOMEM; goto done;}
+	plugin->hdf5.filter = b->filter;
+	plugin->codec.codec = b->codec;
+	if((stat = NCZ_plugin_save(b->filter->id,plugin))) goto done;
+	plugin = NULL;
+    }
+done:
+    nullfree(plugin);
+    return ZUNTRACE(stat);
+}
+#endif /*ENABLE_NCZARR_FILTERS*/
+
 static int
 NCZ_load_all_plugins(void)
 {
@@ -39,4 +39,14 @@ int NCZ_filter_jsonize(const NC_FILE_INFO_T*, const NC_VAR_INFO_T*, struct NCZ_F
 int NCZ_filter_build(const NC_FILE_INFO_T*, NC_VAR_INFO_T* var, const NCjson* jfilter, int chainindex);
 int NCZ_codec_attr(const NC_VAR_INFO_T* var, size_t* lenp, void* data);
 
+/* zcodecs.c */
+/* A filter built into libnczarr */
+typedef struct NCZ_Builtin {
+    const struct H5Z_class2_t* filter;
+    const struct NCZ_codec_t* codec;
+} NCZ_Builtin;
+
+/* Terminated by an entry with a NULL filter */
+extern const NCZ_Builtin NCZ_builtin_codecs[];
+
 #endif /*ZFILTER_H*/
@@ -46,6 +46,8 @@ extern "C" {
 #include "ncrc.h"
 #include "ncindex.h"
 #include "ncjson.h"
+#include "nciostats.h"
+#include "ncarena.h"
 
 #include "zmap.h"
 #include "zinternal.h"
@@ -55,6 +55,8 @@ NCZ_initialize_internal(void)
 {
     int stat = NC_NOERR;
     char* dimsep = NULL;
+    const char* nthreads = NULL;
+    const char* empty = NULL; /* write_empty_chunks */
     NCglobalstate* ngs = NULL;
 
     ncz_initialized = 1;
@@ -68,6 +70,17 @@ NCZ_initialize_internal(void)
 	    if(dimsep != NULL && strlen(dimsep) == 1 && islegaldimsep(dimsep[0]))
 		ngs->zarr.dimension_separator = dimsep[0];
         }    
+	ngs->zarr.prefetch_threads = DFALT_PREFETCH_THREADS;
+        nthreads = NC_rclookup("ZARR.PREFETCH_THREADS",NULL,NULL);
+        if(nthreads != NULL) {
+	    int n = 0;
+	    if(sscanf(nthreads,"%d",&n) == 1 && n >= 0)
+		ngs->zarr.prefetch_threads = n;
+        }
+	ngs->zarr.write_empty_chunks = 1;
+        empty = NC_rclookup("ZARR.WRITE_EMPTY_CHUNKS",NULL,NULL);
+        if(NCZ_isfalse(empty))
+	    ngs->zarr.write_empty_chunks = 0;
     }
 
     return stat;
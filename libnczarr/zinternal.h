@@ -94,11 +94,15 @@ Inserted into any .zattrs ? or should it go into the container?
 #define PUREZARRCONTROL "zarr"
 #define XARRAYCONTROL "xarray"
 #define NOXARRAYCONTROL "noxarray"
+#define EMPTYCHUNKSCONTROL "write_empty_chunks"
 #define XARRAYSCALAR "_scalar_"
 
 #define LEGAL_DIM_SEPARATORS "./"
 #define DFALT_DIM_SEPARATOR '.'
 
+/* Default # of threads used to read ahead the metadata objects of a group */
+#define DFALT_PREFETCH_THREADS 8
+
 /* Default max string length for fixed length strings */
 #define NCZ_MAXSTR_DEFAULT 128
 
@@ -152,6 +156,7 @@ typedef struct NCZ_FILE_INFO {
 #		define FLAG_LOGGING     4
 #		define FLAG_XARRAYDIMS  8
 #		define FLAG_NCZARR_V1   16
+#		define FLAG_NOEMPTYCHUNKS 32 /* do not store chunks holding only the fill value */
 	NCZM_IMPL mapimpl;
     } controls;
     int default_maxstrlen; /* default max str size for variables of type string */
@@ -196,6 +201,7 @@ typedef struct NCZ_VAR_INFO {
     char dimension_separator; /* '.' | '/' */
     NClist* incompletefilters;
     int maxstrlen; /* max length of strings for this variable */
+    struct NClist* plans; /* NClist<NCZPlan*>; recently used projections, most recent last */
 } NCZ_VAR_INFO_T;
 
 /* Struct to hold ZARR-specific info for a field. */
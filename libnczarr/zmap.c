@@ -5,7 +5,23 @@
 
 #include "zincludes.h"
 #include <stdarg.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 #include "ncpathmgr.h"
+#include "nchashmap.h"
+
+/* An object read ahead by nczmap_prefetch */
+typedef struct NCZprefetch {
+    char* key;
+    int stat; /* result of reading the object */
+    size64_t len;
+    char* content;
+} NCZprefetch;
+
+static void prefetchfree(NCZprefetch* entry);
+static void prefetchclear(NCZMAP* map);
+static void prefetchinvalidate(NCZMAP* map, const char* key);
 
 /**************************************************/
 /* Import the current implementations */
@@ -108,6 +124,173 @@ done:
     return THROW(stat);
 }
 
+/**************************************************/
+/* Concurrent read-ahead of metadata objects */
+
+#ifdef HAVE_PTHREAD_H
+typedef struct NCZprefetcher {
+    NCZMAP* map;
+    NCZprefetch** entries;
+    size_t nentries;
+    size_t next; /* next entry to read; protected by lock */
+    pthread_mutex_t lock;
+} NCZprefetcher;
+
+static void*
+prefetchworker(void* arg)
+{
+    NCZprefetcher* pf = (NCZprefetcher*)arg;
+    NCZMAP* map = pf->map;
+    for(;;) {
+	NCZprefetch* entry;
+	size_t i;
+	pthread_mutex_lock(&pf->lock);
+	i = pf->next++;
+	pthread_mutex_unlock(&pf->lock);
+	if(i >= pf->nentries) break;
+	entry = pf->entries[i];
+	/* Note: bypass the wrappers; statistics are collected by the caller */
+	if((entry->stat = map->api->len(map,entry->key,&entry->len)) != NC_NOERR)
+	    continue;
+	if((entry->content = (char*)malloc(entry->len+1)) == NULL)
+	    {entry->stat = NC_ENOMEM; continue;}
+	entry->stat = map->api->read(map,entry->key,0,entry->len,entry->content);
+	entry->content[entry->len] = '\0';
+    }
+    return NULL;
+}
+#endif /*HAVE_PTHREAD_H*/
+
+int
+nczmap_prefetch(NCZMAP* map, NClist* keys, int nthreads)
+{
+    int stat = NC_NOERR;
+#ifdef HAVE_PTHREAD_H
+    size_t i, nstarted = 0;
+    NCZprefetcher pf;
+    pthread_t* threads = NULL;
+
+    memset(&pf,0,sizeof(pf));
+    if(map == NULL || nthreads < 2 || nclistlength(keys) < 2)
+	goto done;
+    if((nczmap_features(map->format) & NCZM_CONCURRENTREAD) == 0)
+	goto done;
+    if(map->prefetched == NULL
+       && (map->prefetched = NC_hashmapnew(nclistlength(keys))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+
+    /* Collect the objects not already read ahead */
+    pf.map = map;
+    if((pf.entries = (NCZprefetch**)calloc(nclistlength(keys),sizeof(NCZprefetch*))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<nclistlength(keys);i++) {
+	const char* key = (const char*)nclistget(keys,i);
+	NCZprefetch* entry = NULL;
+	if(NC_hashmapget(map->prefetched,key,strlen(key),NULL)) continue;
+	if((entry = (NCZprefetch*)calloc(1,sizeof(NCZprefetch))) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	pf.entries[pf.nentries++] = entry;
+	if((entry->key = strdup(key)) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+    }
+    if(pf.nentries < 2) goto done;
+
+    if((size_t)nthreads > pf.nentries) nthreads = (int)pf.nentries;
+    if((threads = (pthread_t*)calloc((size_t)nthreads,sizeof(pthread_t))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    pthread_mutex_init(&pf.lock,NULL);
+    for(nstarted=0;nstarted<(size_t)nthreads;nstarted++) {
+	if(pthread_create(&threads[nstarted],NULL,prefetchworker,&pf) != 0)
+	    break;
+    }
+    if(nstarted == 0) /* could not start any thread; do it here */
+	(void)prefetchworker(&pf);
+    for(i=0;i<nstarted;i++)
+	pthread_join(threads[i],NULL);
+    pthread_mutex_destroy(&pf.lock);
+
+    /* Hand the results over to nczmap_prefetched */
+    for(i=0;i<pf.nentries;i++) {
+	NCZprefetch* entry = pf.entries[i];
+#ifdef ENABLE_IOSTATS
+	if(entry->stat == NC_NOERR) {
+	    NCIOSTAT_INCR(map->iostats,io_reads);
+	    NCIOSTAT_ADD(map->iostats,io_bytes_read,entry->len);
+	    if(map->format == NCZM_S3) {
+		NCIOSTAT_INCR(map->iostats,http_requests);
+		NCIOSTAT_ADD(map->iostats,http_bytes,entry->len);
+	    }
+	}
+#endif
+	NC_hashmapadd(map->prefetched,(uintptr_t)entry,entry->key,strlen(entry->key));
+	pf.entries[i] = NULL;
+    }
+
+done:
+    if(pf.entries != NULL) {
+	for(i=0;i<pf.nentries;i++) prefetchfree(pf.entries[i]);
+	free(pf.entries);
+    }
+    nullfree(threads);
+#else
+    NC_UNUSED(map);
+    NC_UNUSED(keys);
+    NC_UNUSED(nthreads);
+#endif /*HAVE_PTHREAD_H*/
+    return THROW(stat);
+}
+
+int
+nczmap_prefetched(NCZMAP* map, const char* key, size64_t* lenp, char** contentp)
+{
+    int stat = NC_NOERR;
+    uintptr_t data = 0;
+    NCZprefetch* entry = NULL;
+
+    if(map == NULL || map->prefetched == NULL
+       || !NC_hashmapremove(map->prefetched,key,strlen(key),&data))
+	return NC_ENOOBJECT;
+    entry = (NCZprefetch*)data;
+    if((stat = entry->stat) == NC_NOERR) {
+	if(lenp) *lenp = entry->len;
+	if(contentp) {*contentp = entry->content; entry->content = NULL;}
+    }
+    prefetchfree(entry);
+    return stat;
+}
+
+static void
+prefetchfree(NCZprefetch* entry)
+{
+    if(entry == NULL) return;
+    nullfree(entry->key);
+    nullfree(entry->content);
+    free(entry);
+}
+
+static void
+prefetchinvalidate(NCZMAP* map, const char* key)
+{
+    uintptr_t data = 0;
+    if(map->prefetched != NULL && NC_hashmapremove(map->prefetched,key,strlen(key),&data))
+	prefetchfree((NCZprefetch*)data);
+}
+
+static void
+prefetchclear(NCZMAP* map)
+{
+    size_t i;
+    if(map->prefetched == NULL) return;
+    for(i=0;i<map->prefetched->alloc;i++) {
+	uintptr_t data = 0;
+	const char* key = NULL;
+	if(NC_hashmapith(map->prefetched,i,&data,&key) == NC_NOERR && key != NULL)
+	    prefetchfree((NCZprefetch*)data);
+    }
+    NC_hashmapfree(map->prefetched);
+    map->prefetched = NULL;
+}
+
 /**************************************************/
 /* API Wrapper */
 
@@ -115,6 +298,7 @@ int
 nczmap_close(NCZMAP* map, int delete)
 {
     int stat = NC_NOERR;
+    if(map) prefetchclear(map);
     if(map && map->api)
         stat = map->api->close(map,delete);
     return THROW(stat);
@@ -135,15 +319,37 @@ nczmap_len(NCZMAP* map, const char* key, size64_t* lenp)
 int
 nczmap_read(NCZMAP* map, const char* key, size64_t start, size64_t count, void* content)
 {
+#ifdef ENABLE_IOSTATS
+    NCIOSTAT_INCR(map->iostats,io_reads);
+    NCIOSTAT_ADD(map->iostats,io_bytes_read,count);
+    if(map->format == NCZM_S3) {
+        NCIOSTAT_INCR(map->iostats,http_requests);
+        NCIOSTAT_ADD(map->iostats,http_bytes,count);
+    }
+#endif
     return map->api->read(map, key, start, count, content);
 }
 
 int
 nczmap_write(NCZMAP* map, const char* key, size64_t start, size64_t count, const void* content)
 {
+#ifdef ENABLE_IOSTATS
+    NCIOSTAT_INCR(map->iostats,io_writes);
+    NCIOSTAT_ADD(map->iostats,io_bytes_written,count);
+    if(map->format == NCZM_S3)
+        NCIOSTAT_INCR(map->iostats,http_requests);
+#endif
+    prefetchinvalidate(map,key);
     return map->api->write(map, key, start, count, content);
 }
 
+int
+nczmap_remove(NCZMAP* map, const char* key)
+{
+    prefetchinvalidate(map,key);
+    return map->api->remove(map, key);
+}
+
 /* Define a static qsort comparator for strings for use with qsort */
 static int
 cmp_strings(const void* a1, const void* a2)
@@ -164,6 +164,7 @@ typedef size64_t NCZM_FEATURES;
 #define NCZM_UNIMPLEMENTED 1 /* Unknown/ unimplemented */
 #define NCZM_WRITEONCE 2     /* Objects can only be written once */
 #define NCZM_ZEROSTART 4     /* Objects can only be written using a start count of zero */
+#define NCZM_CONCURRENTREAD 8 /* len and read may be called concurrently from several threads */
 
 /*
 For each dataset, we create what amounts to a class
@@ -183,6 +184,10 @@ typedef struct NCZMAP {
     int mode;
     size64_t flags; /* Passed in by caller */
     struct NCZMAP_API* api;
+#ifdef ENABLE_IOSTATS
+    struct nc_io_stats_t* iostats; /* file level counters; may be NULL */
+#endif
+    struct NC_hashmap* prefetched; /* objects read ahead by nczmap_prefetch; may be NULL */
 } NCZMAP;
 
 /* zmap_s3sdk related-types and constants */
@@ -202,6 +207,7 @@ struct NCZMAP_API {
 	int (*read)(NCZMAP* map, const char* key, size64_t start, size64_t count, void* content);
 	int (*write)(NCZMAP* map, const char* key, size64_t start, size64_t count, const void* content);
         int (*search)(NCZMAP* map, const char* prefix, struct NClist* matches);
+	int (*remove)(NCZMAP* map, const char* key);
 };
 
 /* Define the Dataset level API */
@@ -287,6 +293,16 @@ Note that this makes the key a content-bearing object.
 */
 EXTERNL int nczmap_write(NCZMAP* map, const char* key, size64_t start, size64_t count, const void* content);
 
+/**
+Remove a content-bearing object.
+@param map -- the containing map
+@param key -- the key specifying the content-bearing object
+@return NC_NOERR if the operation succeeded
+@return NC_EEMPTY if the object did not exist
+@return NC_EXXX if the operation failed for one of several possible reasons
+*/
+EXTERNL int nczmap_remove(NCZMAP* map, const char* key);
+
 /**
 Return a vector of names (not keys) representing the
 next segment of legal objects that are immediately contained by the prefix key.
@@ -298,6 +314,33 @@ next segment of legal objects that are immediately contained by the prefix key.
 */
 EXTERNL int nczmap_search(NCZMAP* map, const char* prefix, struct NClist* matches);
 
+/**
+Read a set of (small) objects concurrently and keep their content
+until claimed by nczmap_prefetched(). This is a no-op if the map
+implementation does not support concurrent reads or if threads
+are not available.
+@param map -- the containing map
+@param keys -- NClist<char*> of the keys of the objects to read
+@param nthreads -- maximum number of threads to use
+@return NC_NOERR if the operation succeeded; individual read failures
+        are reported by nczmap_prefetched()
+@return NC_EXXX if the operation failed for one of several possible reasons
+*/
+EXTERNL int nczmap_prefetch(NCZMAP* map, struct NClist* keys, int nthreads);
+
+/**
+Claim the content of an object read by nczmap_prefetch().
+@param map -- the containing map
+@param key -- the key specifying the object
+@param sizep -- the object's size is returned thru this pointer.
+@param contentp -- return the (nul terminated) content; caller frees
+@return NC_NOERR if the object was read ahead
+@return NC_ENOOBJECT if the object was not read ahead
+@return NC_EEMPTY if the object does not exist
+@return NC_EXXX if reading the object failed
+*/
+EXTERNL int nczmap_prefetched(NCZMAP* map, const char* key, size64_t* sizep, char** contentp);
+
 /**
 Close a map
 @param map -- the map to close
@@ -120,6 +120,7 @@ typedef struct ZFMAP {
 /* Forward */
 static NCZMAP_API zapi;
 static int zfileclose(NCZMAP* map, int delete);
+static int zfileremove(NCZMAP* map, const char* key);
 static int zfcreategroup(ZFMAP*, const char* key, int nskip);
 static int zflookupobj(ZFMAP*, const char* key, FD* fd);
 static int zfparseurl(const char* path0, NCURI** urip);
@@ -404,7 +405,18 @@ zfilewrite(NCZMAP* map, const char* key, size64_t start, size64_t count, const v
         assert(!"expected file, have dir");
 #endif
 
-    switch (stat = zflookupobj(zfmap,key,&fd)) {
+    stat = zflookupobj(zfmap,key,&fd);
+    if(stat == NC_NOERR && start == 0) {
+	/* Rewriting the whole object: do not leave the tail of longer old content */
+	size64_t len = 0;
+	if((stat = platformseek(zfmap, &fd, SEEK_END, &len))) goto done;
+	if(len > count) {
+	    zfrelease(zfmap,&fd);
+	    if((stat = zfileremove(map,key))) goto done;
+	    stat = NC_EEMPTY;
+	}
+    }
+    switch (stat) {
     case NC_ENOOBJECT:
     case NC_EEMPTY:
 	stat = NC_NOERR;
@@ -428,6 +440,29 @@ done:
     return ZUNTRACE(stat);
 }
 
+static int
+zfileremove(NCZMAP* map, const char* key)
+{
+    int stat = NC_NOERR;
+    ZFMAP* zfmap = (ZFMAP*)map; /* cast to true type */
+    char* truepath = NULL;
+    char* local = NULL;
+
+    ZTRACE(5,"map=%s key=%s",map->url,key);
+
+    if((stat = zffullpath(zfmap,key,&truepath))) goto done;
+    if((local = NCpathcvt(truepath))==NULL) {stat = NC_ENOMEM; goto done;}
+    errno = 0;
+    if(unlink(local) < 0)
+	stat = (errno == ENOENT ? NC_EEMPTY : platformerr(errno));
+    errno = 0;
+
+done:
+    nullfree(local);
+    nullfree(truepath);
+    return ZUNTRACE(stat);
+}
+
 static int
 zfileclose(NCZMAP* map, int delete)
 {
@@ -583,7 +618,7 @@ zfrelease(ZFMAP* zfmap, FD* fd)
 
 NCZMAP_DS_API zmap_file = {
     NCZM_FILE_V1,
-    0,
+    NCZM_CONCURRENTREAD,
     zfilecreate,
     zfileopen,
 };
@@ -596,6 +631,7 @@ static NCZMAP_API zapi = {
     zfileread,
     zfilewrite,
     zfilesearch,
+    zfileremove,
 };
 
 static int
@@ -38,7 +38,7 @@ Notes:
 
 #define NCZM_S3SDK_V1 1
 
-#define ZS3_PROPERTIES (0)
+#define ZS3_PROPERTIES (NCZM_CONCURRENTREAD)
 
 /* Define the "subclass" of NCZMAP */
 typedef struct ZS3MAP {
@@ -51,6 +51,7 @@ typedef struct ZS3MAP {
 /* Forward */
 static NCZMAP_API nczs3sdkapi; // c++ will not allow static forward variables
 static int zs3len(NCZMAP* map, const char* key, size64_t* lenp);
+static int zs3remove(NCZMAP* map, const char* key);
 
 static void freevector(size_t nkeys, char** list);
 
@@ -80,8 +81,18 @@ reporterr(ZS3MAP* z3map)
 	errclear(z3map);
     }
 }
+
+/* Variant for an error message local to one (possibly concurrent) call */
+static void
+reportlocalerr(char** errmsgp)
+{
+    if(*errmsgp) nclog(NCLOGERR,*errmsgp);
+    nullfree(*errmsgp);
+    *errmsgp = NULL;
+}
 #else
 #define reporterr(map)
+#define reportlocalerr(errmsgp) do{nullfree(*(errmsgp)); *(errmsgp) = NULL;}while(0)
 #endif
 
 /* Define the Dataset level API */
@@ -268,12 +279,13 @@ zs3len(NCZMAP* map, const char* key, size64_t* lenp)
     int stat = NC_NOERR;
     ZS3MAP* z3map = (ZS3MAP*)map;
     char* truekey = NULL;
+    char* errmsg = NULL; /* local so that len may be called concurrently */
 
     ZTRACE(6,"map=%s key=%s",map->url,key);
 
     if((stat = maketruekey(z3map->s3.rootkey,key,&truekey))) goto done;
 
-    switch (stat = NC_s3sdkinfo(z3map->s3client,z3map->s3.bucket,truekey,lenp,&z3map->errmsg)) {
+    switch (stat = NC_s3sdkinfo(z3map->s3client,z3map->s3.bucket,truekey,lenp,&errmsg)) {
     case NC_NOERR: break;
     case NC_EEMPTY:
 	if(lenp) *lenp = 0;
@@ -283,7 +295,7 @@ zs3len(NCZMAP* map, const char* key, size64_t* lenp)
     }
 done:
     nullfree(truekey);
-    reporterr(z3map);
+    reportlocalerr(&errmsg);
     return ZUNTRACE(stat);
 }
 
@@ -299,12 +311,13 @@ zs3read(NCZMAP* map, const char* key, size64_t start, size64_t count, void* cont
     ZS3MAP* z3map = (ZS3MAP*)map; /* cast to true type */
     size64_t size = 0;
     char* truekey = NULL;
+    char* errmsg = NULL; /* local so that read may be called concurrently */
     
     ZTRACE(6,"map=%s key=%s start=%llu count=%llu",map->url,key,start,count);
 
     if((stat = maketruekey(z3map->s3.rootkey,key,&truekey))) goto done;
     
-    switch (stat=NC_s3sdkinfo(z3map->s3client, z3map->s3.bucket, truekey, &size, &z3map->errmsg)) {
+    switch (stat=NC_s3sdkinfo(z3map->s3client, z3map->s3.bucket, truekey, &size, &errmsg)) {
     case NC_NOERR: break;
     case NC_EEMPTY: goto done;
     default: goto done; 	
@@ -313,12 +326,12 @@ zs3read(NCZMAP* map, const char* key, size64_t start, size64_t count, void* cont
     if(start >= size || start+count > size)
         {stat = NC_EEDGE; goto done;}
     if(count > 0)  {
-        if((stat = NC_s3sdkread(z3map->s3client, z3map->s3.bucket, truekey, start, count, content, &z3map->errmsg)))
+        if((stat = NC_s3sdkread(z3map->s3client, z3map->s3.bucket, truekey, start, count, content, &errmsg)))
             goto done;
     }
 done:
     nullfree(truekey);
-    reporterr(z3map);
+    reportlocalerr(&errmsg);
     return ZUNTRACE(stat);
 }
 
@@ -409,6 +422,29 @@ zs3close(NCZMAP* map, int deleteit)
     return ZUNTRACE(stat);
 }
 
+/*
+Remove an object; S3 reports success whether or not the object existed.
+@return NC_NOERR if success
+@return NC_EXXX return true error
+*/
+static int
+zs3remove(NCZMAP* map, const char* key)
+{
+    int stat = NC_NOERR;
+    ZS3MAP* z3map = (ZS3MAP*)map; /* cast to true type */
+    char* truekey = NULL;
+
+    ZTRACE(6,"map=%s key=%s",map->url,key);
+
+    if((stat = maketruekey(z3map->s3.rootkey,key,&truekey))) goto done;
+    if((stat = NC_s3sdkdeletekey(z3map->s3client, z3map->s3.bucket, truekey, &z3map->errmsg)))
+	reporterr(z3map);
+
+done:
+    nullfree(truekey);
+    return ZUNTRACE(stat);
+}
+
 /*
 Return a list of full keys immediately "below" a specified prefix,
 but not including the prefix.
@@ -579,4 +615,5 @@ nczs3sdkapi = {
     zs3read,
     zs3write,
     zs3search,
+    zs3remove,
 };
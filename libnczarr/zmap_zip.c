@@ -52,6 +52,19 @@ For the object API, the mapping is as follows:
 /* define the var name containing an objects content */
 #define ZCONTENT "data"
 
+typedef zip_int64_t ZINDEX;;    
+
+/* Limits on the cache of decompressed objects used for ranged reads */
+#define ZZCACHESIZE 4 /* max no. of objects */
+#define ZZCACHEMAX (16*1024*1024) /* max total bytes */
+
+/* A decompressed object */
+typedef struct ZZCACHED {
+    ZINDEX zindex;
+    size64_t len;
+    char* data;
+} ZZCACHED;
+
 /* Define the "subclass" of NCZMAP */
 typedef struct ZZMAP {
     NCZMAP map;
@@ -59,13 +72,14 @@ typedef struct ZZMAP {
     char* dataset; /* prefix for all keys in zip file */
     zip_t* archive;
     char** searchcache;
+    size_t ncached;
+    ZZCACHED cached[ZZCACHESIZE]; /* most recently used first */
 } ZZMAP;
 
-typedef zip_int64_t ZINDEX;;    
-
 /* Forward */
 static NCZMAP_API zapi;
 static int zipclose(NCZMAP* map, int delete);
+static int zipremove(NCZMAP* map, const char* key);
 static int zzcreategroup(ZZMAP*, const char* key, int nskip);
 static int zzlookupobj(ZZMAP*, const char* key, ZINDEX* fd);
 static int zzlen(ZZMAP* zzmap, ZINDEX zindex, size64_t* lenp);
@@ -73,6 +87,9 @@ static int zipmaperr(ZZMAP* zzmap);
 static int ziperr(zip_error_t* zerror);
 static int ziperrno(int zerror);
 static void freesearchcache(char** cache);
+static ZZCACHED* zzcachelookup(ZZMAP* zzmap, ZINDEX zindex);
+static void zzcacheinsert(ZZMAP* zzmap, ZINDEX zindex, size64_t len, char* data);
+static void zzcacheclear(ZZMAP* zzmap);
 
 static int zzinitialized = 0;
 
@@ -323,10 +340,11 @@ zipread(NCZMAP* map, const char* key, size64_t start, size64_t count, void* cont
     ZINDEX zindex = -1;
     zip_flags_t zipflags = 0;
     int zerrno;
-    size64_t endpoint;
     char* buffer = NULL;
-    char* truekey = NULL;
     zip_int64_t red = 0;
+    zip_stat_t statbuf;
+    ZZCACHED* cached = NULL;
+    int stored;
 
     ZTRACE(6,"map=%s key=%s start=%llu count=%llu",map->url,key,start,count);
 
@@ -336,38 +354,52 @@ zipread(NCZMAP* map, const char* key, size64_t start, size64_t count, void* cont
     case NC_EEMPTY: /* its a dir; fall thru*/
     default: goto done;
     }
-    
-    /* Note, assume key[0] == '/' */
-    if((stat = nczm_appendn(&truekey,2,zzmap->dataset,key)))
-        goto done;
 
-    zfile = zip_fopen(zzmap->archive, truekey, zipflags);
+    /* See if this object was decompressed recently */
+    if((cached = zzcachelookup(zzmap,zindex)) != NULL) {
+	if(start + count > cached->len) {stat = NC_EINTERNAL; goto done;}
+	memcpy(content,cached->data+start,count);
+	goto done;
+    }
+
+    zip_stat_init(&statbuf);
+    if(zip_stat_index(zzmap->archive,(zip_uint64_t)zindex,zipflags,&statbuf) < 0)
+        {stat = (zipmaperr(zzmap)); goto done;}
+    if(start + count > statbuf.size) {stat = NC_EINTERNAL; goto done;}
+    /* Is the object stored without compression or encryption? */
+    stored = ((statbuf.valid & ZIP_STAT_COMP_METHOD) && statbuf.comp_method == ZIP_CM_STORE
+	      && (!(statbuf.valid & ZIP_STAT_ENCRYPTION_METHOD) || statbuf.encryption_method == ZIP_EM_NONE));
+
+    zfile = zip_fopen_index(zzmap->archive, (zip_uint64_t)zindex, zipflags);
     if(zfile == NULL)
 	{stat = (zipmaperr(zzmap)); goto done;}
 
-    /* Ideally, we would like to seek to the start point,
-       but that will fail if the file is compressed, so
-       we need to read whole thing and extract what we need
+    /* A stored object can be read at any offset; a compressed one must
+       be decompressed from the start, so all of it is decompressed once
+       and cached for later ranged reads. An object too big to cache is
+       only decompressed up to the end of the range.
     */
-
-    /* read data starting at zero */
-    if(start == 0) { /*optimize to read directly into content */
+    if(start == 0 || (stored && zip_fseek(zfile, (zip_int64_t)start, SEEK_SET) == 0)) {
+	/* read directly into content */
         if((red = zip_fread(zfile, content, (zip_uint64_t)count)) < 0)
 	    {stat = (zipmaperr(zzmap)); goto done;}
 	if(red < count) {stat = NC_EINTERNAL; goto done;}
     } else {
-        endpoint = start + count;
-        if((buffer = malloc(endpoint))==NULL) /* consider caching this */
+	size64_t len = (statbuf.size > ZZCACHEMAX ? start + count : statbuf.size);
+        if((buffer = malloc(len))==NULL)
             {stat = NC_ENOMEM; goto done;}
-        if((red = zip_fread(zfile, buffer, (zip_uint64_t)endpoint)) < 0)
+        if((red = zip_fread(zfile, buffer, (zip_uint64_t)len)) < 0)
 	    {stat = (zipmaperr(zzmap)); goto done;}
-	if(red < endpoint) {stat = NC_EINTERNAL; goto done;}
+	if(red < len) {stat = NC_EINTERNAL; goto done;}
         /* Extract what we need */
         memcpy(content,buffer+start,count);
+	if(len == statbuf.size) {
+	    zzcacheinsert(zzmap,zindex,len,buffer);
+	    buffer = NULL;
+	}
     }
 
 done:
-    nullfree(truekey);
     nullfree(buffer);
     if(zfile != NULL && (zerrno=zip_fclose(zfile)) != 0)
         {stat = ziperrno(zerrno);}
@@ -436,6 +468,7 @@ zipwrite(NCZMAP* map, const char* key, size64_t start, size64_t count, const voi
 	{stat = zipmaperr(zzmap); goto done;}
 
     freesearchcache(zzmap->searchcache); zzmap->searchcache = NULL;
+    zzcacheclear(zzmap);
 
 done:
     if(zs) zip_source_free(zs);
@@ -472,6 +505,7 @@ zipclose(NCZMAP* map, int delete)
     nullfree(zzmap->dataset);
     zzmap->root = NULL;
     freesearchcache(zzmap->searchcache);
+    zzcacheclear(zzmap);
     free(zzmap);
     return ZUNTRACE(stat);
 }
@@ -711,6 +745,58 @@ freesearchcache(char** cache)
     free(cache);
 }
 
+/* Find a decompressed object and make it the most recently used */
+static ZZCACHED*
+zzcachelookup(ZZMAP* zzmap, ZINDEX zindex)
+{
+    size_t i;
+    for(i=0;i<zzmap->ncached;i++) {
+	if(zzmap->cached[i].zindex == zindex) {
+	    ZZCACHED found = zzmap->cached[i];
+	    memmove(&zzmap->cached[1],&zzmap->cached[0],i*sizeof(ZZCACHED));
+	    zzmap->cached[0] = found;
+	    return &zzmap->cached[0];
+	}
+    }
+    return NULL;
+}
+
+/* Keep a decompressed object, evicting the least recently used ones
+   to stay within ZZCACHESIZE objects and ZZCACHEMAX bytes;
+   takes ownership of data */
+static void
+zzcacheinsert(ZZMAP* zzmap, ZINDEX zindex, size64_t len, char* data)
+{
+    size64_t total = len;
+    size_t i;
+
+    if(len > ZZCACHEMAX) {free(data); return;}
+    for(i=0;i<zzmap->ncached;i++) total += zzmap->cached[i].len;
+    while(zzmap->ncached > 0 && (zzmap->ncached == ZZCACHESIZE || total > ZZCACHEMAX)) {
+	ZZCACHED* last = &zzmap->cached[--zzmap->ncached];
+	total -= last->len;
+	nullfree(last->data);
+	last->data = NULL;
+    }
+    memmove(&zzmap->cached[1],&zzmap->cached[0],zzmap->ncached*sizeof(ZZCACHED));
+    zzmap->cached[0].zindex = zindex;
+    zzmap->cached[0].len = len;
+    zzmap->cached[0].data = data;
+    zzmap->ncached++;
+}
+
+/* Discard all decompressed objects; used whenever the archive changes */
+static void
+zzcacheclear(ZZMAP* zzmap)
+{
+    size_t i;
+    for(i=0;i<zzmap->ncached;i++) {
+	nullfree(zzmap->cached[i].data);
+	zzmap->cached[i].data = NULL;
+    }
+    zzmap->ncached = 0;
+}
+
 /**************************************************/
 /* External API objects */
 
@@ -729,8 +815,31 @@ static NCZMAP_API zapi = {
     zipread,
     zipwrite,
     zipsearch,
+    zipremove,
 };
 
+static int
+zipremove(NCZMAP* map, const char* key)
+{
+    int stat = NC_NOERR;
+    ZZMAP* zzmap = (ZZMAP*)map; /* cast to true type */
+    ZINDEX zindex = -1;
+
+    ZTRACE(6,"map=%s key=%s",map->url,key);
+    switch(stat = zzlookupobj(zzmap,key,&zindex)) {
+    case NC_NOERR:
+	if(zip_delete(zzmap->archive,(zip_uint64_t)zindex) < 0)
+	    {stat = zipmaperr(zzmap); goto done;}
+	freesearchcache(zzmap->searchcache); zzmap->searchcache = NULL;
+	zzcacheclear(zzmap);
+	break;
+    case NC_ENOOBJECT: stat = NC_EEMPTY; break;
+    default: break; /* includes NC_EEMPTY for a directory */
+    }
+done:
+    return ZUNTRACE(stat);
+}
+
 static int
 zipmaperr(ZZMAP* zzmap)
 {
@@ -40,10 +40,20 @@ nczodom_new(int rank, const size64_t* start, const size64_t* stop, const size64_
 NCZOdometer*
 nczodom_fromslices(int rank, const NCZSlice* slices)
 {
-    size_t i;
     NCZOdometer* odom = NULL;
 
     if(buildodom(rank,&odom)) return NULL;
+    nczodom_setslices(odom,slices);
+    return odom;
+}
+
+/* Reinitialize an odometer from a new set of slices of the same rank */
+void
+nczodom_setslices(NCZOdometer* odom, const NCZSlice* slices)
+{
+    size_t i;
+    int rank = odom->rank;
+
     odom->properties.stride1 = 1; /* assume */
     odom->properties.start0 = 1; /* assume */
     for(i=0;i<rank;i++) {    
@@ -59,7 +69,6 @@ nczodom_fromslices(int rank, const NCZSlice* slices)
         assert(slices[i].stop >= slices[i].start && slices[i].stride > 0);
         assert((slices[i].stop - slices[i].start) <= slices[i].len);
     }
-    return odom;
 }
   
 void
@@ -26,6 +26,7 @@ typedef struct NCZOdometer {
 /* From zodom.c */
 extern NCZOdometer* nczodom_new(int rank, const size64_t*, const size64_t*, const size64_t*, const size64_t*);
 extern NCZOdometer* nczodom_fromslices(int rank, const struct NCZSlice* slices);
+extern void nczodom_setslices(NCZOdometer* odom, const struct NCZSlice* slices);
 extern int nczodom_more(const NCZOdometer*);
 extern void nczodom_next(NCZOdometer*);
 extern size64_t* nczodom_indices(const NCZOdometer*);
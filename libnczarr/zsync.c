@@ -27,6 +27,7 @@ static int computeattrinfo(const char* name, NClist* atypes, nc_type typehint, i
 static int parse_group_content(NCjson* jcontent, NClist* dimdefs, NClist* varnames, NClist* subgrps);
 static int parse_group_content_pure(NCZ_FILE_INFO_T*  zinfo, NC_GRP_INFO_T* grp, NClist* varnames, NClist* subgrps);
 static int define_grp(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp);
+static int prefetch_grp(NC_FILE_INFO_T* file, const char* grppath, NClist* varnames, NClist* subgrps, int purezarr);
 static int define_dims(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* diminfo);
 static int define_vars(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* varnames);
 static int define_subgrps(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* subgrpnames);
@@ -1127,6 +1128,63 @@ done:
     return ZUNTRACE(THROW(stat));
 }
 
+/**
+ * @internal Read ahead the metadata objects that will be
+ * needed to define the variables and subgroups of a group.
+ * The objects are read concurrently (if the map supports it)
+ * and are then claimed one by one by NCZ_downloadjson.
+ *
+ * @param file Pointer to file struct
+ * @param grppath Key of the group
+ * @param varnames Names of the group's variables
+ * @param subgrps Names of the group's subgroups
+ * @param purezarr 1 => pure zarr
+ *
+ * @return ::NC_NOERR No error.
+ */
+static int
+prefetch_grp(NC_FILE_INFO_T* file, const char* grppath, NClist* varnames, NClist* subgrps, int purezarr)
+{
+    int i, stat = NC_NOERR;
+    NCZ_FILE_INFO_T* zinfo = file->format_file_info;
+    NCglobalstate* ngs = NC_getglobalstate();
+    NClist* keys = NULL;
+    char* objpath = NULL;
+    char* key = NULL;
+
+    if(ngs->zarr.prefetch_threads <= 1) goto done;
+    if(nclistlength(varnames) + nclistlength(subgrps) < 2) goto done;
+
+    keys = nclistnew();
+    for(i=0;i<nclistlength(varnames);i++) {
+	if((stat = nczm_concat(grppath,(const char*)nclistget(varnames,i),&objpath))) goto done;
+	if((stat = nczm_concat(objpath,ZARRAY,&key))) goto done;
+	nclistpush(keys,key); key = NULL;
+	/* Attributes are otherwise read lazily; but pure zarr
+	   needs them to get the xarray dimensions */
+	if(purezarr && (zinfo->controls.flags & FLAG_XARRAYDIMS)) {
+	    if((stat = nczm_concat(objpath,ZATTRS,&key))) goto done;
+	    nclistpush(keys,key); key = NULL;
+	}
+	nullfree(objpath); objpath = NULL;
+    }
+    if(!purezarr) {
+	for(i=0;i<nclistlength(subgrps);i++) {
+	    if((stat = nczm_concat(grppath,(const char*)nclistget(subgrps,i),&objpath))) goto done;
+	    if((stat = nczm_concat(objpath,ZGROUP,&key))) goto done;
+	    nclistpush(keys,key); key = NULL;
+	    nullfree(objpath); objpath = NULL;
+	}
+    }
+    if((stat = nczmap_prefetch(zinfo->map,keys,ngs->zarr.prefetch_threads))) goto done;
+
+done:
+    nclistfreeall(keys);
+    nullfree(objpath);
+    nullfree(key);
+    return THROW(stat);
+}
+
 /**
  * @internal Read group data from map to memory
  *
@@ -1203,6 +1261,11 @@ define_grp(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp)
 	}
     }
 
+    /* Read the metadata of the vars and subgroups concurrently */
+    if(!v1) {
+	if((stat = prefetch_grp(file,fullpath,varnames,subgrps,purezarr))) goto done;
+    }
+
     if(!purezarr) {
 	/* Define dimensions */
 	if((stat = define_dims(file,grp,dimdefs))) goto done;
@@ -237,13 +237,20 @@ NCZ_downloadjson(NCZMAP* zmap, const char* key, NCjson** jsonp)
     char* content = NULL;
     NCjson* json = NULL;
 
-    if((stat = nczmap_len(zmap, key, &len)))
-	goto done;
-    if((content = malloc(len+1)) == NULL)
-	{stat = NC_ENOMEM; goto done;}
-    if((stat = nczmap_read(zmap, key, 0, len, (void*)content)))
-	goto done;
-    content[len] = '\0';
+    /* See if the object was read ahead (see define_grp) */
+    switch (stat = nczmap_prefetched(zmap, key, &len, &content)) {
+    case NC_NOERR: break;
+    case NC_ENOOBJECT:
+        if((stat = nczmap_len(zmap, key, &len)))
+	    goto done;
+        if((content = malloc(len+1)) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+        if((stat = nczmap_read(zmap, key, 0, len, (void*)content)))
+	    goto done;
+        content[len] = '\0';
+	break;
+    default: goto done;
+    }
 
     if((stat = NCJparse(content,0,&json)) < 0)
 	{stat = NC_ENCZARR; goto done;}
@@ -1060,6 +1067,16 @@ NCZ_copy_data(NC_FILE_INFO_T* file, NC_TYPE_INFO_T* xtype, const void* memory, s
     return nc_copy_data(file->controller->ext_ncid,xtype->hdr.id,memory,count,copy);
 }
 
+/*
+Copy data read from a chunk into the caller's memory; during
+nc_get_vara_arena() strings and vlens are allocated from its arena.
+*/
+int
+NCZ_copy_data_out(NC_FILE_INFO_T* file, NC_TYPE_INFO_T* xtype, const void* memory, size_t count, void* copy)
+{
+    return NC_copy_data_arena(file->controller->ext_ncid,xtype->hdr.id,memory,count,copy,NC_arena_current());
+}
+
 #if 0
 /* Recursive helper */
 static int
@@ -1110,3 +1127,12 @@ NCZ_iscomplexjson(NCjson* json, nc_type typehint)
 done:
     return stat;
 }
+
+/* Return 1 if a control or .rc value means false ("false", "no", "off" or "0") */
+int
+NCZ_isfalse(const char* value)
+{
+    if(value == NULL) return 0;
+    return (strcasecmp(value,"false")==0 || strcasecmp(value,"no")==0
+            || strcasecmp(value,"off")==0 || strcmp(value,"0")==0);
+}
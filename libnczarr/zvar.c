@@ -125,6 +125,10 @@ ncz_find_default_chunksizes2(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var)
 	    return NC_ENOMEM;
     }
 
+    /* Shape the chunks after the reads of the access hint, if any. */
+    if (var->access_hint != NC_ACCESS_BALANCED)
+	return nc4_find_hint_chunksizes(var, type_size);
+
     /* How many values in the variable (or one record, if there are
      * unlimited dimensions). */
     for (d = 0; d < var->ndims; d++)
@@ -681,6 +685,8 @@ ncz_def_var_extra(int ncid, int varid, int *shuffle, int *unused1,
 		    var->chunksizes[d] = chunksizes[d];
 		    if(chunksizes[d] == 0) anyzero = 1;
 		}
+		/* An access hint no longer picks the chunksizes. */
+		if(!anyzero) var->chunking_set = NC_TRUE;
 	    }
 	    /* If chunksizes == NULL or anyzero then use defaults */
 	    if(chunksizes == NULL || anyzero) { /* Use default chunking */
@@ -928,6 +934,69 @@ NCZ_def_var_chunking(int ncid, int varid, int contiguous, const size_t *chunksiz
 			    &contiguous, chunksizesp, NULL, NULL, NULL, NULL, NULL);
 }
 
+/**
+ * @internal Set the access hint of a var. This is called by
+ * nc_def_var_access_hint(). Until the var is created, a var whose
+ * chunksizes were not given to nc_def_var_chunking() is chunked for
+ * the hinted reads. The chunk cache is sized for the hinted reads if
+ * it still has its default size.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param hint The access hint.
+ * @param shape For ::NC_ACCESS_SHAPE, the expected read shape.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ * @returns ::NC_EINVAL Invalid hint or shape.
+ */
+int
+NCZ_def_var_access_hint(int ncid, int varid, int hint, const size_t *shape)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T *zvar;
+    int d, retval = NC_NOERR;
+
+    ZTRACE(1,"ncid=%d varid=%d hint=%d",ncid,varid,hint);
+
+    if ((retval = nc4_find_grp_h5_var(ncid, varid, &h5, &grp, &var)))
+	goto done;
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+    assert(zvar != NULL && zvar->cache != NULL);
+
+    if ((retval = nc4_set_access_hint(var, hint, shape)))
+	goto done;
+    if (zvar->scalar)
+	goto done;
+
+    /* Choose new default chunksizes, if it is not too late. */
+    if (!var->created && !var->chunking_set) {
+	memset(var->chunksizes, 0, var->ndims * sizeof(size_t));
+	if ((retval = ncz_find_default_chunksizes2(grp, var)))
+	    goto done;
+	zvar->chunkproduct = 1;
+	for (d = 0; d < var->ndims; d++)
+	    zvar->chunkproduct *= var->chunksizes[d];
+	zvar->chunksize = zvar->chunkproduct * var->type_info->size;
+	var->chunkcache.nelems = ceildiv(var->chunkcache.size,zvar->chunksize);
+    }
+
+    /* Size the cache for the hinted reads */
+    if (var->chunkcache.size == CHUNK_CACHE_SIZE_NCZARR) {
+	var->chunkcache.size = nc4_access_hint_cache_size(var, var->type_info->size, CHUNK_CACHE_SIZE_NCZARR);
+	var->chunkcache.nelems = ceildiv(var->chunkcache.size,zvar->chunksize);
+    }
+    zvar->cache->valid = 0;
+    if ((retval = NCZ_adjust_var_cache(var)))
+	goto done;
+
+done:
+    return ZUNTRACE(retval);
+}
+
 /**
  * @internal Define chunking stuff for a var. This is called by
  * the fortran API.
@@ -2127,7 +2196,7 @@ NCZ_get_vars(int ncid, int varid, const size_t *startp, const size_t *countp,
 	for (i = 0; i < fill_len; i++)
 	{
 	    /* Copy one instance of the fill_value */
-	    if((retval = nc_copy_data(ncid,var->type_info->hdr.id,var->fill_value,1,filldata)))
+	    if((retval = NCZ_copy_data_out(h5,var->type_info,var->fill_value,1,filldata)))
 	        BAIL(retval);
 	    filldata = (char *)filldata + file_type_size;
 	}
@@ -2175,6 +2244,67 @@ exit:
     return NC_NOERR;
 }
 
+/**
+ * @internal Read a set of scattered elements of a variable; the
+ * points are grouped by chunk so that each chunk is read only once.
+ * Only non-scalar variables of fixed-size atomic types are handled,
+ * and only when all points are inside the current dimension lengths;
+ * otherwise *handledp is set to 0 and the caller falls back to the
+ * generic implementation.
+ *
+ * @param ncid File and group ID.
+ * @param varid Variable ID.
+ * @param npoints Number of points.
+ * @param coords npoints*ndims indices.
+ * @param data Where the values are stored, in the variable's type.
+ * @param handledp Set to 1 if the points were read.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Var not found.
+ */
+int
+NCZ_get_var_points(int ncid, int varid, size_t npoints, const size_t *coords,
+                   void *data, int *handledp)
+{
+    int retval = NC_NOERR;
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T* zvar = NULL;
+    nc_type mem_nc_type = NC_NAT;
+    size_t i;
+    int d;
+
+    *handledp = 0;
+
+    if ((retval = nc4_find_grp_h5_var(ncid, varid, &h5, &grp, &var)))
+	return THROW(retval);
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+
+    if(var->ndims == 0 || zvar->scalar
+       || var->type_info->hdr.id > NC_MAX_ATOMIC_TYPE
+       || var->type_info->hdr.id == NC_STRING)
+	return NC_NOERR;
+
+    /* End define mode, if needed. */
+    if ((retval = check_for_vara(&mem_nc_type, var, h5)))
+	return THROW(retval);
+
+    /* Leave errors and fill values to the generic code. */
+    for(i=0;i<npoints;i++) {
+	for(d=0;d<var->ndims;d++) {
+	    if(coords[i*(size_t)var->ndims+(size_t)d] >= var->dim[d]->len)
+		return NC_NOERR;
+	}
+    }
+
+    if((retval = NCZ_transferpoints(var, npoints, coords, data)))
+	return THROW(retval);
+    *handledp = 1;
+    return NC_NOERR;
+}
+
 /**
  * @internal Get all the information about a variable. Pass NULL for
  * whatever you don't care about.
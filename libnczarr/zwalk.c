@@ -27,6 +27,7 @@ static int rangecount(NCZChunkRange range);
 static int readfromcache(void* source, size64_t* chunkindices, void** chunkdata);
 static int iswholechunk(struct Common* common,NCZSlice*);
 static int wholechunk_indices(struct Common* common, NCZSlice* slices, size64_t* chunkindices);
+static int readparts(struct Common* common, size64_t* chunkindices, NCZProjection** proj, void** chunkdatap);
 
 const char*
 astype(int typesize, void* ptr)
@@ -162,6 +163,8 @@ NCZ_transferslice(NC_VAR_INFO_T* var, int reading,
     common.memshape = memshape; /* ditto */
     common.reader.source = ((NCZ_VAR_INFO_T*)(var->format_var_info))->cache;
     common.reader.read = readfromcache;
+    /* Unfiltered fixed size data can be read in part from storage */
+    common.partial = (reading && !common.scalar && typecode != NC_STRING && FILTERED(common.cache) == 0);
 
     if(common.scalar) {
         if((stat = NCZ_transferscalar(&common))) goto done;
@@ -234,11 +237,12 @@ NCZ_transfer(struct Common* common, NCZSlice* slices)
         case NC_NOERR: break;
         default: goto done;
         }
+	if(!common->reading && (stat = NCZ_chunk_cache_modify(common->reader.source, chunkindices))) goto done;
         /* Figure out memory address */
 	memptr = ((unsigned char*)common->memory);
 	slpptr = ((unsigned char*)chunkdata);
 	if(common->reading) {
-	    if((stat=NCZ_copy_data(common->file,common->var->type_info,slpptr,common->chunkcount,!ZCLEAR,memptr))) goto done;
+	    if((stat=NCZ_copy_data_out(common->file,common->var->type_info,slpptr,common->chunkcount,memptr))) goto done;
 	} else {
 	    if((stat=NCZ_copy_data(common->file,common->var->type_info,memptr,common->chunkcount,ZCLEAR,slpptr))) goto done;
 	}
@@ -297,17 +301,29 @@ NCZ_transfer(struct Common* common, NCZSlice* slices)
 	if(zutest && zutest->tests & UTEST_TRANSFER)
 	    zutest->print(UTEST_TRANSFER, common, chunkodom, slpslices, memslices);
 
-        /* Read from cache */
-        stat = common->reader.read(common->reader.source, chunkindices, &chunkdata);
+        /* Read only the needed bytes if the chunk is not cached, else read from cache */
+        stat = NC_ENOOBJECT;
+        if(common->partial)
+	    stat = readparts(common, chunkindices, proj, &chunkdata);
+        if(stat == NC_ENOOBJECT)
+            stat = common->reader.read(common->reader.source, chunkindices, &chunkdata);
 	switch (stat) {
         case NC_EEMPTY: /* cache created the chunk */
 	    break;
         case NC_NOERR: break;
         default: goto done;
         }
+	if(!common->reading && (stat = NCZ_chunk_cache_modify(common->reader.source, chunkindices))) goto done;
 
-	slpodom = nczodom_fromslices(common->rank,slpslices);
-	memodom = nczodom_fromslices(common->rank,memslices);
+	/* The slice and memory odometers are reused across chunks */
+	if(slpodom == NULL) {
+	    if((slpodom = nczodom_fromslices(common->rank,slpslices)) == NULL
+	       || (memodom = nczodom_fromslices(common->rank,memslices)) == NULL)
+		{stat = NC_ENOMEM; goto done;}
+	} else {
+	    nczodom_setslices(slpodom,slpslices);
+	    nczodom_setslices(memodom,memslices);
+	}
 
 	{ /* walk with odometer */
 	    if(wdebug >= 1)
@@ -316,8 +332,6 @@ NCZ_transfer(struct Common* common, NCZSlice* slices)
   	    if((stat = NCZ_walk(proj,chunkodom,slpodom,memodom,common,chunkdata))) goto done;
 	}
 next:
-        nczodom_free(slpodom); slpodom = NULL;
-        nczodom_free(memodom); memodom = NULL;
         nczodom_next(chunkodom);
     }
 done:
@@ -416,7 +430,7 @@ NCZ_walk(NCZProjection** projv, NCZOdometer* chunkodom, NCZOdometer* slpodom, NC
    	    if(slpavail > 0) {
 if(wdebug > 0) wdebug2(common,slpptr0,memptr0,slpavail,laststride,chunkdata);
 	  	if(common->reading) {
-		    if((stat=NCZ_copy_data(common->file,common->var->type_info,slpptr0,slpavail,!ZCLEAR,memptr0))) goto done;
+		    if((stat=NCZ_copy_data_out(common->file,common->var->type_info,slpptr0,slpavail,memptr0))) goto done;
 		} else {
 		    if((stat=NCZ_copy_data(common->file,common->var->type_info,memptr0,slpavail,ZCLEAR,slpptr0))) goto done;
 		}
@@ -680,11 +694,83 @@ readfromcache(void* source, size64_t* chunkindices, void** chunkdatap)
     return NCZ_read_cache_chunk((struct NCZChunkCache*)source, chunkindices, chunkdatap);
 }
 
+/*
+Compute the byte ranges of one chunk touched by a set of projections
+and read just those ranges into common->partbuf. Row-major runs are
+merged when the gap between them is at most NCZ_PARTIAL_GAP bytes.
+@return NC_ENOOBJECT if the chunk should be read whole through the cache
+*/
+static int
+readparts(struct Common* common, size64_t* chunkindices, NCZProjection** proj, void** chunkdatap)
+{
+    int stat = NC_NOERR;
+    int r, last = common->rank - 1;
+    size64_t chunkstrides[NC_MAX_VAR_DIMS];
+    size64_t index[NC_MAX_VAR_DIMS];
+    size64_t ranges[2*NCZ_PARTIAL_MAXRANGES];
+    size64_t chunksize = common->chunkcount * common->typesize;
+    size64_t runlen, nruns, total = 0;
+    size_t nranges = 0;
+
+    /* Element strides of the chunk in each dimension */
+    chunkstrides[last] = 1;
+    for(r=last-1;r>=0;r--)
+        chunkstrides[r] = chunkstrides[r+1] * common->chunklens[r+1];
+
+    /* A contiguous run in the last dimension, or single elements */
+    if(proj[last]->chunkslice.stride == 1) {
+        runlen = proj[last]->iocount * common->typesize;
+        nruns = 1;
+    } else {
+        runlen = common->typesize;
+        nruns = proj[last]->iocount;
+    }
+
+    for(r=0;r<common->rank;r++) index[r] = 0;
+    for(;;) {
+        size64_t i, base = 0;
+        for(r=0;r<last;r++)
+            base += (proj[r]->chunkslice.start + index[r]*proj[r]->chunkslice.stride) * chunkstrides[r];
+        base += proj[last]->chunkslice.start;
+        for(i=0;i<nruns;i++) {
+            size64_t offset = (base + i*proj[last]->chunkslice.stride) * common->typesize;
+            if(nranges > 0 && offset <= ranges[2*(nranges-1)] + ranges[2*(nranges-1)+1] + NCZ_PARTIAL_GAP) {
+                /* merge with the previous range */
+                total -= ranges[2*(nranges-1)+1];
+                ranges[2*(nranges-1)+1] = (offset + runlen) - ranges[2*(nranges-1)];
+            } else {
+                if(nranges == NCZ_PARTIAL_MAXRANGES) return NC_ENOOBJECT;
+                ranges[2*nranges] = offset;
+                ranges[2*nranges+1] = runlen;
+                nranges++;
+            }
+            total += ranges[2*(nranges-1)+1];
+            if(total > chunksize/2) return NC_ENOOBJECT;
+        }
+        /* Move to the next run in the outer dimensions */
+        for(r=last-1;r>=0;r--) {
+            if(++index[r] < proj[r]->iocount) break;
+            index[r] = 0;
+        }
+        if(r < 0) break;
+    }
+
+    if(common->partbuf == NULL
+       && (common->partbuf = malloc(chunksize)) == NULL)
+        {stat = NC_ENOMEM; goto done;}
+    if((stat = NCZ_read_chunk_ranges(common->cache, chunkindices, nranges, ranges, common->partbuf))) goto done;
+    *chunkdatap = common->partbuf;
+done:
+    return stat;
+}
+
 void
 NCZ_clearcommon(struct Common* common)
 {
     NCZ_clearsliceprojections(common->rank,common->allprojections);
     nullfree(common->allprojections);
+    nullfree(common->partbuf);
+    common->partbuf = NULL;
 }
 
 /* Does the User want all of one and only chunk? */
@@ -737,12 +823,13 @@ NCZ_transferscalar(struct Common* common)
     case NC_NOERR: break;
     default: goto done;
     }
+    if(!common->reading && (stat = NCZ_chunk_cache_modify(common->reader.source, chunkindices))) goto done;
 
     /* Figure out memory address */
     memptr = ((unsigned char*)common->memory);
     slpptr = ((unsigned char*)chunkdata);
     if(common->reading) {
-        if((stat=NCZ_copy_data(common->file,common->var->type_info,slpptr,common->chunkcount,!ZCLEAR,memptr))) goto done;
+        if((stat=NCZ_copy_data_out(common->file,common->var->type_info,slpptr,common->chunkcount,memptr))) goto done;
     } else {
         if((stat=NCZ_copy_data(common->file,common->var->type_info,memptr,common->chunkcount,ZCLEAR,slpptr))) goto done;
     }
@@ -751,6 +838,100 @@ done:
     return stat;
 }
 
+/* One point of a NCZ_transferpoints() request */
+typedef struct NCZPoint {
+    size64_t chunk;  /* linear index of the containing chunk */
+    size64_t offset; /* linear offset of the element within that chunk */
+    size_t index;    /* position of the point in the request */
+} NCZPoint;
+
+static int
+pointcompare(const void* a, const void* b)
+{
+    const NCZPoint* pa = (const NCZPoint*)a;
+    const NCZPoint* pb = (const NCZPoint*)b;
+    if(pa->chunk != pb->chunk) return (pa->chunk < pb->chunk ? -1 : 1);
+    if(pa->offset != pb->offset) return (pa->offset < pb->offset ? -1 : 1);
+    return (pa->index < pb->index ? -1 : (pa->index > pb->index ? 1 : 0));
+}
+
+/**
+Read a set of scattered elements of a non-scalar variable of a
+fixed size atomic type. The points are grouped by chunk so that
+each chunk is obtained from the cache exactly once.
+
+@param var Controlling variable
+@param npoints number of points
+@param coords npoints*rank indices; must be within the variable's dimensions
+@param memory where to store the values, in the variable's type
+*/
+int
+NCZ_transferpoints(NC_VAR_INFO_T* var, size_t npoints, const size_t* coords, void* memory)
+{
+    int stat = NC_NOERR;
+    int r, rank = var->ndims;
+    size_t i, j, typesize;
+    size64_t chunklens[NC_MAX_VAR_DIMS];
+    size64_t nchunks[NC_MAX_VAR_DIMS];
+    size64_t chunkindices[NC_MAX_VAR_DIMS];
+    size64_t inchunk[NC_MAX_VAR_DIMS];
+    NCZ_FILE_INFO_T* zfile = NULL;
+    NCZ_VAR_INFO_T* zvar = NULL;
+    NCZPoint* points = NULL;
+    unsigned char* memptr = (unsigned char*)memory;
+    int swap;
+
+    if(npoints == 0) goto done;
+    zfile = (NCZ_FILE_INFO_T*)var->container->nc4_info->format_file_info;
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+    typesize = var->type_info->size;
+    swap = (zfile->native_endianness == var->endianness ? 0 : 1);
+
+    for(r=0;r<rank;r++) {
+	chunklens[r] = var->chunksizes[r];
+	nchunks[r] = ceildiv(var->dim[r]->len,chunklens[r]);
+    }
+
+    if((points = (NCZPoint*)malloc(sizeof(NCZPoint)*npoints)) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<npoints;i++) {
+	const size_t* coord = coords + (i * (size_t)rank);
+	for(r=0;r<rank;r++) {
+	    chunkindices[r] = coord[r] / chunklens[r];
+	    inchunk[r] = coord[r] % chunklens[r];
+	}
+	points[i].chunk = NCZ_computelinearoffset((size_t)rank,chunkindices,nchunks);
+	points[i].offset = NCZ_computelinearoffset((size_t)rank,inchunk,chunklens);
+	points[i].index = i;
+    }
+    qsort(points,npoints,sizeof(NCZPoint),pointcompare);
+
+    for(i=0;i<npoints;i=j) {
+	void* chunkdata = NULL;
+	const size_t* coord = coords + (points[i].index * (size_t)rank);
+	for(r=0;r<rank;r++)
+	    chunkindices[r] = coord[r] / chunklens[r];
+	switch ((stat = NCZ_read_cache_chunk(zvar->cache, chunkindices, &chunkdata))) {
+	case NC_EEMPTY: /* cache created the chunk */
+	    stat = NC_NOERR;
+	    break;
+	case NC_NOERR: break;
+	default: goto done;
+	}
+	/* All the points in this chunk */
+	for(j=i;j<npoints && points[j].chunk == points[i].chunk;j++) {
+	    unsigned char* dst = memptr + (points[j].index * typesize);
+	    memcpy(dst,((unsigned char*)chunkdata) + (points[j].offset * typesize),typesize);
+	    if(swap)
+		NCZ_swapatomicdata(typesize,dst,(int)typesize);
+	}
+    }
+
+done:
+    nullfree(points);
+    return THROW(stat);
+}
+
 /* Debugging Interface: return the contents of a specified chunk */
 EXTERNL int
 NCZ_read_chunk(int ncid, int varid, size64_t* zindices, void* chunkdata)
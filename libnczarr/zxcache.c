@@ -24,10 +24,28 @@
 /* Forward */
 static int get_chunk(NCZChunkCache* cache, NCZCacheEntry* entry);
 static int put_chunk(NCZChunkCache* cache, NCZCacheEntry*);
+static int isfillchunk(NCZChunkCache* cache, const NCZCacheEntry* entry);
 static int makeroom(NCZChunkCache* cache);
 static int flushcache(NCZChunkCache* cache);
 static int constraincache(NCZChunkCache* cache);
 
+#ifdef ENABLE_IOSTATS
+/* Increment a cache counter, given its offset in nc_io_stats_t,
+   for both the file and the cache's variable */
+static void
+cachestat(NCZChunkCache* cache, size_t fieldoffset)
+{
+    NC_VAR_INFO_T* var = cache->var;
+    NC* nc = (NC*)var->container->nc4_info->controller;
+    nc_io_stats_t* fs = NC_iostats_file(nc);
+    nc_io_stats_t* vs = NULL;
+    if(fs == NULL) return;
+    vs = NC_iostats_var(nc,nc->ext_ncid | var->container->hdr.id,var->hdr.id);
+    (*(unsigned long long*)(((char*)fs)+fieldoffset))++;
+    if(vs != NULL) (*(unsigned long long*)(((char*)vs)+fieldoffset))++;
+}
+#endif
+
 /**************************************************/
 /* Dispatch table per-var cache functions */
 
@@ -281,6 +299,12 @@ NCZ_read_cache_chunk(NCZChunkCache* cache, const size64_t* indices, void** datap
 	break;
     default: goto done;
     }
+#ifdef ENABLE_IOSTATS
+    if(entry == NULL)
+        cachestat(cache,offsetof(nc_io_stats_t,cache_misses));
+    else
+        cachestat(cache,offsetof(nc_io_stats_t,cache_hits));
+#endif
 
     if(entry == NULL) { /*!found*/
 	/* Create a new entry */
@@ -408,6 +432,9 @@ constraincache(NCZChunkCache* cache)
 	assert(cache->used >= e->size);
 	/* Note that |old chunk data| may not be same as |new chunk data| because of filters */
 	cache->used -= e->size; /* old size */
+#ifdef ENABLE_IOSTATS
+	cachestat(cache,offsetof(nc_io_stats_t,cache_evictions));
+#endif
 	if(e->modified) /* flush to file */
 	    stat=put_chunk(cache,e);
 	/* reclaim */
@@ -517,28 +544,84 @@ NCZ_reclaim_fill_chunk(NCZChunkCache* zcache)
     return stat;
 }
 
-#if 0
+/**
+ * @internal Read some byte ranges of an unfiltered chunk straight
+ * from storage, bypassing the cache. Each range is stored at its own
+ * offset in chunkbuf, which must hold a whole chunk; the rest of
+ * chunkbuf is left as is.
+ *
+ * The chunk must be read through the cache instead if it is already
+ * cached, if it is not stored, or if it was also the last chunk read
+ * in part: a run of small reads in one chunk then reads it whole once.
+ *
+ * @param cache Pointer to the cache of the var
+ * @param indices Indices of the chunk
+ * @param nranges Number of ranges
+ * @param ranges (offset,length) pairs in bytes, in increasing order
+ * @param chunkbuf Buffer of cache->chunksize bytes
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_ENOOBJECT Read the chunk through the cache.
+ */
 int
-NCZ_chunk_cache_modified(NCZChunkCache* cache, const size64_t* indices)
+NCZ_read_chunk_ranges(NCZChunkCache* cache, const size64_t* indices, size_t nranges, const size64_t* ranges, void* chunkbuf)
 {
     int stat = NC_NOERR;
-    char* key = NULL;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+    ncexhashkey_t hkey = 0;
     NCZCacheEntry* entry = NULL;
-    int rank = cache->ndims;
+    struct ChunkKey key = {NULL,NULL};
+    char* path = NULL;
+    size_t i;
 
-    /* Create the key for this cache */
-    if((stat=NCZ_buildchunkkey(rank, indices, &key))) goto done;
+    hkey = ncxcachekey(indices,sizeof(size64_t)*cache->ndims);
+    if(ncxcachelookup(cache->xcache,hkey,(void**)&entry) == NC_NOERR)
+	return NC_ENOOBJECT;
+    if(cache->partial && cache->lastpartial == hkey) {
+	cache->partial = 0;
+	return NC_ENOOBJECT;
+    }
+    cache->partial = 1;
+    cache->lastpartial = hkey;
+
+    if((stat = NCZ_buildchunkpath(cache,indices,&key))) goto done;
+    path = NCZ_chunkpath(key);
+    for(i=0;i<nranges;i++) {
+	size64_t offset = ranges[2*i];
+	size64_t len = ranges[2*i+1];
+	assert(offset + len <= cache->chunksize);
+	switch (stat = nczmap_read(zfile->map,path,offset,len,((char*)chunkbuf)+offset)) {
+	case NC_NOERR: break;
+	case NC_EEMPTY: stat = NC_ENOOBJECT; goto done; /* let the cache fake the chunk */
+	default: goto done;
+	}
+    }
 
+done:
+    nullfree(path);
+    nullfree(key.varkey);
+    nullfree(key.chunkkey);
+    return stat;
+}
+
+/* Mark a cached chunk as modified so that it is written when flushed */
+int
+NCZ_chunk_cache_modify(NCZChunkCache* cache, const size64_t* indices)
+{
+    int stat = NC_NOERR;
+    ncexhashkey_t hkey = 0;
+    NCZCacheEntry* entry = NULL;
+
+    /* the hash key */
+    hkey = ncxcachekey(indices,sizeof(size64_t)*cache->ndims);
     /* See if already in cache */
-    if(NC_hashmapget(cache->mru, key, strlen(key), (uintptr_t*)entry)) { /* found */
-	entry->modified = 1;
-    }
+    if((stat = ncxcachelookup(cache->xcache,hkey,(void**)&entry))) goto done;
+    entry->modified = 1;
 
 done:
-    nullfree(key);
     return THROW(stat);
 }
-#endif
 
 /**************************************************/
 /*
@@ -623,6 +706,25 @@ put_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
     ncid = file->controller->ext_ncid;
     tid = cache->var->type_info->hdr.id;
 
+    /* Optionally, do not store a chunk holding only the fill value;
+       reading a missing chunk produces the same data. An existing
+       object is removed so that it does not shadow the fill value. */
+    if((zfile->controls.flags & FLAG_NOEMPTYCHUNKS) && tid != NC_STRING && !entry->isfiltered) {
+	if(cache->fillchunk == NULL)
+	    {if((stat = NCZ_ensure_fill_chunk(cache))) goto done;}
+	if(isfillchunk(cache,entry)) {
+	    if(entry->stored) {
+		path = NCZ_chunkpath(entry->key);
+		stat = nczmap_remove(map,path);
+		nullfree(path); path = NULL;
+		if(stat != NC_NOERR && stat != NC_EEMPTY) goto done;
+		stat = NC_NOERR;
+		entry->stored = 0;
+	    }
+	    goto done;
+	}
+    }
+
     if(tid == NC_STRING && !entry->isfixedstring) {
         /* Convert from char* to char[strlen] format */
         int maxstrlen = NCZ_get_maxstrlen((NC_OBJ*)cache->var);
@@ -665,6 +767,7 @@ put_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
 
     switch(stat) {
     case NC_NOERR:
+	entry->stored = 1;
 	break;
     case NC_EEMPTY:
     default: goto done;
@@ -675,6 +778,30 @@ done:
     return ZUNTRACE(stat);
 }
 
+/**
+ * @internal Test if every element of an unfiltered chunk is equal to
+ * the fill value. The first element is compared to the fill chunk and
+ * then the chunk is compared to itself shifted by one element, so only
+ * the chunk is scanned.
+ *
+ * @param cache Pointer to parent cache; its fillchunk must exist
+ * @param entry cache entry to test
+ *
+ * @return 1 if the chunk holds only the fill value, 0 otherwise.
+ */
+static int
+isfillchunk(NCZChunkCache* cache, const NCZCacheEntry* entry)
+{
+    size_t typesize = cache->var->type_info->size;
+    const unsigned char* data = (const unsigned char*)entry->data;
+
+    if(data == NULL || entry->size != cache->chunksize || entry->size < typesize)
+	return 0;
+    if(memcmp(data,cache->fillchunk,typesize) != 0)
+	return 0;
+    return (memcmp(data,data+typesize,entry->size-typesize) == 0);
+}
+
 /**
  * @internal Push data from memory to file.
  *
@@ -717,7 +844,7 @@ get_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
     stat = nczmap_len(map,path,&size);
     nullfree(path); path = NULL;
     switch(stat) {
-    case NC_NOERR: entry->size = size; break;
+    case NC_NOERR: entry->size = size; entry->stored = 1; break;
     case NC_EEMPTY: empty = 1; stat = NC_NOERR; break;
     default: goto done;
     }
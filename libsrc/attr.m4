@@ -36,6 +36,10 @@ free_NC_attr(NC_attr *attrp)
 	if(attrp == NULL)
 		return;
 	free_NC_string(attrp->name);
+	/* A value read by NC_load_attrV() is not part of the block */
+	if(attrp->xvalue != NULL
+		&& attrp->xvalue != (char *)attrp + M_RNDUP(sizeof(NC_attr)))
+		free(attrp->xvalue);
 	free(attrp);
 }
 
@@ -103,6 +107,36 @@ new_x_NC_attr(
 		attrp->xvalue = (char *)attrp + M_RNDUP(sizeof(NC_attr));
 	else
 		attrp->xvalue = NULL;
+	attrp->lazy = NULL;
+	attrp->xoff = 0;
+
+	return(attrp);
+}
+
+
+/*
+ * Like new_x_NC_attr(), but the value is left in the file
+ * at offset 'xoff' and only read by NC_load_attrV().
+ */
+NC_attr *
+new_x_NC_attr_lazy(
+	NC_string *strp,
+	nc_type type,
+	size_t nelems,
+	NC3_INFO *ncp,
+	off_t xoff)
+{
+	NC_attr *attrp = (NC_attr *) malloc(M_RNDUP(sizeof(NC_attr)));
+	if(attrp == NULL )
+		return NULL;
+
+	attrp->xsz = ncx_len_NC_attrV(type, nelems);
+	attrp->name = strp;
+	attrp->type = type;
+	attrp->nelems = nelems;
+	attrp->xvalue = NULL;
+	attrp->lazy = ncp;
+	attrp->xoff = xoff;
 
 	return(attrp);
 }
@@ -147,7 +181,10 @@ done:
 static NC_attr *
 dup_NC_attr(const NC_attr *rattrp)
 {
-	NC_attr *attrp = new_NC_attr(rattrp->name->cp,
+	NC_attr *attrp;
+	if(NC_load_attrV((NC_attr *)rattrp) != NC_NOERR)
+		return NULL;
+	attrp = new_NC_attr(rattrp->name->cp,
 		 rattrp->type, rattrp->nelems);
 	if(attrp == NULL)
 		return NULL;
@@ -872,6 +909,9 @@ NC3_put_att(
 	    if(xsz > attrp->xsz) return NC_ENOTINDEFINE;
 	    /* else, we can reuse existing without redef */
 
+	    status = NC_load_attrV(attrp);
+	    if(status != NC_NOERR) return status;
+
 	    attrp->xsz = xsz;
             attrp->type = type;
             attrp->nelems = nelems;
@@ -972,6 +1012,9 @@ NC3_get_att(
     if(memtype == NC_CHAR && attrp->type != NC_CHAR)
 	return NC_ECHAR;
 
+    status = NC_load_attrV(attrp);
+    if(status != NC_NOERR) return status;
+
     xp = attrp->xvalue;
     switch (memtype) {
     case NC_CHAR:
@@ -481,6 +481,7 @@ ncio_ffio_init(ncio *const nciop)
 	*((ncio_filesizefunc **)&nciop->filesize) = ncio_ffio_filesize; /* cast away const */
 	*((ncio_pad_lengthfunc **)&nciop->pad_length) = ncio_ffio_pad_length; /* cast away const */
 	*((ncio_closefunc **)&nciop->close) = ncio_ffio_close; /* cast away const */
+	*((ncio_fillfunc **)&nciop->fill) = NULL; /* cast away const */
 
 	ffp->pos = -1;
 	ffp->bf_offset = OFF_NONE;
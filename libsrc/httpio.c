@@ -37,6 +37,7 @@
 #include "rnd.h"
 #include "ncbytes.h"
 #include "nchttp.h"
+#include "nciostats.h"
 
 #define DEFAULTPAGESIZE 16384
 
@@ -259,6 +260,10 @@ httpio_get(ncio* const nciop, off_t offset, size_t extent, int rflags, void** co
     if((status = nc_http_read(http->state,nciop->path,offset,extent,http->region)))
 	goto done;
     assert(ncbyteslength(http->region) == extent);
+#ifdef ENABLE_IOSTATS
+    NCIOSTAT_INCR(nciop->iostats,http_requests);
+    NCIOSTAT_ADD(nciop->iostats,http_bytes,extent);
+#endif
     if(vpp) *vpp = ncbytescontents(http->region);
 done:
     return status;
@@ -30,6 +30,7 @@
 #include "ncpathmgr.h"
 #include "ncrc.h"
 #include "ncbytes.h"
+#include "nclist.h"
 
 #undef DEBUG
 
@@ -95,6 +96,38 @@ reallocx(void* mem, size_t newsize, size_t oldsize)
 }
 #endif
 
+/* Copy-on-write images.
+   An image is a table of reference counted pages that can be shared
+   by any number of open files and by the images produced when those
+   files are closed with nc_close_memio(). A page is copied only when
+   it is first modified; a NULL page is all zeros. */
+
+#ifndef MEMIO_COWPAGESIZE
+#define MEMIO_COWPAGESIZE 65536
+#endif
+
+typedef struct NCmempage {
+    int refcount;
+    char* data; /* MEMIO_COWPAGESIZE bytes */
+} NCmempage;
+
+struct NC_memimage {
+    int refcount;
+    size_t size; /* logical size of the file */
+    size_t npages;
+    NCmempage** pages;
+};
+
+/* A region handed out by get() that spans more than one page;
+   modifications are copied back into the pages by rel() */
+typedef struct NCcowregion {
+    off_t offset;
+    size_t extent;
+    char* buf;
+} NCcowregion;
+
+#define NPAGES(n) (((n) + MEMIO_COWPAGESIZE - 1) / MEMIO_COWPAGESIZE)
+
 /* Private data for memio */
 
 typedef struct NCMEMIO {
@@ -108,6 +141,11 @@ typedef struct NCMEMIO {
     /* Convenience flags */
     int diskless;
     int inmemory; /* assert(inmemory iff !diskless */
+    /* Copy-on-write mode: memory is unused */
+    int cow;
+    size_t npages;
+    NCmempage** pages;
+    NClist* regions; /* NClist<NCcowregion*> */
 } NCMEMIO;
 
 /* Forward */
@@ -122,6 +160,9 @@ static int readfile(const char* path, NC_memio*);
 static int writefile(const char* path, NCMEMIO*);
 static int fileiswriteable(const char* path);
 static int fileexists(const char* path);
+static int memio_cow_init(ncio* nciop, NCMEMIO* memio, NC_memimage* image);
+static void memio_cow_free(NCMEMIO* memio);
+static int cow_flatten(NCMEMIO* memio, char** memoryp);
 
 /* Mnemonic */
 #define DOOPEN 1
@@ -334,6 +375,7 @@ memio_open(const char* path,
     int diskless = (fIsSet(ioflags,NC_DISKLESS));
     int inmemory = fIsSet(ioflags,NC_INMEMORY);
     int locked = 0;
+    int cow = 0;
 
     assert(inmemory ? !diskless : 1);
 
@@ -350,9 +392,11 @@ memio_open(const char* path,
 	NC_memio* memparams = (NC_memio*)parameters;
         meminfo = *memparams;
         locked = fIsSet(meminfo.flags,NC_MEMIO_LOCKED);
+        cow = fIsSet(meminfo.flags,NC_MEMIO_COW);
 	/* As a safeguard, if !locked and NC_WRITE is set,
-           then we must take control of the incoming memory */
-        if(!locked && fIsSet(ioflags,NC_WRITE)) {
+           then we must take control of the incoming memory;
+           a copy-on-write image is never taken over */
+        if(!cow && !locked && fIsSet(ioflags,NC_WRITE)) {
 	    memparams->memory = NULL;	    
 	}	
     } else { /* read the file into a chunk of memory*/
@@ -369,6 +413,11 @@ memio_open(const char* path,
     status = memio_new(path, ioflags, initialsize, &nciop, &memio);
     if(status != NC_NOERR)
 	{goto unwind_open;}
+    if(cow) {
+	/* Share the pages of the image */
+	if((status = memio_cow_init(nciop,memio,(NC_memimage*)meminfo.memory)))
+	    {goto unwind_open;}
+    } else {
     memio->locked = locked;
 
     /* Initialize the memio memory */
@@ -386,6 +435,7 @@ memio_open(const char* path,
 	       {status = NC_ENOMEM; goto unwind_open;}
 	}
     }
+    }
 
 #ifdef DEBUG
 fprintf(stderr,"memio_open: initial memory: %lu/%lu\n",(unsigned long)memio->memory,(unsigned long)memio->alloc);
@@ -406,6 +456,9 @@ fprintf(stderr,"memio_open: initial memory: %lu/%lu\n",(unsigned long)memio->mem
     sizehint = (sizehint / 8) * 8;
     if(sizehint < 8) sizehint = 8;
 
+    /* Keep copy-on-write requests within a page where possible */
+    if(cow) sizehint = MEMIO_COWPAGESIZE;
+
     fd = nc__pseudofd();
     *((int* )&nciop->fd) = fd;
 
@@ -520,9 +573,16 @@ memio_close(ncio* nciop, int doUnlink)
     assert(memio != NULL);
 
     /* See if the user wants the contents persisted to a file */
-    if(memio->persist && memio->memory != NULL) {
+    if(memio->persist && memio->cow) {
+	if((status = cow_flatten(memio,&memio->memory)) == NC_NOERR)
+	    status = writefile(nciop->path,memio);
+	nullfree(memio->memory);
+	memio->memory = NULL;
+    } else if(memio->persist && memio->memory != NULL) {
 	status = writefile(nciop->path,memio);		
     }
+    if(memio->cow)
+	memio_cow_free(memio);
 
     /* We only free the memio memory if file is not locked or has been modified */
     if(memio->memory != NULL && (!memio->locked || memio->modified)) {
@@ -645,11 +705,287 @@ memio_sync(ncio* const nciop)
     return NC_NOERR; /* do nothing */
 }
 
+/**************************************************/
+/* Copy-on-write pages */
+
+static NCmempage*
+page_new(const char* src)
+{
+    NCmempage* pg = (NCmempage*)malloc(sizeof(NCmempage));
+    if(pg == NULL) return NULL;
+    if((pg->data = (char*)malloc(MEMIO_COWPAGESIZE)) == NULL)
+	{free(pg); return NULL;}
+    if(src != NULL)
+	memcpy(pg->data,src,MEMIO_COWPAGESIZE);
+    else
+	memset(pg->data,0,MEMIO_COWPAGESIZE);
+    pg->refcount = 1;
+    return pg;
+}
+
+static void
+page_unref(NCmempage* pg)
+{
+    if(pg != NULL && --pg->refcount == 0) {
+	free(pg->data);
+	free(pg);
+    }
+}
+
+static void
+pages_free(NCmempage** pages, size_t npages)
+{
+    size_t i;
+    if(pages == NULL) return;
+    for(i=0;i<npages;i++)
+	page_unref(pages[i]);
+    free(pages);
+}
+
+/* Copy count bytes at offset out of a page table */
+static void
+pages_gather(NCmempage** pages, size_t npages, size_t offset, size_t count, char* buf)
+{
+    while(count > 0) {
+	size_t pageno = offset / MEMIO_COWPAGESIZE;
+	size_t pos = offset % MEMIO_COWPAGESIZE;
+	size_t n = MIN(count, MEMIO_COWPAGESIZE - pos);
+	if(pageno < npages && pages[pageno] != NULL)
+	    memcpy(buf,pages[pageno]->data+pos,n);
+	else
+	    memset(buf,0,n);
+	buf += n; offset += n; count -= n;
+    }
+}
+
+/* Make sure that page pageno is private to this file and return its data */
+static char*
+cow_private(NCMEMIO* memio, size_t pageno)
+{
+    NCmempage* pg = memio->pages[pageno];
+    if(pg == NULL)
+	pg = page_new(NULL);
+    else if(pg->refcount > 1) {
+	pg = page_new(pg->data);
+	if(pg != NULL) page_unref(memio->pages[pageno]);
+    }
+    if(pg == NULL) return NULL;
+    memio->pages[pageno] = pg;
+    return pg->data;
+}
+
+/* Copy count bytes from buf into the pages at offset */
+static int
+cow_scatter(NCMEMIO* memio, size_t offset, size_t count, const char* buf)
+{
+    while(count > 0) {
+	size_t pageno = offset / MEMIO_COWPAGESIZE;
+	size_t pos = offset % MEMIO_COWPAGESIZE;
+	size_t n = MIN(count, MEMIO_COWPAGESIZE - pos);
+	char* data = cow_private(memio,pageno);
+	if(data == NULL) return NC_ENOMEM;
+	memcpy(data+pos,buf,n);
+	buf += n; offset += n; count -= n;
+    }
+    return NC_NOERR;
+}
+
+/* Return the contents as one contiguous malloc'd block */
+static int
+cow_flatten(NCMEMIO* memio, char** memoryp)
+{
+    char* memory = (char*)malloc(memio->size > 0 ? memio->size : 1);
+    if(memory == NULL) return NC_ENOMEM;
+    pages_gather(memio->pages,memio->npages,0,memio->size,memory);
+    *memoryp = memory;
+    return NC_NOERR;
+}
+
+static int
+memio_cow_pad_length(ncio* nciop, off_t length)
+{
+    NCMEMIO* memio;
+    size_t len = (size_t)length;
+    size_t npages = NPAGES(len);
+    if(nciop == NULL || nciop->pvt == NULL) return NC_EINVAL;
+    memio = (NCMEMIO*)nciop->pvt;
+
+    if(!fIsSet(nciop->ioflags,NC_WRITE))
+        return EPERM; /* attempt to write readonly file*/
+
+    /* Pages never move, so outstanding regions stay valid */
+    if(npages > memio->npages) {
+	NCmempage** newpages = (NCmempage**)realloc(memio->pages,npages*sizeof(NCmempage*));
+	if(newpages == NULL) return NC_ENOMEM;
+	memset(newpages+memio->npages,0,(npages - memio->npages)*sizeof(NCmempage*));
+	memio->pages = newpages;
+	memio->npages = npages;
+	memio->alloc = npages * MEMIO_COWPAGESIZE;
+    }
+    memio->size = len;
+    return NC_NOERR;
+}
+
+static int
+cow_guarantee(ncio* nciop, off_t endpoint0)
+{
+    NCMEMIO* memio = (NCMEMIO*)nciop->pvt;
+    size_t endpoint = (size_t)endpoint0;
+    if(endpoint > memio->alloc) {
+	int status = memio_cow_pad_length(nciop,endpoint);
+	if(status != NC_NOERR) return status;
+    }
+    if(memio->size < endpoint)
+	memio->size = endpoint;
+    return NC_NOERR;
+}
+
+/*
+ * A request that fits in one page is served directly from that page,
+ * after making it private if it is to be written. Otherwise the pages
+ * are copied into a temporary region that is written back by rel().
+ */
+static int
+memio_cow_get(ncio* const nciop, off_t offset, size_t extent, int rflags, void** const vpp)
+{
+    int status = NC_NOERR;
+    NCMEMIO* memio;
+    size_t first, last;
+    if(nciop == NULL || nciop->pvt == NULL) return NC_EINVAL;
+    memio = (NCMEMIO*)nciop->pvt;
+    status = cow_guarantee(nciop, offset+(off_t)extent);
+    if(status != NC_NOERR) return status;
+    first = (size_t)offset / MEMIO_COWPAGESIZE;
+    last = (extent == 0 ? first : ((size_t)offset + extent - 1) / MEMIO_COWPAGESIZE);
+    if(first == last) {
+	char* data;
+	/* Unmodified zero pages are materialized as well, so that
+	   the caller always sees addressable memory */
+	if(fIsSet(rflags,RGN_WRITE) || memio->pages[first] == NULL)
+	    data = cow_private(memio,first);
+	else
+	    data = memio->pages[first]->data;
+	if(data == NULL) return NC_ENOMEM;
+	if(vpp) *vpp = data + ((size_t)offset % MEMIO_COWPAGESIZE);
+    } else {
+	NCcowregion* region = (NCcowregion*)calloc(1,sizeof(NCcowregion));
+	if(region == NULL) return NC_ENOMEM;
+	if((region->buf = (char*)malloc(extent)) == NULL)
+	    {free(region); return NC_ENOMEM;}
+	region->offset = offset;
+	region->extent = extent;
+	pages_gather(memio->pages,memio->npages,(size_t)offset,extent,region->buf);
+	nclistpush(memio->regions,region);
+	if(vpp) *vpp = region->buf;
+    }
+    memio->locked++;
+    return NC_NOERR;
+}
+
+static int
+memio_cow_rel(ncio* const nciop, off_t offset, int rflags)
+{
+    int status = NC_NOERR;
+    NCMEMIO* memio;
+    size_t i;
+    if(nciop == NULL || nciop->pvt == NULL) return NC_EINVAL;
+    memio = (NCMEMIO*)nciop->pvt;
+    memio->locked--;
+    /* Most recent region first */
+    for(i=nclistlength(memio->regions);i-- > 0;) {
+	NCcowregion* region = (NCcowregion*)nclistget(memio->regions,i);
+	if(region->offset != offset) continue;
+	if(fIsSet(rflags,RGN_MODIFIED))
+	    status = cow_scatter(memio,(size_t)region->offset,region->extent,region->buf);
+	nclistremove(memio->regions,i);
+	free(region->buf);
+	free(region);
+	break;
+    }
+    return status;
+}
+
+/*
+ * Like memmove(), safely move possibly overlapping data,
+ * one page worth at a time.
+ */
+static int
+memio_cow_move(ncio* const nciop, off_t to, off_t from, size_t nbytes, int ignored)
+{
+    int status = NC_NOERR;
+    NCMEMIO* memio;
+    char* tmp = NULL;
+    size_t done = 0;
+
+    if(nciop == NULL || nciop->pvt == NULL) return NC_EINVAL;
+    memio = (NCMEMIO*)nciop->pvt;
+    if(from < to) {
+       /* extend if "to" is not currently allocated */
+       status = cow_guarantee(nciop,to+(off_t)nbytes);
+       if(status != NC_NOERR) return status;
+    }
+    if((tmp = (char*)malloc(MEMIO_COWPAGESIZE)) == NULL) return NC_ENOMEM;
+    while(done < nbytes) {
+	size_t n = MIN(nbytes - done, MEMIO_COWPAGESIZE);
+	size_t pos = (to > from ? nbytes - done - n : done); /* copy backward when moving up */
+	pages_gather(memio->pages,memio->npages,(size_t)from+pos,n,tmp);
+	if((status = cow_scatter(memio,(size_t)to+pos,n,tmp))) break;
+	done += n;
+    }
+    free(tmp);
+    return status;
+}
+
+/* Switch a new memio to sharing the pages of image */
+static int
+memio_cow_init(ncio* nciop, NCMEMIO* memio, NC_memimage* image)
+{
+    size_t i;
+    if(image == NULL) return NC_EINMEMORY;
+    memio->cow = 1;
+    memio->memory = NULL;
+    memio->locked = 0;
+    memio->regions = nclistnew();
+    memio->npages = image->npages;
+    if(image->npages > 0) {
+        memio->pages = (NCmempage**)malloc(image->npages*sizeof(NCmempage*));
+	if(memio->pages == NULL) return NC_ENOMEM;
+	for(i=0;i<image->npages;i++) {
+	    memio->pages[i] = image->pages[i];
+	    if(memio->pages[i] != NULL) memio->pages[i]->refcount++;
+	}
+    }
+    memio->size = image->size;
+    memio->alloc = memio->npages * MEMIO_COWPAGESIZE;
+
+    *((ncio_relfunc**)&nciop->rel) = memio_cow_rel;
+    *((ncio_getfunc**)&nciop->get) = memio_cow_get;
+    *((ncio_movefunc**)&nciop->move) = memio_cow_move;
+    *((ncio_pad_lengthfunc**)&nciop->pad_length) = memio_cow_pad_length;
+    return NC_NOERR;
+}
+
+static void
+memio_cow_free(NCMEMIO* memio)
+{
+    size_t i;
+    for(i=0;i<nclistlength(memio->regions);i++) {
+	NCcowregion* region = (NCcowregion*)nclistget(memio->regions,i);
+	free(region->buf);
+	free(region);
+    }
+    nclistfree(memio->regions);
+    memio->regions = NULL;
+    pages_free(memio->pages,memio->npages);
+    memio->pages = NULL;
+    memio->npages = 0;
+}
+
 /* "Hidden" Internal function to extract the 
    the size and/or contents of the memory.
 */
 int
-memio_extract(ncio* const nciop, size_t* sizep, void** memoryp)
+memio_extract(ncio* const nciop, size_t* sizep, void** memoryp, int* flagsp)
 {
     int status = NC_NOERR;
     NCMEMIO* memio = NULL;
@@ -659,6 +995,29 @@ memio_extract(ncio* const nciop, size_t* sizep, void** memoryp)
     assert(memio != NULL);
     if(sizep) *sizep = memio->size;
 
+    if(memio->cow) {
+	/* Hand the page table over to a new image */
+	NC_memimage* image = NULL;
+	size_t i, npages = NPAGES(memio->size);
+	if(memoryp == NULL) return NC_NOERR;
+	if((image = (NC_memimage*)calloc(1,sizeof(NC_memimage))) == NULL)
+	    return NC_ENOMEM;
+	for(i=npages;i<memio->npages;i++) {
+	    NCmempage* pg = memio->pages[i];
+	    if(pg != NULL && --pg->refcount == 0) {free(pg->data); free(pg);}
+	}
+	image->refcount = 1;
+	image->size = memio->size;
+	image->npages = npages;
+	image->pages = memio->pages;
+	memio->pages = NULL;
+	memio->npages = 0;
+	*memoryp = image;
+	if(flagsp) *flagsp = NC_MEMIO_COW;
+	return NC_NOERR;
+    }
+
+    if(flagsp) fClr(*flagsp,NC_MEMIO_COW);
     if(memoryp && memio->memory != NULL) {
 	*memoryp = memio->memory;
 	memio->memory = NULL; /* make sure it does not get free'd */
@@ -738,3 +1097,64 @@ writefile(const char* path, NCMEMIO* memio)
 done:
     return status;    
 }
+
+/**************************************************/
+/* Copy-on-write image API; see netcdf_mem.h */
+
+int
+nc_memimage_create(size_t size, const void* memory, NC_memimage** imagep)
+{
+    NC_memimage* image = NULL;
+    size_t i;
+    const char* src = (const char*)memory;
+
+    if(imagep == NULL) return NC_EINVAL;
+    if((image = (NC_memimage*)calloc(1,sizeof(NC_memimage))) == NULL)
+	return NC_ENOMEM;
+    image->refcount = 1;
+    image->size = size;
+    image->npages = NPAGES(size);
+    if(image->npages > 0
+       && (image->pages = (NCmempage**)calloc(image->npages,sizeof(NCmempage*))) == NULL)
+	{free(image); return NC_ENOMEM;}
+    /* Pages that are all zeros are left as NULL */
+    for(i=0;src != NULL && i<image->npages;i++) {
+	size_t pos = i * MEMIO_COWPAGESIZE;
+	size_t n = MIN(size - pos, MEMIO_COWPAGESIZE);
+	size_t j;
+	for(j=0;j<n;j++) {if(src[pos+j] != 0) break;}
+	if(j == n) continue;
+	if((image->pages[i] = page_new(NULL)) == NULL)
+	    {(void)nc_memimage_free(image); return NC_ENOMEM;}
+	memcpy(image->pages[i]->data,src+pos,n);
+    }
+    *imagep = image;
+    return NC_NOERR;
+}
+
+int
+nc_memimage_free(NC_memimage* image)
+{
+    if(image == NULL) return NC_NOERR;
+    if(--image->refcount > 0) return NC_NOERR;
+    pages_free(image->pages,image->npages);
+    free(image);
+    return NC_NOERR;
+}
+
+int
+nc_memimage_size(const NC_memimage* image, size_t* sizep)
+{
+    if(image == NULL) return NC_EINVAL;
+    if(sizep) *sizep = image->size;
+    return NC_NOERR;
+}
+
+int
+nc_memimage_read(const NC_memimage* image, size_t offset, size_t count, void* buf)
+{
+    if(image == NULL || (count > 0 && buf == NULL)) return NC_EINVAL;
+    if(offset > image->size || count > image->size - offset) return NC_EINVAL;
+    pages_gather(image->pages,image->npages,offset,count,(char*)buf);
+    return NC_NOERR;
+}
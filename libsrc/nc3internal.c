@@ -13,12 +13,18 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
 
 #include "nc3internal.h"
 #include "netcdf_mem.h"
 #include "rnd.h"
 #include "ncx.h"
 #include "ncrc.h"
+#include "nciostats.h"
+#include "nclog.h"
+#include "ncpathmgr.h"
 
 /* These have to do with version numbers. */
 #define MAGIC_NUM_LEN 4
@@ -34,7 +40,7 @@
 #define NC_NUMRECS_EXTENT5 8
 
 /* Internal function; breaks ncio abstraction */
-extern int memio_extract(ncio* const nciop, size_t* sizep, void** memoryp);
+extern int memio_extract(ncio* const nciop, size_t* sizep, void** memoryp, int* flagsp);
 
 static void
 free_NC3INFO(NC3_INFO *nc3)
@@ -595,9 +601,50 @@ fill_added(NC3_INFO *gnu, NC3_INFO *old)
 }
 
 
+/*
+ * Longest single ncio_move() when data is relocated. Larger regions
+ * are moved in pieces of this size, which every i/o layer can take,
+ * and progress is logged after each piece.
+ */
+#define NC_MOVE_PIECE ((off_t)256*1024*1024)
+
+/*
+ * Move the 'nbytes' long region at 'from' "out" to 'to',
+ * back to front.
+ */
+static int
+move_region_r(ncio *nciop, off_t to, off_t from, off_t nbytes)
+{
+	int status = NC_NOERR;
+	off_t remaining = nbytes;
+
+	assert(to > from);
+
+	while(remaining > 0)
+	{
+		const off_t n = remaining < NC_MOVE_PIECE
+				? remaining : NC_MOVE_PIECE;
+		remaining -= n;
+		status = ncio_move(nciop, to + remaining, from + remaining,
+				(size_t)n, 0);
+		if(status != NC_NOERR)
+			return status;
+		if(nbytes > NC_MOVE_PIECE)
+			nclog(NCLOGNOTE, "%s: moved %lld of %lld bytes",
+				nciop->path, (long long)(nbytes - remaining),
+				(long long)nbytes);
+	}
+	return NC_NOERR;
+}
+
+
 /*
  * Move the records "out".
  * Fill as needed.
+ *
+ * When the record variables that existed before keep their place
+ * within a record, whole records are moved, and when the record size
+ * did not change either, the record section is moved as one region.
  */
 static int
 move_recs_r(NC3_INFO *gnu, NC3_INFO *old)
@@ -612,10 +659,53 @@ move_recs_r(NC3_INFO *gnu, NC3_INFO *old)
 	off_t gnu_off;
 	off_t old_off;
 	const size_t old_nrecs = NC_get_numrecs(old);
+	int inplace = 1;
+
+	for(varid = 0; varid < (int)old->vars.nelems; varid++)
+	{
+		gnu_varp = *(gnu_varpp + varid);
+		old_varp = *(old_varpp + varid);
+		if(IS_RECVAR(gnu_varp)
+		   && gnu_varp->begin - gnu->begin_rec
+		      != old_varp->begin - old->begin_rec)
+		{
+			inplace = 0;
+			break;
+		}
+	}
+
+	if(inplace && gnu->recsize == old->recsize)
+	{
+		if(gnu->begin_rec != old->begin_rec && old_nrecs > 0)
+		{
+			status = move_region_r(gnu->nciop, gnu->begin_rec,
+				old->begin_rec,
+				(off_t)old->recsize * (off_t)old_nrecs);
+			if(status != NC_NOERR)
+				return status;
+		}
+		NC_set_numrecs(gnu, old_nrecs);
+		return NC_NOERR;
+	}
 
 	/* Don't parallelize this loop */
 	for(recno = (int)old_nrecs -1; recno >= 0; recno--)
 	{
+	if(inplace)
+	{
+		gnu_off = gnu->begin_rec + (off_t)(gnu->recsize * recno);
+		old_off = old->begin_rec + (off_t)(old->recsize * recno);
+		if(gnu_off == old_off)
+			continue; 	/* nothing to do */
+
+		assert(gnu_off > old_off);
+
+		status = move_region_r(gnu->nciop, gnu_off, old_off,
+			 (off_t)old->recsize);
+		if(status != NC_NOERR)
+			return status;
+		continue;
+	}
 	/* Don't parallelize this loop */
 	for(varid = (int)old->vars.nelems -1; varid >= 0; varid--)
 	{
@@ -655,6 +745,9 @@ move_recs_r(NC3_INFO *gnu, NC3_INFO *old)
 /*
  * Move the "non record" variables "out".
  * Fill as needed.
+ *
+ * When all of them move by the same distance, which is the case when
+ * only the header grew, they are moved as one region.
  */
 static int
 move_vars_r(NC3_INFO *gnu, NC3_INFO *old)
@@ -667,6 +760,37 @@ move_vars_r(NC3_INFO *gnu, NC3_INFO *old)
 	NC_var *old_varp;
 	off_t gnu_off;
 	off_t old_off;
+	off_t shift = 0;
+	off_t lower = 0;
+	off_t upper = 0;
+	int nfixed = 0;
+
+	for(varid = 0; varid < (int)old->vars.nelems; varid++)
+	{
+		gnu_varp = *(gnu_varpp + varid);
+		if(IS_RECVAR(gnu_varp))
+			continue;
+		old_varp = *(old_varpp + varid);
+		if(nfixed++ == 0)
+		{
+			shift = gnu_varp->begin - old_varp->begin;
+			lower = old_varp->begin;
+		}
+		else if(gnu_varp->begin - old_varp->begin != shift)
+		{
+			nfixed = -1;
+			break;
+		}
+		if(old_varp->begin + old_varp->len > upper)
+			upper = old_varp->begin + old_varp->len;
+	}
+	if(nfixed >= 0)
+	{
+		if(nfixed > 0 && shift > 0)
+			status = move_region_r(gnu->nciop, lower + shift, lower,
+					upper - lower);
+		return status;
+	}
 
 	/* Don't parallelize this loop */
 	for(varid = (int)old->vars.nelems -1;
@@ -835,6 +959,222 @@ NC_check_voffs(NC3_INFO *ncp)
     return NC_NOERR;
 }
 
+/*
+ * Suffix of the file written by move_shadow()
+ */
+#define NC_SHADOW_SUFFIX ".shadow"
+
+/*
+ * Copy 'nbytes' bytes at 'from' in one file to 'to' in another,
+ * through get and rel of at most 'piece' bytes.
+ */
+static int
+copy_region(ncio *to_nciop, off_t to, ncio *from_nciop, off_t from,
+	off_t nbytes, size_t piece)
+{
+	int status = NC_NOERR;
+
+	while(nbytes > 0)
+	{
+		const size_t n = nbytes < (off_t)piece ? (size_t)nbytes : piece;
+		void *src = NULL;
+		void *dest = NULL;
+
+		status = ncio_get(from_nciop, from, n, 0, &src);
+		if(status != NC_NOERR)
+			return status;
+		status = ncio_get(to_nciop, to, n, RGN_WRITE, &dest);
+		if(status != NC_NOERR)
+		{
+			(void) ncio_rel(from_nciop, from, 0);
+			return status;
+		}
+		(void) memcpy(dest, src, n);
+		(void) ncio_rel(from_nciop, from, 0);
+		status = ncio_rel(to_nciop, to, RGN_MODIFIED);
+		if(status != NC_NOERR)
+			return status;
+		from += (off_t)n;
+		to += (off_t)n;
+		nbytes -= (off_t)n;
+	}
+	return NC_NOERR;
+}
+
+
+/*
+ * Should the data of a redefined file be laid out in a shadow file?
+ * Opt in with the .rc key NETCDF3.SHADOW_REDEF=1; only for files on
+ * disk, and only if some data moves.
+ */
+static int
+use_shadow(const NC3_INFO *ncp)
+{
+	const char *value;
+
+	if(fIsSet(ncp->nciop->ioflags, NC_DISKLESS|NC_INMEMORY|NC_MMAP))
+		return 0;
+	if(ncp->begin_rec == ncp->old->begin_rec
+	   && ncp->begin_var == ncp->old->begin_var
+	   && ncp->recsize == ncp->old->recsize)
+		return 0;
+	value = NC_rclookup("NETCDF3.SHADOW_REDEF", NULL, NULL);
+	return (value != NULL && atoi(value) != 0);
+}
+
+
+/*
+ * Instead of moving the data "out" within the file, write it with
+ * the new layout and the new header to a new file next to it, then
+ * rename that over the file and reopen it. Unlike the moves in
+ * place, a failure leaves the original file untouched, and all data
+ * is read and written front to back once; the cost is the disk space
+ * of a second copy.
+ */
+static int
+move_shadow(NC3_INFO *gnu, NC3_INFO *old)
+{
+	int status = NC_NOERR;
+	int varid;
+	size_t recno;
+	ncio *nciop = gnu->nciop;
+	ncio *shadow = NULL;
+	const int ioflags = nciop->ioflags;
+	char *path = NULL;
+	char *tmppath = NULL;
+	size_t chunk = gnu->chunk;
+	size_t piece;
+	NC_var **gnu_varpp = (NC_var **)gnu->vars.value;
+	NC_var **old_varpp = (NC_var **)old->vars.value;
+	const size_t old_nrecs = NC_get_numrecs(old);
+#ifdef ENABLE_IOSTATS
+	nc_io_stats_t *iostats = nciop->iostats;
+#endif
+
+	path = strdup(nciop->path);
+	tmppath = (char *)malloc(strlen(nciop->path) + sizeof(NC_SHADOW_SUFFIX));
+	if(path == NULL || tmppath == NULL)
+	{
+		status = NC_ENOMEM;
+		goto done;
+	}
+	strcpy(tmppath, path);
+	strcat(tmppath, NC_SHADOW_SUFFIX);
+
+	status = ncio_create(tmppath, ioflags & ~NC_NOCLOBBER, 0, 0, 0,
+			&chunk, NULL, &shadow, NULL);
+	if(status != NC_NOERR)
+		goto done;
+	piece = chunk < gnu->chunk ? chunk : gnu->chunk;
+
+	for(varid = 0; varid < (int)old->vars.nelems; varid++)
+	{
+		if(IS_RECVAR(gnu_varpp[varid]))
+			continue;
+		status = copy_region(shadow, gnu_varpp[varid]->begin,
+			nciop, old_varpp[varid]->begin,
+			old_varpp[varid]->len, piece);
+		if(status != NC_NOERR)
+			goto unlink;
+	}
+	for(recno = 0; recno < old_nrecs; recno++)
+	{
+		for(varid = 0; varid < (int)old->vars.nelems; varid++)
+		{
+			if(!IS_RECVAR(gnu_varpp[varid]))
+				continue;
+			status = copy_region(shadow,
+				gnu_varpp[varid]->begin
+					+ (off_t)gnu->recsize * (off_t)recno,
+				nciop,
+				old_varpp[varid]->begin
+					+ (off_t)old->recsize * (off_t)recno,
+				old_varpp[varid]->len, piece);
+			if(status != NC_NOERR)
+				goto unlink;
+		}
+	}
+	NC_set_numrecs(gnu, old_nrecs);
+
+	/* The shadow gets its header before it replaces the file */
+	gnu->nciop = shadow;
+	status = write_NC(gnu);
+	gnu->nciop = nciop;
+	if(status == NC_NOERR)
+		status = ncio_sync(shadow);
+	if(status != NC_NOERR)
+		goto unlink;
+	status = ncio_close(shadow, 0);
+	shadow = NULL;
+	if(status != NC_NOERR)
+		goto unlink;
+
+#ifndef _WIN32
+	{
+		/* Keep the permissions of the file */
+		struct stat sb;
+		if(NCstat(path, &sb) == 0)
+			(void) chmod(tmppath, sb.st_mode & 07777);
+	}
+#endif
+
+	/*
+	 * Replace the file and reopen it. Until the rename the original
+	 * handle is kept, so if the rename fails the dataset still has
+	 * the data in the old layout. Once the file has been replaced the
+	 * old handle is of no use; if the new file cannot be opened, the
+	 * dataset is left without a file, which can only be closed, and
+	 * NC_EIO is returned. Windows cannot replace an open file, so
+	 * there the handle is closed first.
+	 */
+#ifdef _WIN32
+	status = ncio_close(nciop, 0);
+	nciop = gnu->nciop = NULL;
+	if(status == NC_NOERR)
+		(void) NCremove(path);
+#endif
+	if(status == NC_NOERR && rename(tmppath, path) != 0)
+		status = errno;
+	if(status != NC_NOERR)
+	{
+		/* Keep the shadow if it is the only copy of the data */
+		if(nciop != NULL)
+			(void) NCremove(tmppath);
+		goto done;
+	}
+	{
+		ncio *newnciop = NULL;
+		size_t newchunk = gnu->chunk;
+
+		status = ncio_open(path, ioflags, 0, 0, &newchunk, NULL,
+				&newnciop, NULL);
+		if(nciop != NULL)
+			(void) ncio_close(nciop, 0);
+		gnu->nciop = newnciop;
+		if(status != NC_NOERR)
+		{
+			status = NC_EIO;
+			goto done;
+		}
+		gnu->chunk = newchunk;
+#ifdef ENABLE_IOSTATS
+		newnciop->iostats = iostats;
+#endif
+	}
+	goto done;
+
+unlink:
+	if(shadow != NULL)
+		(void) ncio_close(shadow, 1);
+	else
+		(void) NCremove(tmppath);
+done:
+	free(path);
+	free(tmppath);
+	return status;
+}
+
+
 /*
  *  End define mode.
  *  Common code for ncendef, ncclose(endef)
@@ -847,6 +1187,10 @@ NC_endef(NC3_INFO *ncp,
 {
 	int status = NC_NOERR;
 
+	/* A failed move_shadow() can leave no file open */
+	if(ncp->nciop == NULL)
+	    return NC_EIO;
+
 	assert(!NC_readonly(ncp));
 	assert(NC_indef(ncp));
 
@@ -868,7 +1212,13 @@ NC_endef(NC3_INFO *ncp,
 		assert(ncp->begin_rec >= ncp->old->begin_rec);
 		assert(ncp->begin_var >= ncp->old->begin_var);
 
-		if(ncp->vars.nelems != 0)
+		if(ncp->vars.nelems != 0 && use_shadow(ncp))
+		{
+			status = move_shadow(ncp, ncp->old);
+			if(status != NC_NOERR)
+				return status;
+		}
+		else if(ncp->vars.nelems != 0)
 		{
 		if(ncp->begin_rec > ncp->old->begin_rec)
 		{
@@ -1070,6 +1420,9 @@ NC3_create(const char *path, int ioflags, size_t initialsz, int basepe,
 			status = NC_EEXIST;
 		goto unwind_alloc;
 	}
+#ifdef ENABLE_IOSTATS
+	nc3->nciop->iostats = NC_iostats_file(nc);
+#endif
 
 	fSet(nc3->state, NC_CREAT);
 
@@ -1177,6 +1530,9 @@ NC3_open(const char *path, int ioflags, int basepe, size_t *chunksizehintp,
 			       &nc3->nciop, NULL);
 	if(status)
 		goto unwind_alloc;
+#ifdef ENABLE_IOSTATS
+	nc3->nciop->iostats = NC_iostats_file(nc);
+#endif
 
 	assert(nc3->state == 0);
 
@@ -1275,7 +1631,8 @@ NC3_abort(int ncid)
 	}
 
 
-	(void) ncio_close(nc3->nciop, doUnlink);
+	if(nc3->nciop != NULL)
+		(void) ncio_close(nc3->nciop, doUnlink);
 	nc3->nciop = NULL;
 
 	free_NC3INFO(nc3);
@@ -1337,7 +1694,7 @@ NC3_close(int ncid, void* params)
 	if(params != NULL && (nc->mode & NC_INMEMORY) != 0) {
 	    NC_memio* memio = (NC_memio*)params;
             /* Extract the final memory size &/or contents */
-            status = memio_extract(nc3->nciop,&memio->size,&memio->memory);
+            status = memio_extract(nc3->nciop,&memio->size,&memio->memory,&memio->flags);
         }
 
 	(void) ncio_close(nc3->nciop, 0);
@@ -14,6 +14,7 @@
 #include "fbits.h"
 #include "ncuri.h"
 #include "ncrc.h"
+#include "nciostats.h"
 
 /* With the advent of diskless io, we need to provide
    for multiple ncio packages at the same time,
@@ -53,8 +54,8 @@ extern int ffio_open(const char*,int,off_t,size_t,size_t*,void*,ncio**,void** co
 static int urlmodetest(const char* path);
 #endif
 
-int
-ncio_create(const char *path, int ioflags, size_t initialsz,
+static int
+ncio_create_impl(const char *path, int ioflags, size_t initialsz,
                        off_t igeto, size_t igetsz, size_t *sizehintp,
 		       void* parameters,
                        ncio** iopp, void** const mempp)
@@ -79,8 +80,8 @@ ncio_create(const char *path, int ioflags, size_t initialsz,
 #endif
 }
 
-int
-ncio_open(const char *path, int ioflags,
+static int
+ncio_open_impl(const char *path, int ioflags,
                      off_t igeto, size_t igetsz, size_t *sizehintp,
 		     void* parameters,
                      ncio** iopp, void** const mempp)
@@ -123,6 +124,32 @@ ncio_open(const char *path, int ioflags,
 #endif
 }
 
+int
+ncio_create(const char *path, int ioflags, size_t initialsz,
+                       off_t igeto, size_t igetsz, size_t *sizehintp,
+		       void* parameters,
+                       ncio** iopp, void** const mempp)
+{
+    int status = ncio_create_impl(path,ioflags,initialsz,igeto,igetsz,sizehintp,parameters,iopp,mempp);
+#ifdef ENABLE_IOSTATS
+    if(status == NC_NOERR && iopp != NULL && *iopp != NULL) (*iopp)->iostats = NULL;
+#endif
+    return status;
+}
+
+int
+ncio_open(const char *path, int ioflags,
+                     off_t igeto, size_t igetsz, size_t *sizehintp,
+		     void* parameters,
+                     ncio** iopp, void** const mempp)
+{
+    int status = ncio_open_impl(path,ioflags,igeto,igetsz,sizehintp,parameters,iopp,mempp);
+#ifdef ENABLE_IOSTATS
+    if(status == NC_NOERR && iopp != NULL && *iopp != NULL) (*iopp)->iostats = NULL;
+#endif
+    return status;
+}
+
 /**************************************************/
 /* wrapper functions for the ncio dispatch table */
 
@@ -136,12 +163,26 @@ int
 ncio_get(ncio* const nciop, off_t offset, size_t extent,
 			int rflags, void **const vpp)
 {
+#ifdef ENABLE_IOSTATS
+    if(nciop->iostats != NULL) {
+        if(fIsSet(rflags,RGN_WRITE)) {
+	    NCIOSTAT_INCR(nciop->iostats,io_writes);
+	    NCIOSTAT_ADD(nciop->iostats,io_bytes_written,extent);
+	} else {
+	    NCIOSTAT_INCR(nciop->iostats,io_reads);
+	    NCIOSTAT_ADD(nciop->iostats,io_bytes_read,extent);
+	}
+    }
+#endif
     return nciop->get(nciop,offset,extent,rflags,vpp);
 }
 
 int
 ncio_move(ncio* const nciop, off_t to, off_t from, size_t nbytes, int rflags)
 {
+#ifdef ENABLE_IOSTATS
+    NCIOSTAT_INCR(nciop->iostats,io_moves);
+#endif
     return nciop->move(nciop,to,from,nbytes,rflags);
 }
 
@@ -163,6 +204,17 @@ ncio_pad_length(ncio* const nciop, off_t length)
     return nciop->pad_length(nciop,length);
 }
 
+int
+ncio_fill(ncio* const nciop, off_t offset, off_t nbytes, const void* block, size_t blocklen)
+{
+    if(nciop->fill == NULL) return NC_ENOTBUILT;
+#ifdef ENABLE_IOSTATS
+    NCIOSTAT_INCR(nciop->iostats,io_writes);
+    NCIOSTAT_ADD(nciop->iostats,io_bytes_written,nbytes);
+#endif
+    return nciop->fill(nciop,offset,nbytes,block,blocklen);
+}
+
 int
 ncio_close(ncio* const nciop, int doUnlink)
 {
@@ -95,6 +95,14 @@ typedef int ncio_filesizefunc(ncio *nciop, off_t *filesizep);
 */
 typedef int ncio_closefunc(ncio *nciop, int doUnlink);
 
+/* Write 'nbytes' bytes starting at 'offset' as back to back copies of
+   the 'blocklen' byte 'block'; the last copy may be partial. This is
+   used to write fill values in large blocks. It is optional: if
+   NULL, the caller fills through get and rel instead.
+*/
+typedef int ncio_fillfunc(ncio *nciop, off_t offset, off_t nbytes,
+			const void *block, size_t blocklen);
+
 /* Get around cplusplus "const xxx in class ncio without constructor" error */
 #if defined(__cplusplus)
 #define NCIO_CONST
@@ -134,6 +142,8 @@ struct ncio {
   
 	ncio_closefunc *NCIO_CONST close;
 
+	ncio_fillfunc *NCIO_CONST fill; /* may be NULL */
+
 	/*
 	 * A copy of the 'path' argument passed in to ncio_open()
 	 * or ncio_create(). Used by ncabort() to remove (unlink)
@@ -143,6 +153,11 @@ struct ncio {
 
 	/* implementation private stuff */
 	void *pvt;
+
+#ifdef ENABLE_IOSTATS
+	/* File level I/O counters of the owning NC; may be NULL */
+	nc_io_stats_t* iostats;
+#endif
 };
 
 #undef NCIO_CONST
@@ -156,6 +171,7 @@ extern int ncio_sync(ncio* const);
 extern int ncio_filesize(ncio* const, off_t*);
 extern int ncio_pad_length(ncio* const, off_t);
 extern int ncio_close(ncio* const, int);
+extern int ncio_fill(ncio* const, off_t, off_t, const void*, size_t);
 
 extern int ncio_create(const char *path, int ioflags, size_t initialsz,
                        off_t igeto, size_t igetsz, size_t *sizehintp,
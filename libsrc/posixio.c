@@ -6,6 +6,10 @@
 
 /* For MinGW Build */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* copy_file_range() */
+#endif
+
 #if HAVE_CONFIG_H
 #include <config.h>
 #endif
@@ -94,6 +98,8 @@ static int ncio_px_filesize(ncio *nciop, off_t *filesizep);
 static int ncio_px_pad_length(ncio *nciop, off_t length);
 static int ncio_px_close(ncio *nciop, int doUnlink);
 static int ncio_spx_close(ncio *nciop, int doUnlink);
+static int ncio_px_fill(ncio *nciop, off_t offset, off_t nbytes, const void *block, size_t blocklen);
+static int ncio_px_sync(ncio *const nciop);
 
 
 /*
@@ -412,7 +418,6 @@ px_pgin(ncio *const nciop,
    status, read/write permissions, and modification status of regions
    of data in the buffer.
    bf_refcount - buffer reference count.
-   slave - used in moves.
 */
 typedef struct ncio_px {
 	size_t blksz;
@@ -424,8 +429,6 @@ typedef struct ncio_px {
 	void	*bf_base;
 	int	bf_rflags;
 	int	bf_refcount;
-	/* chain for double buffering in px_move */
-	struct ncio_px *slave;
 } ncio_px;
 
 
@@ -778,80 +781,194 @@ ncio_px_get(ncio *const nciop,
 	if(fIsSet(rflags, RGN_WRITE) && !fIsSet(nciop->ioflags, NC_WRITE))
 		return EPERM; /* attempt to write readonly file */
 
-	/* reclaim space used in move */
-	if(pxp->slave != NULL)
+	return px_get(nciop, pxp, offset, extent, rflags, vpp);
+}
+
+
+/* Size of the buffer used by px_bulk_move() */
+#define PX_MOVE_BUFSIZE ((size_t)8*1024*1024)
+
+/* Largest single copy_file_range() request of px_bulk_move() */
+#define PX_MOVE_CFRMAX ((size_t)256*1024*1024)
+
+/* Read nbytes at offset, bypassing the page buffer. What lies past
+   the end of the file (a file written in NOFILL mode) reads as
+   zeros. */
+static int
+px_readall(ncio *const nciop, off_t offset, size_t nbytes, char *buf)
+{
+	ncio_px *const pxp = (ncio_px *)nciop->pvt;
+	ssize_t partial;
+
+	pxp->pos = OFF_NONE;
+	if(lseek(nciop->fd, offset, SEEK_SET) != offset)
+		return errno;
+	while(nbytes > 0)
 	{
-		if(pxp->slave->bf_base != NULL)
+		partial = read(nciop->fd, buf, nbytes);
+		if(partial == -1)
 		{
-			free(pxp->slave->bf_base);
-			pxp->slave->bf_base = NULL;
-			pxp->slave->bf_extent = 0;
-			pxp->slave->bf_offset = OFF_NONE;
+			if(errno == EINTR)
+				continue;
+			return errno;
 		}
-		free(pxp->slave);
-		pxp->slave = NULL;
+		if(partial == 0)
+		{
+			/* end of file */
+			(void) memset(buf, 0, nbytes);
+			break;
+		}
+		buf += partial;
+		nbytes -= (size_t)partial;
 	}
-	return px_get(nciop, pxp, offset, extent, rflags, vpp);
+	return NC_NOERR;
 }
 
-
-/* ARGSUSED */
+/* Write nbytes at offset, bypassing the page buffer */
 static int
-px_double_buffer(ncio *const nciop, off_t to, off_t from,
-			size_t nbytes, int rflags)
+px_writeall(ncio *const nciop, off_t offset, size_t nbytes, const char *buf)
 {
 	ncio_px *const pxp = (ncio_px *)nciop->pvt;
-	int status = NC_NOERR;
-	void *src;
-	void *dest;
-	NC_UNUSED(rflags);
+	ssize_t partial;
 
-#if INSTRUMENT
-fprintf(stderr, "\tdouble_buffr %ld %ld %ld\n",
-		 (long)to, (long)from, (long)nbytes);
-#endif
-	status = px_get(nciop, pxp, to, nbytes, RGN_WRITE,
-			&dest);
-	if(status != NC_NOERR)
-		return status;
-
-	if(pxp->slave == NULL)
+	pxp->pos = OFF_NONE;
+	if(lseek(nciop->fd, offset, SEEK_SET) != offset)
+		return errno;
+	while(nbytes > 0)
 	{
-		pxp->slave = (ncio_px *) malloc(sizeof(ncio_px));
-		if(pxp->slave == NULL)
-			return ENOMEM;
+		partial = write(nciop->fd, buf, nbytes);
+		if(partial == -1)
+		{
+			if(errno == EINTR)
+				continue;
+			return errno;
+		}
+		buf += partial;
+		nbytes -= (size_t)partial;
+	}
+	return NC_NOERR;
+}
 
-		pxp->slave->blksz = pxp->blksz;
-		/* pos done below */
-		pxp->slave->bf_offset = pxp->bf_offset;
-		pxp->slave->bf_extent = pxp->bf_extent;
-		pxp->slave->bf_cnt = pxp->bf_cnt;
-		pxp->slave->bf_base = malloc(2 * pxp->blksz);
-		if(pxp->slave->bf_base == NULL)
-			return ENOMEM;
-		(void) memcpy(pxp->slave->bf_base, pxp->bf_base,
-			 pxp->bf_extent);
-		pxp->slave->bf_rflags = 0;
-		pxp->slave->bf_refcount = 0;
-		pxp->slave->slave = NULL;
+#ifdef HAVE_COPY_FILE_RANGE
+/* Copy nbytes from 'from' to 'to' inside the kernel. The ranges
+   must not overlap. Returns an error if the file system cannot do
+   it, or -1 if the source ends early. */
+static int
+px_copy_range(ncio *const nciop, off_t to, off_t from, size_t nbytes)
+{
+	loff_t in = from;
+	loff_t out = to;
+	ssize_t partial;
+
+	while(nbytes > 0)
+	{
+		partial = copy_file_range(nciop->fd, &in, nciop->fd, &out,
+				nbytes, 0);
+		if(partial == -1)
+		{
+			if(errno == EINTR)
+				continue;
+			return errno;
+		}
+		if(partial == 0)
+			return -1;
+		nbytes -= (size_t)partial;
 	}
+	return NC_NOERR;
+}
+#endif
 
-	pxp->slave->pos = pxp->pos;
-	status = px_get(nciop, pxp->slave, from, nbytes, 0,
-			&src);
+/* Move a region that does not fit the page buffer: back to front
+   when moving up, front to back when moving down, in pieces that
+   never overwrite data not yet moved. Where copy_file_range() is
+   available and the regions are at least a buffer apart the data
+   stays in the kernel; otherwise it goes through one large buffer
+   instead of the page buffer. */
+static int
+px_bulk_move(ncio *const nciop, off_t to, off_t from, size_t nbytes)
+{
+	ncio_px *const pxp = (ncio_px *)nciop->pvt;
+	int status = NC_NOERR;
+	const size_t diff = (size_t)(to > from ? to - from : from - to);
+	const off_t lower = MIN(to, from);
+	const off_t upper = (to > from ? to : from) + (off_t)nbytes;
+	size_t remaining = nbytes;
+	size_t bufsz = MIN(nbytes, PX_MOVE_BUFSIZE);
+	char *buf = NULL;
+#ifdef HAVE_COPY_FILE_RANGE
+	int usecfr = (diff >= PX_MOVE_BUFSIZE);
+#endif
+
+	assert(pxp->bf_refcount <= 0);
+
+	/* The file must hold any modified page, and the page must not
+	   hide the moved data */
+	status = ncio_px_sync(nciop);
 	if(status != NC_NOERR)
 		return status;
-	if(pxp->pos != pxp->slave->pos)
+	if(pxp->bf_offset != OFF_NONE
+	   && pxp->bf_offset < upper
+	   && lower < pxp->bf_offset + (off_t)pxp->bf_extent)
 	{
-		/* position changed, sync */
-		pxp->pos = pxp->slave->pos;
+		pxp->bf_offset = OFF_NONE;
+		pxp->bf_extent = 0;
+		pxp->bf_cnt = 0;
+		pxp->bf_rflags = 0;
 	}
 
-	(void) memcpy(dest, src, nbytes);
-
-	(void)px_rel(pxp->slave, from, 0);
-	(void)px_rel(pxp, to, RGN_MODIFIED);
-
+	while(remaining > 0)
+	{
+		size_t n = MIN(remaining, bufsz);
+		off_t src;
+		off_t dst;
+#ifdef HAVE_COPY_FILE_RANGE
+		if(usecfr)
+			n = MIN(remaining, MIN(diff, PX_MOVE_CFRMAX));
+#endif
+		if(to > from)
+		{
+			src = from + (off_t)(remaining - n);
+			dst = to + (off_t)(remaining - n);
+		}
+		else
+		{
+			src = from + (off_t)(nbytes - remaining);
+			dst = to + (off_t)(nbytes - remaining);
+		}
+#ifdef HAVE_COPY_FILE_RANGE
+		if(usecfr)
+		{
+			if(px_copy_range(nciop, dst, src, n) == NC_NOERR)
+			{
+				remaining -= n;
+				continue;
+			}
+			/* Not supported here, or the source is short: the
+			   pieces are disjoint, so redo this one by hand */
+			usecfr = 0;
+			n = MIN(n, bufsz);
+			if(to > from)
+			{
+				src = from + (off_t)(remaining - n);
+				dst = to + (off_t)(remaining - n);
+			}
+		}
+#endif
+		if(buf == NULL)
+		{
+			buf = (char *)malloc(bufsz);
+			if(buf == NULL)
+				return ENOMEM;
+		}
+		status = px_readall(nciop, src, n, buf);
+		if(status != NC_NOERR)
+			break;
+		status = px_writeall(nciop, dst, n, buf);
+		if(status != NC_NOERR)
+			break;
+		remaining -= n;
+	}
+	free(buf);
 	return status;
 }
 
@@ -909,49 +1026,7 @@ fprintf(stderr, "ncio_px_move %ld %ld %ld %ld %ld\n",
 		 (long)to, (long)from, (long)nbytes, (long)lower, (long)extent);
 #endif
 	if(extent > pxp->blksz)
-	{
-		size_t remaining = nbytes;
-
-if(to > from)
-{
-		off_t frm = from + nbytes;
-		off_t toh = to + nbytes;
-		for(;;)
-		{
-			size_t loopextent = MIN(remaining, pxp->blksz);
-			frm -= loopextent;
-			toh -= loopextent;
-
-			status = px_double_buffer(nciop, toh, frm,
-				 	loopextent, rflags) ;
-			if(status != NC_NOERR)
-				return status;
-			remaining -= loopextent;
-
-			if(remaining == 0)
-				break; /* normal loop exit */
-		}
-}
-else
-{
-		for(;;)
-		{
-			size_t loopextent = MIN(remaining, pxp->blksz);
-
-			status = px_double_buffer(nciop, to, from,
-				 	loopextent, rflags) ;
-			if(status != NC_NOERR)
-				return status;
-			remaining -= loopextent;
-
-			if(remaining == 0)
-				break; /* normal loop exit */
-			to += loopextent;
-			from += loopextent;
-		}
-}
-		return NC_NOERR;
-	}
+		return px_bulk_move(nciop, to, from, nbytes);
 
 #if INSTRUMENT
 fprintf(stderr, "\tncio_px_move small\n");
@@ -1003,6 +1078,98 @@ ncio_px_sync(ncio *const nciop)
 	return status;
 }
 
+/* Write nbytes at offset as copies of block, bypassing the page
+   buffer. Used for filling large regions.
+
+   Any modified page is written out first, and the page is dropped
+   if it overlaps the region, so that it does not hide the new data.
+   If the block is all zeros, the part of the region at or beyond
+   the end of the file is not written; the file is just extended,
+   which leaves a hole on file systems with sparse file support.
+   This function is used when NC_SHARE is NOT used.
+*/
+static int
+ncio_px_fill(ncio *nciop, off_t offset, off_t nbytes,
+	const void *block, size_t blocklen)
+{
+	ncio_px *const pxp = (ncio_px *)nciop->pvt;
+	int status = NC_NOERR;
+	const off_t end = offset + nbytes;
+	off_t wend = end;
+	const char *bp = (const char *)block;
+	size_t i;
+
+	if(!fIsSet(nciop->ioflags, NC_WRITE))
+		return EPERM; /* attempt to write readonly file */
+	assert(pxp->bf_refcount <= 0);
+	assert(blocklen > 0);
+
+	status = ncio_px_sync(nciop);
+	if(status != NC_NOERR)
+		return status;
+	if(pxp->bf_offset != OFF_NONE
+	   && pxp->bf_offset < end
+	   && offset < pxp->bf_offset + (off_t)pxp->bf_extent)
+	{
+		pxp->bf_offset = OFF_NONE;
+		pxp->bf_extent = 0;
+		pxp->bf_cnt = 0;
+		pxp->bf_rflags = 0;
+	}
+
+	/* An all zero fill need not be written past the end of file */
+	for(i = 0; i < blocklen; i++)
+		if(bp[i] != 0) break;
+	if(i == blocklen)
+	{
+		off_t filesize = 0;
+		status = ncio_px_filesize(nciop, &filesize);
+		if(status != NC_NOERR)
+			return status;
+		if(filesize < wend)
+			wend = (filesize > offset ? filesize : offset);
+	}
+
+	if(wend > offset)
+	{
+		off_t pos = offset;
+		if(lseek(nciop->fd, offset, SEEK_SET) != offset)
+			return errno;
+		pxp->pos = offset;
+		while(pos < wend)
+		{
+			size_t nextent = blocklen;
+			const char *nvp = bp;
+			ssize_t partial;
+			if((off_t)nextent > wend - pos)
+				nextent = (size_t)(wend - pos);
+			while(nextent > 0)
+			{
+				partial = write(nciop->fd, nvp, nextent);
+				if(partial == -1)
+				{
+					if(errno == EINTR)
+						continue;
+					pxp->pos = OFF_NONE;
+					return errno;
+				}
+				nvp += partial;
+				nextent -= (size_t)partial;
+				pos += partial;
+			}
+		}
+		pxp->pos = pos;
+	}
+	if(wend < end)
+	{
+		/* fgrow2 restores the file position */
+		status = fgrow2(nciop->fd, end);
+		if(status != NC_NOERR)
+			return status;
+	}
+	return NC_NOERR;
+}
+
 /* Internal function called at close to
    free up anything hanging off pvt.
 */
@@ -1013,19 +1180,6 @@ ncio_px_freepvt(void *const pvt)
 	if(pxp == NULL)
 		return;
 
-	if(pxp->slave != NULL)
-	{
-		if(pxp->slave->bf_base != NULL)
-		{
-			free(pxp->slave->bf_base);
-			pxp->slave->bf_base = NULL;
-			pxp->slave->bf_extent = 0;
-			pxp->slave->bf_offset = OFF_NONE;
-		}
-		free(pxp->slave);
-		pxp->slave = NULL;
-	}
-
 	if(pxp->bf_base != NULL)
 	{
 		free(pxp->bf_base);
@@ -1103,6 +1257,7 @@ ncio_px_init(ncio *const nciop)
 	*((ncio_filesizefunc **)&nciop->filesize) = ncio_px_filesize; /* cast away const */
 	*((ncio_pad_lengthfunc **)&nciop->pad_length) = ncio_px_pad_length; /* cast away const */
 	*((ncio_closefunc **)&nciop->close) = ncio_px_close; /* cast away const */
+	*((ncio_fillfunc **)&nciop->fill) = ncio_px_fill; /* cast away const */
 
 	pxp->blksz = 0;
 	pxp->pos = -1;
@@ -1111,7 +1266,6 @@ ncio_px_init(ncio *const nciop)
 	pxp->bf_rflags = 0;
 	pxp->bf_refcount = 0;
 	pxp->bf_base = NULL;
-	pxp->slave = NULL;
 
 }
 
@@ -1480,6 +1634,7 @@ ncio_spx_init(ncio *const nciop)
 	*((ncio_filesizefunc **)&nciop->filesize) = ncio_px_filesize; /* cast away const */
 	*((ncio_pad_lengthfunc **)&nciop->pad_length) = ncio_px_pad_length; /* cast away const */
 	*((ncio_closefunc **)&nciop->close) = ncio_spx_close; /* cast away const */
+	*((ncio_fillfunc **)&nciop->fill) = NULL; /* cast away const */
 
 	pxp->pos = -1;
 	pxp->bf_offset = OFF_NONE;
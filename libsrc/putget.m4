@@ -131,28 +131,28 @@ NCFILL(ulonglong, ulonglong, X_SIZEOF_ULONGLONG, NC_FILL_UINT64)
 
 
 /*
- * Fill the external space for variable 'varp' values at 'recno' with
- * the appropriate value. If 'varp' is not a record variable, fill the
- * whole thing.  For the special case when 'varp' is the only record
- * variable and it is of type byte, char, or short, varsize should be
- * ncp->recsize, otherwise it should be varp->len.
- * Formerly
-xdr_NC_fill()
+ * Fills larger than this are written by the i/o layer in blocks
+ * of about this size, bypassing its buffer, when it supports that.
  */
-int
-fill_NC_var(NC3_INFO* ncp, const NC_var *varp, long long varsize, size_t recno)
+#define NC_FILL_BLOCKSIZE (4*1024*1024)
+
+/*
+ * Set up 'xfillp' (of NFILL * X_SIZEOF_DOUBLE bytes) with copies of
+ * the fill value of 'varp' in external representation, and return
+ * in *xszp the length of the pattern, a multiple of varp->xsz.
+ */
+static int
+NC_fill_pattern(const NC_var *varp, char *xfillp, size_t *xszp)
 {
-	char xfillp[NFILL * X_SIZEOF_DOUBLE];
 	const size_t step = varp->xsz;
-	const size_t nelems = sizeof(xfillp)/step;
+	const size_t nelems = (NFILL * X_SIZEOF_DOUBLE)/step;
 	const size_t xsz = varp->xsz * nelems;
 	NC_attr **attrpp = NULL;
-	off_t offset;
-	long long remaining = varsize;
-
 	void *xp;
 	int status = NC_NOERR;
 
+	*xszp = xsz;
+
 	/*
 	 * Set up fill value
 	 */
@@ -168,7 +168,7 @@ fill_NC_var(NC3_INFO* ncp, const NC_var *varp, long long varsize, size_t recno)
 		{
 			/* Use the user defined value */
 			char *cp = xfillp;
-			const char *const end = &xfillp[sizeof(xfillp)];
+			const char *const end = &xfillp[NFILL * X_SIZEOF_DOUBLE];
 
 			assert(step <= (*attrpp)->xsz);
 
@@ -177,125 +177,221 @@ fill_NC_var(NC3_INFO* ncp, const NC_var *varp, long long varsize, size_t recno)
 				(void) memcpy(cp, (*attrpp)->xvalue, step);
 			}
 		}
+		return NC_NOERR;
 	}
-	else
-	{
-		/* use the default */
 
-		assert(xsz % X_ALIGN == 0);
-		assert(xsz <= sizeof(xfillp));
-
-		xp = xfillp;
+	/* use the default */
+
+	assert(xsz % X_ALIGN == 0);
+	assert(xsz <= NFILL * X_SIZEOF_DOUBLE);
+
+	xp = xfillp;
+
+	switch(varp->type){
+	case NC_BYTE :
+		status = NC_fill_schar(&xp, nelems);
+		break;
+	case NC_CHAR :
+		status = NC_fill_char(&xp, nelems);
+		break;
+	case NC_SHORT :
+		status = NC_fill_short(&xp, nelems);
+		break;
+	case NC_INT :
+		status = NC_fill_int(&xp, nelems);
+		break;
+	case NC_FLOAT :
+		status = NC_fill_float(&xp, nelems);
+		break;
+	case NC_DOUBLE :
+		status = NC_fill_double(&xp, nelems);
+		break;
+	case NC_UBYTE :
+		status = NC_fill_uchar(&xp, nelems);
+		break;
+	case NC_USHORT :
+		status = NC_fill_ushort(&xp, nelems);
+		break;
+	case NC_UINT :
+		status = NC_fill_uint(&xp, nelems);
+		break;
+	case NC_INT64 :
+		status = NC_fill_longlong(&xp, nelems);
+		break;
+	case NC_UINT64 :
+		status = NC_fill_ulonglong(&xp, nelems);
+		break;
+	default :
+		assert("fill_NC_var invalid type" == 0);
+		status = NC_EBADTYPE;
+		break;
+	}
+	if(status != NC_NOERR)
+		return status;
 
-		switch(varp->type){
-		case NC_BYTE :
-			status = NC_fill_schar(&xp, nelems);
-			break;
-		case NC_CHAR :
-			status = NC_fill_char(&xp, nelems);
-			break;
-		case NC_SHORT :
-			status = NC_fill_short(&xp, nelems);
-			break;
-		case NC_INT :
-			status = NC_fill_int(&xp, nelems);
-			break;
-		case NC_FLOAT :
-			status = NC_fill_float(&xp, nelems);
-			break;
-		case NC_DOUBLE :
-			status = NC_fill_double(&xp, nelems);
-			break;
-                case NC_UBYTE :
-                        status = NC_fill_uchar(&xp, nelems);
-                        break;
-                case NC_USHORT :
-                        status = NC_fill_ushort(&xp, nelems);
-                        break;
-                case NC_UINT :
-                        status = NC_fill_uint(&xp, nelems);
-                        break;
-                case NC_INT64 :
-                        status = NC_fill_longlong(&xp, nelems);
-                        break;
-                case NC_UINT64 :
-                        status = NC_fill_ulonglong(&xp, nelems);
-                        break;
-		default :
-			assert("fill_NC_var invalid type" == 0);
-			status = NC_EBADTYPE;
-			break;
-		}
-		if(status != NC_NOERR)
-			return status;
+	assert(xp == xfillp + xsz);
+	return NC_NOERR;
+}
 
-		assert(xp == xfillp + xsz);
-	}
+/*
+ * Write 'nbytes' bytes at 'offset' made of copies of the 'patlen'
+ * byte 'pattern'. The pattern is first replicated into one larger
+ * block. Large fills are handed to the i/o layer in one call, if it
+ * has a fill function; otherwise the block is copied into the
+ * regions returned by ncio_get(), one memcpy per region at most.
+ */
+static int
+NC_fill_range(NC3_INFO* ncp, off_t offset, long long nbytes,
+	const char *pattern, size_t patlen)
+{
+	int status = NC_NOERR;
+	const int direct = (ncp->nciop->fill != NULL
+				&& nbytes > (long long)ncp->chunk);
+	const long long cap = (direct ? NC_FILL_BLOCKSIZE : (long long)ncp->chunk);
+	char *block = NULL;
+	const char *src = pattern;
+	size_t blocklen = patlen;
+	long long done = 0;
 
-	/*
-	 * copyout:
-	 * xfillp now contains 'nelems' elements of the fill value
-	 * in external representation.
-	 */
+	assert(nbytes > 0 && patlen > 0);
 
-	/*
-	 * Copy it out.
-	 */
+	if(nbytes > (long long)patlen)
+	{
+		/* Round up to a whole number of patterns */
+		long long want = MIN(nbytes, cap);
+		blocklen = (size_t)(((want + (long long)patlen - 1) / (long long)patlen) * (long long)patlen);
+		block = (char *)malloc(blocklen);
+		if(block == NULL)
+			return NC_ENOMEM;
+		{
+			size_t i;
+			for(i = 0; i < blocklen; i += patlen)
+				(void) memcpy(block + i, pattern, patlen);
+		}
+		src = block;
+	}
 
-	offset = varp->begin;
-	if(IS_RECVAR(varp))
+	if(direct)
 	{
-		offset += (off_t)ncp->recsize * recno;
+		status = ncio_fill(ncp->nciop, offset, (off_t)nbytes, src, blocklen);
+		goto done;
 	}
 
-	assert(remaining > 0);
-	for(;;)
+	while(done < nbytes)
 	{
-		const size_t chunksz = MIN(remaining, ncp->chunk);
-		size_t ii;
+		const size_t chunksz = (size_t)MIN(nbytes - done, (long long)ncp->chunk);
+		size_t phase = (size_t)(done % (long long)blocklen);
+		size_t pos = 0;
+		void *xp;
 
-		status = ncio_get(ncp->nciop, offset, chunksz,
+		status = ncio_get(ncp->nciop, offset + (off_t)done, chunksz,
 				 RGN_WRITE, &xp);
 		if(status != NC_NOERR)
+			goto done;
+		while(pos < chunksz)
 		{
-			return status;
+			const size_t n = MIN(chunksz - pos, blocklen - phase);
+			(void) memcpy((char *)xp + pos, src + phase, n);
+			pos += n;
+			phase = 0;
 		}
+		status = ncio_rel(ncp->nciop, offset + (off_t)done, RGN_MODIFIED);
+		if(status != NC_NOERR)
+			goto done;
+		done += (long long)chunksz;
+	}
 
-		/*
-		 * fill the chunksz buffer in units  of xsz
-		 */
-		for(ii = 0; ii < chunksz/xsz; ii++)
-		{
-			(void) memcpy(xp, xfillp, xsz);
-			xp = (char *)xp + xsz;
-		}
-		/*
-		 * Deal with any remainder
-		 */
-		{
-			const size_t rem = chunksz % xsz;
-			if(rem != 0)
-			{
-				(void) memcpy(xp, xfillp, rem);
-				/* xp = (char *)xp + xsz; */
-			}
+done:
+	if(block != NULL)
+		free(block);
+	return status;
+}
 
-		}
+/*
+ * Fill the external space for variable 'varp' values at 'recno' with
+ * the appropriate value. If 'varp' is not a record variable, fill the
+ * whole thing.  For the special case when 'varp' is the only record
+ * variable and it is of type byte, char, or short, varsize should be
+ * ncp->recsize, otherwise it should be varp->len.
+ * Formerly
+xdr_NC_fill()
+ */
+int
+fill_NC_var(NC3_INFO* ncp, const NC_var *varp, long long varsize, size_t recno)
+{
+	char xfillp[NFILL * X_SIZEOF_DOUBLE];
+	size_t xsz = 0;
+	off_t offset;
+	int status = NC_NOERR;
 
-		status = ncio_rel(ncp->nciop, offset, RGN_MODIFIED);
+	status = NC_fill_pattern(varp, xfillp, &xsz);
+	if(status != NC_NOERR)
+		return status;
+
+	offset = varp->begin;
+	if(IS_RECVAR(varp))
+	{
+		offset += (off_t)ncp->recsize * recno;
+	}
+
+	assert(varsize > 0);
+	return NC_fill_range(ncp, offset, varsize, xfillp, xsz);
+}
+
+/*
+ * Fill records [startrec, endrec) of all the record variables.
+ * One record of fill values is built, laid out as in the file, and
+ * then written over the whole range of records in one pass.
+ * Returns NC_ENOMEM without writing anything if a record is too
+ * large to build in memory; the caller then fills record by record.
+ */
+static int
+NCfillrecords(NC3_INFO* ncp, size_t startrec, size_t endrec)
+{
+	int status = NC_NOERR;
+	char *image = NULL;
+	size_t ii;
+	NC_var **varpp = (NC_var **)ncp->vars.value;
 
+	if(ncp->recsize == 0 || endrec <= startrec)
+		return NC_NOERR;
+	if(ncp->recsize > NC_FILL_BLOCKSIZE)
+		return NC_ENOMEM;
+	image = (char *)malloc(ncp->recsize);
+	if(image == NULL)
+		return NC_ENOMEM;
+	(void) memset(image, 0, ncp->recsize);
+
+	for(ii = 0; ii < ncp->vars.nelems; ii++, varpp++)
+	{
+		char xfillp[NFILL * X_SIZEOF_DOUBLE];
+		size_t xsz = 0;
+		size_t pos, len;
+		if( !IS_RECVAR(*varpp) )
+			continue;	/* skip non-record variables */
+		status = NC_fill_pattern(*varpp, xfillp, &xsz);
 		if(status != NC_NOERR)
+			goto done;
+		pos = (size_t)((*varpp)->begin - ncp->begin_rec);
+		assert(pos <= ncp->recsize);
+		/* The only record variable is not padded, see NCfillspecialrecord */
+		len = MIN((size_t)(*varpp)->len, ncp->recsize - pos);
+		while(len > 0)
 		{
-			break;
+			const size_t n = MIN(len, xsz);
+			(void) memcpy(image + pos, xfillp, n);
+			pos += n;
+			len -= n;
 		}
-
-		remaining -= chunksz;
-		if(remaining == 0)
-			break;	/* normal loop exit */
-		offset += chunksz;
-
 	}
 
+	status = NC_fill_range(ncp,
+			ncp->begin_rec + (off_t)ncp->recsize * (off_t)startrec,
+			(long long)ncp->recsize * (long long)(endrec - startrec),
+			image, ncp->recsize);
+
+done:
+	free(image);
 	return status;
 }
 /* End fill */
@@ -437,6 +533,16 @@ NCvnrecs(NC3_INFO* ncp, size_t numrecs)
 			}
 		    }
 
+		    /* Fill all the new records at once if possible */
+		    cur_nrecs = NC_get_numrecs(ncp);
+		    status = NCfillrecords(ncp, cur_nrecs, numrecs);
+		    if(status == NC_NOERR) {
+			NC_increase_numrecs(ncp, numrecs);
+		    } else if(status != NC_ENOMEM) {
+			goto common_return;
+		    }
+		    status = NC_NOERR;
+
 		    if (numrecvars != 1) { /* usual case */
 			/* Fill each record out to numrecs */
 			while((cur_nrecs = NC_get_numrecs(ncp)) < numrecs)
@@ -1915,6 +2021,539 @@ NC3_get_vara(int ncid, int varid,
     return status;
 }
 
+/*
+ * Try to satisfy nc_get_vara_view() directly from the file mapping.
+ * This is only possible when the file was opened read-only with
+ * NC_MMAP and the external representation of the variable is also
+ * its native one: byte and char data, or any type on a big-endian host.
+ * On success, view->data points into the mapping, view->zerocopy is
+ * set and view->strides is filled in; view->count must already be set.
+ * If the view cannot be provided, NC_NOERR is returned with
+ * view->zerocopy unset so that the caller can fall back to copying.
+ */
+int
+NC3_get_vara_view(int ncid, int varid,
+	    const size_t *start, const size_t *edges,
+	    nc_vara_view_t *view)
+{
+    int status = NC_NOERR;
+    NC* nc;
+    NC3_INFO* nc3;
+    NC_var *varp;
+    int i;
+    off_t offset;
+    size_t extent;
+    void* xp = NULL;
+    int mapped = 0;
+
+    status = NC_check_id(ncid, &nc);
+    if(status != NC_NOERR)
+        return status;
+    nc3 = NC3_DATA(nc);
+
+    if(NC_indef(nc3))
+        return NC_EINDEFINE;
+
+    status = NC_lookupvar(nc3, varid, &varp);
+    if(status != NC_NOERR)
+        return status;
+
+#ifdef USE_MMAP
+    mapped = (fIsSet(nc3->nciop->ioflags, NC_MMAP)
+              && !fIsSet(nc3->nciop->ioflags, NC_DISKLESS|NC_INMEMORY)
+              && NC_readonly(nc3));
+#endif
+    if(!mapped)
+        return NC_NOERR; /* not mapped, or the mapping may move */
+
+#ifndef WORDS_BIGENDIAN
+    if(varp->xsz != 1)
+        return NC_NOERR; /* needs byte swapping */
+#endif
+
+    status = NCcoordck(nc3, varp, start);
+    if(status != NC_NOERR)
+        return status;
+    status = NCedgeck(nc3, varp, start, edges);
+    if(status != NC_NOERR)
+        return status;
+
+    /* Byte strides within the file */
+    for(i = varp->ndims - 1; i >= 0; i--) {
+        if(i == varp->ndims - 1)
+            view->strides[i] = (ptrdiff_t)varp->xsz;
+        else
+            view->strides[i] = (ptrdiff_t)(varp->dsizes[i+1] * varp->xsz);
+    }
+    if(IS_RECVAR(varp))
+        view->strides[0] = (ptrdiff_t)nc3->recsize;
+
+    /* Nothing to map for an empty selection */
+    for(i = 0; i < varp->ndims; i++)
+        if(edges[i] == 0) {view->zerocopy = 1; return NC_NOERR;}
+
+    offset = NC_varoffset(nc3, varp, start);
+    extent = varp->xsz;
+    for(i = 0; i < varp->ndims; i++)
+        extent += (edges[i] - 1) * (size_t)view->strides[i];
+
+    /* A read-only mapping never moves, so the region does not need to
+       stay locked for the lifetime of the view. */
+    status = ncio_get(nc3->nciop, offset, extent, 0, &xp);
+    if(status != NC_NOERR)
+        return status;
+    (void)ncio_rel(nc3->nciop, offset, 0);
+
+    view->data = xp;
+    view->zerocopy = 1;
+    return NC_NOERR;
+}
+
+/* One point of a NC3_get_var_points() request */
+typedef struct NC3point {
+    off_t offset; /* file offset of the element */
+    size_t index; /* position of the point in the request */
+} NC3point;
+
+static int
+NC3_pointcompare(const void* a, const void* b)
+{
+    const NC3point* pa = (const NC3point*)a;
+    const NC3point* pb = (const NC3point*)b;
+    if(pa->offset != pb->offset)
+        return (pa->offset < pb->offset ? -1 : 1);
+    return (pa->index < pb->index ? -1 : (pa->index > pb->index ? 1 : 0));
+}
+
+/*
+ * Read a set of scattered elements of a variable in its external type;
+ * see nc_get_var_points(). The points are visited in file order and
+ * each run of elements that are adjacent in the file is read with a
+ * single readNCv(), so that every block of the file is fetched at
+ * most once.
+ */
+int
+NC3_get_var_points(int ncid, int varid, size_t npoints,
+	    const size_t *coords, void *value0)
+{
+    int status = NC_NOERR;
+    NC* nc;
+    NC3_INFO* nc3;
+    NC_var *varp;
+    int ndims;
+    size_t i, j, k, run, maxrun = 0;
+    size_t memtypelen;
+    size_t origin[1] = {0};
+    size_t edges[NC_MAX_VAR_DIMS];
+    NC3point* points = NULL;
+    signed char* value = (signed char*) value0;
+    signed char* buf = NULL;
+
+    status = NC_check_id(ncid, &nc);
+    if(status != NC_NOERR)
+        return status;
+    nc3 = NC3_DATA(nc);
+
+    if(NC_indef(nc3))
+        return NC_EINDEFINE;
+
+    status = NC_lookupvar(nc3, varid, &varp);
+    if(status != NC_NOERR)
+        return status;
+
+    if(npoints == 0)
+        return NC_NOERR;
+
+    ndims = varp->ndims;
+    memtypelen = nctypelen(varp->type);
+    for(k = 0; k < (size_t)ndims; k++)
+        edges[k] = 1;
+
+    points = (NC3point*)malloc(sizeof(NC3point) * npoints);
+    if(points == NULL)
+        return NC_ENOMEM;
+
+    /* Check the points and compute their file offsets */
+    for(i = 0; i < npoints; i++) {
+        const size_t* coord = (ndims == 0 ? origin : coords + i * (size_t)ndims);
+        status = NCcoordck(nc3, varp, coord);
+        if(status != NC_NOERR)
+            goto done;
+        status = NCedgeck(nc3, varp, coord, edges);
+        if(status != NC_NOERR)
+            goto done;
+        if(IS_RECVAR(varp) && *coord + 1 > NC_get_numrecs(nc3))
+            {status = NC_EEDGE; goto done;}
+        points[i].offset = NC_varoffset(nc3, varp, coord);
+        points[i].index = i;
+    }
+    qsort(points, npoints, sizeof(NC3point), NC3_pointcompare);
+
+    for(i = 0; i < npoints; i = j) {
+        const size_t* coord;
+        int lstatus;
+        for(j = i + 1; j < npoints
+                       && points[j].offset == points[j-1].offset + (off_t)varp->xsz; j++);
+        run = j - i;
+        coord = (ndims == 0 ? origin : coords + points[i].index * (size_t)ndims);
+        if(run == 1) {
+            lstatus = readNCv(nc3, varp, coord, 1,
+                              (void*)(value + points[i].index * memtypelen), varp->type);
+        } else {
+            if(run > maxrun) {
+                signed char* newbuf = (signed char*)realloc(buf, run * memtypelen);
+                if(newbuf == NULL)
+                    {status = NC_ENOMEM; goto done;}
+                buf = newbuf;
+                maxrun = run;
+            }
+            lstatus = readNCv(nc3, varp, coord, run, (void*)buf, varp->type);
+            for(k = 0; k < run; k++)
+                (void) memcpy(value + points[i+k].index * memtypelen,
+                              buf + k * memtypelen, memtypelen);
+        }
+        if(lstatus != NC_NOERR) {
+            if(lstatus != NC_ERANGE)
+                {status = lstatus; goto done;}
+            if(status == NC_NOERR)
+                status = lstatus;
+        }
+    }
+
+done:
+    if(points != NULL) free(points);
+    if(buf != NULL) free(buf);
+    return status;
+}
+
+/* Upper bound on the size of the buffer used by NC3_get_recs()
+   and NC3_put_recs(); at least one record is always buffered. */
+#define NC_RECBATCH_SIZE (4*1024*1024)
+
+/*
+ * Copy nbytes of the file starting at offset into buf,
+ * in extents of at most ncp->chunk.
+ */
+static int
+NC3_readbytes(const NC3_INFO* ncp, off_t offset, size_t nbytes, void* buf)
+{
+    int status = NC_NOERR;
+    char* dst = (char*)buf;
+    void* xp;
+
+    while(nbytes > 0) {
+        size_t extent = MIN(nbytes, ncp->chunk);
+        status = ncio_get(ncp->nciop, offset, extent, 0, &xp);
+        if(status != NC_NOERR)
+            return status;
+        (void) memcpy(dst, xp, extent);
+        (void) ncio_rel(ncp->nciop, offset, 0);
+        offset += (off_t)extent;
+        dst += extent;
+        nbytes -= extent;
+    }
+    return status;
+}
+
+/*
+ * Copy nbytes from buf into the file starting at offset,
+ * in extents of at most ncp->chunk.
+ */
+static int
+NC3_writebytes(NC3_INFO* ncp, off_t offset, size_t nbytes, const void* buf)
+{
+    int status = NC_NOERR;
+    const char* src = (const char*)buf;
+    void* xp;
+
+    while(nbytes > 0) {
+        size_t extent = MIN(nbytes, ncp->chunk);
+        status = ncio_get(ncp->nciop, offset, extent, RGN_WRITE, &xp);
+        if(status != NC_NOERR)
+            return status;
+        (void) memcpy(xp, src, extent);
+        status = ncio_rel(ncp->nciop, offset, RGN_MODIFIED);
+        if(status != NC_NOERR)
+            return status;
+        offset += (off_t)extent;
+        src += extent;
+        nbytes -= extent;
+    }
+    return status;
+}
+
+/*
+ * Convert nelems values between the external representation of type
+ * and the same type in memory.
+ */
+static int
+NC3_getn_native(const void* xp, size_t nelems, void* value, nc_type type)
+{
+    switch (type) {
+    case NC_CHAR: return ncx_getn_text(&xp, nelems, (char*)value);
+    case NC_BYTE: return ncx_getn_schar_schar(&xp, nelems, (schar*)value);
+    case NC_UBYTE: return ncx_getn_uchar_uchar(&xp, nelems, (uchar*)value);
+    case NC_SHORT: return ncx_getn_short_short(&xp, nelems, (short*)value);
+    case NC_USHORT: return ncx_getn_ushort_ushort(&xp, nelems, (ushort*)value);
+    case NC_INT: return ncx_getn_int_int(&xp, nelems, (int*)value);
+    case NC_UINT: return ncx_getn_uint_uint(&xp, nelems, (uint*)value);
+    case NC_FLOAT: return ncx_getn_float_float(&xp, nelems, (float*)value);
+    case NC_DOUBLE: return ncx_getn_double_double(&xp, nelems, (double*)value);
+    case NC_INT64: return ncx_getn_longlong_longlong(&xp, nelems, (longlong*)value);
+    case NC_UINT64: return ncx_getn_ulonglong_ulonglong(&xp, nelems, (ulonglong*)value);
+    default: break;
+    }
+    return NC_EBADTYPE;
+}
+
+static int
+NC3_putn_native(void* xp, size_t nelems, const void* value, nc_type type)
+{
+    switch (type) {
+    case NC_CHAR: return ncx_putn_text(&xp, nelems, (const char*)value);
+    case NC_BYTE: return ncx_putn_schar_schar(&xp, nelems, (const schar*)value, NULL);
+    case NC_UBYTE: return ncx_putn_uchar_uchar(&xp, nelems, (const uchar*)value, NULL);
+    case NC_SHORT: return ncx_putn_short_short(&xp, nelems, (const short*)value, NULL);
+    case NC_USHORT: return ncx_putn_ushort_ushort(&xp, nelems, (const ushort*)value, NULL);
+    case NC_INT: return ncx_putn_int_int(&xp, nelems, (const int*)value, NULL);
+    case NC_UINT: return ncx_putn_uint_uint(&xp, nelems, (const uint*)value, NULL);
+    case NC_FLOAT: return ncx_putn_float_float(&xp, nelems, (const float*)value, NULL);
+    case NC_DOUBLE: return ncx_putn_double_double(&xp, nelems, (const double*)value, NULL);
+    case NC_INT64: return ncx_putn_longlong_longlong(&xp, nelems, (const longlong*)value, NULL);
+    case NC_UINT64: return ncx_putn_ulonglong_ulonglong(&xp, nelems, (const ulonglong*)value, NULL);
+    default: break;
+    }
+    return NC_EBADTYPE;
+}
+
+/*
+ * Look up and check the variables of a NC3_get_recs() or
+ * NC3_put_recs() request. Variables with a NULL data pointer are
+ * skipped (their varpp entry is set to NULL). Also compute the span
+ * [*lop,*hip) of each record that holds the selected variables and
+ * the number of bytes of that span actually covered by them.
+ */
+static int
+NC3_lookuprecvars(NC3_INFO* nc3, size_t startrec, size_t nrecs,
+                  int nvars, const int* varids, const void* const* data,
+                  NC_var** varpp, size_t* lop, size_t* hip, size_t* coveredp)
+{
+    int i, j, status = NC_NOERR;
+    size_t lo = nc3->recsize, hi = 0, covered = 0;
+    size_t start[NC_MAX_VAR_DIMS];
+    size_t edges[NC_MAX_VAR_DIMS];
+
+    for(i = 0; i < nvars; i++) {
+        NC_var* varp;
+        size_t vlo, vhi;
+        varpp[i] = NULL;
+        status = NC_lookupvar(nc3, varids[i], &varp);
+        if(status != NC_NOERR)
+            return status;
+        if(!IS_RECVAR(varp))
+            return NC_EINVAL;
+        if(data[i] == NULL)
+            continue;
+        /* Same checks as nc_get_vara/nc_put_vara of the whole records */
+        (void) memset(start, 0, sizeof(size_t) * varp->ndims);
+        (void) memcpy(edges, varp->shape, sizeof(size_t) * varp->ndims);
+        start[0] = startrec;
+        edges[0] = nrecs;
+        status = NCcoordck(nc3, varp, start);
+        if(status != NC_NOERR)
+            return status;
+        status = NCedgeck(nc3, varp, start, edges);
+        if(status != NC_NOERR)
+            return status;
+        varpp[i] = varp;
+        vlo = (size_t)(varp->begin - nc3->begin_rec);
+        vhi = vlo + (size_t)varp->dsizes[0] * varp->xsz;
+        if(vlo < lo) lo = vlo;
+        if(vhi > hi) hi = vhi;
+        for(j = 0; j < i; j++)
+            if(varpp[j] == varp) break;
+        if(j == i) /* not a duplicate */
+            covered += vhi - vlo;
+    }
+    *lop = lo;
+    *hip = hi;
+    *coveredp = covered;
+    return status;
+}
+
+/*
+ * Read nrecs records of a set of record variables, see nc_get_recs().
+ * The records are read in blocks of up to NC_RECBATCH_SIZE bytes with
+ * one sequential pass over the file, and each block is then split into
+ * the per-variable buffers.
+ */
+int
+NC3_get_recs(int ncid, size_t startrec, size_t nrecs,
+	    int nvars, const int *varids, void **data)
+{
+    int status = NC_NOERR;
+    NC* nc;
+    NC3_INFO* nc3;
+    NC_var** varpp = NULL;
+    size_t lo, hi, covered, span, recsperblock, r;
+    int i;
+    char* buf = NULL;
+
+    status = NC_check_id(ncid, &nc);
+    if(status != NC_NOERR)
+        return status;
+    nc3 = NC3_DATA(nc);
+
+    if(NC_indef(nc3))
+        return NC_EINDEFINE;
+
+    if(nvars <= 0)
+        return NC_NOERR;
+
+    varpp = (NC_var**)calloc((size_t)nvars, sizeof(NC_var*));
+    if(varpp == NULL)
+        return NC_ENOMEM;
+    status = NC3_lookuprecvars(nc3, startrec, nrecs, nvars, varids,
+                               (const void* const*)data, varpp, &lo, &hi, &covered);
+    if(status != NC_NOERR)
+        goto done;
+    if(startrec + nrecs > NC_get_numrecs(nc3))
+        {status = NC_EEDGE; goto done;}
+    if(nrecs == 0 || hi <= lo)
+        goto done; /* nothing to read */
+
+    recsperblock = NC_RECBATCH_SIZE / nc3->recsize;
+    if(recsperblock == 0) recsperblock = 1;
+    if(recsperblock > nrecs) recsperblock = nrecs;
+    buf = (char*)malloc((recsperblock - 1) * nc3->recsize + (hi - lo));
+    if(buf == NULL)
+        {status = NC_ENOMEM; goto done;}
+
+    for(r = 0; r < nrecs; r += recsperblock) {
+        size_t k, nblock = MIN(recsperblock, nrecs - r);
+        off_t offset = nc3->begin_rec + (off_t)(startrec + r) * (off_t)nc3->recsize;
+        span = (nblock - 1) * nc3->recsize + (hi - lo);
+        status = NC3_readbytes(nc3, offset + (off_t)lo, span, buf);
+        if(status != NC_NOERR)
+            goto done;
+        for(i = 0; i < nvars; i++) {
+            NC_var* varp = varpp[i];
+            size_t nelems, memlen;
+            char* dst;
+            if(varp == NULL) continue;
+            nelems = (size_t)varp->dsizes[0];
+            memlen = nelems * nctypelen(varp->type);
+            dst = (char*)data[i] + r * memlen;
+            for(k = 0; k < nblock; k++, dst += memlen) {
+                const char* xp = buf + k * nc3->recsize
+                                 + (size_t)(varp->begin - nc3->begin_rec) - lo;
+                int lstatus = NC3_getn_native(xp, nelems, dst, varp->type);
+                if(lstatus != NC_NOERR && status == NC_NOERR)
+                    status = lstatus;
+            }
+        }
+    }
+
+done:
+    if(varpp != NULL) free(varpp);
+    if(buf != NULL) free(buf);
+    return status;
+}
+
+/*
+ * Write nrecs records of a set of record variables, see nc_put_recs().
+ * The records are assembled in blocks of up to NC_RECBATCH_SIZE bytes
+ * and each block is written with one sequential pass over the file.
+ * The existing contents of a block are only read if the selected
+ * variables do not cover all of it.
+ */
+int
+NC3_put_recs(int ncid, size_t startrec, size_t nrecs,
+	    int nvars, const int *varids, const void *const *data)
+{
+    int status = NC_NOERR;
+    NC* nc;
+    NC3_INFO* nc3;
+    NC_var** varpp = NULL;
+    size_t lo, hi, covered, span, recsperblock, r;
+    int i;
+    char* buf = NULL;
+
+    status = NC_check_id(ncid, &nc);
+    if(status != NC_NOERR)
+        return status;
+    nc3 = NC3_DATA(nc);
+
+    if(NC_readonly(nc3))
+        return NC_EPERM;
+
+    if(NC_indef(nc3))
+        return NC_EINDEFINE;
+
+    if(nvars <= 0)
+        return NC_NOERR;
+
+    varpp = (NC_var**)calloc((size_t)nvars, sizeof(NC_var*));
+    if(varpp == NULL)
+        return NC_ENOMEM;
+    status = NC3_lookuprecvars(nc3, startrec, nrecs, nvars, varids,
+                               data, varpp, &lo, &hi, &covered);
+    if(status != NC_NOERR)
+        goto done;
+    if(nrecs == 0 || hi <= lo)
+        goto done; /* nothing to write */
+
+    /* Add (and fill) any new records first */
+    status = NCvnrecs(nc3, startrec + nrecs);
+    if(status != NC_NOERR)
+        goto done;
+
+    recsperblock = NC_RECBATCH_SIZE / nc3->recsize;
+    if(recsperblock == 0) recsperblock = 1;
+    if(recsperblock > nrecs) recsperblock = nrecs;
+    buf = (char*)malloc((recsperblock - 1) * nc3->recsize + (hi - lo));
+    if(buf == NULL)
+        {status = NC_ENOMEM; goto done;}
+
+    for(r = 0; r < nrecs; r += recsperblock) {
+        size_t k, nblock = MIN(recsperblock, nrecs - r);
+        off_t offset = nc3->begin_rec + (off_t)(startrec + r) * (off_t)nc3->recsize;
+        span = (nblock - 1) * nc3->recsize + (hi - lo);
+        /* Keep the bytes of the other variables and the padding */
+        if(covered < hi - lo || (nblock > 1 && hi - lo < nc3->recsize)) {
+            status = NC3_readbytes(nc3, offset + (off_t)lo, span, buf);
+            if(status != NC_NOERR)
+                goto done;
+        }
+        for(i = 0; i < nvars; i++) {
+            NC_var* varp = varpp[i];
+            size_t nelems, memlen;
+            const char* src;
+            if(varp == NULL) continue;
+            nelems = (size_t)varp->dsizes[0];
+            memlen = nelems * nctypelen(varp->type);
+            src = (const char*)data[i] + r * memlen;
+            for(k = 0; k < nblock; k++, src += memlen) {
+                char* xp = buf + k * nc3->recsize
+                           + (size_t)(varp->begin - nc3->begin_rec) - lo;
+                int lstatus = NC3_putn_native(xp, nelems, src, varp->type);
+                if(lstatus != NC_NOERR && status == NC_NOERR)
+                    status = lstatus;
+            }
+        }
+        {
+            int lstatus = NC3_writebytes(nc3, offset + (off_t)lo, span, buf);
+            if(lstatus != NC_NOERR)
+                {status = lstatus; goto done;}
+        }
+    }
+
+done:
+    if(varpp != NULL) free(varpp);
+    if(buf != NULL) free(buf);
+    return status;
+}
+
 int
 NC3_put_vara(int ncid, int varid,
 	    const size_t *start, const size_t *edges0,
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
 #include "nc3internal.h"
 #include "rnd.h"
 #include "ncx.h"
@@ -56,8 +57,26 @@ typedef struct v1hs {
 	void *base;	/* beginning of current buffer */
 	void *pos;	/* current position in buffer */
 	void *end;	/* end of current buffer = base + extent */
+	off_t filesize;	/* reads only: size of the file, extent may grow to it */
+	int grow;	/* reads only: double extent on each fault */
+	NC3_INFO *lazy;	/* reads only: if not NULL, defer large attribute values */
 } v1hs;
 
+/*
+ * A header read that faults once usually faults many times (large
+ * headers), so each fault of a read stream doubles the extent, up
+ * to this size, for as long as the i/o layer accepts it.
+ */
+#define V1HS_MAXEXTENT ((size_t)16*1024*1024)
+
+/*
+ * Attribute values of at least this many bytes are not read with
+ * the header; they are read on first use by NC_load_attrV().
+ * All _FillValue attributes are smaller, so the fill code never
+ * has to read the file for them.
+ */
+#define NC_ATTR_LAZY_MIN 256
+
 
 /*
  * Release the stream, invalidate buffer
@@ -97,6 +116,35 @@ fault_v1hs(v1hs *gsp, size_t extent)
 
 	if(extent > gsp->extent)
 		gsp->extent = extent;
+	else if(gsp->grow && gsp->offset > 0 && gsp->extent < V1HS_MAXEXTENT)
+	{
+		/* Refault of a read stream: try a larger piece */
+		size_t want = 2 * gsp->extent;
+		if(want > V1HS_MAXEXTENT)
+			want = V1HS_MAXEXTENT;
+		if(gsp->filesize > gsp->offset
+			&& (off_t)want > gsp->filesize - gsp->offset)
+			want = (size_t)(gsp->filesize - gsp->offset);
+		if(want > gsp->extent)
+		{
+			status = ncio_get(gsp->nciop, gsp->offset, want,
+					gsp->flags, &gsp->base);
+			if(status == NC_NOERR)
+			{
+				gsp->extent = want;
+				goto got;
+			}
+			if(status != E2BIG)
+				return status;
+			/* The i/o layer has a size limit; stay below it */
+			gsp->grow = 0;
+		}
+	}
+
+	/* Do not read past the end of the file when it is not needed */
+	if(gsp->filesize > gsp->offset && (off_t)extent <= gsp->filesize - gsp->offset
+		&& (off_t)gsp->extent > gsp->filesize - gsp->offset)
+		gsp->extent = (size_t)(gsp->filesize - gsp->offset);
 
 	status = ncio_get(gsp->nciop,
 		 	gsp->offset, gsp->extent,
@@ -104,6 +152,7 @@ fault_v1hs(v1hs *gsp, size_t extent)
 	if(status)
 		return status;
 
+got:
 	gsp->pos = gsp->base;
 
 	gsp->end = (char *)gsp->base + gsp->extent;
@@ -129,6 +178,34 @@ fprintf(stderr, "nextread %lu, remaining %lu\n",
     return fault_v1hs(gsp, nextread);
 }
 
+/*
+ * Advance past 'nskip' bytes without reading them when they are
+ * not in the current buffer, and get the piece that follows.
+ */
+static int
+skip_v1hs(v1hs *gsp, size_t nskip)
+{
+	int status;
+	ptrdiff_t incr;
+
+	if((char *)gsp->pos + nskip <= (char *)gsp->end)
+	{
+		gsp->pos = (void *)((char *)gsp->pos + nskip);
+		return NC_NOERR;
+	}
+	incr = (char *)gsp->pos - (char *)gsp->base;
+	status = rel_v1hs(gsp);
+	if(status)
+		return status;
+	gsp->offset += incr + (off_t)nskip;
+	/* A header always continues after the skipped bytes */
+	return fault_v1hs(gsp, 0);
+}
+
+/* Offset in the file of the current position */
+#define V1HS_OFFSET(gsp) \
+	((gsp)->offset + ((char *)(gsp)->pos - (char *)(gsp)->base))
+
 /* End v1hs */
 
 /* Write a size_t to the header */
@@ -755,6 +832,27 @@ v1h_get_NC_attr(v1hs *gsp, NC_attr **attrpp)
     if(status != NC_NOERR)
 		goto unwind_name;
 
+	if(gsp->lazy != NULL
+		&& ncmpix_len_nctype(type) * nelems >= NC_ATTR_LAZY_MIN)
+	{
+		/* Leave the value in the file until it is used */
+		attrp = new_x_NC_attr_lazy(strp, type, nelems,
+				gsp->lazy, V1HS_OFFSET(gsp));
+		if(attrp == NULL)
+		{
+			status = NC_ENOMEM;
+			goto unwind_name;
+		}
+		status = skip_v1hs(gsp, attrp->xsz);
+		if(status != NC_NOERR)
+		{
+			free_NC_attr(attrp); /* frees strp */
+			return status;
+		}
+		*attrpp = attrp;
+		return NC_NOERR;
+	}
+
 	attrp = new_x_NC_attr(strp, type, nelems);
 	if(attrp == NULL)
 	{
@@ -1312,19 +1410,119 @@ ncx_len_NC(const NC3_INFO* ncp, size_t sizeof_off_t)
 }
 
 
+/*
+ * Read the value of an attribute that was left in the file when
+ * the header was read, in pieces the i/o layer can take.
+ * A no-op for attributes whose value is in memory.
+ */
+int
+NC_load_attrV(NC_attr *attrp)
+{
+	int status = NC_NOERR;
+	NC3_INFO *ncp = attrp->lazy;
+	size_t remaining = attrp->xsz;
+	off_t offset = attrp->xoff;
+	char *value = NULL;
+	char *vp;
+	size_t perchunk;
+#if USE_STRICT_NULL_BYTE_HEADER_PADDING
+	size_t padding;
+#endif /* USE_STRICT_NULL_BYTE_HEADER_PADDING */
+
+	if(ncp == NULL)
+		return NC_NOERR;
+	perchunk = (ncp->chunk > 0 ? ncp->chunk : 4096);
+
+	value = (char *)malloc(attrp->xsz);
+	if(value == NULL)
+		return NC_ENOMEM;
+	for(vp = value; remaining > 0; /*NADA*/)
+	{
+		const size_t nget = MIN(perchunk, remaining);
+		void *xp = NULL;
+
+		status = ncio_get(ncp->nciop, offset, nget, 0, &xp);
+		if(status != NC_NOERR)
+			goto done;
+		(void) memcpy(vp, xp, nget);
+		status = ncio_rel(ncp->nciop, offset, 0);
+		if(status != NC_NOERR)
+			goto done;
+		vp += nget;
+		offset += (off_t)nget;
+		remaining -= nget;
+	}
+
+#if USE_STRICT_NULL_BYTE_HEADER_PADDING
+	padding = attrp->xsz - ncmpix_len_nctype(attrp->type) * attrp->nelems;
+	if (padding > 0) {
+		/* CDF specification: Header padding uses null (\x00) bytes. */
+		char pad[X_ALIGN-1];
+		memset(pad, 0, X_ALIGN-1);
+		if (memcmp(value + attrp->xsz - padding, pad, (size_t)padding) != 0)
+		{
+			status = NC_ENULLPAD;
+			goto done;
+		}
+	}
+#endif
+
+	attrp->xvalue = value;
+	value = NULL;
+	attrp->lazy = NULL;
+
+done:
+	free(value);
+	return status;
+}
+
+
+/* Read the deferred attribute values of an attribute array */
+static int
+NC_load_attrarrayV(const NC_attrarray *ncap)
+{
+	size_t i;
+	for(i = 0; i < ncap->nelems; i++)
+	{
+		const int status = NC_load_attrV(ncap->value[i]);
+		if(status != NC_NOERR)
+			return status;
+	}
+	return NC_NOERR;
+}
+
+
 /* Write the file header */
 int
 ncx_put_NC(const NC3_INFO* ncp, void **xpp, off_t offset, size_t extent)
 {
     int status = NC_NOERR;
 	v1hs ps; /* the get stream */
+	size_t i;
 
 	assert(ncp != NULL);
 
+	/*
+	 * Deferred attribute values are read before the header
+	 * is overwritten.
+	 */
+	status = NC_load_attrarrayV(&ncp->attrs);
+	if(status != NC_NOERR)
+		return status;
+	for(i = 0; i < ncp->vars.nelems; i++)
+	{
+		status = NC_load_attrarrayV(&ncp->vars.value[i]->attrs);
+		if(status != NC_NOERR)
+			return status;
+	}
+
 	/* Initialize stream ps */
 
 	ps.nciop = ncp->nciop;
 	ps.flags = RGN_WRITE;
+	ps.filesize = 0;
+	ps.grow = 0;
+	ps.lazy = NULL;
 
 	if (ncp->flags & NC_64BIT_DATA)
 	  ps.version = 5;
@@ -1429,6 +1627,10 @@ nc_get_NC(NC3_INFO* ncp)
 	gs.version = 0;
 	gs.base = NULL;
 	gs.pos = gs.base;
+	gs.filesize = 0;
+	gs.grow = 1;
+	/* Another process may rewrite the header of a shared file */
+	gs.lazy = fIsSet(ncp->nciop->ioflags, NC_SHARE) ? NULL : ncp;
 
 	{
 		/*
@@ -1437,11 +1639,13 @@ nc_get_NC(NC3_INFO* ncp)
 	        off_t filesize;
 		size_t extent = ncp->xsz;
 
+	        status = ncio_filesize(ncp->nciop, &filesize);
+		if(status)
+		    return status;
+		gs.filesize = filesize;
+
 		if(extent <= ((fIsSet(ncp->flags, NC_64BIT_DATA))?MIN_NC5_XSZ:MIN_NC3_XSZ))
 		{
-		        status = ncio_filesize(ncp->nciop, &filesize);
-			if(status)
-			    return status;
 			if(filesize < sizeof(ncmagic)) { /* too small, not netcdf */
 
 			    status = NC_ENOTNC;
@@ -1110,6 +1110,7 @@ nc4_type_list_add(NC_GRP_INFO_T *grp, size_t size, const char *name,
 
     /* Increment the ref. count on the type */
     new_type->rc++;
+    new_type->container = grp;
 
     /* Add object to lists */
     ncindexadd(grp->type, (NC_OBJ *)new_type);
@@ -1176,6 +1177,19 @@ nc4_field_list_add(NC_TYPE_INFO_T *parent, const char *name,
     field->hdr.id = nclistlength(parent->u.c.field);
     nclistpush(parent->u.c.field,field);
 
+    /* The layout changed, so drop any walk plans; plans of other
+       types may refer to the plan of this one. */
+    {
+        NClist* alltypes = parent->container->nc4_info->alltypes;
+        int i;
+        for(i=0;i<nclistlength(alltypes);i++) {
+            NC_TYPE_INFO_T* type = (NC_TYPE_INFO_T*)nclistget(alltypes,i);
+            if(type == NULL) continue;
+            NC_free_walkplan(type->walkplan);
+            type->walkplan = NULL;
+        }
+    }
+
     return NC_NOERR;
 }
 
@@ -1271,6 +1285,9 @@ nc4_type_free(NC_TYPE_INFO_T *type)
         /* Free the name. */
         free(type->hdr.name);
 
+        /* Free the cached walk plan. */
+        NC_free_walkplan(type->walkplan);
+
         /* Enums and compound types have lists of fields to clean up. */
         switch (type->nc_type_class)
         {
@@ -1414,6 +1431,9 @@ var_free(NC_VAR_INFO_T *var)
     if (var->chunksizes)
         free(var->chunksizes);
 
+    if (var->access_shape)
+        free(var->access_shape);
+
     if (var->alt_name)
         free(var->alt_name);
 
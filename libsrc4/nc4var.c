@@ -21,6 +21,14 @@
 /** @internal Default size for unlimited dim chunksize. */
 #define DEFAULT_1D_UNLIM_SIZE (4096)
 
+/** @internal Number of records an unlimited dimension is expected to
+ * reach when chunks are chosen for an access hint. */
+#define ACCESS_UNLIM_RECORDS (1024)
+
+/** @internal Chunks chosen for an access hint are grown to about this
+ * many bytes, so that other reads do not touch too many chunks. */
+#define ACCESS_MIN_CHUNK_SIZE (1048576)
+
 /* Define log_e for 10 and 2. Prefer constants defined in math.h,
  * however, GCC environments can have hard time defining M_LN10/M_LN2
  * despite finding math.h */
@@ -1776,6 +1784,10 @@ nc4_find_default_chunksizes2(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var)
             return NC_ENOMEM;
     }
 
+    /* Shape the chunks after the reads of the access hint, if any. */
+    if (var->access_hint != NC_ACCESS_BALANCED)
+        return nc4_find_hint_chunksizes(var, type_size);
+
     /* How many values in the variable (or one record, if there are
      * unlimited dimensions). */
     for (d = 0; d < var->ndims; d++)
@@ -1866,6 +1878,261 @@ nc4_find_default_chunksizes2(NC_GRP_INFO_T *grp, NC_VAR_INFO_T *var)
     return NC_NOERR;
 }
 
+/**
+ * @internal Length of a dimension of a variable, as used for access
+ * hints. An unlimited dimension is expected to grow to at least
+ * ACCESS_UNLIM_RECORDS records.
+ *
+ * @param var Pointer to the var info.
+ * @param d Dimension index.
+ *
+ * @return The length.
+ */
+static size_t
+hint_dimlen(const NC_VAR_INFO_T *var, int d)
+{
+    size_t len = var->dim[d]->len;
+    if (var->dim[d]->unlimited && len < ACCESS_UNLIM_RECORDS)
+        len = ACCESS_UNLIM_RECORDS;
+    return (len ? len : 1);
+}
+
+/**
+ * @internal Get the shape of the reads described by the access hint
+ * of a variable. The first dimension is the time dimension. For
+ * ::NC_ACCESS_BALANCED, the whole variable is returned.
+ *
+ * @param var Pointer to the var info.
+ * @param shape Gets ndims lengths.
+ */
+static void
+hint_shape(const NC_VAR_INFO_T *var, size_t *shape)
+{
+    int d;
+
+    for (d = 0; d < var->ndims; d++)
+    {
+        size_t len = hint_dimlen(var, d);
+        switch (var->access_hint)
+        {
+        case NC_ACCESS_TIMESERIES:
+            shape[d] = (d == 0 ? len : 1);
+            break;
+        case NC_ACCESS_SPATIAL:
+            shape[d] = (d == 0 ? 1 : len);
+            break;
+        case NC_ACCESS_SHAPE:
+            shape[d] = var->access_shape[d];
+            if (shape[d] == 0 || shape[d] > len)
+                shape[d] = len;
+            break;
+        default:
+            shape[d] = len;
+            break;
+        }
+    }
+}
+
+/**
+ * @internal Record the access hint of a variable.
+ *
+ * @param var Pointer to the var info.
+ * @param hint One of ::NC_ACCESS_BALANCED, ::NC_ACCESS_TIMESERIES,
+ * ::NC_ACCESS_SPATIAL or ::NC_ACCESS_SHAPE.
+ * @param shape For ::NC_ACCESS_SHAPE, ndims lengths; otherwise ignored.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EINVAL Bad hint, or no shape for ::NC_ACCESS_SHAPE.
+ * @returns ::NC_ENOMEM Out of memory.
+ */
+int
+nc4_set_access_hint(NC_VAR_INFO_T *var, int hint, const size_t *shape)
+{
+    size_t *newshape = NULL;
+
+    switch (hint)
+    {
+    case NC_ACCESS_BALANCED:
+    case NC_ACCESS_TIMESERIES:
+    case NC_ACCESS_SPATIAL:
+        break;
+    case NC_ACCESS_SHAPE:
+        if (shape == NULL && var->ndims > 0)
+            return NC_EINVAL;
+        if (var->ndims > 0)
+        {
+            if (!(newshape = malloc(var->ndims * sizeof(size_t))))
+                return NC_ENOMEM;
+            memcpy(newshape, shape, var->ndims * sizeof(size_t));
+        }
+        break;
+    default:
+        return NC_EINVAL;
+    }
+
+    if (var->access_shape)
+        free(var->access_shape);
+    var->access_shape = newshape;
+    var->access_hint = hint;
+    return NC_NOERR;
+}
+
+/**
+ * @internal Determine chunksizes for a variable from its access hint.
+ *
+ * The chunks take the shape of the hinted reads, so that a read
+ * touches as few chunks as possible. Chunks bigger than
+ * DEFAULT_CHUNK_SIZE bytes are shrunk along the dimensions the reads
+ * span. Chunks smaller than ACCESS_MIN_CHUNK_SIZE bytes are grown
+ * along the other dimensions, which keeps reads of other shapes from
+ * touching too many chunks.
+ *
+ * @param var Pointer to the var info.
+ * @param type_size Size in bytes of a value.
+ *
+ * @returns ::NC_NOERR for success
+ * @returns ::NC_ENOMEM Out of memory.
+ */
+int
+nc4_find_hint_chunksizes(NC_VAR_INFO_T *var, size_t type_size)
+{
+    size_t shape[NC_MAX_VAR_DIMS];
+    double len[NC_MAX_VAR_DIMS];
+    double chunk[NC_MAX_VAR_DIMS];
+    double maxvals, minvals, product;
+    int d, pass;
+
+    if (var->ndims == 0)
+        return NC_NOERR;
+    if (var->chunksizes == NULL)
+        if (!(var->chunksizes = calloc(var->ndims, sizeof(size_t))))
+            return NC_ENOMEM;
+    if (type_size == 0)
+        type_size = 1;
+
+    maxvals = (double)DEFAULT_CHUNK_SIZE / type_size;
+    minvals = (double)(ACCESS_MIN_CHUNK_SIZE < DEFAULT_CHUNK_SIZE ?
+                       ACCESS_MIN_CHUNK_SIZE : DEFAULT_CHUNK_SIZE) / type_size;
+    if (maxvals < 1)
+        maxvals = 1;
+
+    hint_shape(var, shape);
+    for (d = 0; d < var->ndims; d++)
+    {
+        len[d] = (double)hint_dimlen(var, d);
+        chunk[d] = (double)shape[d];
+    }
+
+    /* Scale the free dimensions by a common factor; a dimension that
+     * hits a bound drops out, and the rest are scaled again. */
+    for (pass = 0; pass <= var->ndims; pass++)
+    {
+        double target, factor;
+        int nfree = 0, shrink;
+
+        for (product = 1, d = 0; d < var->ndims; d++)
+            product *= chunk[d];
+        if (product > maxvals)
+            shrink = 1, target = maxvals;
+        else if (product < minvals)
+            shrink = 0, target = minvals;
+        else
+            break;
+
+        for (d = 0; d < var->ndims; d++)
+            if (shrink ? chunk[d] > 1 : chunk[d] < len[d])
+                nfree++;
+        if (nfree == 0)
+            break;
+        factor = pow(target / product, 1.0 / nfree);
+        for (d = 0; d < var->ndims; d++)
+            if (shrink ? chunk[d] > 1 : chunk[d] < len[d])
+            {
+                chunk[d] *= factor;
+                if (chunk[d] < 1)
+                    chunk[d] = 1;
+                if (chunk[d] > len[d])
+                    chunk[d] = len[d];
+            }
+    }
+
+    for (d = 0; d < var->ndims; d++)
+    {
+        var->chunksizes[d] = (size_t)chunk[d];
+        if (var->chunksizes[d] == 0)
+            var->chunksizes[d] = 1;
+        LOG((4, "%s: name %s dim %d hint %d chunksize %ld", __func__,
+             var->hdr.name, d, var->access_hint, var->chunksizes[d]));
+    }
+
+    return NC_NOERR;
+}
+
+/**
+ * @internal Get the chunk cache size that suits the access hint of a
+ * variable: enough to hold the chunks touched by one hinted read, but
+ * at least dfalt and at most MAX_DEFAULT_CACHE_SIZE bytes.
+ *
+ * @param var Pointer to the var info.
+ * @param type_size Size in bytes of a value.
+ * @param dfalt Default cache size.
+ *
+ * @return The cache size; dfalt for ::NC_ACCESS_BALANCED.
+ */
+size_t
+nc4_access_hint_cache_size(const NC_VAR_INFO_T *var, size_t type_size, size_t dfalt)
+{
+    size_t shape[NC_MAX_VAR_DIMS];
+    double size = (double)type_size;
+    int d;
+
+    if (var->access_hint == NC_ACCESS_BALANCED || var->ndims == 0 ||
+        var->chunksizes == NULL || var->chunksizes[0] == 0)
+        return dfalt;
+
+    hint_shape(var, shape);
+    for (d = 0; d < var->ndims; d++)
+    {
+        size_t nchunks = (shape[d] + var->chunksizes[d] - 1) / var->chunksizes[d];
+        size *= (double)nchunks * (double)var->chunksizes[d];
+    }
+    if (size > MAX_DEFAULT_CACHE_SIZE)
+        size = MAX_DEFAULT_CACHE_SIZE;
+    return (size > dfalt ? (size_t)size : dfalt);
+}
+
+/**
+ * @internal Get the access hint of a variable. This is
+ * nc_inq_var_access_hint() for the netCDF-4 based formats.
+ *
+ * @param ncid File and group ID.
+ * @param varid Variable ID.
+ * @param hintp Gets the hint. Ignored if NULL.
+ * @param shapep Gets the expected read shape, ndims lengths, for
+ * ::NC_ACCESS_SHAPE; otherwise the shape that the hint implies.
+ * Ignored if NULL.
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Bad varid.
+ */
+int
+NC4_inq_var_access_hint(int ncid, int varid, int *hintp, size_t *shapep)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    int retval;
+
+    if ((retval = nc4_find_grp_h5_var(ncid, varid, &h5, &grp, &var)))
+        return retval;
+    if (hintp)
+        *hintp = var->access_hint;
+    if (shapep)
+        hint_shape(var, shapep);
+    return NC_NOERR;
+}
+
 /**
  * @internal Get the default fill value for an atomic type. Memory for
  * fill_value must already be allocated, or you are DOOMED!
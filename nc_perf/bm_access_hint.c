@@ -0,0 +1,164 @@
+/* This is part of the netCDF package. Copyright 2018 University
+   Corporation for Atmospheric Research/Unidata See COPYRIGHT file for
+   conditions of use. See www.unidata.ucar.edu for more info.
+
+   This program benchmarks the read costs of the chunk shapes chosen
+   by nc_def_var_access_hint(). For each hint it writes a (time, y, x)
+   float variable, then reads time series at random points and whole
+   spatial slices at random times, and prints the chunk shape, the
+   number of chunks and bytes one read of each kind touches, and the
+   time taken.
+*/
+
+#include <config.h>
+#include <nc_tests.h>
+#include "err_macros.h"
+#include <netcdf_meta.h>
+#include <time.h>
+#include <sys/time.h> /* Extra high precision time info. */
+
+#define FILE_NAME "tst_access_hint_bm.nc"
+#define NCZ_FILE_NAME "file://tst_access_hint_bm.file#mode=nczarr,file"
+#define NDIMS 3
+#define NT 730
+#define NY 90
+#define NX 180
+#define NSERIES 100
+#define NSLICES 50
+#define NHINTS 4
+
+int nc4_timeval_subtract(struct timeval *result, struct timeval *x,
+                         struct timeval *y);
+
+static const int hints[NHINTS] = {NC_ACCESS_BALANCED, NC_ACCESS_TIMESERIES,
+                                  NC_ACCESS_SPATIAL, NC_ACCESS_SHAPE};
+static const char *hint_names[NHINTS] = {"balanced", "timeseries", "spatial",
+                                         "shape"};
+/* For NC_ACCESS_SHAPE: a month of a 30x30 region */
+static size_t region[NDIMS] = {30, 30, 30};
+
+static double
+elapsed(struct timeval *start_time)
+{
+   struct timeval end_time, diff_time;
+   gettimeofday(&end_time, NULL);
+   nc4_timeval_subtract(&diff_time, &end_time, start_time);
+   return diff_time.tv_sec + diff_time.tv_usec / (double)MILLION;
+}
+
+/* Chunks and bytes touched by a read of the given shape at the origin */
+static void
+read_cost(const size_t *chunks, const size_t *count, size_t *nchunksp,
+          double *mbp)
+{
+   size_t nchunks = 1;
+   double bytes = sizeof(float);
+   int d;
+   for (d = 0; d < NDIMS; d++)
+   {
+      size_t n = (count[d] + chunks[d] - 1) / chunks[d];
+      nchunks *= n;
+      bytes *= (double)(n * chunks[d]);
+   }
+   *nchunksp = nchunks;
+   *mbp = bytes / MILLION;
+}
+
+/* Time NREADS reads of the given shape at random positions. */
+static int
+time_reads(const char *path, int hint, const size_t *count, int nreads,
+           float *buf, double *secp)
+{
+   int ncid, varid, r, d;
+   size_t start[NDIMS];
+   size_t dimlen[NDIMS] = {NT, NY, NX};
+   struct timeval start_time;
+
+   srand(17);
+   gettimeofday(&start_time, NULL);
+   if (nc_open(path, NC_NOWRITE, &ncid)) ERR;
+   if (nc_inq_varid(ncid, "tas", &varid)) ERR;
+   if (nc_def_var_access_hint(ncid, varid, hint, region)) ERR;
+   for (r = 0; r < nreads; r++)
+   {
+      for (d = 0; d < NDIMS; d++)
+         start[d] = (size_t)rand() % (dimlen[d] - count[d] + 1);
+      if (nc_get_vara_float(ncid, varid, start, count, buf)) ERR;
+      /* The values encode their indices. */
+      if (buf[0] != (float)(start[0] * 10000 + start[1] * NX + start[2])) ERR;
+   }
+   if (nc_close(ncid)) ERR;
+   *secp = elapsed(&start_time);
+   return 0;
+}
+
+static int
+bench(const char *path, int unlimited)
+{
+   size_t series[NDIMS] = {NT, 1, 1};
+   size_t slice[NDIMS] = {1, NY, NX};
+   float *buf;
+   int h;
+
+   if (!(buf = malloc(NT * NY * NX * sizeof(float)))) ERR;
+   printf("\n%-10s %-15s %17s %17s %17s\n", "hint", "chunks", "series chunks/MB",
+          "slice chunks/MB", "region chunks/MB");
+   for (h = 0; h < NHINTS; h++)
+   {
+      int ncid, varid, dimids[NDIMS];
+      size_t chunks[NDIMS], start[NDIMS] = {0, 0, 0};
+      size_t count[NDIMS] = {NT, NY, NX};
+      size_t nseries, nslice, nregion;
+      double mbseries, mbslice, mbregion, write_sec, series_sec, slice_sec;
+      struct timeval start_time;
+      size_t t, i;
+
+      /* Write the whole variable at once; slice-at-a-time writes into
+         time series chunks would measure the chunk cache instead. */
+      gettimeofday(&start_time, NULL);
+      if (nc_create(path, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "time", unlimited ? NC_UNLIMITED : NT, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "y", NY, &dimids[1])) ERR;
+      if (nc_def_dim(ncid, "x", NX, &dimids[2])) ERR;
+      if (nc_def_var(ncid, "tas", NC_FLOAT, NDIMS, dimids, &varid)) ERR;
+      if (nc_def_var_access_hint(ncid, varid, hints[h], region)) ERR;
+      if (nc_inq_var_chunking(ncid, varid, NULL, chunks)) ERR;
+      for (t = 0; t < NT; t++)
+         for (i = 0; i < NY * NX; i++)
+            buf[t * NY * NX + i] = (float)(t * 10000 + i);
+      if (nc_put_vara_float(ncid, varid, start, count, buf)) ERR;
+      if (nc_close(ncid)) ERR;
+      write_sec = elapsed(&start_time);
+
+      if (time_reads(path, hints[h], series, NSERIES, buf, &series_sec)) ERR;
+      if (time_reads(path, hints[h], slice, NSLICES, buf, &slice_sec)) ERR;
+
+      read_cost(chunks, series, &nseries, &mbseries);
+      read_cost(chunks, slice, &nslice, &mbslice);
+      read_cost(chunks, region, &nregion, &mbregion);
+      printf("%-10s %4d x%3d x%3d %8d %8.2f %8d %8.2f %8d %8.2f\n",
+             hint_names[h], (int)chunks[0], (int)chunks[1], (int)chunks[2],
+             (int)nseries, mbseries, (int)nslice, mbslice, (int)nregion, mbregion);
+      printf("%-10s write %.3f s, %d series %.3f s, %d slices %.3f s\n", "",
+             write_sec, NSERIES, series_sec, NSLICES, slice_sec);
+   }
+   free(buf);
+   return 0;
+}
+
+int
+main(void)
+{
+   printf("\n*** Benchmarking access hints for a %dx%dx%d float variable.\n",
+          NT, NY, NX);
+   printf("*** benchmarking with HDF5...");
+   if (bench(FILE_NAME, 1)) ERR;
+   SUMMARIZE_ERR;
+#if NC_HAS_NCZARR
+   printf("*** benchmarking with NCZarr...");
+   /* NCZarr has no unlimited dimensions */
+   if (bench(NCZ_FILE_NAME, 0)) ERR;
+   SUMMARIZE_ERR;
+#endif
+   FINAL_RESULTS;
+}
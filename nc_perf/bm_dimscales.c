@@ -0,0 +1,128 @@
+/* This is part of the netCDF package. Copyright 2018 University
+   Corporation for Atmospheric Research/Unidata See COPYRIGHT file for
+   conditions of use. See www.unidata.ucar.edu for more info.
+
+   This program benchmarks opening an HDF5 file with many datasets
+   and many dimension scales. The file is written with the HDF5 API,
+   so it has no _Netcdf4Coordinates attributes, and netCDF has to
+   match the attached scale of every dimension of every dataset on
+   open.
+*/
+
+#include <config.h>
+#include <nc_tests.h>
+#include "err_macros.h"
+#include <netcdf.h>
+#include <hdf5.h>
+#include <H5DSpublic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h> /* Extra high precision time info. */
+
+/* We will create this file. */
+#define FILE_NAME "bm_dimscales.h5"
+
+#define NUM_GRPS 4
+#define NUM_REPS 5
+
+/* Prototype from tst_utils.c. */
+int nc4_timeval_subtract(struct timeval *result, struct timeval *x,
+                         struct timeval *y);
+
+int main(int argc, char **argv)
+{
+    struct timeval start_time, end_time, diff_time;
+    double sec;
+    int ndims = 500;		/* default number of dimension scales */
+    int nvars = 4000;		/* default number of datasets */
+    hid_t fcpl_id, file_id, spaceid, dsetid;
+    hid_t grp_id[NUM_GRPS];
+    hid_t *scale_id;
+    hsize_t len, dims[2];
+    char name[NC_MAX_NAME + 1];
+    int ncid, nvars_in;
+    int i, r;
+
+    if(argc != 1 && argc != 3) { 	/* Usage */
+	printf("NetCDF performance test, opening a file with many dimension scales.\n");
+	printf("Usage:\t%s [NDIMS NVARS]\n", argv[0]);
+	printf("\tNDIMS: number of dimension scales\n");
+	printf("\tNVARS: number of 2-D datasets\n");
+	return(0);
+    }
+    if(argc == 3) {
+	ndims = atoi(argv[1]);
+	nvars = atoi(argv[2]);
+    }
+    if (ndims < 1 || nvars < 1) ERR;
+    if (!(scale_id = malloc((size_t)ndims * sizeof(hid_t)))) ERR;
+
+    /* Create the file. Scales are spread over the root group and its
+     * subgroups, datasets all live in the last subgroup, so that
+     * scales are found both locally and in ancestor groups. */
+    if ((fcpl_id = H5Pcreate(H5P_FILE_CREATE)) < 0) ERR;
+    if (H5Pset_link_creation_order(fcpl_id, H5P_CRT_ORDER_TRACKED|H5P_CRT_ORDER_INDEXED) < 0) ERR;
+    if (H5Pset_attr_creation_order(fcpl_id, H5P_CRT_ORDER_TRACKED|H5P_CRT_ORDER_INDEXED) < 0) ERR;
+    if ((file_id = H5Fcreate(FILE_NAME, H5F_ACC_TRUNC, fcpl_id, H5P_DEFAULT)) < 0) ERR;
+    grp_id[0] = file_id;
+    for (i = 1; i < NUM_GRPS; i++) {
+	snprintf(name, sizeof(name), "group%d", i);
+	if ((grp_id[i] = H5Gcreate2(grp_id[i - 1], name, H5P_DEFAULT, fcpl_id,
+				    H5P_DEFAULT)) < 0) ERR;
+    }
+    if (H5Pclose(fcpl_id) < 0) ERR;
+
+    for (i = 0; i < ndims; i++) {
+	len = (hsize_t)(i % 10) + 1;
+	snprintf(name, sizeof(name), "dim%d", i);
+	if ((spaceid = H5Screate_simple(1, &len, NULL)) < 0) ERR;
+	if ((scale_id[i] = H5Dcreate2(grp_id[i % NUM_GRPS], name, H5T_NATIVE_INT,
+				      spaceid, H5P_DEFAULT, H5P_DEFAULT,
+				      H5P_DEFAULT)) < 0) ERR;
+	if (H5Sclose(spaceid) < 0) ERR;
+	if (H5DSset_scale(scale_id[i], name) < 0) ERR;
+    }
+    for (i = 0; i < nvars; i++) {
+	int d0 = i % ndims, d1 = (i / ndims + i + 1) % ndims;
+	dims[0] = (hsize_t)(d0 % 10) + 1;
+	dims[1] = (hsize_t)(d1 % 10) + 1;
+	snprintf(name, sizeof(name), "var%d", i);
+	if ((spaceid = H5Screate_simple(2, dims, NULL)) < 0) ERR;
+	if ((dsetid = H5Dcreate2(grp_id[NUM_GRPS - 1], name, H5T_NATIVE_INT,
+				 spaceid, H5P_DEFAULT, H5P_DEFAULT,
+				 H5P_DEFAULT)) < 0) ERR;
+	if (H5DSattach_scale(dsetid, scale_id[d0], 0) < 0) ERR;
+	if (H5DSattach_scale(dsetid, scale_id[d1], 1) < 0) ERR;
+	if (H5Dclose(dsetid) < 0) ERR;
+	if (H5Sclose(spaceid) < 0) ERR;
+    }
+    for (i = 0; i < ndims; i++)
+	if (H5Dclose(scale_id[i]) < 0) ERR;
+    for (i = NUM_GRPS - 1; i > 0; i--)
+	if (H5Gclose(grp_id[i]) < 0) ERR;
+    if (H5Fclose(file_id) < 0) ERR;
+    free(scale_id);
+
+    /* Time opening the file. */
+    if (gettimeofday(&start_time, NULL)) ERR;
+    for (r = 0; r < NUM_REPS; r++) {
+	int grpid = 0;
+	if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+	for (i = 1; i < NUM_GRPS; i++) {
+	    snprintf(name, sizeof(name), "group%d", i);
+	    if (nc_inq_grp_ncid(i == 1 ? ncid : grpid, name, &grpid)) ERR;
+	}
+	if (nc_inq_nvars(grpid, &nvars_in)) ERR;
+	if (nvars_in < nvars) ERR;
+	if (nc_close(ncid)) ERR;
+    }
+    if (gettimeofday(&end_time, NULL)) ERR;
+    if (nc4_timeval_subtract(&diff_time, &end_time, &start_time)) ERR;
+    sec = diff_time.tv_sec + 1.0e-6 * diff_time.tv_usec;
+    printf("%d dimension scales, %d datasets: open %.3g sec\n",
+	   ndims, nvars, sec / NUM_REPS);
+
+    SUMMARIZE_ERR;
+    FINAL_RESULTS;
+}
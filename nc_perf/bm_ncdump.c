@@ -0,0 +1,117 @@
+/* This is part of the netCDF package. Copyright 2018 University
+   Corporation for Atmospheric Research/Unidata See COPYRIGHT file for
+   conditions of use. See www.unidata.ucar.edu for more info.
+
+   This program benchmarks the throughput of ncdump on a large float
+   variable. It creates a file, then runs the ncdump named on the
+   command line on it, once reading a single row of values at a time
+   (-m 1) and once with the default read buffer, and checks that both
+   produce the same output.
+*/
+
+#include <config.h>
+#include <nc_tests.h>
+#include "err_macros.h"
+#include <time.h>
+#include <sys/time.h> /* Extra high precision time info. */
+
+/* We will create this file. */
+#define FILE_NAME "tst_ncdump_floats.nc"
+#define NDIMS 3
+#define NZ 200
+#define NY 100
+#define NX 200
+#define BUF_LEN 65536
+#define CMD_LEN 4096
+
+int nc4_timeval_subtract(struct timeval *result, struct timeval *x,
+                         struct timeval *y);
+
+/* Run ncdump on the file with the given -m option, timing it and
+ * computing the length and a checksum of its output. */
+static int
+run_ncdump(const char *ncdump, const char *bufsize, size_t *lenp,
+           unsigned long *sump, double *secp)
+{
+   char cmd[CMD_LEN];
+   char *buf;
+   FILE *fp;
+   size_t n, i;
+   unsigned long sum = 5381;
+   struct timeval start_time, end_time, diff_time;
+
+   if (!(buf = malloc(BUF_LEN))) return NC_ENOMEM;
+   snprintf(cmd, CMD_LEN, "%s -m %s -v f %s", ncdump, bufsize, FILE_NAME);
+   *lenp = 0;
+   if (gettimeofday(&start_time, NULL)) {free(buf); return NC_EIO;}
+   if (!(fp = popen(cmd, "r"))) {free(buf); return NC_EIO;}
+   while ((n = fread(buf, 1, BUF_LEN, fp)) > 0)
+   {
+      for (i = 0; i < n; i++)
+         sum = sum * 33 + (unsigned char)buf[i];
+      *lenp += n;
+   }
+   if (pclose(fp)) {free(buf); return NC_EIO;}
+   if (gettimeofday(&end_time, NULL)) {free(buf); return NC_EIO;}
+   if (nc4_timeval_subtract(&diff_time, &end_time, &start_time))
+      {free(buf); return NC_EIO;}
+   *secp = diff_time.tv_sec + diff_time.tv_usec / (double)MILLION;
+   *sump = sum;
+   free(buf);
+   return NC_NOERR;
+}
+
+int
+main(int argc, char **argv)
+{
+   const char *ncdump = argc > 1 ? argv[1] : "ncdump";
+   double data_mb = (double)NZ * NY * NX * sizeof(float) / MILLION;
+
+   printf("\n*** Creating file with %g MB float variable...", data_mb);
+   {
+      int ncid, varid, dimids[NDIMS];
+      size_t start[NDIMS] = {0, 0, 0}, count[NDIMS] = {1, NY, NX};
+      float *data;
+      size_t i;
+      int z;
+
+      if (!(data = malloc(NY * NX * sizeof(float)))) ERR;
+      if (nc_create(FILE_NAME, NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "z", NZ, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "y", NY, &dimids[1])) ERR;
+      if (nc_def_dim(ncid, "x", NX, &dimids[2])) ERR;
+      if (nc_def_var(ncid, "f", NC_FLOAT, NDIMS, dimids, &varid)) ERR;
+      if (nc_enddef(ncid)) ERR;
+      srand(42);
+      for (z = 0; z < NZ; z++)
+      {
+         for (i = 0; i < NY * NX; i++)
+            data[i] = (float)((rand() - RAND_MAX / 2) / 1000.0);
+         start[0] = z;
+         if (nc_put_vara_float(ncid, varid, start, count, data)) ERR;
+      }
+      if (nc_close(ncid)) ERR;
+      free(data);
+   }
+   SUMMARIZE_ERR;
+
+   printf("*** Benchmarking %s...\n", ncdump);
+   {
+      const char *bufsizes[2] = {"1", "5M"};
+      size_t len[2];
+      unsigned long sum[2];
+      double sec[2];
+      int b;
+
+      for (b = 0; b < 2; b++)
+      {
+         if (run_ncdump(ncdump, bufsizes[b], &len[b], &sum[b], &sec[b])) ERR;
+         printf("-m %-3s %8.3f s %10.1f MB/s data %10.1f MB/s text\n",
+                bufsizes[b], sec[b], data_mb / sec[b],
+                len[b] / (double)MILLION / sec[b]);
+      }
+      if (len[0] != len[1] || sum[0] != sum[1]) ERR;
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
@@ -0,0 +1,15 @@
+#!/bin/sh
+
+# This shell runs the ncdump throughput benchmark, which compares
+# reading one row at a time with reading large blocks, and checks
+# that the output is the same.
+
+# Load common values for netCDF shell script tests.
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+echo ""
+echo "*** Running benchmarking program bm_ncdump..."
+${execdir}/bm_ncdump ${NCDUMP}
+echo '*** SUCCESS!!!'
+exit 0
@@ -0,0 +1,151 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test that repeated reads of the same hyperslab shape return the right
+data for netCDF-4/HDF5 and NCZarr, which keep the selection or the
+chunk projections of recent shapes. Shapes are read at many starts,
+interleaved with each other, on edge chunks, and after the unlimited
+dimension grew.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netcdf.h>
+#include <netcdf_meta.h>
+
+#define NT 3
+#define NY 37
+#define NX 29
+#define VAL(t,y,x) ((t)*10000 + (y)*100 + (x))
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+/* Shapes as {count y, count x, stride y, stride x} */
+static const size_t shapes[][4] = {
+    {1, 1, 1, 1}, {1, NX, 1, 1}, {4, 5, 1, 1}, {3, 3, 2, 3},
+    {8, 6, 1, 1}, {2, 7, 5, 1}, {5, 2, 1, 4}, {NY, 1, 1, 1},
+};
+#define NSHAPES (sizeof(shapes)/sizeof(shapes[0]))
+
+static int data[NT][NY][NX];
+
+/* Read every shape at every start that fits, in the given record,
+   cycling through the shapes so that each read changes shape */
+static int
+readall(int ncid, int varid, int t, int pass)
+{
+    int err, nerrs = 0, buf[NY*NX];
+    size_t s, i, y0, x0, y, x;
+    size_t start[3], count[3], ny, nx;
+    ptrdiff_t stride[3];
+
+    for(y0=0;y0<NY;y0++) {
+        for(x0=0;x0<NX;x0 += 1 + pass) {
+            for(s=0;s<NSHAPES;s++) {
+                ny = shapes[s][0]; nx = shapes[s][1];
+                if(y0 + (ny-1)*shapes[s][2] >= NY) continue;
+                if(x0 + (nx-1)*shapes[s][3] >= NX) continue;
+                start[0] = t; start[1] = y0; start[2] = x0;
+                count[0] = 1; count[1] = ny; count[2] = nx;
+                stride[0] = 1;
+                stride[1] = (ptrdiff_t)shapes[s][2];
+                stride[2] = (ptrdiff_t)shapes[s][3];
+                err = nc_get_vars_int(ncid, varid, start, count, stride, buf); CHECK_ERR
+                if(err) return nerrs;
+                for(i=0,y=0;y<ny;y++)
+                    for(x=0;x<nx;x++,i++) {
+                        int exp = data[t][y0+y*shapes[s][2]][x0+x*shapes[s][3]];
+                        if(buf[i] != exp) {
+                            printf("t=%d start=(%zu,%zu) shape=%zu: [%zu] %d != %d\n",
+                                   t, y0, x0, s, i, buf[i], exp);
+                            return nerrs + 1;
+                        }
+                    }
+            }
+        }
+    }
+    return nerrs;
+}
+
+static int
+test(const char* path, int unlimited)
+{
+    int t, y, x, err, nerrs = 0, ncid, dimids[3], varid, varid2;
+    size_t chunks[3] = {1, 8, 6}, chunks2[3] = {1, 5, 29};
+    size_t start[3] = {0, 0, 0}, count[3] = {1, NY, NX};
+    int nrec = unlimited ? NT - 1 : NT;
+
+    printf("\n*** Testing repeated access shapes on %s... ", path);
+
+    for(t=0;t<NT;t++)
+        for(y=0;y<NY;y++)
+            for(x=0;x<NX;x++) data[t][y][x] = VAL(t,y,x);
+
+    err = nc_create(path, NC_NETCDF4|NC_CLOBBER, &ncid); CHECK_ERR
+    err = nc_def_dim(ncid, "t", unlimited ? NC_UNLIMITED : NT, &dimids[0]); CHECK_ERR
+    err = nc_def_dim(ncid, "y", NY, &dimids[1]); CHECK_ERR
+    err = nc_def_dim(ncid, "x", NX, &dimids[2]); CHECK_ERR
+    err = nc_def_var(ncid, "v", NC_INT, 3, dimids, &varid); CHECK_ERR
+    err = nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks); CHECK_ERR
+    err = nc_def_var(ncid, "w", NC_INT, 3, dimids, &varid2); CHECK_ERR
+    err = nc_def_var_chunking(ncid, varid2, NC_CHUNKED, chunks2); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    for(t=0;t<nrec;t++) {
+        start[0] = t;
+        err = nc_put_vara_int(ncid, varid, start, count, &data[t][0][0]); CHECK_ERR
+        err = nc_put_vara_int(ncid, varid2, start, count, &data[t][0][0]); CHECK_ERR
+    }
+    err = nc_close(ncid); CHECK_ERR
+
+    err = nc_open(path, NC_WRITE, &ncid); CHECK_ERR
+    for(t=0;t<nrec;t++) {
+        nerrs += readall(ncid, varid, t, t);
+        nerrs += readall(ncid, varid2, t, t);
+    }
+
+    /* Grow the record dimension, or rewrite the last record, then read again */
+    start[0] = NT - 1;
+    for(y=0;y<NY;y++)
+        for(x=0;x<NX;x++) data[NT-1][y][x] = -VAL(NT-1,y,x);
+    err = nc_put_vara_int(ncid, varid, start, count, &data[NT-1][0][0]); CHECK_ERR
+    nerrs += readall(ncid, varid, NT-1, 0);
+    nerrs += readall(ncid, varid, 0, 1);
+    err = nc_close(ncid); CHECK_ERR
+
+    printf("%s", nerrs ? "FAILED" : "ok");
+    return nerrs;
+}
+
+int main(int argc, char *argv[])
+{
+    int nerrs = 0;
+
+#if NC_HAS_HDF5
+    nerrs += test("tst_access_plans_nc4.nc", 1);
+    nerrs += test("tst_access_plans_nc4fixed.nc", 0);
+#endif
+#if NC_HAS_NCZARR
+    /* NCZarr does not support unlimited dimensions */
+    nerrs += test("file://tst_access_plans_nczarr.file#mode=nczarr,file", 0);
+#endif
+    printf("\n");
+    return (nerrs > 0);
+}
@@ -0,0 +1,179 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test classic, 64-bit offset and CDF-5 files whose header holds many
+variables with large attributes. Such headers are read in growing
+pieces, and the values of large attributes are only read when first
+used. The attributes must read back correctly after opening the file
+read-only, shared, in memory, after an attribute was rewritten in
+place, and after the header grew in redef mode.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netcdf.h>
+#include <netcdf_meta.h>
+#include <netcdf_mem.h>
+
+#define NVARS 3000
+#define NATT 100   /* doubles in attribute "big" of each variable */
+#define NTEXT 5000 /* characters of global attribute "history" */
+#define NX 4
+#define CHANGED 7  /* variable whose "big" attribute is rewritten */
+#define VAL(v,k) ((double)(v)*1000 + (k))
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+static char history[NTEXT];
+
+/* Check every attribute and the data of the first and last variable */
+static int
+verify(int ncid, int changed, int grown)
+{
+    int err, nerrs = 0, v, k, varid, data[NX];
+    double big[NATT];
+    char buf[NTEXT], units[32], name[NC_MAX_NAME+1];
+    size_t len;
+
+    err = nc_get_att_text(ncid, NC_GLOBAL, "history", buf); CHECK_ERR
+    CHECK(memcmp(buf, history, NTEXT) == 0)
+    for (v = 0; v < NVARS; v++) {
+        snprintf(name, sizeof(name), "v%d", v);
+        err = nc_inq_varid(ncid, name, &varid); CHECK_ERR
+        err = nc_inq_attlen(ncid, varid, "big", &len); CHECK_ERR
+        CHECK(len == NATT)
+        err = nc_get_att_double(ncid, varid, "big", big); CHECK_ERR
+        for (k = 0; k < NATT; k++) {
+            double exp = VAL(v,k) + ((changed && v == CHANGED) ? 0.5 : 0);
+            if (big[k] != exp) {
+                printf("v%d big[%d] = %g, expected %g\n", v, k, big[k], exp);
+                return nerrs + 1;
+            }
+        }
+        err = nc_get_att_text(ncid, varid, "units", units); CHECK_ERR
+        CHECK(units[0] == 'm' && units[1] == '/')
+    }
+    for (v = 0; v < NVARS; v += NVARS - 1) {
+        err = nc_get_var_int(ncid, v, data); CHECK_ERR
+        for (k = 0; k < NX; k++) CHECK(data[k] == v + k)
+    }
+    if (grown) {
+        err = nc_inq_varid(ncid, "added", &varid); CHECK_ERR
+        err = nc_get_att_double(ncid, varid, "big", big); CHECK_ERR
+        CHECK(big[NATT-1] == -1)
+    }
+    return nerrs;
+}
+
+static int
+test(const char* path, int cmode)
+{
+    int err, nerrs = 0, ncid, dimid, varid, v, k, data[NX];
+    double big[NATT];
+    char name[NC_MAX_NAME+1];
+
+    printf("\n*** Testing large headers, format 0x%x... ", cmode);
+
+    err = nc_create(path, cmode|NC_CLOBBER, &ncid); CHECK_ERR
+    err = nc_set_fill(ncid, NC_NOFILL, NULL); CHECK_ERR
+    err = nc_def_dim(ncid, "x", NX, &dimid); CHECK_ERR
+    err = nc_put_att_text(ncid, NC_GLOBAL, "history", NTEXT, history); CHECK_ERR
+    for (v = 0; v < NVARS; v++) {
+        snprintf(name, sizeof(name), "v%d", v);
+        err = nc_def_var(ncid, name, NC_INT, 1, &dimid, &varid); CHECK_ERR
+        for (k = 0; k < NATT; k++) big[k] = VAL(v,k);
+        err = nc_put_att_double(ncid, varid, "big", NC_DOUBLE, NATT, big); CHECK_ERR
+        err = nc_put_att_text(ncid, varid, "units", 4, "m/s"); CHECK_ERR
+    }
+    err = nc_enddef(ncid); CHECK_ERR
+    for (v = 0; v < NVARS; v += NVARS - 1) {
+        for (k = 0; k < NX; k++) data[k] = v + k;
+        err = nc_put_var_int(ncid, v, data); CHECK_ERR
+    }
+    err = nc_close(ncid); CHECK_ERR
+
+    err = nc_open(path, NC_NOWRITE, &ncid); CHECK_ERR
+    nerrs += verify(ncid, 0, 0);
+    err = nc_close(ncid); CHECK_ERR
+
+    /* Shared files read all values with the header */
+    err = nc_open(path, NC_NOWRITE|NC_SHARE, &ncid); CHECK_ERR
+    nerrs += verify(ncid, 0, 0);
+    err = nc_close(ncid); CHECK_ERR
+
+    /* Rewrite an attribute in place, before its value was read */
+    err = nc_open(path, NC_WRITE, &ncid); CHECK_ERR
+    for (k = 0; k < NATT; k++) big[k] = VAL(CHANGED,k) + 0.5;
+    err = nc_put_att_double(ncid, CHANGED, "big", NC_DOUBLE, NATT, big); CHECK_ERR
+    err = nc_close(ncid); CHECK_ERR
+    err = nc_open(path, NC_NOWRITE, &ncid); CHECK_ERR
+    nerrs += verify(ncid, 1, 0);
+    err = nc_close(ncid); CHECK_ERR
+
+    /* Grow the header, which moves the data */
+    err = nc_open(path, NC_WRITE, &ncid); CHECK_ERR
+    err = nc_redef(ncid); CHECK_ERR
+    err = nc_def_var(ncid, "added", NC_INT, 1, &dimid, &varid); CHECK_ERR
+    for (k = 0; k < NATT; k++) big[k] = -1;
+    err = nc_put_att_double(ncid, varid, "big", NC_DOUBLE, NATT, big); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    err = nc_close(ncid); CHECK_ERR
+    err = nc_open(path, NC_NOWRITE, &ncid); CHECK_ERR
+    nerrs += verify(ncid, 1, 1);
+    err = nc_close(ncid); CHECK_ERR
+
+    /* In memory */
+    {
+        FILE* f = fopen(path, "rb");
+        long size;
+        void* mem;
+        CHECK(f != NULL)
+        if (f == NULL) return nerrs;
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        mem = malloc((size_t)size);
+        CHECK(fread(mem, 1, (size_t)size, f) == (size_t)size)
+        fclose(f);
+        err = nc_open_mem(path, NC_NOWRITE, (size_t)size, mem, &ncid); CHECK_ERR
+        nerrs += verify(ncid, 1, 1);
+        err = nc_close(ncid); CHECK_ERR
+        free(mem);
+    }
+
+    printf("%s", nerrs ? "FAILED" : "ok");
+    return nerrs;
+}
+
+int main(int argc, char *argv[])
+{
+    int nerrs = 0, i;
+
+    for (i = 0; i < NTEXT; i++) history[i] = (char)('a' + i % 26);
+
+    nerrs += test("tst_big_header.nc", 0);
+    nerrs += test("tst_big_header_64bit.nc", NC_64BIT_OFFSET);
+#if NC_HAS_CDF5
+    nerrs += test("tst_big_header_cdf5.nc", NC_64BIT_DATA);
+#endif
+    printf("\n");
+    return (nerrs > 0);
+}
@@ -0,0 +1,199 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test that fill values written in large blocks are correct. The same
+file is created through the default posix i/o layer, which writes
+large fills directly, through NC_SHARE, which fills through its page
+buffer, and in memory. The three files must be identical, and every
+value must read back as the fill value. Variables with a zero fill
+value, unpadded records and fills that end in a partial block are
+included.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netcdf.h>
+#include <netcdf_meta.h>
+
+#define NBIG 1500000    /* floats, more than one fill block */
+#define NZERO 2000000   /* ints with a zero _FillValue */
+#define NREC 40000
+#define NR1 3
+#define NR2 7
+#define NR3 5
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+static int
+create(const char* path, int cmode, int onerecvar)
+{
+    int err, nerrs=0, ncid, dimids[2], varid, zero = 0;
+    int tdim, big, zdim, n1, n2, n3;
+    char xfill = 'x';
+    double value = 1.0;
+    size_t index[2] = {NREC-1, 0};
+
+    err = nc_create(path, cmode|NC_CLOBBER, &ncid); CHECK_ERR
+    if(err) return nerrs;
+    err = nc_def_dim(ncid, "time", NC_UNLIMITED, &tdim); CHECK_ERR
+    err = nc_def_dim(ncid, "r1", NR1, &n1); CHECK_ERR
+    if(onerecvar) {
+        /* A single short record variable has unpadded records */
+        dimids[0] = tdim; dimids[1] = n1;
+        err = nc_def_var(ncid, "r1", NC_SHORT, 2, dimids, &varid); CHECK_ERR
+        err = nc_enddef(ncid); CHECK_ERR
+        err = nc_put_var1_double(ncid, varid, index, &value); CHECK_ERR
+        err = nc_close(ncid); CHECK_ERR
+        return nerrs;
+    }
+    err = nc_def_dim(ncid, "r2", NR2, &n2); CHECK_ERR
+    err = nc_def_dim(ncid, "r3", NR3, &n3); CHECK_ERR
+    err = nc_def_dim(ncid, "big", NBIG, &big); CHECK_ERR
+    err = nc_def_dim(ncid, "zero", NZERO, &zdim); CHECK_ERR
+    err = nc_def_var(ncid, "big", NC_FLOAT, 1, &big, &varid); CHECK_ERR
+    err = nc_def_var(ncid, "zero", NC_INT, 1, &zdim, &varid); CHECK_ERR
+    err = nc_put_att_int(ncid, varid, "_FillValue", NC_INT, 1, &zero); CHECK_ERR
+    err = nc_def_var(ncid, "c", NC_CHAR, 1, &n3, &varid); CHECK_ERR
+    dimids[0] = tdim;
+    dimids[1] = n1;
+    err = nc_def_var(ncid, "r1", NC_SHORT, 2, dimids, &varid); CHECK_ERR
+    dimids[1] = n2;
+    err = nc_def_var(ncid, "r2", NC_DOUBLE, 2, dimids, &varid); CHECK_ERR
+    dimids[1] = n3;
+    err = nc_def_var(ncid, "r3", NC_CHAR, 2, dimids, &varid); CHECK_ERR
+    err = nc_put_att_text(ncid, varid, "_FillValue", 1, &xfill); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    /* Writing the last record fills all the ones before it */
+    err = nc_inq_varid(ncid, "r2", &varid); CHECK_ERR
+    err = nc_put_var1_double(ncid, varid, index, &value); CHECK_ERR
+    err = nc_close(ncid); CHECK_ERR
+    return nerrs;
+}
+
+static int
+verify(const char* path, int onerecvar)
+{
+    int err, nerrs=0, ncid, varid;
+    size_t i, n, start[2] = {0,0}, count[2] = {NREC,0};
+    char* buf = malloc(sizeof(double)*NZERO);
+
+    err = nc_open(path, NC_NOWRITE, &ncid); CHECK_ERR
+    if(err) {free(buf); return nerrs;}
+    err = nc_inq_varid(ncid, "r1", &varid); CHECK_ERR
+    count[1] = NR1;
+    err = nc_get_vara_short(ncid, varid, start, count, (short*)buf); CHECK_ERR
+    for(n=0,i=0;i<NREC*NR1;i++)
+        if(((short*)buf)[i] != NC_FILL_SHORT) n++;
+    CHECK(n == (onerecvar ? 1 : 0))
+    if(!onerecvar) {
+        err = nc_inq_varid(ncid, "big", &varid); CHECK_ERR
+        err = nc_get_var_float(ncid, varid, (float*)buf); CHECK_ERR
+        for(n=0,i=0;i<NBIG;i++)
+            if(((float*)buf)[i] != NC_FILL_FLOAT) n++;
+        CHECK(n == 0)
+        err = nc_inq_varid(ncid, "zero", &varid); CHECK_ERR
+        err = nc_get_var_int(ncid, varid, (int*)buf); CHECK_ERR
+        for(n=0,i=0;i<NZERO;i++)
+            if(((int*)buf)[i] != 0) n++;
+        CHECK(n == 0)
+        err = nc_inq_varid(ncid, "c", &varid); CHECK_ERR
+        err = nc_get_var_text(ncid, varid, buf); CHECK_ERR
+        for(n=0,i=0;i<NR3;i++)
+            if(buf[i] != NC_FILL_CHAR) n++;
+        CHECK(n == 0)
+        err = nc_inq_varid(ncid, "r2", &varid); CHECK_ERR
+        count[1] = NR2;
+        err = nc_get_vara_double(ncid, varid, start, count, (double*)buf); CHECK_ERR
+        for(n=0,i=0;i<NREC*NR2;i++)
+            if(((double*)buf)[i] != NC_FILL_DOUBLE) n++;
+        CHECK(n == 1)
+        CHECK(((double*)buf)[(NREC-1)*NR2] == 1.0)
+        err = nc_inq_varid(ncid, "r3", &varid); CHECK_ERR
+        count[1] = NR3;
+        err = nc_get_vara_text(ncid, varid, start, count, buf); CHECK_ERR
+        for(n=0,i=0;i<NREC*NR3;i++)
+            if(buf[i] != 'x') n++;
+        CHECK(n == 0)
+    }
+    err = nc_close(ncid); CHECK_ERR
+    free(buf);
+    return nerrs;
+}
+
+static int
+compare(const char* path1, const char* path2)
+{
+    int nerrs = 0;
+    FILE* f1 = fopen(path1, "rb");
+    FILE* f2 = fopen(path2, "rb");
+    CHECK(f1 != NULL && f2 != NULL)
+    if(f1 != NULL && f2 != NULL) {
+        int c1, c2;
+        long pos = 0;
+        do {
+            c1 = getc(f1);
+            c2 = getc(f2);
+            pos++;
+        } while(c1 == c2 && c1 != EOF);
+        if(c1 != c2) {
+            printf("%s and %s differ at byte %ld\n", path1, path2, pos);
+            nerrs++;
+        }
+    }
+    if(f1 != NULL) fclose(f1);
+    if(f2 != NULL) fclose(f2);
+    return nerrs;
+}
+
+static int
+test(int format, int onerecvar)
+{
+    int nerrs=0;
+    static const char* paths[3] = {"tst_fill_block_px.nc","tst_fill_block_share.nc","tst_fill_block_mem.nc"};
+    const int cmodes[3] = {0, NC_SHARE, NC_DISKLESS|NC_PERSIST};
+    int i;
+
+    printf("\n*** Testing block fills, format %d%s... ", format,
+           onerecvar ? ", one record variable" : "");
+    for(i=0;i<3;i++) {
+        nerrs += create(paths[i], format|cmodes[i], onerecvar);
+        nerrs += verify(paths[i], onerecvar);
+    }
+    nerrs += compare(paths[0], paths[1]);
+    nerrs += compare(paths[0], paths[2]);
+    printf("%s", nerrs ? "FAILED" : "ok");
+    return nerrs;
+}
+
+int main(int argc, char *argv[])
+{
+    int nerrs=0;
+
+    nerrs += test(0, 0);
+    nerrs += test(0, 1);
+    nerrs += test(NC_64BIT_OFFSET, 0);
+#if NC_HAS_CDF5
+    nerrs += test(NC_64BIT_DATA, 0);
+    nerrs += test(NC_64BIT_DATA, 1);
+#endif
+    printf("\n");
+    return (nerrs > 0);
+}
@@ -0,0 +1,112 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test nc_inq_io_stats() and nc_reset_io_stats() on a classic file.
+If the library was built without I/O statistics, check that
+NC_ENOTBUILT is returned.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <netcdf.h>
+#include <netcdf_meta.h>
+
+#define FILE_NAME "tst_iostats.nc"
+#define NX 10
+#define NY 20
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define EXP_ERR(exp) { \
+    if (err != exp) { \
+        nerrs++; \
+        printf("Error at line %d in %s: expecting %s but got %s\n", \
+        __LINE__,__FILE__,nc_strerror(exp), nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+int main(int argc, char *argv[])
+{
+    int i, err, nerrs=0, ncid, dimids[2], varid, varid2;
+    int data[NX*NY];
+    nc_io_stats_t stats, vstats;
+
+    printf("\n*** Testing I/O statistics... ");
+
+    for(i=0;i<NX*NY;i++) data[i] = i;
+
+    err = nc_create(FILE_NAME, NC_CLOBBER, &ncid); CHECK_ERR
+    err = nc_def_dim(ncid, "x", NX, &dimids[0]); CHECK_ERR
+    err = nc_def_dim(ncid, "y", NY, &dimids[1]); CHECK_ERR
+    err = nc_def_var(ncid, "v", NC_INT, 2, dimids, &varid); CHECK_ERR
+    err = nc_def_var(ncid, "w", NC_DOUBLE, 2, dimids, &varid2); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    err = nc_put_var_int(ncid, varid, data); CHECK_ERR
+
+#if NC_HAS_IOSTATS
+    err = nc_inq_io_stats(ncid, NC_GLOBAL, &stats); CHECK_ERR
+    CHECK(stats.put_calls == 1)
+    CHECK(stats.bytes_written == NX*NY*sizeof(int))
+    CHECK(stats.io_writes > 0)
+    err = nc_inq_io_stats(ncid, varid, &vstats); CHECK_ERR
+    CHECK(vstats.put_calls == 1)
+    err = nc_inq_io_stats(ncid, varid2, &vstats); CHECK_ERR
+    CHECK(vstats.put_calls == 0)
+    err = nc_inq_io_stats(ncid, NC_GLOBAL, NULL); EXP_ERR(NC_EINVAL)
+#else
+    err = nc_inq_io_stats(ncid, NC_GLOBAL, &stats); EXP_ERR(NC_ENOTBUILT)
+    err = nc_reset_io_stats(ncid); EXP_ERR(NC_ENOTBUILT)
+#endif
+    err = nc_close(ncid); CHECK_ERR
+
+#if NC_HAS_IOSTATS
+    err = nc_open(FILE_NAME, NC_NOWRITE, &ncid); CHECK_ERR
+    err = nc_inq_io_stats(ncid, NC_GLOBAL, &stats); CHECK_ERR
+    CHECK(stats.get_calls == 0)
+    CHECK(stats.io_reads > 0) /* header */
+    err = nc_reset_io_stats(ncid); CHECK_ERR
+    err = nc_inq_io_stats(ncid, NC_GLOBAL, &stats); CHECK_ERR
+    CHECK(stats.io_reads == 0)
+
+    memset(data,0,sizeof(data));
+    err = nc_get_var_int(ncid, varid, data); CHECK_ERR
+    for(i=0;i<NX*NY;i++) CHECK(data[i] == i)
+    /* The default vars implementation does one vara per element;
+       only the outer call is counted */
+    {
+        size_t start[2] = {0,0}, count[2] = {NX/2,NY/2};
+        ptrdiff_t stride[2] = {2,2};
+        err = nc_get_vars_int(ncid, varid, start, count, stride, data); CHECK_ERR
+    }
+    err = nc_inq_io_stats(ncid, NC_GLOBAL, &stats); CHECK_ERR
+    CHECK(stats.get_calls == 2)
+    CHECK(stats.bytes_read == (NX*NY + (NX/2)*(NY/2))*sizeof(int))
+    CHECK(stats.io_reads > 0)
+    CHECK(stats.io_bytes_read >= NX*NY*sizeof(int))
+    err = nc_inq_io_stats(ncid, varid, &vstats); CHECK_ERR
+    CHECK(vstats.get_calls == 2)
+    CHECK(vstats.bytes_read == stats.bytes_read)
+    err = nc_close(ncid); CHECK_ERR
+    err = nc_inq_io_stats(ncid, NC_GLOBAL, &stats); EXP_ERR(NC_EBADID)
+#endif
+
+    printf("%s\n", nerrs ? "FAILED" : "ok");
+    return (nerrs > 0);
+}
@@ -0,0 +1,172 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test copy-on-write in-memory files: several files opened from one
+template image (NC_MEMIO_COW) are modified independently and closed
+into new images with nc_close_memio(), leaving the template intact.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netcdf.h>
+#include <netcdf_mem.h>
+
+#define FILE_NAME "tst_memio_cow.nc"
+#define NX 100
+#define NY 1000 /* large enough for the data to span several pages */
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define EXP_ERR(exp) { \
+    if (err != exp) { \
+        nerrs++; \
+        printf("Error at line %d in %s: expecting %s but got %s\n", \
+        __LINE__,__FILE__,nc_strerror(exp), nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+static int data[NX*NY];
+
+/* Check that variable v of image has value i*mult+add at index i */
+static int
+check_image(NC_memimage* image, int mult, int add, int expectw)
+{
+    int i, err, nerrs=0, ncid, varid, ndims, nvars;
+    NC_memio params;
+
+    memset(&params,0,sizeof(params));
+    params.memory = image;
+    params.flags = NC_MEMIO_COW;
+    err = nc_open_memio(FILE_NAME, NC_NOWRITE, &params, &ncid); CHECK_ERR
+    if(err) return nerrs;
+    err = nc_inq(ncid, &ndims, &nvars, NULL, NULL); CHECK_ERR
+    CHECK(nvars == (expectw ? 2 : 1))
+    err = nc_inq_varid(ncid, "v", &varid); CHECK_ERR
+    memset(data,0,sizeof(data));
+    err = nc_get_var_int(ncid, varid, data); CHECK_ERR
+    for(i=0;i<NX*NY;i++) {
+        if(data[i] != i*mult+add) {
+            CHECK(data[i] == i*mult+add)
+            break;
+        }
+    }
+    err = nc_close(ncid); CHECK_ERR
+    return nerrs;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, err, nerrs=0, ncid, dimids[2], varid, wvarid;
+    NC_memio final, params;
+    NC_memimage *template = NULL, *image1 = NULL, *image2 = NULL, *image3 = NULL;
+    size_t size;
+    char magic[4];
+
+    printf("\n*** Testing copy-on-write in-memory files... ");
+
+    /* Build the template */
+    for(i=0;i<NX*NY;i++) data[i] = i;
+    err = nc_create_mem(FILE_NAME, NC_CLOBBER, 0, &ncid); CHECK_ERR
+    err = nc_def_dim(ncid, "x", NX, &dimids[0]); CHECK_ERR
+    err = nc_def_dim(ncid, "y", NY, &dimids[1]); CHECK_ERR
+    err = nc_def_var(ncid, "v", NC_INT, 2, dimids, &varid); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    err = nc_put_var_int(ncid, varid, data); CHECK_ERR
+    err = nc_close_memio(ncid, &final); CHECK_ERR
+    err = nc_memimage_create(final.size, final.memory, &template); CHECK_ERR
+    free(final.memory);
+    err = nc_memimage_size(template, &size); CHECK_ERR
+    CHECK(size == final.size)
+    err = nc_memimage_read(template, 0, 3, magic); CHECK_ERR
+    CHECK(memcmp(magic,"CDF",3) == 0)
+    err = nc_memimage_read(template, size, 1, magic); EXP_ERR(NC_EINVAL)
+
+    /* Clone 1: change one value */
+    memset(&params,0,sizeof(params));
+    params.memory = template;
+    params.flags = NC_MEMIO_COW;
+    err = nc_open_memio(FILE_NAME, NC_WRITE, &params, &ncid); CHECK_ERR
+    CHECK(params.memory == template)
+    {
+        size_t index[2] = {NX-1,NY-1};
+        int v = (NX*NY-1)*2;
+        err = nc_inq_varid(ncid, "v", &varid); CHECK_ERR
+        err = nc_put_var1_int(ncid, varid, index, &v); CHECK_ERR
+        /* Rewrite everything so that all pages get copied */
+        for(i=0;i<NX*NY;i++) data[i] = i*2;
+        err = nc_put_var_int(ncid, varid, data); CHECK_ERR
+    }
+    memset(&final,0,sizeof(final));
+    err = nc_close_memio(ncid, &final); CHECK_ERR
+    CHECK(final.flags & NC_MEMIO_COW)
+    image1 = (NC_memimage*)final.memory;
+
+    /* Clone 2: grow the header, which moves the data */
+    err = nc_open_memio(FILE_NAME, NC_WRITE, &params, &ncid); CHECK_ERR
+    err = nc_redef(ncid); CHECK_ERR
+    err = nc_put_att_text(ncid, NC_GLOBAL, "title", 20, "a longer header ....."); CHECK_ERR
+    err = nc_def_var(ncid, "w", NC_DOUBLE, 2, dimids, &wvarid); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    memset(&final,0,sizeof(final));
+    err = nc_close_memio(ncid, &final); CHECK_ERR
+    image2 = (NC_memimage*)final.memory;
+
+    /* Clone of a clone */
+    params.memory = image1;
+    err = nc_open_memio(FILE_NAME, NC_WRITE, &params, &ncid); CHECK_ERR
+    err = nc_inq_varid(ncid, "v", &varid); CHECK_ERR
+    for(i=0;i<NX*NY;i++) data[i] = i*2+1;
+    {
+        /* only the second half */
+        size_t start[2] = {NX/2,0}, count[2] = {NX/2,NY};
+        err = nc_put_vara_int(ncid, varid, start, count, &data[(NX/2)*NY]); CHECK_ERR
+    }
+    memset(&final,0,sizeof(final));
+    err = nc_close_memio(ncid, &final); CHECK_ERR
+    image3 = (NC_memimage*)final.memory;
+
+    /* The template can be released while the images are still in use */
+    err = nc_memimage_free(template); CHECK_ERR
+    nerrs += check_image(image1, 2, 0, 0);
+    nerrs += check_image(image2, 1, 0, 1);
+    {
+        /* image3: first half from image1, second half rewritten */
+        NC_memio p3;
+        int bad = 0;
+        memset(&p3,0,sizeof(p3));
+        p3.memory = image3;
+        p3.flags = NC_MEMIO_COW;
+        err = nc_open_memio(FILE_NAME, NC_NOWRITE, &p3, &ncid); CHECK_ERR
+        err = nc_get_var_int(ncid, varid, data); CHECK_ERR
+        for(i=0;i<NX*NY;i++)
+            if(data[i] != (i < (NX/2)*NY ? i*2 : i*2+1)) bad++;
+        CHECK(bad == 0)
+        err = nc_close(ncid); CHECK_ERR
+    }
+    nerrs += check_image(image1, 2, 0, 0);
+
+    err = nc_memimage_free(image1); CHECK_ERR
+    err = nc_memimage_free(image2); CHECK_ERR
+    err = nc_memimage_free(image3); CHECK_ERR
+
+    printf("%s\n", nerrs ? "FAILED" : "ok");
+    return (nerrs > 0);
+}
@@ -0,0 +1,172 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test nc_set_var_readahead(): sequences of small reads (rows, records
+and single values) must return the same data with read-ahead enabled,
+and data buffered by read-ahead must not survive a write.
+Run for every format that was built.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netcdf.h>
+#include <netcdf_meta.h>
+
+#define NT 7
+#define NY 30
+#define NX 20
+#define VAL(t,y,x) ((t)*10000 + (y)*100 + (x))
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define EXP_ERR(exp) { \
+    if (err != exp) { \
+        nerrs++; \
+        printf("Error at line %d in %s: expecting %s but got %s\n", \
+        __LINE__,__FILE__,nc_strerror(exp), nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+static int
+test(const char* path, int cmode)
+{
+    int t, y, x, err, nerrs=0, ncid, dimids[3], varid, cvarid;
+    int row[NX], rec[NY*NX];
+    double dval;
+    char name[NX];
+    size_t start[3] = {0,0,0}, count[3] = {1,1,NX}, size;
+
+    printf("\n*** Testing nc_set_var_readahead on %s... ", path);
+
+    err = nc_create(path, cmode|NC_CLOBBER, &ncid); CHECK_ERR
+    err = nc_def_dim(ncid, "t", NC_UNLIMITED, &dimids[0]); CHECK_ERR
+    err = nc_def_dim(ncid, "y", NY, &dimids[1]); CHECK_ERR
+    err = nc_def_dim(ncid, "x", NX, &dimids[2]); CHECK_ERR
+    err = nc_def_var(ncid, "v", NC_INT, 3, dimids, &varid); CHECK_ERR
+    err = nc_def_var(ncid, "c", NC_CHAR, 2, &dimids[1], &cvarid); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    for(t=0;t<NT;t++) {
+        for(y=0;y<NY;y++)
+            for(x=0;x<NX;x++) rec[y*NX+x] = VAL(t,y,x);
+        start[0] = t; count[1] = NY;
+        err = nc_put_vara_int(ncid, varid, start, count, rec); CHECK_ERR
+    }
+    for(y=0;y<NY;y++) {
+        for(x=0;x<NX;x++) name[x] = (char)('a' + (x+y) % 26);
+        start[0] = y; start[1] = 0; count[0] = 1; count[1] = NX;
+        err = nc_put_vara_text(ncid, cvarid, start, count, name); CHECK_ERR
+    }
+    err = nc_close(ncid); CHECK_ERR
+
+    err = nc_open(path, NC_WRITE, &ncid); CHECK_ERR
+    err = nc_get_var_readahead(ncid, varid, &size); CHECK_ERR
+    CHECK(size == 0)
+    err = nc_set_var_readahead(ncid, 99, 4096); EXP_ERR(NC_ENOTVAR)
+    err = nc_set_var_readahead(ncid, NC_GLOBAL, 16384); CHECK_ERR
+    err = nc_get_var_readahead(ncid, varid, &size); CHECK_ERR
+    CHECK(size == 16384)
+
+    /* One row per call, across records */
+    count[0] = 1; count[1] = 1; count[2] = NX;
+    for(t=0;t<NT;t++)
+        for(y=0;y<NY;y++) {
+            start[0] = t; start[1] = y; start[2] = 0;
+            err = nc_get_vara_int(ncid, varid, start, count, row); CHECK_ERR
+            for(x=0;x<NX;x++)
+                if(row[x] != VAL(t,y,x)) {CHECK(row[x] == VAL(t,y,x)) break;}
+        }
+
+    /* One record per call; the window is clipped at the last record */
+    count[1] = NY;
+    for(t=0;t<NT;t++) {
+        start[0] = t; start[1] = 0;
+        err = nc_get_vara_int(ncid, varid, start, count, rec); CHECK_ERR
+        for(x=0;x<NY*NX;x++)
+            if(rec[x] != VAL(t,x/NX,x%NX)) {CHECK(rec[x] == VAL(t,x/NX,x%NX)) break;}
+    }
+
+    /* One value per call, converted, then the same values as int */
+    start[0] = 3; start[1] = 4;
+    for(x=0;x<NX;x++) {
+        start[2] = x;
+        err = nc_get_var1_double(ncid, varid, start, &dval); CHECK_ERR
+        CHECK(dval == (double)VAL(3,4,x))
+    }
+    for(x=0;x<NX;x++) {
+        int ival;
+        start[2] = x;
+        err = nc_get_var1_int(ncid, varid, start, &ival); CHECK_ERR
+        CHECK(ival == VAL(3,4,x))
+    }
+
+    /* Rows of a char variable */
+    for(y=0;y<NY;y++) {
+        start[0] = y; start[1] = 0; count[0] = 1; count[1] = NX;
+        err = nc_get_vara_text(ncid, cvarid, start, count, name); CHECK_ERR
+        for(x=0;x<NX;x++) CHECK(name[x] == (char)('a' + (x+y) % 26))
+    }
+
+    /* A write discards the buffered rows */
+    count[0] = 1; count[1] = 1; count[2] = NX;
+    start[0] = 2; start[2] = 0;
+    for(y=0;y<NY;y++) {
+        start[1] = y;
+        err = nc_get_vara_int(ncid, varid, start, count, row); CHECK_ERR
+        if(y == 10)
+            CHECK(row[NX-1] == -(NX-1))
+        else
+            CHECK(row[NX-1] == VAL(2,y,NX-1))
+        if(y == 2) {
+            int newrow[NX];
+            size_t wstart[3] = {2,10,0};
+            for(x=0;x<NX;x++) newrow[x] = -x;
+            err = nc_put_vara_int(ncid, varid, wstart, count, newrow); CHECK_ERR
+        }
+    }
+    start[1] = 10; start[2] = 5;
+    err = nc_get_vara_int(ncid, varid, start, count, row); EXP_ERR(NC_EEDGE)
+    start[2] = 0;
+    err = nc_get_vara_int(ncid, varid, start, count, row); CHECK_ERR
+    CHECK(row[NX-1] == -(NX-1))
+
+    err = nc_set_var_readahead(ncid, varid, 0); CHECK_ERR
+    err = nc_get_var_readahead(ncid, varid, &size); CHECK_ERR
+    CHECK(size == 0)
+    err = nc_close(ncid); CHECK_ERR
+
+    return nerrs;
+}
+
+int main(int argc, char *argv[])
+{
+    int nerrs=0;
+
+    nerrs += test("tst_readahead_classic.nc", 0);
+    nerrs += test("tst_readahead_64bit.nc", NC_64BIT_OFFSET);
+#if NC_HAS_CDF5
+    nerrs += test("tst_readahead_cdf5.nc", NC_64BIT_DATA);
+#endif
+#if NC_HAS_HDF5
+    nerrs += test("tst_readahead_nc4.nc", NC_NETCDF4);
+#endif
+    printf("\n");
+    return (nerrs > 0);
+}
@@ -0,0 +1,161 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test nc_put_recs() and nc_get_recs() against nc_put_vara() and
+nc_get_vara() of the whole records, for every format that was built.
+The record variables have padded records, and enough records are
+written to need several batches.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netcdf.h>
+#include <netcdf_meta.h>
+
+#define NREC 6000
+#define NX 5
+#define NY 4
+#define NC3 3 /* length of the char records */
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define EXP_ERR(exp) { \
+    if (err != exp) { \
+        nerrs++; \
+        printf("Error at line %d in %s: expecting %s but got %s\n", \
+        __LINE__,__FILE__,nc_strerror(exp), nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+static int
+test(const char* path, int cmode)
+{
+    int i, err, nerrs=0, ncid, dimids[3], varids[4], fvarid;
+    char* cdata = malloc(NREC*NC3), *cdata2 = malloc(NREC*NC3);
+    short* sdata = malloc(sizeof(short)*NREC*NX), *sdata2 = malloc(sizeof(short)*NREC*NX);
+    double* ddata = malloc(sizeof(double)*NREC*NY*NX), *ddata2 = malloc(sizeof(double)*NREC*NY*NX);
+    int idata[NREC], idata2[NREC], fdata[NX];
+    void* data[4];
+    size_t start[3] = {0,0,0}, count[3] = {NREC,NY,NX};
+    size_t numrecs;
+
+    printf("\n*** Testing nc_put_recs/nc_get_recs on %s... ", path);
+    for(i=0;i<NREC*NC3;i++) cdata[i] = (char)('a' + (i % 26));
+    for(i=0;i<NREC*NX;i++) sdata[i] = (short)(i % 30000);
+    for(i=0;i<NREC*NY*NX;i++) ddata[i] = i * 0.25;
+    for(i=0;i<NREC;i++) idata[i] = -i;
+    for(i=0;i<NX;i++) fdata[i] = 100 + i;
+
+    err = nc_create(path, cmode|NC_CLOBBER, &ncid); CHECK_ERR
+    err = nc_def_dim(ncid, "time", NC_UNLIMITED, &dimids[0]); CHECK_ERR
+    err = nc_def_dim(ncid, "y", NY, &dimids[1]); CHECK_ERR
+    err = nc_def_dim(ncid, "x", NX, &dimids[2]); CHECK_ERR
+    err = nc_def_var(ncid, "f", NC_INT, 1, &dimids[2], &fvarid); CHECK_ERR
+    err = nc_def_dim(ncid, "n", NC3, &i); CHECK_ERR
+    {
+        int cdims[2] = {dimids[0], i};
+        int sdims[2] = {dimids[0], dimids[2]};
+        err = nc_def_var(ncid, "c", NC_CHAR, 2, cdims, &varids[0]); CHECK_ERR
+        err = nc_def_var(ncid, "s", NC_SHORT, 2, sdims, &varids[1]); CHECK_ERR
+    }
+    err = nc_def_var(ncid, "d", NC_DOUBLE, 3, dimids, &varids[2]); CHECK_ERR
+    err = nc_def_var(ncid, "i", NC_INT, 1, dimids, &varids[3]); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    err = nc_put_var_int(ncid, fvarid, fdata); CHECK_ERR
+
+    /* Write "i" with nc_put_vara and the others with nc_put_recs */
+    count[0] = NREC;
+    err = nc_put_vara_int(ncid, varids[3], start, count, idata); CHECK_ERR
+    data[0] = cdata; data[1] = sdata; data[2] = ddata;
+    err = nc_put_recs(ncid, 0, NREC, 3, varids, (const void* const*)data); CHECK_ERR
+    /* Rewrite some records in the middle, skipping "s" */
+    for(i=0;i<10*NC3;i++) cdata[100*NC3+i] = 'Z';
+    data[0] = cdata + 100*NC3; data[1] = NULL; data[2] = ddata + 100*NY*NX;
+    err = nc_put_recs(ncid, 100, 10, 3, varids, (const void* const*)data); CHECK_ERR
+    /* Errors */
+    err = nc_put_recs(ncid, 0, 1, 1, &fvarid, (const void* const*)data); EXP_ERR(NC_EINVAL)
+    err = nc_inq_dimlen(ncid, dimids[0], &numrecs); CHECK_ERR
+    CHECK(numrecs == NREC)
+    err = nc_close(ncid); CHECK_ERR
+
+    err = nc_open(path, NC_NOWRITE, &ncid); CHECK_ERR
+    /* Compare with nc_get_vara of each variable */
+    count[0] = NREC; count[1] = NC3;
+    err = nc_get_vara_text(ncid, varids[0], start, count, cdata2); CHECK_ERR
+    CHECK(memcmp(cdata, cdata2, NREC*NC3) == 0)
+    count[1] = NX;
+    err = nc_get_vara_short(ncid, varids[1], start, count, sdata2); CHECK_ERR
+    CHECK(memcmp(sdata, sdata2, sizeof(short)*NREC*NX) == 0)
+    count[1] = NY; count[2] = NX;
+    err = nc_get_vara_double(ncid, varids[2], start, count, ddata2); CHECK_ERR
+    CHECK(memcmp(ddata, ddata2, sizeof(double)*NREC*NY*NX) == 0)
+
+    /* Read all four back with nc_get_recs */
+    memset(cdata2, 0, NREC*NC3);
+    memset(sdata2, 0, sizeof(short)*NREC*NX);
+    memset(ddata2, 0, sizeof(double)*NREC*NY*NX);
+    memset(idata2, 0, sizeof(idata2));
+    data[0] = cdata2; data[1] = sdata2; data[2] = ddata2; data[3] = idata2;
+    err = nc_get_recs(ncid, 0, NREC, 4, varids, data); CHECK_ERR
+    CHECK(memcmp(cdata, cdata2, NREC*NC3) == 0)
+    CHECK(memcmp(sdata, sdata2, sizeof(short)*NREC*NX) == 0)
+    CHECK(memcmp(ddata, ddata2, sizeof(double)*NREC*NY*NX) == 0)
+    CHECK(memcmp(idata, idata2, sizeof(idata)) == 0)
+
+    /* A subrange of two variables, in reverse order */
+    {
+        int rvarids[2] = {varids[3], varids[1]};
+        memset(sdata2, 0, sizeof(short)*NREC*NX);
+        memset(idata2, 0, sizeof(idata2));
+        data[0] = idata2; data[1] = sdata2;
+        err = nc_get_recs(ncid, 17, 5, 2, rvarids, data); CHECK_ERR
+        CHECK(memcmp(idata + 17, idata2, 5*sizeof(int)) == 0)
+        CHECK(memcmp(sdata + 17*NX, sdata2, 5*NX*sizeof(short)) == 0)
+    }
+
+    /* Errors */
+    err = nc_get_recs(ncid, NREC-1, 2, 4, varids, data); EXP_ERR(NC_EEDGE)
+    err = nc_get_recs(ncid, 0, 1, 1, &fvarid, data); EXP_ERR(NC_EINVAL)
+    err = nc_put_recs(ncid, 0, 1, 1, varids, (const void* const*)data);
+    if(cmode & NC_NETCDF4) {CHECK(err != NC_NOERR)} else EXP_ERR(NC_EPERM)
+    err = nc_get_recs(ncid, 0, 1, 0, NULL, NULL); CHECK_ERR
+    err = nc_close(ncid); CHECK_ERR
+
+    free(cdata); free(cdata2); free(sdata); free(sdata2); free(ddata); free(ddata2);
+    printf("%s", nerrs ? "FAILED" : "ok");
+    return nerrs;
+}
+
+int main(int argc, char *argv[])
+{
+    int nerrs=0;
+
+    nerrs += test("tst_recs_classic.nc", 0);
+    nerrs += test("tst_recs_64bit.nc", NC_64BIT_OFFSET);
+#if NC_HAS_CDF5
+    nerrs += test("tst_recs_cdf5.nc", NC_64BIT_DATA);
+#endif
+#if NC_HAS_HDF5
+    nerrs += test("tst_recs_nc4.nc", NC_NETCDF4);
+#endif
+    printf("\n");
+    return (nerrs > 0);
+}
@@ -0,0 +1,169 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test that the data of classic, 64-bit offset and CDF-5 files moves
+correctly when a redefinition grows the header: when only the header
+grows (the data moves as one region), when a record variable is added
+(whole records move), when the header grows by more than the move
+buffer, and when the new layout is written to a shadow file.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netcdf.h>
+#include <netcdf_meta.h>
+
+#define NF (3*1024*1024) /* ints in fixed variable "f" */
+#define NG 10            /* ints in fixed variable "g" */
+#define NR 100000        /* ints per record of "r1" and "r2" */
+#define NREC 4
+#define BIGFREE (16*1024*1024)
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+static int buf[NF];
+
+/* Check the data of all variables written by test() */
+static int
+verify(const char* path)
+{
+    int err, nerrs = 0, ncid, varid, rec, v, i;
+    char name[NC_MAX_NAME+1];
+    size_t start[2] = {0, 0}, count[2] = {1, NR};
+
+    err = nc_open(path, NC_NOWRITE, &ncid); CHECK_ERR
+    if (err) return nerrs;
+    err = nc_inq_varid(ncid, "f", &varid); CHECK_ERR
+    err = nc_get_var_int(ncid, varid, buf); CHECK_ERR
+    for (i = 0; i < NF; i++)
+        if (buf[i] != i) {CHECK(buf[i] == i) break;}
+    err = nc_inq_varid(ncid, "g", &varid); CHECK_ERR
+    err = nc_get_var_int(ncid, varid, buf); CHECK_ERR
+    for (i = 0; i < NG; i++) CHECK(buf[i] == -i)
+    for (v = 1; v <= 2; v++) {
+        snprintf(name, sizeof(name), "r%d", v);
+        err = nc_inq_varid(ncid, name, &varid); CHECK_ERR
+        for (rec = 0; rec < NREC; rec++) {
+            start[0] = (size_t)rec;
+            err = nc_get_vara_int(ncid, varid, start, count, buf); CHECK_ERR
+            for (i = 0; i < NR; i++)
+                if (buf[i] != v*1000000 + rec*NR + i) {
+                    printf("%s[%d][%d] = %d\n", name, rec, i, buf[i]);
+                    nerrs++;
+                    break;
+                }
+        }
+    }
+    err = nc_close(ncid); CHECK_ERR
+    return nerrs;
+}
+
+/* Grow the header by adding an attribute "a<n>" */
+static int
+grow(const char* path, int n, size_t h_minfree)
+{
+    int err, nerrs = 0, ncid;
+    char name[NC_MAX_NAME+1];
+
+    err = nc_open(path, NC_WRITE, &ncid); CHECK_ERR
+    err = nc_redef(ncid); CHECK_ERR
+    snprintf(name, sizeof(name), "a%d", n);
+    err = nc_put_att_text(ncid, NC_GLOBAL, name, 100, "a long enough attribute value that grows the header past its current free space"); CHECK_ERR
+    err = nc__enddef(ncid, h_minfree, 4, 0, 4); CHECK_ERR
+    err = nc_close(ncid); CHECK_ERR
+    return nerrs;
+}
+
+static int
+test(const char* path, int cmode)
+{
+    int err, nerrs = 0, ncid, dimids[2], fdim, gdim, varid, rec, v, i;
+    char name[NC_MAX_NAME+1];
+    size_t start[2] = {0, 0}, count[2] = {1, NR};
+    FILE* f;
+
+    printf("\n*** Testing moves of data on header growth, format 0x%x... ", cmode);
+
+    err = nc_create(path, cmode|NC_CLOBBER, &ncid); CHECK_ERR
+    err = nc_def_dim(ncid, "t", NC_UNLIMITED, &dimids[0]); CHECK_ERR
+    err = nc_def_dim(ncid, "x", NR, &dimids[1]); CHECK_ERR
+    err = nc_def_dim(ncid, "nf", NF, &fdim); CHECK_ERR
+    err = nc_def_dim(ncid, "ng", NG, &gdim); CHECK_ERR
+    err = nc_def_var(ncid, "f", NC_INT, 1, &fdim, &varid); CHECK_ERR
+    err = nc_def_var(ncid, "g", NC_INT, 1, &gdim, &varid); CHECK_ERR
+    err = nc_def_var(ncid, "r1", NC_INT, 2, dimids, &varid); CHECK_ERR
+    err = nc_def_var(ncid, "r2", NC_INT, 2, dimids, &varid); CHECK_ERR
+    err = nc__enddef(ncid, 0, 4, 0, 4); CHECK_ERR
+    for (i = 0; i < NF; i++) buf[i] = i;
+    err = nc_put_var_int(ncid, 0, buf); CHECK_ERR
+    for (i = 0; i < NG; i++) buf[i] = -i;
+    err = nc_put_var_int(ncid, 1, buf); CHECK_ERR
+    for (v = 1; v <= 2; v++)
+        for (rec = 0; rec < NREC; rec++) {
+            for (i = 0; i < NR; i++) buf[i] = v*1000000 + rec*NR + i;
+            start[0] = (size_t)rec;
+            err = nc_put_vara_int(ncid, v + 1, start, count, buf); CHECK_ERR
+        }
+    err = nc_close(ncid); CHECK_ERR
+    nerrs += verify(path);
+
+    /* Only the header grows */
+    nerrs += grow(path, 1, 0);
+    nerrs += verify(path);
+
+    /* A new record variable changes the record size */
+    err = nc_open(path, NC_WRITE, &ncid); CHECK_ERR
+    err = nc_redef(ncid); CHECK_ERR
+    err = nc_def_var(ncid, "r3", NC_INT, 2, dimids, &varid); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    err = nc_close(ncid); CHECK_ERR
+    nerrs += verify(path);
+
+    /* The header grows by more than the move buffer */
+    nerrs += grow(path, 2, BIGFREE);
+    nerrs += verify(path);
+
+    /* Through a shadow file */
+    err = nc_rc_set("NETCDF3.SHADOW_REDEF", "1"); CHECK_ERR
+    nerrs += grow(path, 3, 2*BIGFREE);
+    err = nc_rc_set("NETCDF3.SHADOW_REDEF", "0"); CHECK_ERR
+    nerrs += verify(path);
+    snprintf(name, sizeof(name), "%s.shadow", path);
+    f = fopen(name, "rb");
+    CHECK(f == NULL)
+    if (f != NULL) fclose(f);
+
+    printf("%s", nerrs ? "FAILED" : "ok");
+    return nerrs;
+}
+
+int main(int argc, char *argv[])
+{
+    int nerrs = 0;
+
+    nerrs += test("tst_redef_move.nc", 0);
+    nerrs += test("tst_redef_move_64bit.nc", NC_64BIT_OFFSET);
+#if NC_HAS_CDF5
+    nerrs += test("tst_redef_move_cdf5.nc", NC_64BIT_DATA);
+#endif
+    printf("\n");
+    return (nerrs > 0);
+}
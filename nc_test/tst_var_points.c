@@ -0,0 +1,200 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test nc_get_var_points() against nc_get_var1() for every format
+that was built: classic, 64-bit offset, CDF-5, netCDF-4/HDF5 and
+NCZarr. Both record and fixed size variables are read, with
+duplicate and out of order points.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netcdf.h>
+#include <netcdf_meta.h>
+
+#define NREC 5
+#define NY 12
+#define NX 15
+#define NPOINTS 500
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define EXP_ERR(exp) { \
+    if (err != exp) { \
+        nerrs++; \
+        printf("Error at line %d in %s: expecting %s but got %s\n", \
+        __LINE__,__FILE__,nc_strerror(exp), nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+static unsigned int seed = 17;
+
+/* Small deterministic generator, so that failures are reproducible */
+static size_t
+next(size_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (size_t)((seed >> 8) % n);
+}
+
+static int
+create(const char* path, int cmode, int unlimited)
+{
+    int i, err, nerrs=0, ncid, dimids[3], tvarid, uvarid, dvarid, cvarid, svarid;
+    int idata[NY*NX];
+    short sdata[NY*NX];
+    double ddata[NY*NX];
+    char cdata[NX];
+    double scalar = 3.5;
+    size_t start[3] = {0,0,0}, count[3] = {1,NY,NX};
+
+    err = nc_create(path, cmode|NC_CLOBBER, &ncid); CHECK_ERR
+    if(err) return nerrs;
+    err = nc_def_dim(ncid, "time", (unlimited ? NC_UNLIMITED : NREC), &dimids[0]); CHECK_ERR
+    err = nc_def_dim(ncid, "y", NY, &dimids[1]); CHECK_ERR
+    err = nc_def_dim(ncid, "x", NX, &dimids[2]); CHECK_ERR
+    /* Two record variables so that records are interleaved */
+    err = nc_def_var(ncid, "t", NC_INT, 3, dimids, &tvarid); CHECK_ERR
+    err = nc_def_var(ncid, "u", NC_SHORT, 3, dimids, &uvarid); CHECK_ERR
+    err = nc_def_var(ncid, "d", NC_DOUBLE, 2, &dimids[1], &dvarid); CHECK_ERR
+    err = nc_def_var(ncid, "c", NC_CHAR, 1, &dimids[2], &cvarid); CHECK_ERR
+    err = nc_def_var(ncid, "s", NC_DOUBLE, 0, NULL, &svarid); CHECK_ERR
+    if(cmode & NC_NETCDF4) {
+        size_t chunks[3] = {2,5,4};
+        err = nc_def_var_chunking(ncid, tvarid, NC_CHUNKED, chunks); CHECK_ERR
+        err = nc_def_var_chunking(ncid, dvarid, NC_CHUNKED, &chunks[1]); CHECK_ERR
+    }
+    err = nc_enddef(ncid); CHECK_ERR
+
+    for(i=0;i<NY*NX;i++) ddata[i] = i * 0.5;
+    err = nc_put_var_double(ncid, dvarid, ddata); CHECK_ERR
+    for(i=0;i<NX;i++) cdata[i] = (char)('a' + i);
+    err = nc_put_var_text(ncid, cvarid, cdata); CHECK_ERR
+    err = nc_put_var_double(ncid, svarid, &scalar); CHECK_ERR
+    for(start[0]=0;start[0]<NREC;start[0]++) {
+        for(i=0;i<NY*NX;i++) {
+            idata[i] = (int)(start[0]*NY*NX) + i;
+            sdata[i] = (short)(-i);
+        }
+        err = nc_put_vara_int(ncid, tvarid, start, count, idata); CHECK_ERR
+        err = nc_put_vara_short(ncid, uvarid, start, count, sdata); CHECK_ERR
+    }
+    err = nc_close(ncid); CHECK_ERR
+    return nerrs;
+}
+
+/* Compare nc_get_var_points() with nc_get_var1() on random points */
+static int
+compare(int ncid, const char* name, size_t size)
+{
+    int i, d, err, nerrs=0, varid, ndims, dimids[NC_MAX_VAR_DIMS];
+    size_t dimlens[NC_MAX_VAR_DIMS];
+    size_t* coords = NULL;
+    char* values = NULL;
+    char one[8];
+
+    err = nc_inq_varid(ncid, name, &varid); CHECK_ERR
+    err = nc_inq_varndims(ncid, varid, &ndims); CHECK_ERR
+    err = nc_inq_vardimid(ncid, varid, dimids); CHECK_ERR
+    for(d=0;d<ndims;d++) {
+        err = nc_inq_dimlen(ncid, dimids[d], &dimlens[d]); CHECK_ERR
+    }
+
+    coords = (size_t*)malloc(sizeof(size_t)*NPOINTS*(ndims ? ndims : 1));
+    values = (char*)malloc(size*NPOINTS);
+    for(i=0;i<NPOINTS;i++) {
+        for(d=0;d<ndims;d++)
+            coords[i*ndims+d] = next(dimlens[d]);
+        /* Some runs of adjacent points and some duplicates */
+        if(i > 0 && ndims > 0 && (i % 7) < 3) {
+            memcpy(&coords[i*ndims],&coords[(i-1)*ndims],sizeof(size_t)*ndims);
+            if((i % 7) != 0 && coords[i*ndims+ndims-1] + 1 < dimlens[ndims-1])
+                coords[i*ndims+ndims-1]++;
+        }
+    }
+
+    memset(values,0,size*NPOINTS);
+    err = nc_get_var_points(ncid, varid, NPOINTS, coords, values); CHECK_ERR
+    for(i=0;i<NPOINTS;i++) {
+        memset(one,0,sizeof(one));
+        err = nc_get_var1(ncid, varid, &coords[i*ndims], one); CHECK_ERR
+        if(memcmp(one, values + i*size, size) != 0) {
+            printf("%s: mismatch at point %d\n", name, i);
+            nerrs++;
+            break;
+        }
+    }
+
+    /* An out of bounds point fails as nc_get_var1() does */
+    if(ndims > 0) {
+        int exp;
+        coords[(NPOINTS/2)*ndims] = dimlens[0];
+        exp = nc_get_var1(ncid, varid, &coords[(NPOINTS/2)*ndims], one);
+        CHECK(exp != NC_NOERR)
+        err = nc_get_var_points(ncid, varid, NPOINTS, coords, values); EXP_ERR(exp)
+        err = nc_get_var_points(ncid, varid, 1, NULL, values); EXP_ERR(NC_EINVAL)
+    }
+    err = nc_get_var_points(ncid, varid, 0, NULL, NULL); CHECK_ERR
+
+    free(coords);
+    free(values);
+    return nerrs;
+}
+
+static int
+test(const char* path, int cmode, int unlimited)
+{
+    int err, nerrs=0, ncid;
+
+    printf("\n*** Testing nc_get_var_points on %s... ", path);
+    nerrs += create(path, cmode, unlimited);
+    err = nc_open(path, NC_NOWRITE, &ncid); CHECK_ERR
+    if(err) return nerrs + 1;
+    nerrs += compare(ncid, "t", sizeof(int));
+    nerrs += compare(ncid, "u", sizeof(short));
+    nerrs += compare(ncid, "d", sizeof(double));
+    nerrs += compare(ncid, "c", sizeof(char));
+    nerrs += compare(ncid, "s", sizeof(double));
+    err = nc_get_var_points(ncid, 99, 1, NULL, NULL); EXP_ERR(NC_ENOTVAR)
+    err = nc_close(ncid); CHECK_ERR
+    printf("%s", nerrs ? "FAILED" : "ok");
+    return nerrs;
+}
+
+int main(int argc, char *argv[])
+{
+    int nerrs=0;
+
+    nerrs += test("tst_var_points_classic.nc", 0, 1);
+    nerrs += test("tst_var_points_64bit.nc", NC_64BIT_OFFSET, 1);
+#if NC_HAS_CDF5
+    nerrs += test("tst_var_points_cdf5.nc", NC_64BIT_DATA, 1);
+#endif
+#if NC_HAS_HDF5
+    nerrs += test("tst_var_points_nc4.nc", NC_NETCDF4, 1);
+#endif
+#if NC_HAS_NCZARR
+    /* NCZarr does not support unlimited dimensions */
+    nerrs += test("file://tst_var_points_nczarr.file#mode=nczarr,file", NC_NETCDF4, 0);
+#endif
+    printf("\n");
+    return (nerrs > 0);
+}
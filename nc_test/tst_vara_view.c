@@ -0,0 +1,155 @@
+/*! \file
+
+Copyright 2018 University Corporation for Atmospheric
+Research/Unidata. See \ref copyright file for more info.
+
+Test nc_get_vara_view() on a classic file, opened with and
+without NC_MMAP. Byte and char data are expected to be returned
+without copying when the file is mapped.
+
+*/
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <netcdf.h>
+
+#define FILE_NAME "tst_vara_view.nc"
+#define NREC 3
+#define NX 10
+#define NY 20
+
+#define CHECK_ERR { \
+    if (err != NC_NOERR) { \
+        nerrs++; \
+        printf("Error at line %d in %s: (%s)\n", \
+        __LINE__,__FILE__,nc_strerror(err)); \
+    } \
+}
+
+#define EXP_ERR(exp) { \
+    if (err != exp) { \
+        nerrs++; \
+        printf("Error at line %d in %s: expecting %s but got %s\n", \
+        __LINE__,__FILE__,nc_strerror(exp), nc_strerror(err)); \
+    } \
+}
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        nerrs++; \
+        printf("Error at line %d in %s: %s\n", __LINE__,__FILE__,#cond); \
+    } \
+}
+
+/* Address of element (i,j[,k]) of a view */
+#define AT2(v,i,j) ((const char*)(v).data + (i)*(v).strides[0] + (j)*(v).strides[1])
+#define AT3(v,i,j,k) (AT2(v,i,j) + (k)*(v).strides[2])
+
+static int
+check_views(int ncid, int mapped)
+{
+    int i, j, k, err, nerrs=0, bvarid, cvarid, ivarid;
+    nc_vara_view_t view;
+    size_t start[3] = {1,2,3}, count[3] = {2,5,7}, zeros[3] = {0,0,0};
+
+    err = nc_inq_varid(ncid, "b", &bvarid); CHECK_ERR
+    err = nc_inq_varid(ncid, "c", &cvarid); CHECK_ERR
+    err = nc_inq_varid(ncid, "i", &ivarid); CHECK_ERR
+
+    /* fixed size byte variable */
+    err = nc_get_vara_view(ncid, bvarid, &start[1], &count[1], &view); CHECK_ERR
+    CHECK(view.xtype == NC_BYTE && view.size == 1 && view.ndims == 2)
+    CHECK(view.zerocopy == mapped)
+    CHECK(view.strides[1] == 1)
+    for(i=0;i<count[1];i++)
+        for(j=0;j<count[2];j++)
+            CHECK(*(const signed char*)AT2(view,i,j) == (signed char)((i+start[1])*NY+(j+start[2])))
+    err = nc_free_vara_view(&view); CHECK_ERR
+    CHECK(view.data == NULL && view.count == NULL)
+
+    /* record char variable: records are interleaved */
+    err = nc_get_vara_view(ncid, cvarid, start, count, &view); CHECK_ERR
+    CHECK(view.xtype == NC_CHAR && view.ndims == 3)
+    CHECK(view.zerocopy == mapped)
+    for(k=0;k<count[0];k++)
+        for(i=0;i<count[1];i++)
+            for(j=0;j<count[2];j++)
+                CHECK(*AT3(view,k,i,j) == 'a' + (char)((k+start[0]+i+start[1]+j+start[2])%26))
+    err = nc_free_vara_view(&view); CHECK_ERR
+
+    /* int variable: needs conversion unless the host is big-endian */
+    err = nc_get_vara_view(ncid, ivarid, &start[1], &count[1], &view); CHECK_ERR
+    CHECK(view.xtype == NC_INT && view.size == sizeof(int))
+#ifdef WORDS_BIGENDIAN
+    CHECK(view.zerocopy == mapped)
+#else
+    CHECK(view.zerocopy == 0 && view.buffer != NULL)
+#endif
+    for(i=0;i<count[1];i++)
+        for(j=0;j<count[2];j++) {
+            int v;
+            memcpy(&v, AT2(view,i,j), sizeof(int));
+            CHECK(v == -(int)((i+start[1])*NY+(j+start[2])))
+        }
+    err = nc_free_vara_view(&view); CHECK_ERR
+
+    /* whole variable and error cases */
+    err = nc_get_vara_view(ncid, bvarid, zeros, NULL, &view); CHECK_ERR
+    CHECK(view.count != NULL && view.count[0] == NX && view.count[1] == NY)
+    CHECK(*(const signed char*)AT2(view,NX-1,NY-1) == (signed char)(NX*NY-1))
+    err = nc_free_vara_view(&view); CHECK_ERR
+    count[1] = NX;
+    err = nc_get_vara_view(ncid, bvarid, &start[1], &count[1], &view); EXP_ERR(NC_EEDGE)
+    CHECK(view.data == NULL && view.count == NULL)
+    err = nc_get_vara_view(ncid, bvarid, start, count, NULL); EXP_ERR(NC_EINVAL)
+    return nerrs;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, j, k, err, nerrs=0, ncid, dimids[3], bvarid, cvarid, ivarid;
+    signed char bdata[NX*NY];
+    char cdata[NREC*NX*NY];
+    int idata[NX*NY];
+
+    printf("\n*** Testing nc_get_vara_view... ");
+
+    for(i=0;i<NX*NY;i++) {bdata[i] = (signed char)i; idata[i] = -i;}
+    for(k=0;k<NREC;k++)
+        for(i=0;i<NX;i++)
+            for(j=0;j<NY;j++)
+                cdata[(k*NX+i)*NY+j] = 'a' + (char)((k+i+j)%26);
+
+    err = nc_create(FILE_NAME, NC_CLOBBER|NC_64BIT_DATA, &ncid); CHECK_ERR
+    err = nc_def_dim(ncid, "t", NC_UNLIMITED, &dimids[0]); CHECK_ERR
+    err = nc_def_dim(ncid, "x", NX, &dimids[1]); CHECK_ERR
+    err = nc_def_dim(ncid, "y", NY, &dimids[2]); CHECK_ERR
+    err = nc_def_var(ncid, "b", NC_BYTE, 2, &dimids[1], &bvarid); CHECK_ERR
+    err = nc_def_var(ncid, "c", NC_CHAR, 3, dimids, &cvarid); CHECK_ERR
+    err = nc_def_var(ncid, "i", NC_INT, 2, &dimids[1], &ivarid); CHECK_ERR
+    /* a second record variable so that records are not contiguous */
+    err = nc_def_var(ncid, "r", NC_DOUBLE, 1, dimids, &ivarid); CHECK_ERR
+    err = nc_enddef(ncid); CHECK_ERR
+    err = nc_put_var_schar(ncid, bvarid, bdata); CHECK_ERR
+    err = nc_inq_varid(ncid, "i", &ivarid); CHECK_ERR
+    err = nc_put_var_int(ncid, ivarid, idata); CHECK_ERR
+    {
+        size_t start[3] = {0,0,0}, count[3] = {NREC,NX,NY};
+        err = nc_put_vara_text(ncid, cvarid, start, count, cdata); CHECK_ERR
+    }
+    err = nc_close(ncid); CHECK_ERR
+
+    err = nc_open(FILE_NAME, NC_NOWRITE, &ncid); CHECK_ERR
+    nerrs += check_views(ncid, 0);
+    err = nc_close(ncid); CHECK_ERR
+
+#ifdef USE_MMAP
+    err = nc_open(FILE_NAME, NC_NOWRITE|NC_MMAP, &ncid); CHECK_ERR
+    nerrs += check_views(ncid, 1);
+    err = nc_close(ncid); CHECK_ERR
+#endif
+
+    printf("%s\n", nerrs ? "FAILED" : "ok");
+    return (nerrs > 0);
+}
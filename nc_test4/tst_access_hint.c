@@ -0,0 +1,155 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test nc_def_var_access_hint: the default chunks of a variable take
+   the shape of the hinted reads, chunking chosen with
+   nc_def_var_chunking is kept, and bad hints are rejected.
+*/
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nc_tests.h>
+#include "err_macros.h"
+#include <netcdf_meta.h>
+
+#define FILE_NAME "tst_access_hint.nc"
+#define NCZ_FILE_NAME "file://tst_access_hint.file#mode=nczarr,file"
+#define CLASSIC_FILE_NAME "tst_access_hint_classic.nc"
+#define NDIMS 3
+#define NT 400
+#define NY 90
+#define NX 180
+
+/* Define var "v" of (time, y, x) with the given hint, write and read
+   back a time series, and return the chunksizes it got */
+static int
+hint_chunks(const char* path, int unlimited, int hint, const size_t* shape,
+            size_t* chunks)
+{
+   int ncid, varid, dimids[NDIMS], hint_in, storage;
+   size_t shape_in[NDIMS];
+   size_t start[NDIMS] = {0, 3, 5}, count[NDIMS] = {NT, 1, 1};
+   float series[NT], series_in[NT];
+   int i;
+
+   for (i = 0; i < NT; i++) series[i] = (float)i;
+   if (nc_create(path, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+   if (nc_def_dim(ncid, "time", unlimited ? NC_UNLIMITED : NT, &dimids[0])) ERR;
+   if (nc_def_dim(ncid, "y", NY, &dimids[1])) ERR;
+   if (nc_def_dim(ncid, "x", NX, &dimids[2])) ERR;
+   if (nc_def_var(ncid, "v", NC_FLOAT, NDIMS, dimids, &varid)) ERR;
+   if (nc_def_var_access_hint(ncid, varid, hint, shape)) ERR;
+   if (nc_inq_var_access_hint(ncid, varid, &hint_in, shape_in)) ERR;
+   if (hint_in != hint) ERR;
+   if (hint == NC_ACCESS_SHAPE)
+      for (i = 0; i < NDIMS; i++)
+         if (shape_in[i] != (shape[i] ? shape[i] : (i == 1 ? NY : NX))) ERR;
+   if (nc_put_vara_float(ncid, varid, start, count, series)) ERR;
+   if (nc_close(ncid)) ERR;
+
+   if (nc_open(path, NC_NOWRITE, &ncid)) ERR;
+   if (nc_inq_var_chunking(ncid, varid, &storage, chunks)) ERR;
+   if (storage != NC_CHUNKED) ERR;
+   /* The hint is not stored, but helps the reads of an existing file */
+   if (nc_inq_var_access_hint(ncid, varid, &hint_in, NULL)) ERR;
+   if (hint_in != NC_ACCESS_BALANCED) ERR;
+   if (nc_def_var_access_hint(ncid, varid, hint, shape)) ERR;
+   if (nc_get_vara_float(ncid, varid, start, count, series_in)) ERR;
+   for (i = 0; i < NT; i++)
+      if (series_in[i] != series[i]) ERR;
+   if (nc_close(ncid)) ERR;
+   return 0;
+}
+
+static int
+test_hints(const char* path, int unlimited)
+{
+   size_t chunks[NDIMS], dflt[NDIMS];
+   size_t shape[NDIMS] = {10, 0, 45};
+
+   /* A balanced hint keeps the library default. Unlimited dimensions
+      make HDF5 variables chunked by default. */
+   {
+      int ncid, varid, dimids[NDIMS];
+      if (nc_create(path, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "time", unlimited ? NC_UNLIMITED : NT, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "y", NY, &dimids[1])) ERR;
+      if (nc_def_dim(ncid, "x", NX, &dimids[2])) ERR;
+      if (nc_def_var(ncid, "v", NC_FLOAT, NDIMS, dimids, &varid)) ERR;
+      if (nc_inq_var_chunking(ncid, varid, NULL, dflt)) ERR;
+      if (nc_abort(ncid)) ERR;
+   }
+   if (hint_chunks(path, unlimited, NC_ACCESS_BALANCED, NULL, chunks)) ERR;
+   if (memcmp(chunks, dflt, sizeof(dflt))) ERR;
+
+   /* Time series: all times in a chunk, small in y and x */
+   if (hint_chunks(path, 0, NC_ACCESS_TIMESERIES, NULL, chunks)) ERR;
+   if (chunks[0] != NT || chunks[1] >= NY || chunks[2] >= NX) ERR;
+   if (chunks[1] < 2 || chunks[2] < 2) ERR;
+
+   /* Spatial slices: whole maps, a few times */
+   if (hint_chunks(path, 0, NC_ACCESS_SPATIAL, NULL, chunks)) ERR;
+   if (chunks[1] != NY || chunks[2] != NX || chunks[0] >= NT) ERR;
+
+   /* An unlimited time dimension still gets long time series */
+   if (unlimited)
+   {
+      if (hint_chunks(path, 1, NC_ACCESS_TIMESERIES, NULL, chunks)) ERR;
+      if (chunks[0] < NT || chunks[1] >= NY) ERR;
+   }
+
+   /* Explicit shape; a zero length is the whole dimension */
+   if (hint_chunks(path, 0, NC_ACCESS_SHAPE, shape, chunks)) ERR;
+   if (chunks[0] < shape[0] || chunks[1] != NY || chunks[2] < shape[2]) ERR;
+
+   /* Chunks given with nc_def_var_chunking are kept */
+   {
+      int ncid, varid, dimids[NDIMS];
+      size_t mine[NDIMS] = {7, 9, 11};
+      if (nc_create(path, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "time", NT, &dimids[0])) ERR;
+      if (nc_def_dim(ncid, "y", NY, &dimids[1])) ERR;
+      if (nc_def_dim(ncid, "x", NX, &dimids[2])) ERR;
+      if (nc_def_var(ncid, "v", NC_FLOAT, NDIMS, dimids, &varid)) ERR;
+      if (nc_def_var_chunking(ncid, varid, NC_CHUNKED, mine)) ERR;
+      if (nc_def_var_access_hint(ncid, varid, NC_ACCESS_TIMESERIES, NULL)) ERR;
+      if (nc_inq_var_chunking(ncid, varid, NULL, chunks)) ERR;
+      if (memcmp(chunks, mine, sizeof(mine))) ERR;
+
+      /* Bad hints */
+      if (nc_def_var_access_hint(ncid, varid, 42, NULL) != NC_EINVAL) ERR;
+      if (nc_def_var_access_hint(ncid, varid, NC_ACCESS_SHAPE, NULL) != NC_EINVAL) ERR;
+      if (nc_def_var_access_hint(ncid, varid + 1, NC_ACCESS_SPATIAL, NULL) != NC_ENOTVAR) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+   printf("\n*** Testing access hints.\n");
+   printf("*** testing access hints with HDF5...");
+   if (test_hints(FILE_NAME, 1)) ERR;
+   SUMMARIZE_ERR;
+#if NC_HAS_NCZARR
+   printf("*** testing access hints with NCZarr...");
+   /* NCZarr has no unlimited dimensions */
+   if (test_hints(NCZ_FILE_NAME, 0)) ERR;
+   SUMMARIZE_ERR;
+#endif
+   printf("*** testing access hints on a classic file...");
+   {
+      int ncid, dimid, varid;
+      if (nc_create(CLASSIC_FILE_NAME, NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "time", NT, &dimid)) ERR;
+      if (nc_def_var(ncid, "v", NC_FLOAT, 1, &dimid, &varid)) ERR;
+      if (nc_def_var_access_hint(ncid, varid, NC_ACCESS_TIMESERIES, NULL) != NC_ENOTNC4) ERR;
+      if (nc_inq_var_access_hint(ncid, varid, NULL, NULL) != NC_ENOTNC4) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
@@ -0,0 +1,140 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test nc_get_vara_arena and nc_get_vara_string_arena: strings, vlens
+   and compounds holding strings are read into an arena, checked
+   against the written data, and released with one nc_free_arena call.
+*/
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nc_tests.h>
+#include "err_macros.h"
+#include <netcdf_meta.h>
+
+#define FILE_NAME "tst_arena.nc"
+#define NCZ_FILE_NAME "file://tst_arena.file#mode=nczarr,file"
+#define NREC 300
+#define MAXLEN 2000
+
+typedef struct rec_t {
+   int key;
+   char* label;
+} rec_t;
+
+/* String i; every tenth string is long enough to need its own
+   block, unless limited to maxlen characters */
+static void
+makestring(int i, size_t maxlen, char* s)
+{
+   size_t len = (i % 10 == 0 ? 1000 + i : 1 + i % 17), k;
+   if (len > maxlen) len = maxlen;
+   for (k = 0; k < len; k++) s[k] = (char)('a' + (i + k) % 26);
+   s[len] = '\0';
+}
+
+/* Write, then read back the strings of "s" in two arena reads */
+static int
+test_strings(const char* path, size_t maxlen)
+{
+   int ncid, dimid, varid, i;
+   char buf[MAXLEN];
+   char* strings[NREC];
+   char* got[NREC];
+   size_t start = 0, count = NREC, half = NREC / 2;
+   nc_arena_t arena;
+
+   memset(&arena, 0, sizeof(arena));
+   for (i = 0; i < NREC; i++) {
+      makestring(i, maxlen, buf);
+      strings[i] = strdup(buf);
+   }
+   if (nc_create(path, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+   if (nc_def_dim(ncid, "n", NREC, &dimid)) ERR;
+   if (nc_def_var(ncid, "s", NC_STRING, 1, &dimid, &varid)) ERR;
+   if (nc_put_vara_string(ncid, varid, &start, &count, (const char**)strings)) ERR;
+   if (nc_close(ncid)) ERR;
+
+   if (nc_open(path, NC_NOWRITE, &ncid)) ERR;
+   if (nc_inq_varid(ncid, "s", &varid)) ERR;
+   /* Two reads share the arena */
+   if (nc_get_vara_string_arena(ncid, varid, &start, &half, got, &arena)) ERR;
+   start = half; count = NREC - half;
+   if (nc_get_vara_string_arena(ncid, varid, &start, &count, got + half, &arena)) ERR;
+   if (arena.blocks == NULL || arena.size == 0) ERR;
+   for (i = 0; i < NREC; i++)
+      if (strcmp(got[i], strings[i])) ERR;
+   /* An arena is required */
+   if (nc_get_vara_string_arena(ncid, varid, &start, &count, got, NULL) != NC_EINVAL) ERR;
+   if (nc_close(ncid)) ERR;
+   if (nc_free_arena(&arena)) ERR;
+   if (arena.blocks != NULL || arena.size != 0) ERR;
+   for (i = 0; i < NREC; i++) free(strings[i]);
+   return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+   printf("\n*** Testing arena reads.\n");
+   printf("*** testing arena read of strings...");
+   if (test_strings(FILE_NAME, MAXLEN - 1)) ERR;
+   SUMMARIZE_ERR;
+   printf("*** testing arena read of vlens and compounds with strings...");
+   {
+      int ncid, dimid, vlenid, recid, vvarid, rvarid, i, k;
+      nc_vlen_t vdata[NREC], vgot[NREC];
+      rec_t rdata[NREC], rgot[NREC];
+      char buf[MAXLEN];
+      size_t start = 0, count = NREC;
+      nc_arena_t arena;
+
+      memset(&arena, 0, sizeof(arena));
+      for (i = 0; i < NREC; i++) {
+         vdata[i].len = (size_t)(i % 7);
+         vdata[i].p = (i % 7 ? malloc((i % 7) * sizeof(int)) : NULL);
+         for (k = 0; k < i % 7; k++) ((int*)vdata[i].p)[k] = i * 10 + k;
+         makestring(i, MAXLEN - 1, buf);
+         rdata[i].key = i;
+         rdata[i].label = strdup(buf);
+      }
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_dim(ncid, "n", NREC, &dimid)) ERR;
+      if (nc_def_vlen(ncid, "ints", NC_INT, &vlenid)) ERR;
+      if (nc_def_compound(ncid, sizeof(rec_t), "rec", &recid)) ERR;
+      if (nc_insert_compound(ncid, recid, "key", NC_COMPOUND_OFFSET(rec_t, key), NC_INT)) ERR;
+      if (nc_insert_compound(ncid, recid, "label", NC_COMPOUND_OFFSET(rec_t, label), NC_STRING)) ERR;
+      if (nc_def_var(ncid, "v", vlenid, 1, &dimid, &vvarid)) ERR;
+      if (nc_def_var(ncid, "r", recid, 1, &dimid, &rvarid)) ERR;
+      if (nc_put_var(ncid, vvarid, vdata)) ERR;
+      if (nc_put_var(ncid, rvarid, rdata)) ERR;
+      if (nc_close(ncid)) ERR;
+
+      if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+      if (nc_inq_varid(ncid, "v", &vvarid)) ERR;
+      if (nc_inq_varid(ncid, "r", &rvarid)) ERR;
+      if (nc_get_vara_arena(ncid, vvarid, &start, &count, vgot, &arena)) ERR;
+      if (nc_get_vara_arena(ncid, rvarid, &start, &count, rgot, &arena)) ERR;
+      for (i = 0; i < NREC; i++) {
+         if (vgot[i].len != vdata[i].len) ERR;
+         if (vgot[i].len && memcmp(vgot[i].p, vdata[i].p, vgot[i].len * sizeof(int))) ERR;
+         if (rgot[i].key != i || strcmp(rgot[i].label, rdata[i].label)) ERR;
+      }
+      if (nc_close(ncid)) ERR;
+      if (nc_free_arena(&arena)) ERR;
+      for (i = 0; i < NREC; i++) {
+         free(vdata[i].p);
+         free(rdata[i].label);
+      }
+   }
+   SUMMARIZE_ERR;
+#if NC_HAS_NCZARR
+   printf("*** testing arena read of strings with NCZarr...");
+   /* NCZarr stores strings of at most 128 bytes by default */
+   if (test_strings(NCZ_FILE_NAME, 100)) ERR;
+   SUMMARIZE_ERR;
+#endif
+   FINAL_RESULTS;
+}
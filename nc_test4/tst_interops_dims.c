@@ -15,6 +15,60 @@
 
 #define FILE_NAME "tst_interops_dims.h5"
 #define DIM_LEN 100
+#define NUM_SCALES 50
+#define NUM_DSETS 200
+
+/* Create a 1-D dataset of length len and make it a dimension scale. */
+static hid_t
+make_scale(hid_t loc_id, const char *name, hsize_t len)
+{
+    hid_t spaceid, scaleid;
+
+    if ((spaceid = H5Screate_simple(1, &len, NULL)) < 0) return -1;
+    if ((scaleid = H5Dcreate2(loc_id, name, H5T_NATIVE_INT, spaceid,
+                              H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)) < 0) return -1;
+    if (H5Sclose(spaceid) < 0) return -1;
+    if (H5DSset_scale(scaleid, name) < 0) return -1;
+    return scaleid;
+}
+
+/* Create a 2-D dataset and attach a dimension scale to each dimension. */
+static int
+make_dset(hid_t loc_id, const char *name, hsize_t len0, hsize_t len1,
+          hid_t scale0, hid_t scale1)
+{
+    hid_t spaceid, dsetid;
+    hsize_t dims[2];
+
+    dims[0] = len0;
+    dims[1] = len1;
+    if ((spaceid = H5Screate_simple(2, dims, NULL)) < 0) return -1;
+    if ((dsetid = H5Dcreate2(loc_id, name, H5T_NATIVE_INT, spaceid,
+                             H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)) < 0) return -1;
+    if (H5DSattach_scale(dsetid, scale0, 0) < 0) return -1;
+    if (H5DSattach_scale(dsetid, scale1, 1) < 0) return -1;
+    if (H5Dclose(dsetid) < 0) return -1;
+    if (H5Sclose(spaceid) < 0) return -1;
+    return 0;
+}
+
+/* Check that a var has the dims with the given names, looked up in
+ * the groups that own them. */
+static int
+check_dimids(int grpid, const char *name, int dgrp0, const char *dim0,
+             int dgrp1, const char *dim1)
+{
+    int varid, ndims, dimids[2], dimid0, dimid1;
+
+    if (nc_inq_varid(grpid, name, &varid)) return 1;
+    if (nc_inq_varndims(grpid, varid, &ndims)) return 1;
+    if (ndims != 2) return 1;
+    if (nc_inq_vardimid(grpid, varid, dimids)) return 1;
+    if (nc_inq_dimid(dgrp0, dim0, &dimid0)) return 1;
+    if (nc_inq_dimid(dgrp1, dim1, &dimid1)) return 1;
+    if (dimids[0] != dimid0 || dimids[1] != dimid1) return 1;
+    return 0;
+}
 
 int
 main(int argc, char **argv)
@@ -128,5 +182,107 @@ main(int argc, char **argv)
        }
    }
    SUMMARIZE_ERR;
+   printf("*** Checking dimension scales in nested groups...");
+   {
+       hid_t fcpl_id, file_id, g1_id, g2_id;
+       hid_t x_id, y_id, z_id, y2_id;
+
+       /* Root has scales x and y, g1 has z and a hard link xl to x,
+        * and g1/g2 has its own y. */
+       if ((fcpl_id = H5Pcreate(H5P_FILE_CREATE)) < 0) ERR;
+       if (H5Pset_link_creation_order(fcpl_id, H5P_CRT_ORDER_TRACKED|H5P_CRT_ORDER_INDEXED) < 0) ERR;
+       if (H5Pset_attr_creation_order(fcpl_id, H5P_CRT_ORDER_TRACKED|H5P_CRT_ORDER_INDEXED) < 0) ERR;
+       if ((file_id = H5Fcreate(FILE_NAME, H5F_ACC_TRUNC, fcpl_id, H5P_DEFAULT)) < 0) ERR;
+       if ((g1_id = H5Gcreate2(file_id, "g1", H5P_DEFAULT, fcpl_id, H5P_DEFAULT)) < 0) ERR;
+       if ((g2_id = H5Gcreate2(g1_id, "g2", H5P_DEFAULT, fcpl_id, H5P_DEFAULT)) < 0) ERR;
+       if (H5Pclose(fcpl_id) < 0) ERR;
+       if ((x_id = make_scale(file_id, "x", 3)) < 0) ERR;
+       if ((y_id = make_scale(file_id, "y", 4)) < 0) ERR;
+       if ((z_id = make_scale(g1_id, "z", 5)) < 0) ERR;
+       if ((y2_id = make_scale(g2_id, "y", 6)) < 0) ERR;
+       if (H5Lcreate_hard(file_id, "x", g1_id, "xl", H5P_DEFAULT, H5P_DEFAULT) < 0) ERR;
+
+       /* Datasets using local scales, scales of ancestor groups, and
+        * the scale that is shared through the hard link. */
+       if (make_dset(file_id, "a", 3, 4, x_id, y_id)) ERR;
+       if (make_dset(g1_id, "b", 4, 5, y_id, z_id)) ERR;
+       if (make_dset(g1_id, "c", 3, 5, x_id, z_id)) ERR;
+       if (make_dset(g2_id, "d", 6, 5, y2_id, z_id)) ERR;
+       if (make_dset(g2_id, "e", 3, 4, x_id, y_id)) ERR;
+
+       if (H5Dclose(x_id) < 0 || H5Dclose(y_id) < 0 || H5Dclose(z_id) < 0 ||
+           H5Dclose(y2_id) < 0) ERR;
+       if (H5Gclose(g2_id) < 0 || H5Gclose(g1_id) < 0) ERR;
+       if (H5Fclose(file_id) < 0) ERR;
+
+       /* Now open the file with netCDF. A scale is found in the
+        * nearest group that has it as a dimension. */
+       {
+           int ncid, g1, g2;
+
+           if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+           if (nc_inq_grp_ncid(ncid, "g1", &g1)) ERR;
+           if (nc_inq_grp_ncid(g1, "g2", &g2)) ERR;
+           if (check_dimids(ncid, "a", ncid, "x", ncid, "y")) ERR;
+           if (check_dimids(g1, "b", ncid, "y", g1, "z")) ERR;
+           if (check_dimids(g1, "c", g1, "xl", g1, "z")) ERR;
+           if (check_dimids(g2, "d", g2, "y", g1, "z")) ERR;
+           if (check_dimids(g2, "e", g1, "xl", ncid, "y")) ERR;
+           if (nc_close(ncid)) ERR;
+       }
+   }
+   SUMMARIZE_ERR;
+   printf("*** Checking many datasets sharing many dimension scales...");
+   {
+       hid_t fcpl_id, file_id, g1_id;
+       hid_t scale_id[NUM_SCALES];
+       char name[NC_MAX_NAME + 1];
+       char name0[NC_MAX_NAME + 1];
+       char name1[NC_MAX_NAME + 1];
+       int i;
+
+       /* Scales are split between the root group and g1, datasets
+        * all live in g1. */
+       if ((fcpl_id = H5Pcreate(H5P_FILE_CREATE)) < 0) ERR;
+       if (H5Pset_link_creation_order(fcpl_id, H5P_CRT_ORDER_TRACKED|H5P_CRT_ORDER_INDEXED) < 0) ERR;
+       if (H5Pset_attr_creation_order(fcpl_id, H5P_CRT_ORDER_TRACKED|H5P_CRT_ORDER_INDEXED) < 0) ERR;
+       if ((file_id = H5Fcreate(FILE_NAME, H5F_ACC_TRUNC, fcpl_id, H5P_DEFAULT)) < 0) ERR;
+       if ((g1_id = H5Gcreate2(file_id, "g1", H5P_DEFAULT, fcpl_id, H5P_DEFAULT)) < 0) ERR;
+       if (H5Pclose(fcpl_id) < 0) ERR;
+       for (i = 0; i < NUM_SCALES; i++)
+       {
+           snprintf(name, sizeof(name), "dim_%d", i);
+           if ((scale_id[i] = make_scale(i % 2 ? g1_id : file_id, name, (hsize_t)i + 1)) < 0) ERR;
+       }
+       for (i = 0; i < NUM_DSETS; i++)
+       {
+           int d0 = i % NUM_SCALES, d1 = (i * 7 + 3) % NUM_SCALES;
+           snprintf(name, sizeof(name), "dset_%d", i);
+           if (make_dset(g1_id, name, (hsize_t)d0 + 1, (hsize_t)d1 + 1,
+                         scale_id[d0], scale_id[d1])) ERR;
+       }
+       for (i = 0; i < NUM_SCALES; i++)
+           if (H5Dclose(scale_id[i]) < 0) ERR;
+       if (H5Gclose(g1_id) < 0) ERR;
+       if (H5Fclose(file_id) < 0) ERR;
+
+       {
+           int ncid, g1;
+
+           if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) ERR;
+           if (nc_inq_grp_ncid(ncid, "g1", &g1)) ERR;
+           for (i = 0; i < NUM_DSETS; i++)
+           {
+               int d0 = i % NUM_SCALES, d1 = (i * 7 + 3) % NUM_SCALES;
+               snprintf(name, sizeof(name), "dset_%d", i);
+               snprintf(name0, sizeof(name0), "dim_%d", d0);
+               snprintf(name1, sizeof(name1), "dim_%d", d1);
+               if (check_dimids(g1, name, d0 % 2 ? g1 : ncid, name0,
+                                d1 % 2 ? g1 : ncid, name1)) ERR;
+           }
+           if (nc_close(ncid)) ERR;
+       }
+   }
+   SUMMARIZE_ERR;
    FINAL_RESULTS;
 }
@@ -0,0 +1,134 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test nc_copy_data, nc_dump_data and nc_reclaim_data on nested
+   types: a vlen of compounds holding strings and vlens, and a
+   compound that gains a string field after it was first copied.
+*/
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nc_tests.h>
+#include "err_macros.h"
+
+#define FILE_NAME "tst_reclaim.nc"
+#define NREC 3
+#define NOBS 4
+
+typedef struct obs_t {
+   int id;
+   char* tags[2];
+   nc_vlen_t values; /* vlen of int */
+   double weight;
+} obs_t;
+
+typedef struct pair_t {
+   int key;
+   char* label;
+} pair_t;
+
+static char*
+dupstr(const char* s)
+{
+   return s == NULL ? NULL : strdup(s);
+}
+
+int
+main(int argc, char **argv)
+{
+   printf("\n*** Testing deep copy and reclaim of nested user types.\n");
+   printf("*** testing vlen of compound with strings and vlens...");
+   {
+      int ncid, intvlen, obstype, obsvlen, tagdims[1] = {2};
+      nc_vlen_t recs[NREC], *copy = NULL;
+      char* dump1 = NULL;
+      char* dump2 = NULL;
+      int r, o, k;
+
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_vlen(ncid, "ints", NC_INT, &intvlen)) ERR;
+      if (nc_def_compound(ncid, sizeof(obs_t), "obs", &obstype)) ERR;
+      if (nc_insert_compound(ncid, obstype, "id", NC_COMPOUND_OFFSET(obs_t, id), NC_INT)) ERR;
+      if (nc_insert_array_compound(ncid, obstype, "tags", NC_COMPOUND_OFFSET(obs_t, tags), NC_STRING, 1, tagdims)) ERR;
+      if (nc_insert_compound(ncid, obstype, "values", NC_COMPOUND_OFFSET(obs_t, values), intvlen)) ERR;
+      if (nc_insert_compound(ncid, obstype, "weight", NC_COMPOUND_OFFSET(obs_t, weight), NC_DOUBLE)) ERR;
+      if (nc_def_vlen(ncid, "obslist", obstype, &obsvlen)) ERR;
+
+      /* Record r holds r+1 observations; some strings and vlens are empty */
+      for (r = 0; r < NREC; r++) {
+         obs_t* obs = calloc(r + 1, sizeof(obs_t));
+         char name[32];
+         for (o = 0; o <= r; o++) {
+            obs[o].id = r * 100 + o;
+            snprintf(name, sizeof(name), "tag%d_%d", r, o);
+            obs[o].tags[0] = dupstr(name);
+            obs[o].tags[1] = (o % 2 ? NULL : dupstr("even"));
+            obs[o].values.len = (size_t)o;
+            obs[o].values.p = (o > 0 ? malloc(o * sizeof(int)) : NULL);
+            for (k = 0; k < o; k++) ((int*)obs[o].values.p)[k] = r + o + k;
+            obs[o].weight = r + o / 10.0;
+         }
+         recs[r].len = (size_t)(r + 1);
+         recs[r].p = obs;
+      }
+
+      /* Copy twice, so the second copy uses the cached plans */
+      for (k = 0; k < 2; k++) {
+         if (nc_copy_data_all(ncid, obsvlen, recs, NREC, (void**)&copy)) ERR;
+         for (r = 0; r < NREC; r++) {
+            obs_t* src = recs[r].p;
+            obs_t* dst = copy[r].p;
+            if (copy[r].len != recs[r].len || dst == src) ERR;
+            for (o = 0; o <= r; o++) {
+               if (dst[o].id != src[o].id || dst[o].weight != src[o].weight) ERR;
+               if (strcmp(dst[o].tags[0], src[o].tags[0]) || dst[o].tags[0] == src[o].tags[0]) ERR;
+               if ((dst[o].tags[1] == NULL) != (src[o].tags[1] == NULL)) ERR;
+               if (src[o].tags[1] && strcmp(dst[o].tags[1], src[o].tags[1])) ERR;
+               if (dst[o].values.len != src[o].values.len) ERR;
+               if (o > 0 && (dst[o].values.p == src[o].values.p
+                             || memcmp(dst[o].values.p, src[o].values.p, o * sizeof(int)))) ERR;
+            }
+         }
+         if (k == 0) {
+            /* Break the copy's strings apart from the original */
+            ((obs_t*)copy[NREC-1].p)[0].tags[0][0] = 'X';
+            if (((obs_t*)recs[NREC-1].p)[0].tags[0][0] != 't') ERR;
+            ((obs_t*)copy[NREC-1].p)[0].tags[0][0] = 't';
+         } else {
+            if (nc_dump_data(ncid, obsvlen, recs, NREC, &dump1)) ERR;
+            if (nc_dump_data(ncid, obsvlen, copy, NREC, &dump2)) ERR;
+            if (strcmp(dump1, dump2)) ERR;
+            if (strstr(dump1, "tag2_1") == NULL) ERR;
+            free(dump1);
+            free(dump2);
+         }
+         if (nc_reclaim_data_all(ncid, obsvlen, copy, NREC)) ERR;
+      }
+      if (nc_reclaim_data(ncid, obsvlen, recs, NREC)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   printf("*** testing a compound that gains a string field...");
+   {
+      int ncid, pairtype;
+      pair_t src[2] = {{1, NULL}, {2, NULL}}, dst[2];
+
+      if (nc_create(FILE_NAME, NC_NETCDF4|NC_CLOBBER, &ncid)) ERR;
+      if (nc_def_compound(ncid, sizeof(pair_t), "pair", &pairtype)) ERR;
+      if (nc_insert_compound(ncid, pairtype, "key", NC_COMPOUND_OFFSET(pair_t, key), NC_INT)) ERR;
+      /* Only fixed size fields so far */
+      if (nc_copy_data(ncid, pairtype, src, 2, dst)) ERR;
+      if (dst[1].key != 2) ERR;
+      if (nc_insert_compound(ncid, pairtype, "label", NC_COMPOUND_OFFSET(pair_t, label), NC_STRING)) ERR;
+      src[0].label = "one";
+      src[1].label = "two";
+      if (nc_copy_data(ncid, pairtype, src, 2, dst)) ERR;
+      if (dst[0].label == src[0].label || strcmp(dst[1].label, "two")) ERR;
+      if (nc_reclaim_data(ncid, pairtype, dst, 2)) ERR;
+      if (nc_close(ncid)) ERR;
+   }
+   SUMMARIZE_ERR;
+   FINAL_RESULTS;
+}
@@ -27,6 +27,7 @@
 #include "ncdump.h"
 #include "isnan.h"
 #include "nctime0.h"
+#include "numfmt.h"
 
 static float float_eps;
 static double double_eps;
@@ -1394,6 +1395,106 @@ static typ_tostring_func ts_funcs[] = {
     };
 
 
+/* Faster conversions of primitive values, used for variables printed
+ * with the default formats, see set_val_tobuf_func().  The output is
+ * identical to that of the *_val_tostring() functions above. */
+static int
+ncfloat_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_g(buf, *(float *)valp, varp->gprec);
+}
+
+static int
+ncdouble_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_g(buf, *(double *)valp, varp->gprec);
+}
+
+static int
+ncbyte_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_int(buf, *(signed char *)valp);
+}
+
+static int
+ncshort_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_int(buf, *(short *)valp);
+}
+
+static int
+ncint_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_int(buf, *(int *)valp);
+}
+
+static int
+ncubyte_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_uint(buf, *(unsigned char *)valp);
+}
+
+static int
+ncushort_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_uint(buf, *(unsigned short *)valp);
+}
+
+static int
+ncuint_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_uint(buf, *(unsigned int *)valp);
+}
+
+static int
+ncint64_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_int(buf, *(long long *)valp);
+}
+
+static int
+ncuint64_val_tobuf(const ncvar_t *varp, char *buf, const void *valp) {
+    return numfmt_uint(buf, *(unsigned long long *)valp);
+}
+
+/* Set the fast conversion function for the variable pointed to by
+ * varp, if its type is primitive and numeric and its format is one
+ * the fast functions reproduce, else set it to NULL. */
+static void
+set_val_tobuf_func(ncvar_t *varp) {
+    const char *fmt = varp->fmt;
+    varp->val_tobuf = NULL;
+    varp->gprec = -1;
+    if(fmt == NULL)
+	return;
+    switch(varp->type) {
+    case NC_FLOAT:
+    case NC_DOUBLE:
+	varp->gprec = numfmt_gprec(fmt);
+	if(varp->gprec >= 0)
+	    varp->val_tobuf = (varp->type == NC_FLOAT) ?
+		ncfloat_val_tobuf : ncdouble_val_tobuf;
+	break;
+    case NC_BYTE:
+	if(NCSTREQ(fmt, "%d")) varp->val_tobuf = ncbyte_val_tobuf;
+	break;
+    case NC_SHORT:
+	if(NCSTREQ(fmt, "%d")) varp->val_tobuf = ncshort_val_tobuf;
+	break;
+    case NC_INT:
+	if(NCSTREQ(fmt, "%d")) varp->val_tobuf = ncint_val_tobuf;
+	break;
+    case NC_UBYTE:
+	if(NCSTREQ(fmt, "%u")) varp->val_tobuf = ncubyte_val_tobuf;
+	break;
+    case NC_USHORT:
+	if(NCSTREQ(fmt, "%u")) varp->val_tobuf = ncushort_val_tobuf;
+	break;
+    case NC_UINT:
+	if(NCSTREQ(fmt, "%u")) varp->val_tobuf = ncuint_val_tobuf;
+	break;
+    case NC_INT64:
+	if(NCSTREQ(fmt, "%lld")) varp->val_tobuf = ncint64_val_tobuf;
+	break;
+    case NC_UINT64:
+	if(NCSTREQ(fmt, "%llu")) varp->val_tobuf = ncuint64_val_tobuf;
+	break;
+    default:
+	break;
+    }
+}
+
 /* Set function pointer of function to convert a value to a string for
  * the variable pointed to by varp. */
 void
@@ -1412,12 +1513,14 @@ set_tostring_func(ncvar_t *varp) {
 	ncuint64_val_tostring,
 	ncstring_val_tostring
     };
+    varp->val_tobuf = NULL;
     if(varp->has_timeval && formatting_specs.string_times) {
 	varp->val_tostring = (val_tostring_func) nctime_val_tostring;
 	return;
     }
     if( !is_user_defined_type(varp->type) ) {
 	varp->val_tostring = tostring_funcs[varp->type - 1];
+	set_val_tobuf_func(varp);
 	return;
     }
 #ifdef USE_NETCDF4
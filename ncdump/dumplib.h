@@ -31,6 +31,7 @@ extern char *progname;		/* for error messages */
 
 #define FLT_DIGITS 7		/* default sig. digits for float data */
 #define DBL_DIGITS 15		/* default sig. digits for double data */
+#define DATA_BUFSIZE 5000000	/* default bytes of variable data read at once */
 
 extern int float_precision_specified; /* -p option specified float precision */
 extern int double_precision_specified; /* -p option specified double precision */
@@ -41,6 +41,16 @@ typedef int (*val_tostring_func)(const struct ncvar_t *this,
 				 struct safebuf_t *sb, 
 				 const void *valp);
 
+/* 
+ * Optional faster per-variable function to convert a value to a
+ * string in a fixed buffer of at least NUMFMT_LEN bytes, producing
+ * the same text as val_tostring.  Returns number of bytes in output,
+ * or -1 if val_tostring must be used for this value.
+ */
+typedef int (*val_tobuf_func)(const struct ncvar_t *this, 
+			      char *buf, 
+			      const void *valp);
+
 typedef struct nctype_t {	/* type */
     int ncid;		    /* group in which type is defined */
     nc_type tid;	    /* type ID */
@@ -83,6 +93,8 @@ typedef struct ncvar_t {	/* variable */
     /* member functions */
     val_tostring_func val_tostring; /* function to convert value to string for 
 				       output */
+    val_tobuf_func val_tobuf;	/* faster version of val_tostring, or NULL */
+    int gprec;			/* precision of fmt, if it is "%.<n>g" */
 } ncvar_t;
 
 typedef struct ncatt_t {			/* attribute */
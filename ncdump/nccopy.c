@@ -1684,15 +1684,10 @@ copy_var_data(int igrp, int varid, int ogrp)
 #endif
 	NC_CHECK(nc_put_vara(ogrp, ovarid, start, count, buf));
 #ifdef USE_NETCDF4
-	/* we have to explicitly free values for strings and vlens */
-	if(vartype == NC_STRING) {
-	    NC_CHECK(nc_free_string(ntoget, (char **)buf));
-	} else if(vartype > NC_STRING) { /* user-defined type */
-	    nc_type vclass;
-	    NC_CHECK(nc_inq_user_type(igrp, vartype, NULL, NULL, NULL, NULL, &vclass));
-	    if(vclass == NC_VLEN) {
-		NC_CHECK(nc_free_vlens(ntoget, (nc_vlen_t *)buf));
-	    }
+	/* we have to explicitly free values for strings and vlens,
+	   including those nested in compounds */
+	if(vartype >= NC_STRING) {
+	    NC_CHECK(nc_reclaim_data(igrp, vartype, buf, ntoget));
 	}
 #endif	/* USE_NETCDF4 */
     } /* end main iteration loop */
@@ -2149,44 +2144,6 @@ fail:
     exit(EXIT_FAILURE);
 }
 
-/*
- * For non-negative numeric string with multiplier suffix K, M, G, T,
- * or P (or lower-case equivalent), return corresponding value
- * incorporating multiplier 1000, 1000000, 1.0d9, ... 1.0d15, or -1.0
- * for error.
- */
-static double
-double_with_suffix(char *str) {
-    double dval;
-    char *suffix = 0;
-    errno = 0;
-    dval = strtod(str, &suffix);
-    if(dval < 0 || errno != 0)
-	return -1.0;
-    if(*suffix) {
-	switch (*suffix) {
-	case 'k': case 'K':
-	    dval *= 1000;
-	    break;
-	case 'm': case 'M':
-	    dval *= 1000000;
-	    break;
-	case 'g': case 'G':
-	    dval *= 1000000000;
-	    break;
-	case 't': case 'T':
-	    dval *= 1.0e12;
-	    break;
-	case 'p': case 'P':
-	    dval *= 1.0e15;
-	    break;
-	default:
-	    dval = -1.0;	/* error, suffix multiplier must be K, M, G, or T */
-	}
-    }
-    return dval;
-}
-
 static void
 usage(void)
 {
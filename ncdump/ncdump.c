@@ -55,6 +55,9 @@ Research/Unidata. See \ref copyright file for more info.  */
 #define LPAREN "("
 #define RPAREN ")"
 
+/* Size of the stdout buffer, when output is not to a terminal */
+#define OUTPUT_BUFSIZE 1048576
+
 #define int64_t long long
 #define uint64_t unsigned long long
 
@@ -116,6 +119,7 @@ usage(void)
   [-b [c|f]]       Brief annotations for C or Fortran indices in data\n\
   [-f [c|f]]       Full annotations for C or Fortran indices in data\n\
   [-l len]         Line length maximum in data section (default 80)\n\
+  [-m n]           Size in bytes of buffer for reading data (default 5M)\n\
   [-n name]        Name for netCDF (default derived from file name)\n\
   [-p n[,n]]       Display floating-point values with less precision\n\
   [-k]             Output kind of netCDF file\n\
@@ -131,7 +135,7 @@ usage(void)
   file             Name of netCDF file (or URL if DAP access enabled)\n"
 
     (void) fprintf(stderr,
-		   "%s [-c|-h] [-v ...] [[-b|-f] [c|f]] [-l len] [-n name] [-p n[,n]] [-k] [-x] [-s] [-t|-i] [-g ...] [-w] [-F] [-Ln] file\n%s",
+		   "%s [-c|-h] [-v ...] [[-b|-f] [c|f]] [-l len] [-m n] [-n name] [-p n[,n]] [-k] [-x] [-s] [-t|-i] [-g ...] [-w] [-F] [-Ln] file\n%s",
 		   progname,
 		   USAGE);
 
@@ -2263,6 +2267,7 @@ main(int argc, char *argv[])
 
     progname = argv[0];
     set_formats(FLT_DIGITS, DBL_DIGITS); /* default for float, double data */
+    formatting_specs.data_bufsize = DATA_BUFSIZE;
 
     /* If the user called ncdump without arguments, print the usage
      * message and return peacefully. */
@@ -2273,7 +2278,7 @@ main(int argc, char *argv[])
     }
 
     opterr = 1;
-    while ((c = getopt(argc, argv, "b:cd:f:g:hikl:n:p:stv:xwFKL:X:")) != EOF)
+    while ((c = getopt(argc, argv, "b:cd:f:g:hikl:m:n:p:stv:xwFKL:X:")) != EOF)
       switch(c) {
 	case 'h':		/* dump header only, no data */
 	  formatting_specs.header_only = true;
@@ -2323,6 +2328,16 @@ main(int argc, char *argv[])
 	      goto fail;
 	  }
 	  break;
+	case 'm':		/* size of buffer for reading data */
+	  {
+	      double dval = double_with_suffix(optarg); /* "K" for kilobytes, "M" for megabytes, ... */
+	      if(dval < 1) {
+		  snprintf(errmsg,sizeof(errmsg),"invalid value for -m option: %s", optarg);
+		  goto fail;
+	      }
+	      formatting_specs.data_bufsize = (size_t)dval;
+	  }
+	  break;
 	case 'v':		/* variable names */
 	  /* make list of names of variables specified */
 	  make_lvars (optarg, &formatting_specs.nlvars, &formatting_specs.lvars);
@@ -2407,6 +2422,12 @@ main(int argc, char *argv[])
 
     set_max_len(max_len);
 
+#ifdef HAVE_UNISTD_H
+    /* Write output in large blocks, unless it goes to a terminal */
+    if(!isatty(fileno(stdout)))
+	setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFSIZE);
+#endif
+
     argc -= optind;
     argv += optind;
 
@@ -82,6 +82,8 @@ typedef struct {			/* specification for how to format dump */
 
     int xopt_inmemory;      /* Use in-memory option; testing only */
     int xopt_props ;      /* 1=>Unconditionally Suppress properties attribute */
+    size_t data_bufsize;	/* size in bytes of the buffer for reading
+				 * variable data, -m option */
 } fspec_t;
 
 #endif	/*_NCDUMP_H_ */
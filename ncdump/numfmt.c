@@ -0,0 +1,212 @@
+/*********************************************************************
+ *   Copyright 2018, University Corporation for Atmospheric Research
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+/*
+ * Fast number to text conversion for the ncdump data section.
+ *
+ * numfmt_g() produces exactly the text of printf("%.<prec>g"). The
+ * value is scaled to prec digits with one multiplication by a power
+ * of ten in the widest floating point type, and the error bound of
+ * that multiplication is tracked. When the rounding of the last digit
+ * cannot be decided from the scaled value, because it is too close to
+ * a tie, -1 is returned and the caller uses printf. With an 80-bit
+ * long double that happens for well under 1% of the values at the
+ * default precisions.
+ */
+
+#include "config.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "numfmt.h"
+
+#if defined(LDBL_MANT_DIG) && LDBL_MANT_DIG >= 64
+typedef long double wide_t;
+#define WIDE_EPS LDBL_EPSILON
+#define P10_MAX 340
+#define WIDE_POW10(n) powl(10.0L, (long double)(n))
+#define WIDE_FLOOR(x) floorl(x)
+#else
+typedef double wide_t;
+#define WIDE_EPS DBL_EPSILON
+#define P10_MAX 290
+#define WIDE_POW10(n) pow(10.0, (double)(n))
+#define WIDE_FLOOR(x) floor(x)
+#endif
+
+/* The digits must fit in an unsigned long long */
+#define NUMFMT_MAXPREC 17
+
+static wide_t p10[2*P10_MAX+1];
+static unsigned long long u10[NUMFMT_MAXPREC+1];
+static int initialized = 0;
+
+static void
+numfmt_init(void)
+{
+    int i;
+    for(i = -P10_MAX; i <= P10_MAX; i++)
+	p10[i+P10_MAX] = WIDE_POW10(i);
+    u10[0] = 1;
+    for(i = 1; i <= NUMFMT_MAXPREC; i++)
+	u10[i] = u10[i-1] * 10;
+    initialized = 1;
+}
+
+int
+numfmt_gprec(const char *fmt)
+{
+    int prec = 0;
+    int ndigits = 0;
+    const char *p = fmt;
+
+    if(p == NULL || *p++ != '%')
+	return -1;
+    if(p[0] == 'g' && p[1] == '\0')
+	return 6;
+    if(*p++ != '.')
+	return -1;
+    for(; *p >= '0' && *p <= '9' && ndigits < 3; p++, ndigits++)
+	prec = 10 * prec + (*p - '0');
+    if(p[0] != 'g' || p[1] != '\0')
+	return -1;
+    return prec;
+}
+
+int
+numfmt_g(char *buf, double v, int prec)
+{
+    char digits[NUMFMT_MAXPREC];
+    unsigned long long d, lo, hi;
+    wide_t scaled, frac, tol;
+    int e, bexp, tries, nd, i;
+    int n = 0;
+
+    if(prec == 0)
+	prec = 1;
+    if(prec < 0 || prec > NUMFMT_MAXPREC || !isfinite(v))
+	return -1;
+    if(v == 0) {
+	if(signbit(v))
+	    buf[n++] = '-';
+	buf[n++] = '0';
+	buf[n] = '\0';
+	return n;
+    }
+    if(!initialized)
+	numfmt_init();
+
+    /* Find e such that 10^(prec-1) <= |v| * 10^(prec-1-e) < 10^prec */
+    (void) frexp(v, &bexp);
+    e = (int)floor((bexp - 1) * 0.30102999566398120);
+    lo = u10[prec-1];
+    hi = u10[prec];
+    for(tries = 0; ; tries++) {
+	const int s = prec - 1 - e;
+	if(tries > 2 || s < -P10_MAX || s > P10_MAX)
+	    return -1;
+	scaled = (wide_t)fabs(v) * p10[s+P10_MAX];
+	/* Generous bound on the error of the power and the product */
+	tol = scaled * (16 * WIDE_EPS);
+	if(tol >= 0.25)
+	    return -1;
+	if(scaled >= (wide_t)hi)
+	    e++;
+	else if(scaled < (wide_t)lo)
+	    e--;
+	else
+	    break;
+    }
+
+    /* Round to nearest, unless too close to call */
+    d = (unsigned long long)WIDE_FLOOR(scaled);
+    frac = scaled - (wide_t)d;
+    if((frac > 0.5 ? frac - 0.5 : 0.5 - frac) <= tol)
+	return -1;
+    if(frac > 0.5)
+	d++;
+    if(d == hi) {
+	d = lo;
+	e++;
+    }
+    if(d < lo || d >= hi)
+	return -1;
+
+    for(i = prec - 1; i >= 0; i--) {
+	digits[i] = (char)('0' + (int)(d % 10));
+	d /= 10;
+    }
+    /* No trailing zeros after the decimal point */
+    nd = prec;
+    while(nd > 1 && digits[nd-1] == '0')
+	nd--;
+
+    if(signbit(v))
+	buf[n++] = '-';
+    if(e < -4 || e >= prec) {
+	int ae = (e < 0 ? -e : e);
+	buf[n++] = digits[0];
+	if(nd > 1) {
+	    buf[n++] = '.';
+	    memcpy(buf + n, digits + 1, (size_t)(nd - 1));
+	    n += nd - 1;
+	}
+	buf[n++] = 'e';
+	buf[n++] = (e < 0 ? '-' : '+');
+	if(ae >= 100) {
+	    buf[n++] = (char)('0' + ae / 100);
+	    ae %= 100;
+	}
+	buf[n++] = (char)('0' + ae / 10);
+	buf[n++] = (char)('0' + ae % 10);
+    } else if(e >= 0) {
+	const int ilen = e + 1;
+	memcpy(buf + n, digits, (size_t)ilen);
+	n += ilen;
+	if(nd > ilen) {
+	    buf[n++] = '.';
+	    memcpy(buf + n, digits + ilen, (size_t)(nd - ilen));
+	    n += nd - ilen;
+	}
+    } else {
+	buf[n++] = '0';
+	buf[n++] = '.';
+	for(i = 0; i < -e - 1; i++)
+	    buf[n++] = '0';
+	memcpy(buf + n, digits, (size_t)nd);
+	n += nd;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+int
+numfmt_uint(char *buf, unsigned long long v)
+{
+    char tmp[NUMFMT_LEN];
+    int n = 0;
+    int len;
+
+    do {
+	tmp[n++] = (char)('0' + (int)(v % 10));
+	v /= 10;
+    } while(v != 0);
+    for(len = 0; n > 0; len++)
+	buf[len] = tmp[--n];
+    buf[len] = '\0';
+    return len;
+}
+
+int
+numfmt_int(char *buf, long long v)
+{
+    if(v < 0) {
+	buf[0] = '-';
+	/* Negate in unsigned arithmetic so that LLONG_MIN works */
+	return 1 + numfmt_uint(buf + 1, 0ULL - (unsigned long long)v);
+    }
+    return numfmt_uint(buf, (unsigned long long)v);
+}
@@ -0,0 +1,24 @@
+/*********************************************************************
+ *   Copyright 2018, University Corporation for Atmospheric Research
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+#ifndef _NUMFMT_H
+#define _NUMFMT_H
+
+/* Large enough for any value produced by the functions below */
+#define NUMFMT_LEN 48
+
+/* Return the precision if fmt is exactly "%g" or "%.<n>g",
+ * else -1. */
+extern int numfmt_gprec(const char *fmt);
+
+/* Format finite v as printf("%.<prec>g") would, into buf.  Returns
+ * the length, or -1 if the result could not be determined exactly;
+ * then the caller must use printf.  Nothing is written in that case. */
+extern int numfmt_g(char *buf, double v, int prec);
+
+/* Format as printf("%lld") / printf("%llu"); returns the length */
+extern int numfmt_int(char *buf, long long v);
+extern int numfmt_uint(char *buf, unsigned long long v);
+
+#endif /* _NUMFMT_H */
@@ -47,6 +47,9 @@ $CC ./iter.c -o iter.exe
 ${NCGEN} -k nc3 -o iter.nc ./iter.cdl
 echo "*** dumping iter.nc to iter.dmp"
 ${NCDUMP} iter.nc > iter.dmp
+echo "*** dumping iter.nc with a small read buffer"
+${NCDUMP} -m 3000 iter.nc > iter.dmp2
+diff iter.dmp iter.dmp2
 echo "*** reformat iter.dmp"
 mv iter.dmp iter.tmp
 sed -e 's/\([0-9][,]\) /\1@/g' <iter.tmp |tr '@' '\n' |sed -e '/^$/d' >./iter.dmp
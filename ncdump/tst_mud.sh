@@ -19,6 +19,11 @@ diff -b tst_mud4.cdl $srcdir/ref_tst_mud4.cdl
 # echo "*** comparing annotation from ncdump -bc tst_mud4.nc with expected output..."
 ${NCDUMP} -bc tst_mud4.nc > tst_mud4-bc.cdl
 diff -b tst_mud4-bc.cdl $srcdir/ref_tst_mud4-bc.cdl
+# Read the data a few rows at a time
+${NCDUMP} -m 60 tst_mud4.nc > tst_mud4-m.cdl
+diff -b tst_mud4-m.cdl $srcdir/ref_tst_mud4.cdl
+${NCDUMP} -bc -m 60 tst_mud4.nc > tst_mud4-m-bc.cdl
+diff -b tst_mud4-m-bc.cdl $srcdir/ref_tst_mud4-bc.cdl
 # Now test with char arrays instead of ints
 echo "*** creating netcdf file tst_mud4_chars.nc from ref_tst_mud4_chars.cdl ..."
 ${NCGEN} -4 -b -o tst_mud4_chars.nc $srcdir/ref_tst_mud4_chars.cdl
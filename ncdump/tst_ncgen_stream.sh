@@ -0,0 +1,68 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+# This shell script checks that a data section that ncgen streams,
+# because the classic model output format is given up front, produces
+# the same file as when the whole data section is buffered.
+set -e
+
+# get some config.h parameters
+if test -f ${top_builddir}/config.h ; then
+  if fgrep -e '#define ENABLE_CDF5 1' ${top_builddir}/config.h >/dev/null ; then
+    CDF5=1
+  else
+    CDF5=0
+  fi
+else
+  echo "Cannot locate config.h"
+  exit 1
+fi
+
+echo ""
+echo "*** Testing ncgen streaming of the data section."
+rm -f tst_ncgen_stream*.nc tmp_ncgen_stream*.cdl
+
+# Without -k or _Format the data section is buffered
+${NCGEN} -b -o tst_ncgen_stream.nc $srcdir/tst_ncgen_stream.cdl
+${NCDUMP} -n tst_ncgen_stream tst_ncgen_stream.nc > tmp_ncgen_stream.cdl
+${NCGEN} -x -b -o tst_ncgen_stream_nofill.nc $srcdir/tst_ncgen_stream.cdl
+${NCDUMP} -n tst_ncgen_stream tst_ncgen_stream_nofill.nc > tmp_ncgen_stream_nofill.cdl
+
+KINDS="nc3 nc6"
+if test "x$CDF5" = x1 ; then KINDS="$KINDS nc5"; fi
+for k in $KINDS ; do
+echo "*** streaming with -k $k..."
+${NCGEN} -k $k -b -o tst_ncgen_stream_$k.nc $srcdir/tst_ncgen_stream.cdl
+${NCDUMP} -n tst_ncgen_stream tst_ncgen_stream_$k.nc > tmp_ncgen_stream_$k.cdl
+diff -b tmp_ncgen_stream.cdl tmp_ncgen_stream_$k.cdl
+${NCGEN} -x -k $k -b -o tst_ncgen_stream_$k.nc $srcdir/tst_ncgen_stream.cdl
+${NCDUMP} -n tst_ncgen_stream tst_ncgen_stream_$k.nc > tmp_ncgen_stream_$k.cdl
+diff -b tmp_ncgen_stream_nofill.cdl tmp_ncgen_stream_$k.cdl
+done
+
+# The classic file is the same byte for byte
+${NCGEN} -k nc3 -b -o tst_ncgen_stream_nc3.nc $srcdir/tst_ncgen_stream.cdl
+cmp tst_ncgen_stream.nc tst_ncgen_stream_nc3.nc
+
+echo "*** checking that an error while streaming leaves no file..."
+sed -e 's/^ sc = 3.25 ;/ sc = {3.25} ;/' $srcdir/tst_ncgen_stream.cdl > tmp_ncgen_stream_bad.cdl
+rm -f tst_ncgen_stream_bad.nc
+if ${NCGEN} -k nc3 -b -o tst_ncgen_stream_bad.nc tmp_ncgen_stream_bad.cdl 2>/dev/null ; then
+  echo "*** FAIL: ncgen accepted bad data"
+  exit 1
+fi
+sed -e 's/^ b = -1, 2, 3, 4, 5 ;/ b = {-1}, 2 ;/' $srcdir/tst_ncgen_stream.cdl > tmp_ncgen_stream_bad.cdl
+if ${NCGEN} -k nc3 -b -o tst_ncgen_stream_bad.nc tmp_ncgen_stream_bad.cdl 2>/dev/null ; then
+  echo "*** FAIL: ncgen accepted bad data"
+  exit 1
+fi
+if test -f tst_ncgen_stream_bad.nc ; then
+  echo "*** FAIL: partial file was left behind"
+  exit 1
+fi
+
+rm -f tst_ncgen_stream*.nc tmp_ncgen_stream*.cdl
+echo "*** All ncgen streaming tests passed!"
+exit 0
@@ -12,6 +12,7 @@
 #include <netcdf.h>
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include "utils.h"
 #include "nccomps.h"
 #ifndef isascii
@@ -996,3 +997,41 @@ void nc_get_att_single_string(const int ncid, const int varid,
         exit(2);
     }
 }
+
+/*
+ * For non-negative numeric string with multiplier suffix K, M, G, T,
+ * or P (or lower-case equivalent), return corresponding value
+ * incorporating multiplier 1000, 1000000, 1.0d9, ... 1.0d15, or -1.0
+ * for error.
+ */
+double
+double_with_suffix(char *str) {
+    double dval;
+    char *suffix = 0;
+    errno = 0;
+    dval = strtod(str, &suffix);
+    if(dval < 0 || errno != 0)
+	return -1.0;
+    if(*suffix) {
+	switch (*suffix) {
+	case 'k': case 'K':
+	    dval *= 1000;
+	    break;
+	case 'm': case 'M':
+	    dval *= 1000000;
+	    break;
+	case 'g': case 'G':
+	    dval *= 1000000000;
+	    break;
+	case 't': case 'T':
+	    dval *= 1.0e12;
+	    break;
+	case 'p': case 'P':
+	    dval *= 1.0e15;
+	    break;
+	default:
+	    dval = -1.0;	/* error, suffix multiplier must be K, M, G, or T */
+	}
+    }
+    return dval;
+}
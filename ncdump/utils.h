@@ -155,6 +155,10 @@ extern void make_lgrps(char *optarg, int *nlgrpsp, char*** lgrpsp, idnode_t **gr
 /* Release an id list */
 extern void freeidlist(idnode_t *idlist);
 
+/* Value of numeric string with optional K, M, G, T, or P suffix, or
+ * -1.0 for error */
+extern double double_with_suffix(char *str);
+
 /* 
  * Simplest interface for group iteration: get total number of groups
  * (including all descendant groups, recursively) and all group ids
@@ -19,6 +19,7 @@
 #include "indent.h"
 #include "vardata.h"
 #include "netcdf_aux.h"
+#include "numfmt.h"
 
 /* maximum len of string needed for one value of a primitive type */
 #define MAX_OUTPUT_LEN 100
@@ -58,23 +59,26 @@ set_max_len(int len) {
  * output string.  If string ends with a newline to force short line,
  * reset indentation after output.
  */
-void
-lput(const char *cp) {
-    size_t nn = strlen(cp);
-
+static void
+lputn(const char *cp, size_t nn) {
     if (nn+linep > max_line_len && nn > 2) {
 	(void) fputs("\n", stdout);
 	indent_out();
 	(void) fputs(LINEPIND, stdout);
 	linep = (int)strlen(LINEPIND) + indent_get();
     }
-    (void) fputs(cp,stdout);
+    (void) fwrite(cp, 1, nn, stdout);
     if (nn > 0 && cp[nn - 1] == '\n') {
 	linep = indent_get();
     } else
 	linep += nn;
 }
 
+void
+lput(const char *cp) {
+    lputn(cp, strlen(cp));
+}
+
 
 /*--------------------------------------------------------------------------*/
 
@@ -178,6 +182,37 @@ print_any_val(
     }
 }
 
+/*
+ * Output a value of a variable followed by ", ", as print_any_val()
+ * and lput() would, but converting it with the faster val_tobuf
+ * function of the variable when it has one.
+ */
+static void
+lput_any_val(
+    safebuf_t *sb,		/* string for output, if needed */
+    const ncvar_t *varp,	/* variable */
+    const void *valp		/* pointer to the value */
+	    )
+{
+    char buf[NUMFMT_LEN + 3];
+    int len = -1;
+
+    if (varp->val_tobuf != NULL &&
+	!(varp->has_fillval &&
+	  (*(varp->tinfo->val_equals))((const nctype_t *)varp->tinfo,
+				       (const void*)varp->fillvalp, valp)))
+	len = (*varp->val_tobuf)(varp, buf, valp);
+    if (len < 0) {
+	print_any_val(sb, varp, valp);
+	sbuf_cat(sb, ", ");
+	lput(sbuf_str(sb));
+	return;
+    }
+    buf[len++] = ',';
+    buf[len++] = ' ';
+    lputn(buf, (size_t)len);
+}
+
 /*
  * print last delimiter in each line before annotation (, or ;)
  */
@@ -414,6 +449,129 @@ upcorner(
     return ret;
 }
 
+/*
+ * Buffer of consecutive rows (values along the last dimension) of a
+ * variable.  Rows are read in blocks of up to about
+ * formatting_specs.data_bufsize bytes, each a single hyperslab, rather
+ * than with one nc_get_vara() call per row.
+ */
+typedef struct rowbuf_t {
+    int ncid;
+    int varid;
+    const ncvar_t *vp;
+    const size_t *vdims;	/* variable dimension sizes */
+    size_t ncols;		/* values in a row */
+    size_t maxrows;		/* rows that fit in vals */
+    size_t first;		/* index of first row in vals */
+    size_t nrows;		/* rows now in vals */
+    size_t *start;		/* for reading a block */
+    size_t *count;
+    void *vals;
+} rowbuf_t;
+
+static void
+rowbuf_init(rowbuf_t *rb, int ncid, int varid, const ncvar_t *vp,
+	    const size_t *vdims, size_t ncols)
+{
+    int rank = vp->ndims;
+    size_t rowsize = ncols * vp->tinfo->size;
+    int id;
+
+    rb->ncid = ncid;
+    rb->varid = varid;
+    rb->vp = vp;
+    rb->vdims = vdims;
+    rb->ncols = ncols;
+    rb->maxrows = 1;
+    if (rank > 1 && rowsize > 0 && rowsize < formatting_specs.data_bufsize) {
+	rb->maxrows = formatting_specs.data_bufsize / rowsize;
+	for (id = 0; id < rank - 1; id++) {
+	    if (vdims[id] == 0)	/* read rows one at a time, as requested */
+		rb->maxrows = 1;
+	}
+    }
+    rb->first = 0;
+    rb->nrows = 0;
+    rb->start = (size_t *) emalloc((1 + rank) * sizeof(size_t));
+    rb->count = (size_t *) emalloc((1 + rank) * sizeof(size_t));
+    rb->vals = emalloc(rb->maxrows * rowsize + 1);
+}
+
+static int
+rowbuf_clear(rowbuf_t *rb)
+{
+    int stat = NC_NOERR;
+    /* In case vals has memory hanging off e.g. vlen or string, make sure to reclaim it */
+    if (rb->nrows > 0)
+	stat = nc_reclaim_data(rb->ncid, rb->vp->type, rb->vals, rb->nrows * rb->ncols);
+    rb->nrows = 0;
+    return stat;
+}
+
+static void
+rowbuf_free(rowbuf_t *rb)
+{
+    NC_CHECK(rowbuf_clear(rb));
+    free(rb->vals);
+    free(rb->start);
+    free(rb->count);
+}
+
+/*
+ * Get a pointer to the row of values starting at cor, with edges edg,
+ * reading it and the rows after it if it is not already in the
+ * buffer.  A block is the largest run of whole slices of the inner
+ * dimensions that starts at cor and fits in the buffer.
+ */
+static int
+rowbuf_get(rowbuf_t *rb, const size_t *cor, const size_t *edg, char **rowp)
+{
+    int rank = rb->vp->ndims;
+    size_t row = 0;
+    size_t nrows = 1;
+    int id;
+
+    for (id = 0; id < rank - 1; id++)
+	row = row * rb->vdims[id] + cor[id];
+    if (rb->nrows > 0 && row >= rb->first && row < rb->first + rb->nrows) {
+	*rowp = (char *)rb->vals + (row - rb->first) * rb->ncols * rb->vp->tinfo->size;
+	return NC_NOERR;
+    }
+    NC_CHECK(rowbuf_clear(rb));
+    if (rb->maxrows == 1) {
+	NC_CHECK(nc_get_vara(rb->ncid, rb->varid, cor, edg, rb->vals));
+    } else {
+	/* Find the outermost dimension k at which the block can start:
+	 * the rows in one step of dimension k must fit, and cor must be
+	 * at the start of such a step */
+	size_t inner = 1;	/* rows in one step of dimension k */
+	int k = rank - 2;
+	while (k > 0 && inner * rb->vdims[k] <= rb->maxrows
+	       && row % (inner * rb->vdims[k]) == 0) {
+	    inner *= rb->vdims[k];
+	    k--;
+	}
+	nrows = rb->maxrows / inner;
+	if (nrows > rb->vdims[k] - cor[k])
+	    nrows = rb->vdims[k] - cor[k];
+	for (id = 0; id < rank; id++) {
+	    rb->start[id] = cor[id];
+	    if (id < k)
+		rb->count[id] = 1;
+	    else if (id == k)
+		rb->count[id] = nrows;
+	    else
+		rb->count[id] = rb->vdims[id];
+	}
+	nrows *= inner;
+	NC_CHECK(nc_get_vara(rb->ncid, rb->varid, rb->start, rb->count, rb->vals));
+    }
+    rb->first = row;
+    rb->nrows = nrows;
+    *rowp = rb->vals;
+    return NC_NOERR;
+}
+
 /*  Print data values for variable varid.
  *
  * Recursive to handle possibility of variables with multiple
@@ -430,7 +588,7 @@ print_rows(
     size_t vdims[],    	/* variable dimension sizes */
     size_t cor[],      	/* corner coordinates */
     size_t edg[],      	/* edges of hypercube */
-    void *vals,   	/* allocated buffer for ncols values in a row */
+    rowbuf_t *rb,   	/* buffer of rows of values */
     int marks_pending	/* number of pending closing "}" record markers */
     )
 {
@@ -461,41 +619,38 @@ print_rows(
 	local_edg[level] = 1;
 	for(i = 0; i < d0 - 1; i++) {
 	    print_rows(level + 1, ncid, varid, vp, vdims,
-		       local_cor, local_edg, vals, 0);
+		       local_cor, local_edg, rb, 0);
 	    local_cor[level] += 1;
 	}
 	print_rows(level + 1, ncid, varid, vp, vdims,
-		   local_cor, local_edg, vals, marks_pending);
+		   local_cor, local_edg, rb, marks_pending);
 	free(local_edg);
 	free(local_cor);
     } else {			/* bottom out of recursion */
-	char *valp = vals;
+	char *valp;
 	bool_t lastrow;
 	int j;
 	if(formatting_specs.brief_data_cmnts && rank > 1 && ncols > 0) {
 	    annotate_brief(vp, cor, vdims);
 	}
-	NC_CHECK(nc_get_vara(ncid, varid, cor, edg, (void *)valp));
+	NC_CHECK(rowbuf_get(rb, cor, edg, &valp));
 
 	/* Test if we should treat array of chars as strings along last dimension  */
 	if(vp->type == NC_CHAR && (vp->fmt == 0 || NCSTREQ(vp->fmt,"%s") || NCSTREQ(vp->fmt,""))) {
-	    pr_tvals(vp, ncols, vals, cor);
+	    pr_tvals(vp, ncols, valp, cor);
 	} else {			/* for non-text variables */
 	    for(i=0; i < d0 - 1; i++) {
-		print_any_val(sb, vp, (void *)valp);
-		valp += vp->tinfo->size; /* next value according to type */
 		if (formatting_specs.full_data_cmnts) {
+		    print_any_val(sb, vp, (void *)valp);
 		    printf("%s, ", sb->buf);
 		    annotate (vp, cor, i);
 		} else {
-		    sbuf_cat(sb, ", ");
-		    lput(sbuf_str(sb));
+		    lput_any_val(sb, vp, (void *)valp);
 		}
+		valp += vp->tinfo->size; /* next value according to type */
 	    }
 	    print_any_val(sb, vp, (void *)valp);
 	}
-        /* In case vals has memory hanging off e.g. vlen or string, make sure to reclaim it */
-        NC_CHECK(nc_reclaim_data(ncid,vp->type,vals,ncols));
 
 	/* determine if this is the last row */
 	lastrow = true;
@@ -536,7 +691,7 @@ vardata(
     size_t *cor;	     /* corner coordinates */
     size_t *edg;	     /* edges of hypercube */
     size_t *add;	     /* "odometer" increment to next "row"  */
-    void *vals;
+    rowbuf_t rb;
 
     int id;
     size_t nels;
@@ -583,10 +738,10 @@ vardata(
 	if (vrank > 1)
 	  add[vrank-2] = 1;
     }
-    vals = emalloc(ncols * vp->tinfo->size);
+    rowbuf_init(&rb, ncid, varid, vp, vdims, ncols);
 
-    NC_CHECK(print_rows(level, ncid, varid, vp, vdims, cor, edg, vals, marks_pending));
-    free(vals);
+    NC_CHECK(print_rows(level, ncid, varid, vp, vdims, cor, edg, &rb, marks_pending));
+    rowbuf_free(&rb);
     free(cor);
     free(edg);
     free(add);
@@ -14,6 +14,8 @@
 #undef TRACE
 
 /* Forward*/
+static void genbin_define(void);
+static void genbin_streamfinish(void);
 static int genbin_defineattr(Symbol* asym);
 static int genbin_definevardata(Symbol* vsym);
 static int  genbin_write(Generator*,Symbol*,Bytebuffer*,int,size_t*,size_t*);
@@ -29,6 +31,35 @@ static int genbin_definespecialattributes(Symbol* var);
  */
 void
 genbin_netcdf(void)
+{
+    int ivar;
+    int nvars = listlength(vardefs);
+
+    /* A streamed file was defined when the data section began */
+    if(stream_flag)
+        genbin_streamfinish();
+    else
+        genbin_define();
+
+    if(!header_only) {
+        /* Load values into those variables with defined data */
+        if(nvars > 0) {
+            for(ivar = 0; ivar < nvars; ivar++) {
+                Symbol* vsym = (Symbol*)listget(vardefs,ivar);
+                if(vsym->data != NULL) {
+                    genbin_definevardata(vsym);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Create the file and define its groups, types, dimensions,
+ * variables and attributes.
+ */
+static void
+genbin_define(void)
 {
     int stat, ncid;
     int idim, ivar, iatt;
@@ -166,18 +197,6 @@ genbin_netcdf(void)
     /* leave define mode */
     stat = nc_enddef(rootgroup->nc_id);
     CHECK_ERR(stat);
-
-    if(!header_only) {
-        /* Load values into those variables with defined data */
-        if(nvars > 0) {
-            for(ivar = 0; ivar < nvars; ivar++) {
-                Symbol* vsym = (Symbol*)listget(vardefs,ivar);
-                if(vsym->data != NULL) {
-                    genbin_definevardata(vsym);
-                }
-            }
-        }
-    }
 }
 
 #ifdef USE_NETCDF4
@@ -573,4 +592,268 @@ genbin_writeattr(Generator* generator, Symbol* asym, Bytebuffer* databuf,
     return stat;
 }
 
+
+/**************************************************/
+/* Streaming of the data section */
+
+/*
+When the output format is known before the data section is
+parsed (from -k or _Format) and it is a classic model format,
+the file is defined when the data section begins, and the
+values of each numeric variable are converted and written in
+blocks of at most STREAM_BUFSIZE bytes as they are parsed,
+instead of holding the whole data section in memory.
+Variables that need the complete data list (char, and any
+other non-numeric type) are still collected and written at
+the end.
+*/
+
+#define STREAM_BUFSIZE (4*1024*1024)
+
+static Bytebuffer* streambuf = NULL; /* converted values not yet written */
+static size_t streamcount = 0;  /* number of values in streambuf */
+static size_t streamoffset = 0; /* number of values already written */
+static size_t streamlimit = 0;  /* values in a fixed size variable */
+static int streamrecord = 0;    /* 1 => variable has an unlimited dimension */
+static Datalist* streamfiller = NULL;
+
+/* Return the number of values in one index of the first dimension */
+static size_t
+streaminner(Symbol* vsym)
+{
+    Dimset* dimset = &vsym->typ.dimset;
+    size_t inner = 1;
+    int i;
+    for(i=1;i<dimset->ndims;i++)
+        inner *= dimset->dimsyms[i]->dim.declsize;
+    return inner;
+}
+
+/*
+Write nelems values, starting at linear position offset in
+the variable, as a sequence of nc_put_vara calls.
+*/
+static int
+genbin_writelinear(Symbol* vsym, size_t offset, size_t nelems, const char* data)
+{
+    int stat = NC_NOERR;
+    Dimset* dimset = &vsym->typ.dimset;
+    int rank = dimset->ndims;
+    size_t typesize = vsym->typ.basetype->typ.size;
+    size_t inner[NC_MAX_VAR_DIMS];
+    size_t start[NC_MAX_VAR_DIMS];
+    size_t count[NC_MAX_VAR_DIMS];
+    int i,k;
+
+    /* inner[i] is the number of values in one index of dimension i */
+    inner[rank-1] = 1;
+    for(i=rank-1;i>0;i--)
+        inner[i-1] = inner[i] * dimset->dimsyms[i]->dim.declsize;
+
+    while(nelems > 0) {
+        size_t n, rem = offset;
+        for(i=0;i<rank;i++) {
+            start[i] = rem / inner[i];
+            rem = rem % inner[i];
+            count[i] = 1;
+        }
+        /* Find the outermost dimension whose index the offset is
+           aligned to and of which at least one index is left */
+        for(k=0;k<rank-1;k++) {
+            if((offset % inner[k]) == 0 && inner[k] <= nelems)
+                break;
+        }
+        n = nelems / inner[k];
+        if(k > 0 || !dimset->dimsyms[0]->dim.isunlimited) {
+            size_t avail = dimset->dimsyms[k]->dim.declsize - start[k];
+            if(n > avail) n = avail;
+        }
+        count[k] = n;
+        for(i=k+1;i<rank;i++)
+            count[i] = dimset->dimsyms[i]->dim.declsize;
+        stat = nc_put_vara(vsym->container->nc_id,vsym->nc_id,start,count,data);
+        if(stat != NC_NOERR) break;
+        n *= inner[k];
+        offset += n;
+        nelems -= n;
+        data += n * typesize;
+    }
+    return stat;
+}
+
+static void
+genbin_streamflush(Symbol* vsym)
+{
+    int stat;
+    if(streamcount > 0) {
+        stat = genbin_writelinear(vsym,streamoffset,streamcount,bbContents(streambuf));
+        CHECK_ERR(stat);
+    }
+    streamoffset += streamcount;
+    streamcount = 0;
+    bbClear(streambuf);
+}
+
+/*
+Called when the data section of the root group begins.  If
+the data can be streamed, process the semantics, define the
+file and return 1; else return 0 and leave everything to the
+end of the parse.
+*/
+int
+genbin_streambegin(void)
+{
+    int format = (k_flag != 0 ? k_flag : globalspecials._Format);
+
+    if(l_flag != L_BINARY || syntax_only || header_only || error_count > 0)
+        return 0;
+    if(enhanced_flag || listlength(grpdefs) != 1)
+        return 0;
+    switch (format) {
+    case NC_FORMAT_CLASSIC:
+    case NC_FORMAT_64BIT_OFFSET:
+#ifdef ENABLE_CDF5
+    case NC_FORMAT_64BIT_DATA:
+#endif
+#ifdef USE_NETCDF4
+    case NC_FORMAT_NETCDF4_CLASSIC:
+#endif
+        break;
+    default:
+        return 0;
+    }
+    if(!computeformat())
+        return 0;
+    processsemantics();
+    if(error_count > 0)
+        return 0;
+    genbin_define();
+    stream_flag = 1;
+    return 1;
+}
+
+/*
+Called before the data list of vsym is parsed; return 1 if its
+values are to be streamed through genbin_streamconst.
+*/
+int
+genbin_streamvar(Symbol* vsym)
+{
+    Dimset* dimset = &vsym->typ.dimset;
+    Symbol* basetype = vsym->typ.basetype;
+    int i;
+
+    if(!stream_flag || vsym->objectclass != NC_VAR || vsym->container != rootgroup)
+        return 0;
+    if(dimset->ndims == 0 || basetype->subclass != NC_PRIM)
+        return 0;
+    if(basetype->typ.typecode == NC_CHAR || basetype->typ.typecode == NC_STRING)
+        return 0;
+    for(i=1;i<dimset->ndims;i++) {
+        if(dimset->dimsyms[i]->dim.isunlimited)
+            return 0;
+    }
+    if(streambuf == NULL)
+        streambuf = bbNew();
+    bbClear(streambuf);
+    streamcount = 0;
+    streamoffset = 0;
+    streamrecord = dimset->dimsyms[0]->dim.isunlimited;
+    streamlimit = (streamrecord ? 0 : dimset->dimsyms[0]->dim.declsize * streaminner(vsym));
+    streamfiller = getfiller(vsym);
+    generator_reset(bin_generator,NULL);
+    return 1;
+}
+
+/* Convert and buffer the next value of vsym; con is reclaimed */
+void
+genbin_streamconst(Symbol* vsym, NCConstant* con)
+{
+    if(islistconst(con))
+        semerror(constline(con),"Expected primitive found {..}");
+    /* Values beyond the end of a fixed size variable are ignored */
+    if(streamrecord || streamoffset + streamcount < streamlimit) {
+        generate_basetype(vsym->typ.basetype,con,streambuf,streamfiller,bin_generator);
+        streamcount++;
+        if(bbLength(streambuf) >= STREAM_BUFSIZE)
+            genbin_streamflush(vsym);
+    }
+    reclaimconstant(con);
+}
+
+/* Called at the end of the data list of a streamed variable */
+void
+genbin_streamvarend(Symbol* vsym)
+{
+    genbin_streamflush(vsym);
+    vsym->var.streamed = 1;
+    vsym->var.nstreamed = streamoffset;
+}
+
+/*
+Called at the end of the parse.  Set the record count from the
+streamed record variables, then fill each streamed variable up
+to its full size, as generate_array does for the others.
+*/
+static void
+genbin_streamfinish(void)
+{
+    int ivar;
+    int nvars = listlength(vardefs);
+
+    for(ivar = 0; ivar < nvars; ivar++) {
+        Symbol* vsym = (Symbol*)listget(vardefs,ivar);
+        Symbol* dim0;
+        size_t inner, nrecs;
+        if(!vsym->var.streamed) continue;
+        dim0 = vsym->typ.dimset.dimsyms[0];
+        inner = streaminner(vsym);
+        if(!dim0->dim.isunlimited || inner == 0) continue;
+        nrecs = (vsym->var.nstreamed + inner - 1) / inner;
+        if(nrecs > dim0->dim.declsize)
+            dim0->dim.declsize = nrecs;
+    }
+
+    for(ivar = 0; ivar < nvars; ivar++) {
+        Symbol* vsym = (Symbol*)listget(vardefs,ivar);
+        size_t total, typesize, nfill, i;
+        char fillvalue[sizeof(double)];
+        int stat;
+        if(!vsym->var.streamed) continue;
+        total = vsym->typ.dimset.dimsyms[0]->dim.declsize * streaminner(vsym);
+        if(vsym->var.nstreamed >= total) continue;
+        /* Build a block of fill values and write it repeatedly */
+        typesize = vsym->typ.basetype->typ.size;
+        nfill = total - vsym->var.nstreamed;
+        if(nfill > STREAM_BUFSIZE / typesize)
+            nfill = STREAM_BUFSIZE / typesize;
+        bbClear(streambuf);
+        generator_reset(bin_generator,NULL);
+        generate_basetype(vsym->typ.basetype,NULL,streambuf,getfiller(vsym),bin_generator);
+        memcpy(fillvalue,bbContents(streambuf),typesize);
+        for(i=1;i<nfill;i++)
+            bbAppendn(streambuf,fillvalue,typesize);
+        for(i=vsym->var.nstreamed;i<total;i+=nfill) {
+            if(nfill > total - i)
+                nfill = total - i;
+            stat = genbin_writelinear(vsym,i,nfill,bbContents(streambuf));
+            CHECK_ERR(stat);
+        }
+    }
+    bbFree(streambuf);
+    streambuf = NULL;
+}
+
+/* Remove the file if the parse fails after streaming began */
+void
+genbin_streamabort(void)
+{
+    if(!stream_flag)
+        return;
+    stream_flag = 0;
+    (void)nc_abort(rootgroup->nc_id);
+    if(!diskless)
+        (void)remove(rootgroup->file.filename);
+}
+
 #endif /*ENABLE_BINARY*/
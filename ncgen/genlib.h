@@ -95,6 +95,7 @@ extern unsigned int convertFilterID(const char* id);
 
 /* from: semantic.c */
 extern  void processsemantics(void);
+extern  void processdatasemantics(void);
 extern  size_t nctypesize(nc_type);
 extern  Symbol* locate(Symbol* refsym);
 extern  Symbol* lookup(nc_class objectclass, Symbol* pattern);
@@ -117,6 +118,11 @@ extern char* indented(int n);
 extern Generator* bin_generator;
 extern void genbin_netcdf(void);
 extern void genbin_close(void);
+extern int genbin_streambegin(void);
+extern int genbin_streamvar(Symbol* vsym);
+extern void genbin_streamconst(Symbol* vsym, NCConstant* con);
+extern void genbin_streamvarend(Symbol* vsym);
+extern void genbin_streamabort(void);
 /* from: bindata.c */
 extern int binary_generate_data(Datalist* data, Symbol* tsym, Datalist* fillvalue, Bytebuffer* databuf);
 extern int binary_reclaim_data(Symbol* tsym, void* memory, size_t count);
@@ -166,6 +172,7 @@ extern int usingclassic;   /* 1 => k_flag == 1|2|5 */
 extern int k_flag;
 extern int ncloglevel;
 extern int wholevarsize;
+extern int stream_flag; /* 1 => the data section is being streamed */
 extern GlobalSpecialData globalspecials;
 
 /* Global data */
@@ -192,7 +199,9 @@ extern int cmode_modifier;
 extern Language l_flag;
 extern char* binary_ext;
 extern int nofill_flag;
+extern int syntax_only;
 extern int header_only;
+extern int diskless;
 extern char* mainname;
 
 extern char* progname; /* for error messages*/
@@ -207,6 +216,7 @@ extern const char* specialname(int tag);
 
 extern void init_netcdf(void);
 extern void finalize_netcdf(int);
+extern int computeformat(void);
 extern void parse_init(void);
 extern int ncgparse(void);
 
@@ -44,6 +44,7 @@ int cmode_modifier;
 int diskless;
 int ncloglevel;
 int wholevarsize;
+int stream_flag; /* 1 => the data section is being streamed */
 
 GlobalSpecialData globalspecials;
 
@@ -469,11 +470,48 @@ main(
     parse_init();
     ncgin = fp;
     if(debug >= 2) {ncgdebug=1;}
-    if(ncgparse() != 0)
+    if(ncgparse() != 0) {
+#ifdef ENABLE_BINARY
+        genbin_streamabort();
+#endif
         return 1;
+    }
 
-    /* Compute the k_flag (1st pass) using rules in the man page (ncgen.1).*/
+    if(!computeformat()) {
+#ifdef ENABLE_BINARY
+        genbin_streamabort();
+#endif
+        return 0;
+    }
+
+    /* If the data section was streamed, the rest of the
+       semantics were processed when it began */
+    if(stream_flag)
+        processdatasemantics();
+    else
+        processsemantics();
+#ifdef ENABLE_BINARY
+    if(error_count > 0)
+        genbin_streamabort();
+#endif
+    if(!syntax_only && error_count == 0)
+        define_netcdf();
 
+done:
+    nullfree(netcdf_name);
+    nullfree(datasetname);
+    finalize_netcdf(code);
+    return code;
+}
+
+/*
+Compute the k_flag, usingclassic and cmode_modifier from the
+command line and from the parse so far, using the rules in the
+man page (ncgen.1). Return 0 if they conflict.
+*/
+int
+computeformat(void)
+{
 #ifndef ENABLE_CDF5
     if(k_flag == NC_FORMAT_CDF5) {
       derror("Output format CDF5 requested, but netcdf was built without cdf5 support.");
@@ -553,15 +591,7 @@ main(
     if(diskless)
 	cmode_modifier |= (NC_DISKLESS|NC_NOCLOBBER);
 
-    processsemantics();
-    if(!syntax_only && error_count == 0)
-        define_netcdf();
-
-done:
-    nullfree(netcdf_name);
-    nullfree(datasetname);
-    finalize_netcdf(code);
-    return code;
+    return 1;
 }
 
 void
@@ -588,6 +618,11 @@ init_netcdf(void) /* initialize global counts, flags */
 void
 finalize_netcdf(int retcode)
 {
+#ifdef ENABLE_BINARY
+    /* Do not leave a partially streamed file behind */
+    if(retcode != 0)
+        genbin_streamabort();
+#endif
     nc_finalize();
     exit(retcode);
 }
@@ -188,6 +188,8 @@ typedef struct Varinfo {
     int		nattributes; /* |attributes|*/
     List*       attributes;  /* List<Symbol*>*/
     Specialdata special;
+    int         streamed;    /* data was written as it was parsed */
+    size_t      nstreamed;   /* number of values that were streamed */
 } Varinfo;
 
 typedef struct Groupinfo {
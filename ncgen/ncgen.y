@@ -72,6 +72,10 @@ static int count;
 static int opaqueid; /* counter for opaque constants*/
 static int arrayuid; /* counter for pseudo-array types*/
 
+/* Track the data list whose values are being streamed */
+static Symbol* streamvar = NULL;
+static int datadepth = 0; /* nesting of {..} within the data list */
+
 char* primtypenames[PRIMNO] = {
 "nat",
 "byte", "char", "short",
@@ -118,6 +122,10 @@ static NCConstant* evaluate(Symbol* fcn, Datalist* arglist);
 static NCConstant* makeenumconstref(Symbol*);
 static void addtogroup(Symbol*);
 static Symbol* currentgroup(void);
+static void datasectionbegin(void);
+static void datavarbegin(Symbol*);
+static void datavarend(Symbol*,Datalist*);
+static void dataappend(Datalist*,NCConstant*);
 static Symbol* createrootgroup(const char*);
 static Symbol* creategroup(Symbol*);
 static int dupobjectcheck(nc_class,Symbol*);
@@ -805,16 +813,19 @@ path:
 	;
 
 datasection:    /* empty */
-                | DATA {}
-                | DATA datadecls {}
+                | datastart {}
+                | datastart datadecls {}
+                ;
+
+datastart:      DATA {datasectionbegin();}
                 ;
 
 datadecls:      datadecl ';'
                 | datadecls datadecl ';'
                 ;
 
-datadecl:       varref '=' datalist
-                   {$1->data = $3;}
+datadecl:       varref '=' {datavarbegin($1);} datalist
+                   {datavarend($1,$4);}
                 ;
 datalist:
 	  datalist0 {$$ = $1;}
@@ -826,14 +837,14 @@ datalist0:
 	;
 
 datalist1: /* Must have at least 1 element */
-	  dataitem {$$ = const2list($1);}
+	  dataitem {$$ = builddatalist(1); dataappend($$,$1);}
 	| datalist ',' dataitem
-	    {dlappend($1,($3)); $$=$1; }
+	    {dataappend($1,($3)); $$=$1; }
 	;
 
 dataitem:
 	  constdata {$$=$1;}
-	| '{' datalist '}' {$$=builddatasublist($2);}
+	| '{' {datadepth++;} datalist '}' {datadepth--; $$=builddatasublist($3);}
 	;
 
 constdata:
@@ -1015,6 +1026,57 @@ currentgroup(void)
     return (Symbol*)listtop(groupstack);
 }
 
+/* Called when the DATA keyword of a group is seen */
+static void
+datasectionbegin(void)
+{
+#ifdef ENABLE_BINARY
+    if(currentgroup() == rootgroup)
+        (void)genbin_streambegin();
+#endif
+}
+
+/* Called before the data list of vsym is parsed */
+static void
+datavarbegin(Symbol* vsym)
+{
+    streamvar = NULL;
+    datadepth = 0;
+#ifdef ENABLE_BINARY
+    if(stream_flag && genbin_streamvar(vsym))
+        streamvar = vsym;
+#endif
+}
+
+/* Called after the data list of vsym is parsed */
+static void
+datavarend(Symbol* vsym, Datalist* list)
+{
+    if(streamvar != NULL) {
+        /* The values were written as they were parsed */
+#ifdef ENABLE_BINARY
+        genbin_streamvarend(vsym);
+#endif
+        reclaimdatalist(list);
+        streamvar = NULL;
+    } else
+        vsym->data = list;
+}
+
+/* Append a data list value, or write it out if the list
+   is being streamed and the value is at the top level */
+static void
+dataappend(Datalist* list, NCConstant* con)
+{
+#ifdef ENABLE_BINARY
+    if(streamvar != NULL && datadepth == 0) {
+        genbin_streamconst(streamvar,con);
+        return;
+    }
+#endif
+    dlappend(list,con);
+}
+
 static Symbol*
 createrootgroup(const char* dataset)
 {
@@ -70,6 +70,25 @@ processsemantics(void)
     checkconsistency();
 }
 
+/*
+When the data section is streamed, processsemantics() was
+run when the data section began, and only the data lists
+of the variables that could not be streamed remain to be
+processed.
+*/
+void
+processdatasemantics(void)
+{
+    /* Fix up enum constant references*/
+    processeconstrefs();
+    /* Compute the unlimited dimension sizes */
+    processunlimiteddims();
+    /* Rebuild var datalists to show dim levels */
+    processvardata();
+    /* check internal consistency*/
+    checkconsistency();
+}
+
 /*
 Given a reference symbol, produce the corresponding
 definition symbol; return NULL if there is no definition
@@ -0,0 +1,31 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# This shell script round trips data through the codecs built into
+# NCZarr (delta, bitpack, fixedscaleoffset) and reports their throughput.
+
+set -e
+
+testcase() {
+zext=$1
+
+echo "*** Test: built-in codecs; format=nczarr zext=$zext"
+fileargs tmp_builtincodecs
+deletemap $zext $file
+${execdir}/tst_builtincodecs "$fileurl"
+
+echo "*** Test: built-in codecs; format=zarr zext=$zext"
+fileargs tmp_builtincodecs_zarr "mode=zarr,$zext"
+deletemap $zext $file
+${execdir}/tst_builtincodecs "$fileurl"
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
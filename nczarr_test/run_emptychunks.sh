@@ -0,0 +1,50 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# This shell script tests the write_empty_chunks control:
+# chunks holding only the fill value are not stored when it is false.
+
+set -e
+
+# Count the chunk objects of variable v
+countchunks() {
+  ${ZMD} -t int -x objdump "$1" > tmp_emptychunks_$zext.txt
+  nchunks=`grep -c '\] /v/[0-9]' tmp_emptychunks_$zext.txt || true`
+}
+
+testcase() {
+zext=$1
+
+echo "*** Test: write_empty_chunks=true (default); zext=$zext"
+fileargs tmp_emptychunks_all
+deletemap $zext $file
+${execdir}/tst_emptychunks create "$fileurl"
+countchunks "$fileurl"
+if test "x$nchunks" != x2 ; then echo "expected 2 chunks, found $nchunks"; exit 1; fi
+
+echo "*** Test: write_empty_chunks=false; zext=$zext"
+fileargs tmp_emptychunks_skip "mode=nczarr,$zext&write_empty_chunks=false"
+deletemap $zext $file
+${execdir}/tst_emptychunks create "$fileurl"
+countchunks "$fileurl"
+if test "x$nchunks" != x1 ; then echo "expected 1 chunk, found $nchunks"; exit 1; fi
+
+# Rewriting the stored chunk with the fill value removes it
+# (the zip format cannot be reopened for writing).
+if test "x$zext" != xzip ; then
+${execdir}/tst_emptychunks clear "$fileurl"
+countchunks "$fileurl"
+if test "x$nchunks" != x1 ; then echo "expected 1 chunk, found $nchunks"; exit 1; fi
+grep -q '\] /v/1\.1 ' tmp_emptychunks_$zext.txt
+fi
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
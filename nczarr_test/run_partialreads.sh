@@ -0,0 +1,24 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# This shell script tests reading only the needed byte ranges of
+# large unfiltered chunks.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: partial chunk reads; zext=$zext"
+fileargs tmp_partialreads
+deletemap $zext $file
+${execdir}/tst_partialreads "$fileurl"
+}
+
+testcase file
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
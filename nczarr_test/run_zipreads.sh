@@ -0,0 +1,27 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# This shell script tests ranged reads of stored and deflated
+# objects of a zip archive written by the zip utility.
+
+set -e
+
+echo "*** Test: ranged reads of zip objects"
+rm -fr tmp_zipreads tmp_zipreads.zip
+mkdir tmp_zipreads
+${execdir}/tst_zipreads -c tmp_zipreads
+# The dataset directory must be the first entry
+zip -q -0 tmp_zipreads.zip tmp_zipreads tmp_zipreads/stored
+zip -q tmp_zipreads.zip tmp_zipreads/deflated* tmp_zipreads/big
+unzip -v tmp_zipreads.zip > tmp_zipreads.txt
+grep -q 'Stored.*tmp_zipreads/stored$' tmp_zipreads.txt
+grep -q 'Defl.*tmp_zipreads/deflated0$' tmp_zipreads.txt
+grep -q 'Defl.*tmp_zipreads/big$' tmp_zipreads.txt
+${execdir}/tst_zipreads "file://tmp_zipreads.zip#mode=nczarr,zip"
+rm -fr tmp_zipreads
+
+exit 0
@@ -0,0 +1,244 @@
+/*
+ *	Copyright 2018, University Corporation for Atmospheric Research
+ *      See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ */
+
+/* Round trip variables through the codecs built into NCZarr: delta,
+   bitpack and fixedscaleoffset, alone and chained. Check the _Codecs
+   attribute and print the read and write throughput of an integer
+   variable with and without the integer codecs.
+
+   Usage: tst_builtincodecs <url>
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "netcdf.h"
+#include "netcdf_filter.h"
+
+#define N 100000
+#define CHUNK 25000
+#define NBENCH (2*1024*1024)
+#define BENCHCHUNK (256*1024)
+
+static void
+check(int err, int lineno)
+{
+    if(err == NC_NOERR) return;
+    fprintf(stderr,"Error at line %d: %s\n",lineno,nc_strerror(err));
+    exit(1);
+}
+
+#define CHECK(err) check(err,__LINE__)
+
+static int nerrs = 0;
+
+#define FAIL(...) {fprintf(stderr,__VA_ARGS__); nerrs++;}
+
+static int counts[N];
+static unsigned short flags[N];
+static long long ticks[N];
+static signed char bytes[N];
+static unsigned long long hashes[N];
+static double temp[N];
+static float tempf[N];
+static int bench[NBENCH];
+
+static void
+fill(void)
+{
+    size_t i;
+    for(i=0;i<N;i++) {
+        counts[i] = (int)(i*3 + i%7);
+        flags[i] = (unsigned short)(0x100 | (i%5));
+        ticks[i] = -1000000000000LL + (long long)(i*17 + i%3);
+        bytes[i] = (signed char)((int)(i%256) - 128);
+        hashes[i] = (unsigned long long)i * 0x9E3779B97F4A7C15ULL;
+        temp[i] = 250.0 + (double)(i%500)*0.1 + (double)(i%3)*0.001;
+        tempf[i] = (float)(i%250) / 10.0f;
+    }
+    for(i=0;i<NBENCH;i++)
+        bench[i] = (int)(i/4 + i%3);
+}
+
+static void
+split(double d, unsigned* params)
+{
+    memcpy(params,&d,sizeof(double));
+}
+
+/* Define a variable and its filters; ids[k] == H5Z_FILTER_FIXEDSCALEOFFSET
+   takes the astype, offset and scale arguments */
+static int
+defvar(int ncid, const char* name, nc_type type, int dimid, size_t chunk, int nids, const unsigned* ids,
+       nc_type astype, double offset, double scale)
+{
+    int varid, k;
+    unsigned params[5];
+    CHECK(nc_def_var(ncid,name,type,1,&dimid,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,&chunk));
+    for(k=0;k<nids;k++) {
+        if(ids[k] == H5Z_FILTER_FIXEDSCALEOFFSET) {
+            params[0] = (unsigned)astype;
+            split(offset,&params[1]);
+            split(scale,&params[3]);
+            CHECK(nc_def_var_filter(ncid,varid,ids[k],5,params));
+        } else
+            CHECK(nc_def_var_filter(ncid,varid,ids[k],0,NULL));
+    }
+    return varid;
+}
+
+/* The _Codecs attribute must contain each of the given strings */
+static void
+checkcodecs(int ncid, const char* name, int nkeys, const char** keys)
+{
+    int varid, k;
+    size_t len;
+    char* text = NULL;
+    CHECK(nc_inq_varid(ncid,name,&varid));
+    CHECK(nc_inq_attlen(ncid,varid,"_Codecs",&len));
+    text = (char*)calloc(1,len+1);
+    CHECK(nc_get_att_text(ncid,varid,"_Codecs",text));
+    for(k=0;k<nkeys;k++)
+        if(strstr(text,keys[k]) == NULL)
+            FAIL("%s: _Codecs %s lacks %s\n",name,text,keys[k]);
+    free(text);
+}
+
+static double
+seconds(clock_t t0)
+{
+    double s = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    return (s > 0 ? s : 1e-6);
+}
+
+/* Time writing and reading bench with the given filters */
+static void
+throughput(const char* url, const char* name, int nids, const unsigned* ids)
+{
+    int ncid, dimid, varid;
+    size_t i;
+    clock_t t0;
+    double wsecs, rsecs, mb = (double)sizeof(bench)/(1024.0*1024.0);
+    int* got = (int*)malloc(sizeof(bench));
+
+    t0 = clock();
+    CHECK(nc_create(url,NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"n",NBENCH,&dimid));
+    varid = defvar(ncid,"bench",NC_INT,dimid,BENCHCHUNK,nids,ids,NC_NAT,0,0);
+    CHECK(nc_put_var_int(ncid,varid,bench));
+    CHECK(nc_close(ncid));
+    wsecs = seconds(t0);
+    t0 = clock();
+    CHECK(nc_open(url,NC_NOWRITE,&ncid));
+    CHECK(nc_get_var_int(ncid,varid,got));
+    CHECK(nc_close(ncid));
+    rsecs = seconds(t0);
+    for(i=0;i<NBENCH;i++)
+        if(got[i] != bench[i]) {FAIL("bench[%d] = %d, expected %d\n",(int)i,got[i],bench[i]); break;}
+    printf("*** throughput %-14s write %8.1f MB/s read %8.1f MB/s\n",name,mb/wsecs,mb/rsecs);
+    free(got);
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, dimid, varid;
+    size_t i;
+    const char* url;
+    static int icounts[N];
+    static unsigned short iflags[N];
+    static long long iticks[N];
+    static signed char ibytes[N];
+    static unsigned long long ihashes[N];
+    static double itemp[N];
+    static float itempf[N];
+    const unsigned delta[] = {H5Z_FILTER_DELTA};
+    const unsigned bitpack[] = {H5Z_FILTER_BITPACK};
+    const unsigned both[] = {H5Z_FILTER_DELTA,H5Z_FILTER_BITPACK};
+    const unsigned fso[] = {H5Z_FILTER_FIXEDSCALEOFFSET};
+    const char* kcounts[] = {"\"id\": \"delta\"","i4\""};
+    const char* kticks[] = {"\"id\": \"delta\"","\"id\": \"bitpack\"","i8\""};
+    const char* ktemp[] = {"\"id\": \"fixedscaleoffset\"","\"offset\": 273.15","\"scale\": 100,","f8\"","i2\""};
+    const char* ktempf[] = {"\"offset\": 0,","\"scale\": 10,","f4\"","\"astype\": \"|u1\""};
+
+    if(argc != 2) {fprintf(stderr,"usage: tst_builtincodecs <url>\n"); exit(1);}
+    url = argv[1];
+    fill();
+
+    CHECK(nc_create(url,NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_inq_filter_avail(ncid,H5Z_FILTER_DELTA));
+    CHECK(nc_inq_filter_avail(ncid,H5Z_FILTER_BITPACK));
+    CHECK(nc_inq_filter_avail(ncid,H5Z_FILTER_FIXEDSCALEOFFSET));
+    CHECK(nc_def_dim(ncid,"n",N,&dimid));
+    defvar(ncid,"counts",NC_INT,dimid,CHUNK,1,delta,NC_NAT,0,0);
+    defvar(ncid,"flags",NC_USHORT,dimid,CHUNK,1,bitpack,NC_NAT,0,0);
+    defvar(ncid,"ticks",NC_INT64,dimid,CHUNK,2,both,NC_NAT,0,0);
+    defvar(ncid,"bytes",NC_BYTE,dimid,CHUNK,1,bitpack,NC_NAT,0,0);
+    defvar(ncid,"hashes",NC_UINT64,dimid,CHUNK,2,both,NC_NAT,0,0);
+    defvar(ncid,"temp",NC_DOUBLE,dimid,CHUNK,1,fso,NC_SHORT,273.15,100);
+    defvar(ncid,"tempf",NC_FLOAT,dimid,CHUNK,1,fso,NC_UBYTE,0,10);
+    CHECK(nc_enddef(ncid));
+    CHECK(nc_put_var_int(ncid,0,counts));
+    CHECK(nc_put_var_ushort(ncid,1,flags));
+    CHECK(nc_put_var_longlong(ncid,2,ticks));
+    CHECK(nc_put_var_schar(ncid,3,bytes));
+    CHECK(nc_put_var_ulonglong(ncid,4,hashes));
+    CHECK(nc_put_var_double(ncid,5,temp));
+    CHECK(nc_put_var_float(ncid,6,tempf));
+    CHECK(nc_close(ncid));
+
+    printf("*** testing round trip of the built-in codecs...");
+    CHECK(nc_open(url,NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"counts",&varid));
+    CHECK(nc_get_var_int(ncid,varid,icounts));
+    CHECK(nc_inq_varid(ncid,"flags",&varid));
+    CHECK(nc_get_var_ushort(ncid,varid,iflags));
+    CHECK(nc_inq_varid(ncid,"ticks",&varid));
+    CHECK(nc_get_var_longlong(ncid,varid,iticks));
+    CHECK(nc_inq_varid(ncid,"bytes",&varid));
+    CHECK(nc_get_var_schar(ncid,varid,ibytes));
+    CHECK(nc_inq_varid(ncid,"hashes",&varid));
+    CHECK(nc_get_var_ulonglong(ncid,varid,ihashes));
+    CHECK(nc_inq_varid(ncid,"temp",&varid));
+    CHECK(nc_get_var_double(ncid,varid,itemp));
+    CHECK(nc_inq_varid(ncid,"tempf",&varid));
+    CHECK(nc_get_var_float(ncid,varid,itempf));
+    for(i=0;i<N && nerrs < 10;i++) {
+        if(icounts[i] != counts[i]) FAIL("counts[%d] = %d\n",(int)i,icounts[i]);
+        if(iflags[i] != flags[i]) FAIL("flags[%d] = %u\n",(int)i,iflags[i]);
+        if(iticks[i] != ticks[i]) FAIL("ticks[%d] = %lld\n",(int)i,iticks[i]);
+        if(ibytes[i] != bytes[i]) FAIL("bytes[%d] = %d\n",(int)i,ibytes[i]);
+        if(ihashes[i] != hashes[i]) FAIL("hashes[%d] = %llu\n",(int)i,ihashes[i]);
+        /* fixedscaleoffset keeps 1/scale precision */
+        if(fabs(itemp[i] - temp[i]) > 0.5/100 + 1e-9) FAIL("temp[%d] = %g, expected %g\n",(int)i,itemp[i],temp[i]);
+        if(fabs(itempf[i] - tempf[i]) > 0.5/10 + 1e-6) FAIL("tempf[%d] = %g, expected %g\n",(int)i,itempf[i],tempf[i]);
+    }
+    printf("%s\n",nerrs ? "FAILED" : "ok");
+
+    printf("*** testing _Codecs of the built-in codecs...");
+    checkcodecs(ncid,"counts",2,kcounts);
+    checkcodecs(ncid,"ticks",3,kticks);
+    checkcodecs(ncid,"temp",5,ktemp);
+    checkcodecs(ncid,"tempf",4,ktempf);
+    CHECK(nc_inq_varid(ncid,"flags",&varid));
+    CHECK(nc_inq_var_filter_ids(ncid,varid,&i,NULL));
+    if(i != 1) FAIL("flags has %d filters\n",(int)i);
+    CHECK(nc_close(ncid));
+    printf("%s\n",nerrs ? "FAILED" : "ok");
+
+    throughput(url,"none",0,NULL);
+    throughput(url,"delta",1,delta);
+    throughput(url,"bitpack",1,bitpack);
+    throughput(url,"delta,bitpack",2,both);
+
+    return (nerrs ? 1 : 0);
+}
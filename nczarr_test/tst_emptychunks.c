@@ -0,0 +1,117 @@
+/*
+ *	Copyright 2018, University Corporation for Atmospheric Research
+ *      See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ */
+
+/* Write and rewrite a variable whose chunks hold partly or only the
+   fill value; run_emptychunks.sh counts the chunk objects that were
+   stored with and without write_empty_chunks=false.
+
+   Usage: tst_emptychunks create|clear <url>
+   create: chunk (0,0) gets data, chunk (0,1) is written with the
+           fill value, chunks (1,0) and (1,1) are never written.
+   clear:  chunk (0,0) is rewritten with the fill value and one value
+           is written in chunk (1,1).
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "netcdf.h"
+
+#define NY 8
+#define NX 8
+#define CHUNK 4
+#define FILL -1
+
+static void
+check(int err, int lineno)
+{
+    if(err == NC_NOERR) return;
+    fprintf(stderr,"Error at line %d: %s\n",lineno,nc_strerror(err));
+    exit(1);
+}
+
+#define CHECK(err) check(err,__LINE__)
+
+/* Expected content after each phase */
+static int
+expected(int clear, size_t y, size_t x)
+{
+    if(clear) {
+        if(y == NY-1 && x == NX-1) return 99;
+        return FILL;
+    }
+    if(y < CHUNK && x < CHUNK) return (int)(y*NX+x);
+    return FILL;
+}
+
+static int
+verify(const char* url, int clear)
+{
+    int ncid, varid, nerrs = 0;
+    int data[NY][NX];
+    size_t y, x;
+
+    CHECK(nc_open(url,NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    CHECK(nc_get_var_int(ncid,varid,&data[0][0]));
+    CHECK(nc_close(ncid));
+    for(y=0;y<NY;y++)
+        for(x=0;x<NX;x++)
+            if(data[y][x] != expected(clear,y,x)) {
+                fprintf(stderr,"v[%d][%d] = %d, expected %d\n",(int)y,(int)x,data[y][x],expected(clear,y,x));
+                nerrs++;
+            }
+    return nerrs;
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2], fill = FILL, value = 99;
+    int data[CHUNK][CHUNK], fills[CHUNK][CHUNK];
+    size_t chunks[2] = {CHUNK,CHUNK};
+    size_t start[2], count[2] = {CHUNK,CHUNK};
+    size_t y, x;
+    int clear;
+    const char* url;
+
+    if(argc != 3) {fprintf(stderr,"usage: tst_emptychunks create|clear <url>\n"); exit(1);}
+    clear = (strcmp(argv[1],"clear") == 0);
+    url = argv[2];
+
+    for(y=0;y<CHUNK;y++)
+        for(x=0;x<CHUNK;x++) {
+            data[y][x] = (int)(y*NX+x);
+            fills[y][x] = FILL;
+        }
+
+    if(!clear) {
+        CHECK(nc_create(url,NC_NETCDF4|NC_CLOBBER,&ncid));
+        CHECK(nc_def_dim(ncid,"y",NY,&dimids[0]));
+        CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+        CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+        CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+        CHECK(nc_def_var_fill(ncid,varid,0,&fill));
+        CHECK(nc_enddef(ncid));
+        start[0] = 0; start[1] = 0;
+        CHECK(nc_put_vara_int(ncid,varid,start,count,&data[0][0]));
+        start[0] = 0; start[1] = CHUNK;
+        CHECK(nc_put_vara_int(ncid,varid,start,count,&fills[0][0]));
+    } else {
+        CHECK(nc_open(url,NC_WRITE,&ncid));
+        CHECK(nc_inq_varid(ncid,"v",&varid));
+        start[0] = 0; start[1] = 0;
+        CHECK(nc_put_vara_int(ncid,varid,start,count,&fills[0][0]));
+        start[0] = NY-1; start[1] = NX-1;
+        CHECK(nc_put_var1_int(ncid,varid,start,&value));
+    }
+    CHECK(nc_close(ncid));
+
+    return (verify(url,clear) ? 1 : 0);
+}
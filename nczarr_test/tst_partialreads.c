@@ -0,0 +1,180 @@
+/*
+ *	Copyright 2018, University Corporation for Atmospheric Research
+ *      See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ */
+
+/* Read points, thin columns and boxes from the large unfiltered
+   chunks of a variable, check the values, and check that only the
+   needed byte ranges of each chunk are read from storage.
+
+   Usage: tst_partialreads <url>
+
+   The variable is int v(y=50,x=6000) with 20x4096 chunks, so a chunk
+   is 327680 bytes, rows of a chunk are 16384 bytes apart, and the
+   chunks in the last row and column are partial. Each case opens the
+   file anew, so that the chunk cache is empty. The storage reads are
+   only counted if the library was built with I/O statistics.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "netcdf.h"
+
+#define NY 50
+#define NX 6000
+#define CY 20
+#define CX 4096
+#define CHUNKBYTES (CY*CX*sizeof(int))
+
+static void
+check(int err, int lineno)
+{
+    if(err == NC_NOERR) return;
+    fprintf(stderr,"Error at line %d: %s\n",lineno,nc_strerror(err));
+    exit(1);
+}
+
+#define CHECK(err) check(err,__LINE__)
+
+struct Case {
+    const char* what;
+    size_t start[2];
+    size_t count[2];
+    ptrdiff_t stride[2];
+    int nreads; /* expected storage reads */
+    size_t nbytes; /* expected bytes read from storage */
+};
+
+static const struct Case cases[] = {
+{"single point", {3,5}, {1,1}, {1,1}, 1, 4},
+{"column of 16 rows", {0,10}, {16,1}, {1,1}, 16, 16*4},
+{"column of 20 rows: more than 16 ranges", {0,10}, {20,1}, {1,1}, 1, CHUNKBYTES},
+{"rows with gaps of 8384 bytes are not merged", {0,0}, {10,2000}, {1,1}, 10, 10*2000*4},
+{"rows with gaps of 7980 bytes are merged", {0,0}, {10,2101}, {1,1}, 1, 9*16384+2101*4},
+{"points with a gap of 8192 bytes are merged", {0,0}, {1,2}, {1,2049}, 1, 2049*4+4},
+{"points with a gap of 8196 bytes are not merged", {0,0}, {1,2}, {1,2050}, 2, 2*4},
+{"more than half a chunk", {0,0}, {20,2200}, {1,1}, 1, CHUNKBYTES},
+{"point in the partial last chunk", {45,5000}, {1,1}, {1,1}, 1, 4},
+{"column in the partial last chunk", {40,5999}, {10,1}, {1,1}, 10, 10*4},
+{"all of the partial last chunk", {40,4096}, {10,NX-4096}, {1,1}, 10, 10*(NX-4096)*4},
+{"column through three chunks", {0,10}, {NY,1}, {1,1}, 2+10, 2*CHUNKBYTES+10*4},
+{NULL}
+};
+
+static int
+readcase(const char* url, const struct Case* c)
+{
+    int ncid, varid, natts, stat, nerrs = 0;
+    int* data;
+    size_t y, x, n = c->count[0]*c->count[1];
+    nc_io_stats_t stats;
+
+    if((data = malloc(n*sizeof(int))) == NULL) {fprintf(stderr,"out of memory\n"); exit(1);}
+    CHECK(nc_open(url,NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    CHECK(nc_inq_varnatts(ncid,varid,&natts)); /* attributes are read lazily */
+    stat = nc_reset_io_stats(ncid);
+    if(stat != NC_ENOTBUILT) CHECK(stat);
+    CHECK(nc_get_vars_int(ncid,varid,c->start,c->count,c->stride,data));
+    if(stat == NC_NOERR)
+        CHECK(nc_inq_io_stats(ncid,NC_GLOBAL,&stats));
+    CHECK(nc_close(ncid));
+
+    for(y=0;y<c->count[0];y++)
+        for(x=0;x<c->count[1];x++) {
+            size_t gy = c->start[0] + y*(size_t)c->stride[0];
+            size_t gx = c->start[1] + x*(size_t)c->stride[1];
+            int expected = (int)(gy*NX+gx);
+            if(data[y*c->count[1]+x] != expected) {
+                if(nerrs < 10)
+                    fprintf(stderr,"%s: v[%d][%d] = %d, expected %d\n",c->what,
+                            (int)gy,(int)gx,data[y*c->count[1]+x],expected);
+                nerrs++;
+            }
+        }
+    free(data);
+
+    if(stat == NC_NOERR) {
+        printf("%s: %llu reads, %llu bytes\n",c->what,stats.io_reads,stats.io_bytes_read);
+        if(stats.io_reads != (unsigned long long)c->nreads
+           || stats.io_bytes_read != (unsigned long long)c->nbytes) {
+            fprintf(stderr,"%s: expected %d reads, %llu bytes\n",c->what,
+                    c->nreads,(unsigned long long)c->nbytes);
+            nerrs++;
+        }
+    }
+    return nerrs;
+}
+
+/* Small reads of one chunk: the first is partial, the second reads
+   the chunk whole into the cache, the third is served by the cache */
+static int
+repeatcase(const char* url)
+{
+    static const unsigned long long nbytes[3] = {4,CHUNKBYTES,0};
+    int ncid, varid, natts, stat, value, nerrs = 0;
+    size_t index[2] = {7,70};
+    nc_io_stats_t stats;
+    int i;
+
+    CHECK(nc_open(url,NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    CHECK(nc_inq_varnatts(ncid,varid,&natts)); /* attributes are read lazily */
+    for(i=0;i<3;i++) {
+        stat = nc_reset_io_stats(ncid);
+        if(stat != NC_ENOTBUILT) CHECK(stat);
+        CHECK(nc_get_var1_int(ncid,varid,index,&value));
+        if(value != (int)(index[0]*NX+index[1])) {
+            fprintf(stderr,"repeated read %d: v[%d][%d] = %d\n",i,(int)index[0],(int)index[1],value);
+            nerrs++;
+        }
+        if(stat == NC_NOERR) {
+            CHECK(nc_inq_io_stats(ncid,NC_GLOBAL,&stats));
+            printf("repeated read %d: %llu bytes\n",i,stats.io_bytes_read);
+            if(stats.io_bytes_read != nbytes[i]) {
+                fprintf(stderr,"repeated read %d: expected %llu bytes\n",i,nbytes[i]);
+                nerrs++;
+            }
+        }
+        index[1]++;
+    }
+    CHECK(nc_close(ncid));
+    return nerrs;
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2], nerrs = 0;
+    int* data;
+    size_t chunks[2] = {CY,CX};
+    size_t i;
+    const struct Case* c;
+    const char* url;
+
+    if(argc != 2) {fprintf(stderr,"usage: tst_partialreads <url>\n"); exit(1);}
+    url = argv[1];
+
+    if((data = malloc(NY*NX*sizeof(int))) == NULL) {fprintf(stderr,"out of memory\n"); exit(1);}
+    for(i=0;i<NY*NX;i++) data[i] = (int)i;
+    CHECK(nc_create(url,NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"y",NY,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    CHECK(nc_enddef(ncid));
+    CHECK(nc_put_var_int(ncid,varid,data));
+    CHECK(nc_close(ncid));
+    free(data);
+
+    for(c=cases;c->what != NULL;c++)
+        nerrs += readcase(url,c);
+    nerrs += repeatcase(url);
+
+    return (nerrs ? 1 : 0);
+}
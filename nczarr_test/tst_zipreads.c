@@ -0,0 +1,176 @@
+/*
+ *	Copyright 2018, University Corporation for Atmospheric Research
+ *      See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ */
+
+/* Read byte ranges at nonzero offsets of the objects of a zip
+   archive through the zip map, repeatedly and in an order that
+   cycles the cache of decompressed objects, and check the bytes.
+
+   Usage: tst_zipreads -c <dir>
+              write the objects into <dir>, to be zipped by the caller
+          tst_zipreads <url>
+              read the objects back from the zipped <dir>
+
+   The caller stores "stored" without compression and deflates the
+   rest. There are more deflated objects than the zip map caches, and
+   "big" is larger than the most it will cache.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "zincludes.h"
+
+/* Every object is a sequence of 16 byte records, "NN:NNNNNNNNNNNN\n",
+   holding the object number and the record number, so that it
+   deflates well and every byte tells where it came from */
+#define RECSIZE 16
+
+#define NSMALL 5
+#define SMALLSIZE 300000
+#define STOREDSIZE 100000
+#define BIGSIZE (17*1024*1024)
+
+struct Object {
+    const char* name;
+    size64_t size;
+};
+
+static const struct Object objects[] = {
+{"stored", STOREDSIZE},
+{"deflated0", SMALLSIZE},
+{"deflated1", SMALLSIZE},
+{"deflated2", SMALLSIZE},
+{"deflated3", SMALLSIZE},
+{"deflated4", SMALLSIZE},
+{"big", BIGSIZE},
+{NULL,0}
+};
+
+#define STORED (&objects[0])
+#define SMALL(i) (&objects[1+(i)])
+#define BIG (&objects[1+NSMALL])
+
+static char* expected = NULL;
+static char* content = NULL;
+
+static void
+check(int err, int lineno)
+{
+    if(err == NC_NOERR) return;
+    fprintf(stderr,"Error at line %d: %s\n",lineno,nc_strerror(err));
+    exit(1);
+}
+
+#define CHECK(err) check(err,__LINE__)
+
+/* Fill buf with bytes [start,start+count) of the object */
+static void
+fill(const struct Object* obj, size64_t start, size64_t count, char* buf)
+{
+    char rec[32];
+    size64_t i;
+    for(i=0;i<count;i++) {
+	size64_t pos = start + i;
+	if(i == 0 || pos % RECSIZE == 0)
+	    snprintf(rec,sizeof(rec),"%02d:%012llu\n",(int)(obj - objects),pos / RECSIZE);
+	buf[i] = rec[pos % RECSIZE];
+    }
+}
+
+static int
+create(const char* dir)
+{
+    const struct Object* obj;
+    char path[4096];
+    FILE* f;
+
+    for(obj=objects;obj->name != NULL;obj++) {
+	fill(obj,0,obj->size,content);
+	snprintf(path,sizeof(path),"%s/%s",dir,obj->name);
+	if((f = fopen(path,"wb")) == NULL) {perror(path); return 1;}
+	if(fwrite(content,1,obj->size,f) != obj->size) {perror(path); return 1;}
+	if(fclose(f) != 0) {perror(path); return 1;}
+    }
+    return 0;
+}
+
+/* Read count bytes at start, clipped to the end of the object */
+static int
+readrange(NCZMAP* map, const struct Object* obj, size64_t start, size64_t count)
+{
+    char key[64];
+
+    if(start + count > obj->size) count = obj->size - start;
+    snprintf(key,sizeof(key),"/%s",obj->name);
+    memset(content,0,count);
+    CHECK(nczmap_read(map,key,start,count,content));
+    fill(obj,start,count,expected);
+    if(memcmp(content,expected,count) != 0) {
+	fprintf(stderr,"%s: bytes [%llu,%llu) differ\n",obj->name,start,start+count);
+	return 1;
+    }
+    return 0;
+}
+
+/* Reads at nonzero offsets, out of order and repeated, then from 0 */
+static int
+readobject(NCZMAP* map, const struct Object* obj)
+{
+    size64_t size = obj->size;
+    size64_t len;
+    char key[64];
+    int nerrs = 0;
+
+    snprintf(key,sizeof(key),"/%s",obj->name);
+    CHECK(nczmap_len(map,key,&len));
+    if(len != size) {
+	fprintf(stderr,"%s: length %llu, expected %llu\n",obj->name,len,size);
+	return 1;
+    }
+    nerrs += readrange(map,obj,size/2,1000);
+    nerrs += readrange(map,obj,1,RECSIZE);
+    nerrs += readrange(map,obj,size-100,100);
+    nerrs += readrange(map,obj,size/2,1000);
+    nerrs += readrange(map,obj,4097,size);
+    nerrs += readrange(map,obj,0,4097);
+    return nerrs;
+}
+
+int
+main(int argc, char** argv)
+{
+    NCZMAP* map = NULL;
+    int i, pass, nerrs = 0;
+
+    if((expected = malloc(BIGSIZE)) == NULL || (content = malloc(BIGSIZE)) == NULL)
+	{fprintf(stderr,"out of memory\n"); exit(1);}
+
+    if(argc == 3 && strcmp(argv[1],"-c") == 0)
+	return create(argv[2]);
+    if(argc != 2) {fprintf(stderr,"usage: tst_zipreads -c <dir> | <url>\n"); exit(1);}
+
+    CHECK(nczmap_open(NCZM_ZIP,argv[1],NC_NOWRITE,0,NULL,&map));
+
+    nerrs += readobject(map,STORED);
+    /* Cycle through more deflated objects than are cached, twice,
+       so that every pass evicts and decompresses them again */
+    for(pass=0;pass<2;pass++)
+	for(i=0;i<NSMALL;i++)
+	    nerrs += readrange(map,SMALL(i),(size64_t)(1000*i+7),20000);
+    for(i=0;i<NSMALL;i++)
+	nerrs += readobject(map,SMALL(i));
+    nerrs += readobject(map,BIG);
+    /* A deflated and the stored object again, after the big one */
+    nerrs += readrange(map,SMALL(0),SMALLSIZE-1,1);
+    nerrs += readrange(map,STORED,STOREDSIZE-1,1);
+
+    CHECK(nczmap_close(map,0));
+    free(expected);
+    free(content);
+    if(nerrs) fprintf(stderr,"*** %d ranged reads failed\n",nerrs);
+    return (nerrs ? 1 : 0);
+}
@@ -30,11 +30,22 @@ ocfetchhttpcode(CURL* curl)
 
 OCerror
 ocfetchurl_file(CURL* curl, const char* url, FILE* stream,
-		off_t* sizep, long* filetime)
+		off_t* sizep, long* filetime, NChttpcache* cache)
 {
 	int stat = OC_NOERR;
 	CURLcode cstat = CURLE_OK;
 	struct Fetchdata fetchdata;
+	long httpcode = 0;
+	int notmodified = 0;
+
+	/* Use a stored response if it is recent enough */
+	if(NC_httpcache_fresh(cache)) {
+	    size_t size = 0;
+	    if(NC_httpcache_read(cache,NULL,stream,&size,filetime) == NC_NOERR) {
+		if(sizep != NULL) *sizep = (off_t)size;
+		return OCTHROW(stat);
+	    }
+	}
 
 	/* Set the URL */
 	cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_URL, (void*)url));
@@ -58,7 +69,20 @@ ocfetchurl_file(CURL* curl, const char* url, FILE* stream,
 
 	fetchdata.stream = stream;
 	fetchdata.size = 0;
+	(void)NC_httpcache_prepare(cache,curl);
 	cstat = CURLERR(curl_easy_perform(curl));
+	httpcode = ocfetchhttpcode(curl);
+	if(cache != NULL && cstat != CURLE_OK) {
+	    /* Do not store a failed transfer */
+	    long nocode = 0;
+	    (void)NC_httpcache_complete(cache,curl,&nocode,NULL,NULL,NULL,NULL);
+	} else if(cache != NULL) {
+	    size_t size = fetchdata.size;
+	    notmodified = (httpcode == 304);
+	    if(NC_httpcache_complete(cache,curl,&httpcode,NULL,stream,&size,filetime))
+	        return OCTHROW(OC_EIO);
+	    fetchdata.size = size;
+	}
 
 	if (cstat != CURLE_OK)
 	    goto fail;
@@ -71,7 +95,7 @@ ocfetchurl_file(CURL* curl, const char* url, FILE* stream,
 	    if (sizep != NULL)
 		*sizep = fetchdata.size;
 	    /* Get the last modified time */
-	    if(filetime != NULL)
+	    if(filetime != NULL && !notmodified)
                 cstat = curl_easy_getinfo(curl,CURLINFO_FILETIME,filetime);
             if(cstat != CURLE_OK) goto fail;
 	}
@@ -83,12 +107,19 @@ fail:
 }
 
 OCerror
-ocfetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime)
+ocfetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime, NChttpcache* cache)
 {
 	OCerror stat = OC_NOERR;
 	CURLcode cstat = CURLE_OK;
 	size_t len;
         long httpcode = 0;
+	int notmodified = 0;
+	int partial = 0;
+
+	/* Use a stored response if it is recent enough */
+	if(NC_httpcache_fresh(cache)
+	   && NC_httpcache_read(cache,buf,NULL,NULL,filetime) == NC_NOERR)
+	    return OCTHROW(stat);
 
 	/* Set the URL */
 	cstat = CURLERR(CURLERR(curl_easy_setopt(curl, CURLOPT_URL, (void*)url)));
@@ -108,6 +139,7 @@ ocfetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime)
         /* One last thing; always try to get the last modified time */
 	cstat = CURLERR(curl_easy_setopt(curl, CURLOPT_FILETIME, (long)1));
 
+	(void)NC_httpcache_prepare(cache,curl);
 	cstat = CURLERR(curl_easy_perform(curl));
 
 	if(cstat == CURLE_PARTIAL_FILE) {
@@ -115,13 +147,23 @@ ocfetchurl(CURL* curl, const char* url, NCbytes* buf, long* filetime)
 	    nclog(NCLOGWARN, "curl error: %s; ignored",
 		   curl_easy_strerror(cstat));
 	    cstat = CURLE_OK;
+	    partial = 1;
 	}
         httpcode = ocfetchhttpcode(curl);
+	if(cache != NULL && (cstat != CURLE_OK || partial)) {
+	    /* Do not store a failed or truncated transfer */
+	    long nocode = 0;
+	    (void)NC_httpcache_complete(cache,curl,&nocode,NULL,NULL,NULL,NULL);
+	} else if(cache != NULL) {
+	    notmodified = (httpcode == 304);
+	    if(NC_httpcache_complete(cache,curl,&httpcode,buf,NULL,NULL,filetime))
+		return OCTHROW(OC_EIO);
+	}
 
 	if(cstat != CURLE_OK) goto fail;
 
         /* Get the last modified time */
-	if(filetime != NULL)
+	if(filetime != NULL && !notmodified)
             cstat = CURLERR(curl_easy_getinfo(curl,CURLINFO_FILETIME,filetime));
         if(cstat != CURLE_OK) goto fail;
 
@@ -331,7 +373,7 @@ ocping(const char* url)
 
     /* Try to get the file */
     buf = ncbytesnew();
-    stat = ocfetchurl(curl,url,buf,NULL);
+    stat = ocfetchurl(curl,url,buf,NULL,NULL);
     if(stat == OC_NOERR) {
 	/* Don't trust curl to return an error when request gets 404 */
 	long http_code = 0;
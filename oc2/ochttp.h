@@ -7,8 +7,8 @@
 extern int curlopen(CURL** curlp);
 extern void curlclose(CURL*);
 
-extern OCerror ocfetchurl(CURL*, const char*, NCbytes*, long*);
-extern OCerror ocfetchurl_file(CURL*, const char*, FILE*, off_t*, long*);
+extern OCerror ocfetchurl(CURL*, const char*, NCbytes*, long*, NChttpcache*);
+extern OCerror ocfetchurl_file(CURL*, const char*, FILE*, off_t*, long*, NChttpcache*);
 
 extern long ocfetchhttpcode(CURL* curl);
 
@@ -41,6 +41,7 @@
 
 #include "netcdf.h"
 #include "ncauth.h"
+#include "nchttpcache.h"
 #include "nclist.h"
 #include "ncbytes.h"
 #include "ncuri.h"
@@ -93,6 +93,7 @@ readpacket(OCstate* state, NCURI* url, NCbytes* packet, OCdxd dxd, OCflags ocfla
    const char* suffix = ocdxdextension(dxd);
    char* fetchurl = NULL;
    CURL* curl = state->curl;
+   NChttpcache* cache = NULL;
 
    fileprotocol = (strcmp(url->protocol,"file")==0);
 
@@ -109,12 +110,16 @@ readpacket(OCstate* state, NCURI* url, NCbytes* packet, OCdxd dxd, OCflags ocfla
 	MEMCHECK(fetchurl,OC_ENOMEM);
 	if(ocdebug > 0)
             {fprintf(stderr,"fetch url=%s\n",fetchurl); fflush(stderr);}
-        stat = ocfetchurl(curl,fetchurl,packet,lastmodified);
+	if(NC_httpcache_open(state->auth,fetchurl,&cache))
+	    {stat = OC_ENOMEM; goto done;}
+        stat = ocfetchurl(curl,fetchurl,packet,lastmodified,cache);
 	if(stat)
 	    oc_curl_printerror(state);
 	if(ocdebug > 0)
             {fprintf(stderr,"fetch complete\n"); fflush(stderr);}
     }
+done:
+    NC_httpcache_close(cache);
     free(fetchurl);
 #ifdef OCDEBUG
   {
@@ -130,6 +135,7 @@ readDATADDS(OCstate* state, OCtree* tree, OCflags ocflags)
 {
     int stat = OC_NOERR;
     long lastmod = -1;
+    NChttpcache* cache = NULL;
 
 #ifdef OCDEBUG
 fprintf(stderr,"readDATADDS:\n");
@@ -162,8 +168,11 @@ fprintf(stderr,"readDATADDS:\n");
             MEMCHECK(readurl,OC_ENOMEM);
             if (ocdebug > 0) 
                 {fprintf(stderr, "fetch url=%s\n", readurl);fflush(stderr);}
+            if(NC_httpcache_open(state->auth,readurl,&cache))
+                {free(readurl); return OCTHROW(OC_ENOMEM);}
             stat = ocfetchurl_file(state->curl, readurl, tree->data.file,
-                                   &tree->data.datasize, &lastmod);
+                                   &tree->data.datasize, &lastmod, cache);
+            NC_httpcache_close(cache);
             if(stat == OC_NOERR)
                 state->datalastmodified = lastmod;
             if (ocdebug > 0) 
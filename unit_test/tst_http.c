@@ -0,0 +1,602 @@
+/* This is part of the netCDF package. Copyright 2018 University
+   Corporation for Atmospheric Research/Unidata. See COPYRIGHT file
+   for conditions of use.
+
+   Test the HTTP functions in dhttp.c against a minimal HTTP/1.1
+   server that runs in a child process on the loopback interface:
+   sizes, single and concurrent range reads, servers that ignore the
+   Range header, HTTP errors, reuse of connections across states,
+   opening a classic file with #mode=bytes, the page cache of the
+   HDF5 byte-range driver and the persistent response cache used by
+   DAP2 and DAP4, which must not store truncated responses.
+*/
+
+#include "config.h"
+#include <nc_tests.h>
+#include "err_macros.h"
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "ncbytes.h"
+#include "nclist.h"
+#include "nchttp.h"
+#ifdef USE_HDF5
+#include <hdf5.h>
+/* From libhdf5/H5FDhttp.h */
+EXTERNL herr_t H5Pset_fapl_http(hid_t fapl_id);
+#endif
+#ifdef ENABLE_DAP
+#include "nchttpcache.h"
+#endif
+
+#define DATALEN 3000000
+#define NRANGES 40
+#define MAXCLIENTS 64
+#define REQMAX 8192
+#define FILE_NAME "tst_http.nc"
+#define NX 50000
+#define FILE_NAME4 "tst_http4.nc"
+#define NVARS4 40
+#define NX4 4096
+#define CACHEDIR "tst_http_cache"
+#define ETAGLEN 100000
+#define LASTMODIFIED "Sat, 01 Jan 2022 00:00:00 GMT"
+
+static unsigned char* data = NULL;
+static unsigned char* filedata = NULL;
+static size_t filelen = 0;
+static unsigned char* filedata4 = NULL;
+static size_t filelen4 = 0;
+static int nfile4 = 0;    /* GET requests for FILE_NAME4 */
+static int nconnections = 0;
+static int nfull = 0;     /* complete responses for /etag.bin and /lastmod.bin */
+static int nnotmodified = 0;
+
+static unsigned char
+databyte(size_t i)
+{
+    return (unsigned char)((i * 7) + (i / 251));
+}
+
+/**************************************************/
+/* The server */
+
+static void
+sendall(int fd, const void* buf, size_t len)
+{
+    const char* p = buf;
+    while(len > 0) {
+	ssize_t n = send(fd,p,len,MSG_NOSIGNAL);
+	if(n <= 0) return;
+	p += n; len -= (size_t)n;
+    }
+}
+
+/* Answer one request; return 0 to close the connection */
+static int
+respond(int fd, const char* req)
+{
+    char method[16], path[256], hdr[512];
+    const unsigned char* content = NULL;
+    size_t len = 0, start = 0, end = 0;
+    int ranged = 0, useranges = 1;
+    const char* r;
+    char stats[64];
+
+    if(sscanf(req,"%15s %255s",method,path) != 2) return 0;
+    if(strcmp(path,"/data.bin") == 0) {
+	content = data; len = DATALEN;
+    } else if(strcmp(path,"/norange.bin") == 0) {
+	content = data; len = DATALEN; useranges = 0;
+    } else if(strcmp(path,"/" FILE_NAME) == 0) {
+	content = filedata; len = filelen;
+    } else if(strcmp(path,"/" FILE_NAME4) == 0) {
+	content = filedata4; len = filelen4;
+	if(strcmp(method,"GET") == 0) nfile4++;
+    } else if(strcmp(path,"/stats") == 0) {
+	snprintf(stats,sizeof(stats),"%d %d %d %d",nconnections,nfull,nnotmodified,nfile4);
+	content = (unsigned char*)stats; len = strlen(stats); useranges = 0;
+    } else if(strcmp(path,"/short.bin") == 0) {
+	/* A validated response cut off halfway through the body */
+	snprintf(hdr,sizeof(hdr),"HTTP/1.1 200 OK\r\nContent-Length: %d\r\nETag: \"v1\"\r\n\r\n",ETAGLEN);
+	sendall(fd,hdr,strlen(hdr));
+	sendall(fd,data,ETAGLEN/2);
+	return 0;
+    } else if(strncmp(path,"/etag.bin",9) == 0 || strcmp(path,"/lastmod.bin") == 0) {
+	/* Validated resources; the query, if any, is ignored */
+	int etag = (path[1] == 'e');
+	if(etag ? strstr(req,"If-None-Match: \"v1\"") != NULL
+	        : strstr(req,"If-Modified-Since:") != NULL) {
+	    nnotmodified++;
+	    snprintf(hdr,sizeof(hdr),"HTTP/1.1 304 Not Modified\r\n\r\n");
+	    sendall(fd,hdr,strlen(hdr));
+	    return 1;
+	}
+	nfull++;
+	if(etag)
+	    snprintf(hdr,sizeof(hdr),"HTTP/1.1 200 OK\r\nContent-Length: %d\r\nETag: \"v1\"\r\n\r\n",ETAGLEN);
+	else
+	    snprintf(hdr,sizeof(hdr),"HTTP/1.1 200 OK\r\nContent-Length: %d\r\nLast-Modified: %s\r\n\r\n",ETAGLEN,LASTMODIFIED);
+	sendall(fd,hdr,strlen(hdr));
+	if(strcmp(method,"HEAD") != 0)
+	    sendall(fd,data,ETAGLEN);
+	return 1;
+    } else {
+	snprintf(hdr,sizeof(hdr),"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+	sendall(fd,hdr,strlen(hdr));
+	return 1;
+    }
+    if(useranges && (r = strstr(req,"Range: bytes=")) != NULL) {
+	unsigned long long a, b;
+	if(sscanf(r,"Range: bytes=%llu-%llu",&a,&b) == 2 && a <= b && a < len) {
+	    start = (size_t)a;
+	    end = (b >= len ? len - 1 : (size_t)b);
+	    ranged = 1;
+	}
+    }
+    if(ranged)
+	snprintf(hdr,sizeof(hdr),"HTTP/1.1 206 Partial Content\r\nContent-Length: %lu\r\n"
+		 "Content-Range: bytes %lu-%lu/%lu\r\nAccept-Ranges: bytes\r\n\r\n",
+		 (unsigned long)(end-start+1),(unsigned long)start,(unsigned long)end,
+		 (unsigned long)len);
+    else {
+	snprintf(hdr,sizeof(hdr),"HTTP/1.1 200 OK\r\nContent-Length: %lu\r\n\r\n",(unsigned long)len);
+	start = 0; end = len - 1;
+    }
+    sendall(fd,hdr,strlen(hdr));
+    if(strcmp(method,"HEAD") != 0)
+	sendall(fd,content+start,end-start+1);
+    return 1;
+}
+
+/* Serve connections on lfd until pfd, the read end of a pipe from
+   the test, is closed; so the server never outlives the test */
+static void
+serve(int lfd, int pfd)
+{
+    struct pollfd fds[MAXCLIENTS+2];
+    char* bufs[MAXCLIENTS+2];
+    size_t lens[MAXCLIENTS+2];
+    int nfds = 2, i;
+
+    fds[0].fd = lfd; fds[0].events = POLLIN;
+    fds[1].fd = pfd; fds[1].events = POLLIN;
+    for(;;) {
+	if(poll(fds,(nfds_t)nfds,-1) < 0) continue;
+	if(fds[1].revents) return;
+	if((fds[0].revents & POLLIN) && nfds < MAXCLIENTS+2) {
+	    int cfd = accept(lfd,NULL,NULL);
+	    if(cfd >= 0) {
+		nconnections++;
+		fds[nfds].fd = cfd; fds[nfds].events = POLLIN; fds[nfds].revents = 0;
+		bufs[nfds] = malloc(REQMAX); lens[nfds] = 0;
+		nfds++;
+	    }
+	}
+	for(i=2;i<nfds;i++) {
+	    ssize_t n;
+	    char* eoh;
+	    int keep = 1;
+	    if(!(fds[i].revents & (POLLIN|POLLHUP|POLLERR))) continue;
+	    n = recv(fds[i].fd,bufs[i]+lens[i],REQMAX-1-lens[i],0);
+	    if(n <= 0) keep = 0;
+	    else {
+		lens[i] += (size_t)n;
+		bufs[i][lens[i]] = '\0';
+		/* Answer every complete request in the buffer */
+		while(keep && (eoh = strstr(bufs[i],"\r\n\r\n")) != NULL) {
+		    size_t used = (size_t)(eoh + 4 - bufs[i]);
+		    *eoh = '\0';
+		    keep = respond(fds[i].fd,bufs[i]);
+		    memmove(bufs[i],bufs[i]+used,lens[i]-used+1);
+		    lens[i] -= used;
+		}
+		if(lens[i] >= REQMAX-1) keep = 0;
+	    }
+	    if(!keep) {
+		close(fds[i].fd);
+		free(bufs[i]);
+		fds[i] = fds[nfds-1]; bufs[i] = bufs[nfds-1]; lens[i] = lens[nfds-1];
+		nfds--; i--;
+	    }
+	}
+    }
+}
+
+/**************************************************/
+
+/* Return the server's count of connections, complete validated
+   responses, 304 responses or requests for FILE_NAME4 */
+static int
+getstats(NC_HTTP_STATE* state, const char* base, int which)
+{
+    char url[256];
+    NCbytes* buf = ncbytesnew();
+    int n[4] = {-1,-1,-1,-1};
+    snprintf(url,sizeof(url),"%s/stats",base);
+    if(nc_http_read(state,url,0,1,buf) == NC_NOERR) {
+	ncbytesnull(buf);
+	sscanf(ncbytescontents(buf),"%d %d %d %d",&n[0],&n[1],&n[2],&n[3]);
+    }
+    ncbytesfree(buf);
+    return n[which];
+}
+
+static unsigned char*
+loadfile(const char* name, size_t* lenp)
+{
+    FILE* f;
+    unsigned char* content = NULL;
+    if((f = fopen(name,"rb")) == NULL) return NULL;
+    fseek(f,0,SEEK_END);
+    *lenp = (size_t)ftell(f);
+    fseek(f,0,SEEK_SET);
+    if((content = malloc(*lenp)) != NULL && fread(content,1,*lenp,f) != *lenp)
+	{free(content); content = NULL;}
+    fclose(f);
+    return content;
+}
+
+#ifdef USE_HDF5
+/* Open url with the HDF5 byte-range driver and check every dataset;
+   return the number of requests it took */
+static int
+h5read(NC_HTTP_STATE* state, const char* base)
+{
+    char url[256], name[32];
+    hid_t fapl, fid, did;
+    int ivals[NX4];
+    int v, i, n0, ok = 1;
+
+    snprintf(url,sizeof(url),"%s/%s",base,FILE_NAME4);
+    n0 = getstats(state,base,3);
+    if((fapl = H5Pcreate(H5P_FILE_ACCESS)) < 0) return -1;
+    if(H5Pset_fapl_http(fapl) < 0) return -1;
+    if((fid = H5Fopen(url,H5F_ACC_RDONLY,fapl)) < 0) return -1;
+    for(v=0;v<NVARS4;v++) {
+	snprintf(name,sizeof(name),"v%d",v);
+	if((did = H5Dopen2(fid,name,H5P_DEFAULT)) < 0) {ok = 0; break;}
+	if(H5Dread(did,H5T_NATIVE_INT,H5S_ALL,H5S_ALL,H5P_DEFAULT,ivals) < 0) ok = 0;
+	for(i=0;i<NX4;i++)
+	    if(ivals[i] != v*1000+i) ok = 0;
+	H5Dclose(did);
+    }
+    H5Fclose(fid);
+    H5Pclose(fapl);
+    return (ok ? getstats(state,base,3) - n0 : -1);
+}
+#endif
+
+#ifdef ENABLE_DAP
+static size_t
+WriteCallback(void *ptr, size_t size, size_t nmemb, void *data)
+{
+    ncbytesappendn((NCbytes*)data,ptr,size*nmemb);
+    return size*nmemb;
+}
+
+/* Fetch url the way the DAP code does, through the response cache */
+static int
+cachedfetch(const NCauth* auth, CURL* curl, const char* url, NCbytes* buf)
+{
+    int stat = NC_NOERR;
+    NChttpcache* cache = NULL;
+    long httpcode = 0;
+
+    ncbytesclear(buf);
+    if((stat = NC_httpcache_open(auth,url,&cache))) return stat;
+    if(cache == NULL) return NC_EINTERNAL;
+    if(NC_httpcache_fresh(cache))
+	stat = NC_httpcache_read(cache,buf,NULL,NULL,NULL);
+    else {
+	curl_easy_setopt(curl,CURLOPT_URL,url);
+	curl_easy_setopt(curl,CURLOPT_WRITEFUNCTION,WriteCallback);
+	curl_easy_setopt(curl,CURLOPT_WRITEDATA,(void*)buf);
+	curl_easy_setopt(curl,CURLOPT_FILETIME,1L);
+	if((stat = NC_httpcache_prepare(cache,curl)) == NC_NOERR
+	   && curl_easy_perform(curl) != CURLE_OK)
+	    stat = NC_ECURL;
+	if(stat == NC_NOERR)
+	    curl_easy_getinfo(curl,CURLINFO_RESPONSE_CODE,&httpcode);
+	if(NC_httpcache_complete(cache,curl,&httpcode,buf,NULL,NULL,NULL) && !stat)
+	    stat = NC_EIO;
+	if(!stat && httpcode != 200) stat = NC_ECURL;
+    }
+    NC_httpcache_close(cache);
+    return stat;
+}
+
+static int
+isfresh(const NCauth* auth, const char* url)
+{
+    NChttpcache* cache = NULL;
+    int fresh;
+    if(NC_httpcache_open(auth,url,&cache)) return -1;
+    fresh = NC_httpcache_fresh(cache);
+    NC_httpcache_close(cache);
+    return fresh;
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    int lfd, one = 1, pipefd[2];
+    pid_t pid;
+    char base[128], url[256], norange[256];
+    size_t i;
+
+    printf("\n*** Testing HTTP access through dhttp.c.\n");
+    if((data = malloc(DATALEN)) == NULL) ERR;
+    for(i=0;i<DATALEN;i++) data[i] = databyte(i);
+
+    /* Create a classic file to serve */
+    {
+	int ncid, dimid, varid;
+	int* ivals = malloc(sizeof(int)*NX);
+	for(i=0;i<NX;i++) ivals[i] = (int)(3*i) - 7;
+	if(nc_create(FILE_NAME, NC_CLOBBER, &ncid)) ERR;
+	if(nc_def_dim(ncid, "x", NX, &dimid)) ERR;
+	if(nc_def_var(ncid, "v", NC_INT, 1, &dimid, &varid)) ERR;
+	if(nc_enddef(ncid)) ERR;
+	if(nc_put_var_int(ncid, varid, ivals)) ERR;
+	if(nc_close(ncid)) ERR;
+	free(ivals);
+	if((filedata = loadfile(FILE_NAME,&filelen)) == NULL) ERR;
+    }
+#ifdef USE_HDF5
+    /* and a netCDF-4 file with many small variables */
+    {
+	int ncid, dimid, varid, v;
+	int ivals[NX4];
+	char name[32];
+	if(nc_create(FILE_NAME4, NC_CLOBBER|NC_NETCDF4, &ncid)) ERR;
+	if(nc_def_dim(ncid, "x", NX4, &dimid)) ERR;
+	for(v=0;v<NVARS4;v++) {
+	    snprintf(name,sizeof(name),"v%d",v);
+	    if(nc_def_var(ncid, name, NC_INT, 1, &dimid, &varid)) ERR;
+	    if(nc_put_att_text(ncid, varid, "long_name", strlen(name), name)) ERR;
+	    if(nc_put_att_int(ncid, varid, "valid_min", NC_INT, 1, &v)) ERR;
+	}
+	if(nc_enddef(ncid)) ERR;
+	for(v=0;v<NVARS4;v++) {
+	    for(i=0;i<NX4;i++) ivals[i] = v*1000+(int)i;
+	    if(nc_put_var_int(ncid, v, ivals)) ERR;
+	}
+	if(nc_close(ncid)) ERR;
+	if((filedata4 = loadfile(FILE_NAME4,&filelen4)) == NULL) ERR;
+    }
+#endif
+
+    /* Start the server on an ephemeral port */
+    if((lfd = socket(AF_INET,SOCK_STREAM,0)) < 0) ERR;
+    (void)setsockopt(lfd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+    memset(&addr,0,sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if(bind(lfd,(struct sockaddr*)&addr,sizeof(addr))) ERR;
+    if(listen(lfd,MAXCLIENTS)) ERR;
+    if(getsockname(lfd,(struct sockaddr*)&addr,&addrlen)) ERR;
+    snprintf(base,sizeof(base),"http://127.0.0.1:%d",(int)ntohs(addr.sin_port));
+    snprintf(url,sizeof(url),"%s/data.bin",base);
+    snprintf(norange,sizeof(norange),"%s/norange.bin",base);
+    fflush(stdout);
+    if(pipe(pipefd)) ERR;
+    if((pid = fork()) < 0) ERR;
+    if(pid == 0) {close(pipefd[1]); serve(lfd,pipefd[0]); _exit(0);}
+    close(pipefd[0]);
+    close(lfd);
+
+    printf("*** testing size and a single range read...");
+    {
+	NC_HTTP_STATE* state = NULL;
+	long long size = 0;
+	NCbytes* buf = ncbytesnew();
+	if(nc_http_init(&state)) ERR;
+	if(nc_http_size(state,url,&size)) ERR;
+	if(size != DATALEN) ERR;
+	if(nc_http_read(state,url,12345,1000,buf)) ERR;
+	if(ncbyteslength(buf) != 1000) ERR;
+	if(memcmp(ncbytescontents(buf),data+12345,1000)) ERR;
+	ncbytesfree(buf);
+	if(nc_http_close(state)) ERR;
+    }
+    SUMMARIZE_ERR;
+
+    printf("*** testing concurrent range reads...");
+    {
+	NC_HTTP_STATE* state = NULL;
+	NC_HTTP_RANGE ranges[NRANGES];
+	size_t starts[NRANGES], counts[NRANGES];
+
+	if(nc_http_init(&state)) ERR;
+	for(i=0;i<NRANGES;i++) {
+	    starts[i] = (i * 73771) % (DATALEN - 100000);
+	    counts[i] = 1 + (i * 9973) % 90000;
+	    ranges[i].url = url;
+	    ranges[i].start = starts[i];
+	    ranges[i].count = counts[i];
+	    ranges[i].buf = ncbytesnew();
+	    ranges[i].httpcode = -1;
+	}
+	ranges[3].count = counts[3] = 0;      /* skipped */
+	ranges[7].url = norange;              /* Range is ignored */
+	ranges[NRANGES-1].start = starts[NRANGES-1] = DATALEN - 10; /* past the end */
+	ranges[NRANGES-1].count = 100; counts[NRANGES-1] = 10;
+	if(nc_http_read_ranges(state,NRANGES,ranges)) ERR;
+	for(i=0;i<NRANGES;i++) {
+	    if(ncbyteslength(ranges[i].buf) != counts[i]) ERR;
+	    if(counts[i] > 0 && memcmp(ncbytescontents(ranges[i].buf),data+starts[i],counts[i])) ERR;
+	    if(counts[i] > 0 && ranges[i].httpcode != (i == 7 ? 200 : 206)) ERR;
+	    ncbytesfree(ranges[i].buf);
+	}
+
+	/* An HTTP error fails the call and is reported per range */
+	snprintf(norange,sizeof(norange),"%s/missing",base);
+	ranges[0].url = url; ranges[0].start = 0; ranges[0].count = 10; ranges[0].buf = ncbytesnew();
+	ranges[1].url = norange; ranges[1].start = 0; ranges[1].count = 10; ranges[1].buf = ncbytesnew();
+	if(nc_http_read_ranges(state,2,ranges) != NC_ECURL) ERR;
+	if(ranges[1].httpcode != 404) ERR;
+	ncbytesfree(ranges[0].buf);
+	ncbytesfree(ranges[1].buf);
+	if(nc_http_read_ranges(state,0,NULL)) ERR;
+	if(nc_http_close(state)) ERR;
+    }
+    SUMMARIZE_ERR;
+
+    printf("*** testing connection reuse across states...");
+    {
+	NC_HTTP_STATE* s1 = NULL;
+	NC_HTTP_STATE* s2 = NULL;
+	NCbytes* buf = ncbytesnew();
+	int n1, n2;
+	if(nc_http_init(&s1)) ERR;
+	n1 = getstats(s1,base,0);
+	if(n1 <= 0) ERR;
+	if(nc_http_close(s1)) ERR;
+	for(i=0;i<6;i++) {
+	    NC_HTTP_STATE* s = NULL;
+	    if(nc_http_init(&s)) ERR;
+	    ncbytesclear(buf);
+	    if(nc_http_read(s,url,i*1000,1000,buf)) ERR;
+	    if(memcmp(ncbytescontents(buf),data+i*1000,1000)) ERR;
+	    if(nc_http_close(s)) ERR;
+	}
+	if(nc_http_init(&s2)) ERR;
+	n2 = getstats(s2,base,0);
+	if(nc_http_close(s2)) ERR;
+	/* Every request used an existing connection */
+	if(n2 != n1) ERR;
+	ncbytesfree(buf);
+    }
+    SUMMARIZE_ERR;
+
+    printf("*** testing nc_open with #mode=bytes...");
+    {
+	int ncid, varid;
+	int* ivals = malloc(sizeof(int)*NX);
+	char fileurl[256];
+	snprintf(fileurl,sizeof(fileurl),"%s/%s#mode=bytes",base,FILE_NAME);
+	if(nc_open(fileurl, NC_NOWRITE, &ncid)) ERR;
+	if(nc_inq_varid(ncid, "v", &varid)) ERR;
+	if(nc_get_var_int(ncid, varid, ivals)) ERR;
+	for(i=0;i<NX;i++)
+	    if(ivals[i] != (int)(3*i) - 7) ERR;
+	if(nc_close(ncid)) ERR;
+	free(ivals);
+    }
+    SUMMARIZE_ERR;
+
+#ifdef USE_HDF5
+    printf("*** testing the page cache of the HDF5 byte-range driver...");
+    {
+	NC_HTTP_STATE* state = NULL;
+	int nuncached, ncached, nprefetch;
+	if(nc_http_init(&state)) ERR;
+	if(nc_rc_set("HTTP.PAGECACHE.SIZE","0")) ERR;
+	if((nuncached = h5read(state,base)) <= 0) ERR;
+	if(nc_rc_set("HTTP.PAGECACHE.SIZE","16777216")) ERR;
+	if((ncached = h5read(state,base)) <= 0) ERR;
+	/* One request covers the whole (small) file */
+	if(nc_rc_set("HTTP.PAGECACHE.PREFETCH","1048576")) ERR;
+	if((nprefetch = h5read(state,base)) <= 0) ERR;
+	if(ncached >= nuncached) ERR;
+	if(filelen4 <= 1048576 && nprefetch != 1) ERR;
+	if(nc_rc_set("HTTP.PAGECACHE.PREFETCH","0")) ERR;
+	if(nc_http_close(state)) ERR;
+    }
+    SUMMARIZE_ERR;
+#endif
+
+#ifdef ENABLE_DAP
+    printf("*** testing the persistent response cache...");
+    {
+	NCauth auth;
+	NC_HTTP_STATE* state = NULL;
+	CURL* curl = curl_easy_init();
+	NCbytes* buf = ncbytesnew();
+	char etagurl[256], lastmodurl[256], otherurl[256], shorturl[256];
+	int full, notmod;
+	FILE* f;
+	size_t size = 0;
+
+	snprintf(etagurl,sizeof(etagurl),"%s/etag.bin",base);
+	snprintf(lastmodurl,sizeof(lastmodurl),"%s/lastmod.bin",base);
+	snprintf(otherurl,sizeof(otherurl),"%s/etag.bin?x,y[0:1:9]",base);
+	snprintf(shorturl,sizeof(shorturl),"%s/short.bin",base);
+	if(system("rm -rf " CACHEDIR)) ERR;
+	memset(&auth,0,sizeof(auth));
+	auth.cache.dir = CACHEDIR;
+	auth.cache.maxsize = 1000000;
+	if(curl == NULL) ERR;
+	if(nc_http_init(&state)) ERR;
+	full = getstats(state,base,1);
+	notmod = getstats(state,base,2);
+
+	/* The first fetch is stored; the second revalidates with the ETag */
+	if(cachedfetch(&auth,curl,etagurl,buf)) ERR;
+	if(ncbyteslength(buf) != ETAGLEN || memcmp(ncbytescontents(buf),data,ETAGLEN)) ERR;
+	if(getstats(state,base,1) != full+1) ERR;
+	if(cachedfetch(&auth,curl,etagurl,buf)) ERR;
+	if(ncbyteslength(buf) != ETAGLEN || memcmp(ncbytescontents(buf),data,ETAGLEN)) ERR;
+	if(getstats(state,base,1) != full+1 || getstats(state,base,2) != notmod+1) ERR;
+
+	/* Last-Modified also works as a validator */
+	if(cachedfetch(&auth,curl,lastmodurl,buf)) ERR;
+	if(cachedfetch(&auth,curl,lastmodurl,buf)) ERR;
+	if(ncbyteslength(buf) != ETAGLEN || memcmp(ncbytescontents(buf),data,ETAGLEN)) ERR;
+	if(getstats(state,base,1) != full+2 || getstats(state,base,2) != notmod+2) ERR;
+
+	/* Within maxage there is no request at all */
+	auth.cache.maxage = 3600;
+	if(cachedfetch(&auth,curl,etagurl,buf)) ERR;
+	if(ncbyteslength(buf) != ETAGLEN || memcmp(ncbytescontents(buf),data,ETAGLEN)) ERR;
+	if(getstats(state,base,1) != full+2 || getstats(state,base,2) != notmod+2) ERR;
+	{
+	    NChttpcache* cache = NULL;
+	    if(NC_httpcache_open(&auth,etagurl,&cache)) ERR;
+	    if((f = tmpfile()) == NULL) ERR;
+	    if(NC_httpcache_read(cache,NULL,f,&size,NULL)) ERR;
+	    if(size != ETAGLEN || ftell(f) != ETAGLEN) ERR;
+	    fclose(f);
+	    NC_httpcache_close(cache);
+	}
+
+	/* A truncated response is not stored */
+	if(cachedfetch(&auth,curl,shorturl,buf) == NC_NOERR) ERR;
+	if(isfresh(&auth,shorturl) != 0) ERR;
+
+	/* The constraint is part of the key, and the least recently used
+	   responses are evicted once the cache is full */
+	if(isfresh(&auth,otherurl) != 0) ERR;
+	auth.cache.maxsize = ETAGLEN + ETAGLEN/2;
+	if(cachedfetch(&auth,curl,otherurl,buf)) ERR;
+	if(getstats(state,base,1) != full+3) ERR;
+	if(isfresh(&auth,otherurl) != 1) ERR;
+	if(isfresh(&auth,etagurl) != 0) ERR;
+	if(isfresh(&auth,lastmodurl) != 0) ERR;
+
+	if(nc_http_close(state)) ERR;
+	ncbytesfree(buf);
+	curl_easy_cleanup(curl);
+    }
+    SUMMARIZE_ERR;
+#endif
+
+    close(pipefd[1]);
+    waitpid(pid,NULL,0);
+    free(data);
+    free(filedata);
+    free(filedata4);
+    FINAL_RESULTS;
+}
@@ -0,0 +1,274 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+/**
+Test and time the NCjson parser on large synthetic .zattrs and
+.zmetadata objects. Any files named on the command line are also
+parsed and timed.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "netcdf.h"
+#include "ncjson.h"
+#include "ncbytes.h"
+
+#include "timer_utils.h"
+
+/* # of values in the big coordinate attribute */
+#define NCOORDS 200000
+/* # of small attributes */
+#define NATTS 2000
+/* # of variables in the consolidated metadata */
+#define NVARS 5000
+
+/* Approximate average times per element; if we get out of
+   this range, then something is drastically wrong */
+static const struct TimeRange parserange = {0,10000};
+static const struct TimeRange lookuprange = {0,10000};
+
+static Nanotime parsetime[2];
+static Nanotime lookuptime[2];
+
+static int nerrs = 0;
+
+#define CHECK(expr) check((expr),#expr,__LINE__)
+static void
+check(int ok, const char* expr, int line)
+{
+    if(!ok) {
+	fprintf(stderr,"%d: check failed: %s\n",line,expr);
+	nerrs++;
+    }
+}
+
+/* Build a .zattrs with a big coordinate array and many small attributes */
+static char*
+buildzattrs(void)
+{
+    int i;
+    char tmp[256];
+    char* text = NULL;
+    NCbytes* buf = ncbytesnew();
+
+    ncbytescat(buf,"{\n  \"_ARRAY_DIMENSIONS\": [\"time\", \"lat\", \"lon\"],\n");
+    ncbytescat(buf,"  \"title\": \"quote\\\" backslash\\\\ newline\\n tab\\t\",\n");
+    ncbytescat(buf,"  \"coordinates\": [");
+    for(i=0;i<NCOORDS;i++) {
+	snprintf(tmp,sizeof(tmp),"%s%d.25",(i==0?"":", "),i);
+	ncbytescat(buf,tmp);
+    }
+    ncbytescat(buf,"],\n");
+    for(i=0;i<NATTS;i++) {
+	snprintf(tmp,sizeof(tmp),"  \"att%d\": %d,\n",i,i);
+	ncbytescat(buf,tmp);
+    }
+    ncbytescat(buf,"  \"flag\": true, \"nothing\": null, \"missing\": -1e+30\n}\n");
+    text = ncbytesextract(buf);
+    ncbytesfree(buf);
+    return text;
+}
+
+/* Build a .zmetadata for many variables */
+static char*
+buildzmetadata(void)
+{
+    int i;
+    char tmp[1024];
+    char* text = NULL;
+    NCbytes* buf = ncbytesnew();
+
+    ncbytescat(buf,"{\n  \"metadata\": {\n    \".zgroup\": {\"zarr_format\": 2}");
+    for(i=0;i<NVARS;i++) {
+	snprintf(tmp,sizeof(tmp),
+	    ",\n    \"var%d/.zarray\": {\"chunks\": [100, 100], \"compressor\": {\"id\": \"zlib\", \"level\": 1},"
+	    " \"dtype\": \"<f8\", \"fill_value\": \"NaN\", \"filters\": null, \"order\": \"C\","
+	    " \"shape\": [1000, %d], \"zarr_format\": 2}"
+	    ",\n    \"var%d/.zattrs\": {\"_ARRAY_DIMENSIONS\": [\"y\", \"x%d\"], \"units\": \"m\"}",
+	    i,i,i,i);
+	ncbytescat(buf,tmp);
+    }
+    ncbytescat(buf,"\n  },\n  \"zarr_consolidated_format\": 1\n}\n");
+    text = ncbytesextract(buf);
+    ncbytesfree(buf);
+    return text;
+}
+
+static void
+testzattrs(void)
+{
+    int i;
+    char* text = buildzattrs();
+    char* text2 = NULL;
+    char key[64];
+    NCjson* json = NULL;
+    NCjson* json2 = NULL;
+    NCjson* jvalue = NULL;
+    struct NCJconst cvt = NCJconst_empty;
+
+    fprintf(stderr,".zattrs: %u bytes\n",(unsigned)strlen(text));
+    NCT_marktime(&parsetime[0]);
+    CHECK(NCJparse(text,0,&json) == 0);
+    NCT_marktime(&parsetime[1]);
+    NCT_reporttime(NCOORDS+NATTS, parsetime, parserange, "parse");
+    if(json == NULL) goto done;
+
+    CHECK(NCJdictget(json,"coordinates",&jvalue) == 0);
+    CHECK(jvalue != NULL && NCJsort(jvalue) == NCJ_ARRAY && NCJlength(jvalue) == NCOORDS);
+    if(jvalue != NULL) {
+	CHECK(NCJsort(NCJith(jvalue,7)) == NCJ_DOUBLE);
+	CHECK(strcmp(NCJstring(NCJith(jvalue,7)),"7.25")==0);
+    }
+    CHECK(NCJdictget(json,"title",&jvalue) == 0);
+    CHECK(jvalue != NULL && strcmp(NCJstring(jvalue),"quote\" backslash\\ newline\n tab\t")==0);
+    CHECK(NCJdictget(json,"flag",&jvalue) == 0 && jvalue != NULL && NCJsort(jvalue) == NCJ_BOOLEAN);
+    CHECK(NCJdictget(json,"nothing",&jvalue) == 0 && jvalue != NULL && NCJsort(jvalue) == NCJ_NULL);
+    CHECK(NCJdictget(json,"missing",&jvalue) == 0 && jvalue != NULL && NCJsort(jvalue) == NCJ_DOUBLE);
+    CHECK(NCJdictget(json,"nosuchkey",&jvalue) == 0 && jvalue == NULL);
+
+    NCT_marktime(&lookuptime[0]);
+    for(i=0;i<NATTS;i++) {
+	snprintf(key,sizeof(key),"att%d",i);
+	jvalue = NULL;
+	CHECK(NCJdictget(json,key,&jvalue) == 0 && jvalue != NULL && NCJsort(jvalue) == NCJ_INT);
+	if(jvalue == NULL) continue;
+	CHECK(NCJcvt(jvalue,NCJ_INT,&cvt) == 0 && cvt.ival == i);
+    }
+    NCT_marktime(&lookuptime[1]);
+    NCT_reporttime(NATTS, lookuptime, lookuprange, "lookup");
+
+    /* Modify the parsed tree, then round trip it */
+    CHECK(NCJnewstring(NCJ_STRING,"new",&json2) == 0);
+    CHECK(NCJinsert(json,"added",json2) == 0);
+    json2 = NULL;
+    CHECK(NCJdictget(json,"added",&jvalue) == 0 && jvalue != NULL && strcmp(NCJstring(jvalue),"new")==0);
+    CHECK(NCJdictget(json,"att5",&jvalue) == 0 && jvalue != NULL && strcmp(NCJstring(jvalue),"5")==0);
+    CHECK(NCJunparse(json,0,&text2) == 0);
+    CHECK(NCJparse(text2,0,&json2) == 0);
+    CHECK(json2 != NULL && NCJlength(json2) == NCJlength(json));
+    CHECK(NCJdictget(json2,"title",&jvalue) == 0);
+    CHECK(jvalue != NULL && strcmp(NCJstring(jvalue),"quote\" backslash\\ newline\n tab\t")==0);
+
+done:
+    NCJreclaim(json);
+    NCJreclaim(json2);
+    free(text);
+    free(text2);
+}
+
+static void
+testzmetadata(void)
+{
+    int i;
+    char* text = buildzmetadata();
+    char key[64];
+    NCjson* json = NULL;
+    NCjson* jmeta = NULL;
+    NCjson* jvalue = NULL;
+    NCjson* jclone = NULL;
+
+    fprintf(stderr,".zmetadata: %u bytes\n",(unsigned)strlen(text));
+    NCT_marktime(&parsetime[0]);
+    CHECK(NCJparse(text,0,&json) == 0);
+    NCT_marktime(&parsetime[1]);
+    NCT_reporttime(2*NVARS, parsetime, parserange, "parse");
+    if(json == NULL) goto done;
+
+    CHECK(NCJdictget(json,"metadata",&jmeta) == 0 && jmeta != NULL);
+    if(jmeta == NULL) goto done;
+    CHECK(NCJlength(jmeta) == 2*(2*NVARS+1));
+
+    NCT_marktime(&lookuptime[0]);
+    for(i=0;i<NVARS;i++) {
+	NCjson* jshape = NULL;
+	snprintf(key,sizeof(key),"var%d/.zarray",i);
+	jvalue = NULL;
+	CHECK(NCJdictget(jmeta,key,&jvalue) == 0 && jvalue != NULL);
+	if(jvalue == NULL) continue;
+	CHECK(NCJdictget(jvalue,"shape",&jshape) == 0 && jshape != NULL && NCJlength(jshape) == 2);
+	if(jshape != NULL) CHECK(atoi(NCJstring(NCJith(jshape,1))) == i);
+    }
+    NCT_marktime(&lookuptime[1]);
+    NCT_reporttime(NVARS, lookuptime, lookuprange, "lookup");
+
+    /* A clone is built with the non-arena build API */
+    CHECK(NCJclone(jmeta,&jclone) == 0 && jclone != NULL);
+    CHECK(NCJdictget(jclone,"var17/.zattrs",&jvalue) == 0 && jvalue != NULL);
+
+done:
+    NCJreclaim(jclone);
+    NCJreclaim(json);
+    free(text);
+}
+
+static void
+testerrors(void)
+{
+    static const char* bad[] = {"", "   ", "{", "[1,2", "{\"a\" 1}", "{\"a\":}", "[,1]",
+				"\"unterminated", "{null: 1}", "[1] 2", NULL};
+    static const char* good[] = {"[]", "{}", "[1,2,]", "{\"a\":1,}", " 17 ", "\"s\"", NULL};
+    const char** p;
+    for(p=bad;*p;p++) {
+	NCjson* json = NULL;
+	if(NCJparse(*p,0,&json) == 0) {
+	    fprintf(stderr,"accepted bad json: |%s|\n",*p);
+	    nerrs++;
+	}
+	NCJreclaim(json);
+    }
+    for(p=good;*p;p++) {
+	NCjson* json = NULL;
+	if(NCJparse(*p,0,&json) != 0 || json == NULL) {
+	    fprintf(stderr,"rejected good json: |%s|\n",*p);
+	    nerrs++;
+	}
+	NCJreclaim(json);
+    }
+}
+
+static void
+parsefile(const char* path)
+{
+    FILE* f = NULL;
+    long len = 0;
+    char* text = NULL;
+    NCjson* json = NULL;
+
+    if((f = fopen(path,"rb")) == NULL) {fprintf(stderr,"cannot open: %s\n",path); nerrs++; return;}
+    fseek(f,0,SEEK_END);
+    len = ftell(f);
+    fseek(f,0,SEEK_SET);
+    if((text = (char*)malloc((size_t)len+1)) == NULL) abort();
+    if(fread(text,1,(size_t)len,f) != (size_t)len) {fprintf(stderr,"cannot read: %s\n",path); nerrs++; goto done;}
+    text[len] = '\0';
+    fprintf(stderr,"%s: %ld bytes\n",path,len);
+    NCT_marktime(&parsetime[0]);
+    if(NCJparsen((size_t)len,text,0,&json) != 0) {fprintf(stderr,"cannot parse: %s\n",path); nerrs++;}
+    NCT_marktime(&parsetime[1]);
+    NCT_reporttime(1, parsetime, parserange, "parse");
+done:
+    NCJreclaim(json);
+    free(text);
+    fclose(f);
+}
+
+int
+main(int argc, char** argv)
+{
+    int i;
+
+    NCT_inittimer();
+    testerrors();
+    testzattrs();
+    testzmetadata();
+    for(i=1;i<argc;i++)
+	parsefile(argv[i]);
+    fprintf(stderr,"%s\n",(nerrs ? "***FAIL" : "***PASS"));
+    return (nerrs ? 1 : 0);
+}